@@ -0,0 +1,164 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <akonadi/qtest_akonadi.h>
+
+#include <Akonadi/Collection>
+#include <Akonadi/Control>
+#include <Akonadi/Item>
+
+#include <KMime/Message>
+
+#include <KArchiveDirectory>
+#include <KTar>
+
+#include <MailCommon/BackupJob>
+
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "testfixtures.cpp"
+
+using namespace Akonadi;
+
+class BackupJobTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+        Akonadi::Control::start();
+
+        const Collection res1 = TestFixtures::topLevelCollection(QStringLiteral("res1"));
+        QVERIFY(res1.isValid());
+
+        // archive
+        //   child1
+        //     grandchild
+        //   child2
+        const QStringList mimeTypes{Collection::mimeType(), KMime::Message::mimeType()};
+        mArchiveRoot = TestFixtures::createCollection(res1, QStringLiteral("archive"), mimeTypes);
+        QVERIFY(mArchiveRoot.isValid());
+        const Collection child1 = TestFixtures::createCollection(mArchiveRoot, QStringLiteral("child1"), mimeTypes);
+        QVERIFY(child1.isValid());
+        const Collection child2 = TestFixtures::createCollection(mArchiveRoot, QStringLiteral("child2"), mimeTypes);
+        QVERIFY(child2.isValid());
+        const Collection grandchild = TestFixtures::createCollection(child1, QStringLiteral("grandchild"), mimeTypes);
+        QVERIFY(grandchild.isValid());
+
+        mFolderPaths = {
+            {mArchiveRoot.id(), QStringLiteral("archive")},
+            {child1.id(), QStringLiteral(".archive.directory/child1")},
+            {child2.id(), QStringLiteral(".archive.directory/child2")},
+            {grandchild.id(), QStringLiteral(".archive.directory/.child1.directory/grandchild")},
+        };
+        const Collection::List folders{mArchiveRoot, child1, child2, grandchild};
+        for (const Collection &folder : folders) {
+            for (int i = 0; i < 5; ++i) {
+                const Item::Id id = TestFixtures::createMessage(folder, QStringLiteral("Message %1").arg(i));
+                QVERIFY(id >= 0);
+                mMessages[folder.id()].append(id);
+            }
+        }
+    }
+
+    void shouldArchiveEachMessageUnderItsFolder()
+    {
+        // One message per fetch job and several of them in flight, so that
+        // results finish while the next batches are still being fetched.
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath(QStringLiteral("archive.tar"));
+        QVERIFY(runBackup(fileName, 1, 4));
+
+        KTar tar(fileName);
+        QVERIFY(tar.open(QIODevice::ReadOnly));
+        for (auto it = mMessages.cbegin(); it != mMessages.cend(); ++it) {
+            const QString curPath = mFolderPaths.value(it.key()) + QLatin1StringView("/cur");
+            const auto cur = dynamic_cast<const KArchiveDirectory *>(tar.directory()->entry(curPath));
+            QVERIFY2(cur, qPrintable(curPath));
+            QCOMPARE(cur->entries().size(), it.value().size());
+            for (const Item::Id id : it.value()) {
+                const KArchiveEntry *entry = cur->entry(QString::number(id));
+                QVERIFY2(entry && entry->isFile(), qPrintable(curPath + u'/' + QString::number(id)));
+            }
+        }
+    }
+
+    void shouldWriteFolderLayout()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath(QStringLiteral("archive.tar"));
+        QVERIFY(runBackup(fileName, 50, 4));
+
+        KTar tar(fileName);
+        QVERIFY(tar.open(QIODevice::ReadOnly));
+        const KArchiveDirectory *root = tar.directory();
+        for (const QString &path : std::as_const(mFolderPaths)) {
+            for (const QString &subdir : {QString(), QStringLiteral("/cur"), QStringLiteral("/new"), QStringLiteral("/tmp")}) {
+                const KArchiveEntry *entry = root->entry(path + subdir);
+                QVERIFY2(entry && entry->isDirectory(), qPrintable(path + subdir));
+            }
+        }
+        // Only folders with children get a subfolder directory
+        QVERIFY(root->entry(QStringLiteral(".archive.directory")));
+        QVERIFY(root->entry(QStringLiteral(".archive.directory/.child1.directory")));
+        QVERIFY(!root->entry(QStringLiteral(".archive.directory/.child2.directory")));
+        QVERIFY(!root->entry(QStringLiteral(".archive.directory/.child1.directory/.grandchild.directory")));
+    }
+
+    void shouldOnlyArchiveRootFolderWhenNotRecursive()
+    {
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath(QStringLiteral("archive.tar"));
+        QVERIFY(runBackup(fileName, 50, 4, false));
+
+        KTar tar(fileName);
+        QVERIFY(tar.open(QIODevice::ReadOnly));
+        const auto cur = dynamic_cast<const KArchiveDirectory *>(tar.directory()->entry(QStringLiteral("archive/cur")));
+        QVERIFY(cur);
+        QCOMPARE(cur->entries().size(), mMessages.value(mArchiveRoot.id()).size());
+        QVERIFY(!tar.directory()->entry(QStringLiteral(".archive.directory")));
+    }
+
+private:
+    bool runBackup(const QString &fileName, int batchSize, int runningFetchJobs, bool recursive = true)
+    {
+        auto job = new MailCommon::BackupJob;
+        job->setRecursive(recursive);
+        job->setRootFolder(mArchiveRoot);
+        job->setSaveLocation(QUrl::fromLocalFile(fileName));
+        job->setArchiveType(MailCommon::BackupJob::Tar);
+        job->setDisplayMessageBox(false);
+        job->setFetchBatchSize(batchSize);
+        job->setMaximumRunningFetchJobs(runningFetchJobs);
+        QSignalSpy doneSpy(job, &MailCommon::BackupJob::backupDone);
+        QSignalSpy errorSpy(job, &MailCommon::BackupJob::error);
+        job->start();
+        if (!QTest::qWaitFor(
+                [&]() {
+                    return doneSpy.count() + errorSpy.count() > 0;
+                },
+                30000)) {
+            qWarning() << "The backup did not finish";
+            return false;
+        }
+        if (!errorSpy.isEmpty()) {
+            qWarning() << errorSpy.constFirst().constFirst().toString();
+            return false;
+        }
+        return true;
+    }
+
+    Collection mArchiveRoot;
+    QHash<Collection::Id, QString> mFolderPaths;
+    QHash<Collection::Id, QList<Item::Id>> mMessages;
+};
+
+QTEST_AKONADIMAIN(BackupJobTest)
+
+#include "backupjobtest.moc"
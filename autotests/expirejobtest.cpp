@@ -0,0 +1,350 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <akonadi/qtest_akonadi.h>
+
+#include <Akonadi/Collection>
+#include <Akonadi/CollectionFetchJob>
+#include <Akonadi/CollectionModifyJob>
+#include <Akonadi/Control>
+#include <Akonadi/Item>
+#include <Akonadi/ItemFetchJob>
+#include <Akonadi/MessageFlags>
+
+#include "collectionpage/attributes/expirecollectionattribute.h"
+#include "collectionpage/attributes/expirecursorattribute.h"
+#include "job/expiredeletejob.h"
+#include "job/expirejob.h"
+#include "job/expiremovejob.h"
+#include <MailCommon/MailKernel>
+#include <PimCommon/BroadcastStatus>
+
+#include <QPointer>
+#include <QSignalSpy>
+#include <QTest>
+#include <QThread>
+
+#include <memory>
+
+#include "dummykernel.cpp"
+#include "testfixtures.cpp"
+
+using namespace Akonadi;
+
+class ExpireJobTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+        Akonadi::Control::start();
+
+        auto kernel = new DummyKernel(this);
+        CommonKernel->registerKernelIf(kernel);
+        CommonKernel->registerSettingsIf(kernel);
+
+        mParent = TestFixtures::topLevelCollection(QStringLiteral("res1"));
+        QVERIFY(mParent.isValid());
+    }
+
+    void cleanup()
+    {
+        MailCommon::ExpireJob::setSearchQueryEnabled(false);
+    }
+
+    void shouldOnlySelectWithSearchQueryWhenEnabled()
+    {
+        QVERIFY(!MailCommon::ExpireJob::searchQueryEnabled());
+        QVERIFY(!MailCommon::ExpireJob::selectsWithSearchQuery(false));
+        QVERIFY(!MailCommon::ExpireJob::selectsWithSearchQuery(true));
+
+        MailCommon::ExpireJob::setSearchQueryEnabled(true);
+        QVERIFY(MailCommon::ExpireJob::selectsWithSearchQuery(false));
+        // Messages without a date are never found by a search
+        QVERIFY(!MailCommon::ExpireJob::selectsWithSearchQuery(true));
+    }
+
+    void shouldExpireOldMessagesByScanning()
+    {
+        // Freshly created messages are not indexed, the scan still finds them
+        const Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("scan"));
+        QVERIFY(folder.isValid());
+        const Item::Id oldId = createMessage(folder, QDateTime::currentDateTime().addYears(-2));
+        const Item::Id recentId = createMessage(folder, QDateTime::currentDateTime());
+        const Item::Id datelessId = createMessage(folder, {});
+        QVERIFY(oldId >= 0 && recentId >= 0 && datelessId >= 0);
+
+        runExpireJob(folder, false);
+        QCOMPARE(itemIds(folder), (QSet<Item::Id>{recentId, datelessId}));
+    }
+
+    void shouldExpireMessagesWithoutDate()
+    {
+        // Even with the search query enabled, these need a full scan
+        MailCommon::ExpireJob::setSearchQueryEnabled(true);
+        const Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("dateless"));
+        QVERIFY(folder.isValid());
+        const Item::Id oldId = createMessage(folder, QDateTime::currentDateTime().addYears(-2));
+        const Item::Id recentId = createMessage(folder, QDateTime::currentDateTime());
+        const Item::Id datelessId = createMessage(folder, {});
+        QVERIFY(oldId >= 0 && recentId >= 0 && datelessId >= 0);
+
+        runExpireJob(folder, true);
+        QCOMPARE(itemIds(folder), (QSet<Item::Id>{recentId}));
+    }
+
+    void shouldResumeAfterCursor()
+    {
+        Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("resume"));
+        QVERIFY(folder.isValid());
+        const Item::Id handledId = createMessage(folder, QDateTime::currentDateTime().addYears(-2));
+        const Item::Id oldId = createMessage(folder, QDateTime::currentDateTime().addYears(-2));
+        QVERIFY(handledId >= 0 && oldId > handledId);
+
+        // An interrupted run already handled the first message
+        folder.attribute<MailCommon::ExpireCursorAttribute>(Collection::AddIfMissing)->setCursor(handledId);
+        runExpireJob(folder, false);
+        QCOMPARE(itemIds(folder), (QSet<Item::Id>{handledId}));
+
+        // The run is complete, the next one starts from the beginning
+        QTRY_VERIFY_WITH_TIMEOUT(!fetchCollection(folder).hasAttribute<MailCommon::ExpireCursorAttribute>(), 10000);
+    }
+
+    void shouldNotOverwriteExpirySettings()
+    {
+        Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("settings"));
+        QVERIFY(folder.isValid());
+        QVERIFY(createMessage(folder, QDateTime::currentDateTime().addYears(-2)) >= 0);
+
+        // Settings stored before the run, then changed while it is running
+        auto stored = folder.attribute<MailCommon::ExpireCollectionAttribute>(Collection::AddIfMissing);
+        stored->setAutoExpire(true);
+        stored->setReadExpireAge(42);
+        stored->setReadExpireUnits(MailCommon::ExpireCollectionAttribute::ExpireWeeks);
+        folder.attribute<MailCommon::ExpireCursorAttribute>(Collection::AddIfMissing)->setCursor(0);
+        auto modifyJob = new CollectionModifyJob(folder);
+        QVERIFY(modifyJob->exec());
+        const std::unique_ptr<MailCommon::ExpireCollectionAttribute> expected(stored->clone());
+
+        runExpireJob(folder, false);
+        QTRY_VERIFY_WITH_TIMEOUT(!fetchCollection(folder).hasAttribute<MailCommon::ExpireCursorAttribute>(), 10000);
+        const Collection result = fetchCollection(folder);
+        QVERIFY(result.hasAttribute<MailCommon::ExpireCollectionAttribute>());
+        QCOMPARE(*result.attribute<MailCommon::ExpireCollectionAttribute>(), *expected);
+    }
+
+    void shouldCancelDeleteBatchesNotSent()
+    {
+        const Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("canceldelete"));
+        QVERIFY(folder.isValid());
+        const QSet<Item::Id> ids = createMessages(folder, 3);
+        QCOMPARE(ids.count(), 3);
+
+        QPointer<ExpireDeleteJob> job = new ExpireDeleteJob;
+        job->setRemovedMsgs(items(ids));
+        QSignalSpy doneSpy(job.data(), &ExpireDeleteJob::expireDeleteDone);
+        job->start();
+        // The session did not send the batch yet
+        job->cancel();
+        job->cancel();
+        QCOMPARE(doneSpy.count(), 1);
+        QTRY_VERIFY(!job);
+        QCOMPARE(itemIds(folder), ids);
+    }
+
+    void shouldCancelMoveBatchesNotSent()
+    {
+        const Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("cancelmove"));
+        const Collection target = TestFixtures::createCollection(mParent, QStringLiteral("cancelmovetarget"));
+        QVERIFY(folder.isValid() && target.isValid());
+        const QSet<Item::Id> ids = createMessages(folder, 3);
+        QCOMPARE(ids.count(), 3);
+
+        QPointer<ExpireMoveJob> job = new ExpireMoveJob;
+        job->setRemovedMsgs(items(ids));
+        job->setMoveToFolder(target);
+        QSignalSpy doneSpy(job.data(), &ExpireMoveJob::expireMovedDone);
+        job->start();
+        job->cancel();
+        job->cancel();
+        QCOMPARE(doneSpy.count(), 1);
+        QTRY_VERIFY(!job);
+        QCOMPARE(itemIds(folder), ids);
+        QVERIFY(itemIds(target).isEmpty());
+    }
+
+    void shouldNotCountQueueWaitInBatchLatency_data()
+    {
+        QTest::addColumn<bool>("move");
+        QTest::newRow("delete") << false;
+        QTest::newRow("move") << true;
+    }
+
+    void shouldNotCountQueueWaitInBatchLatency()
+    {
+        QFETCH(bool, move);
+        const QString name = move ? QStringLiteral("latencymove") : QStringLiteral("latencydelete");
+        const Collection folder = TestFixtures::createCollection(mParent, name);
+        const Collection target = TestFixtures::createCollection(mParent, name + QLatin1StringView("target"));
+        QVERIFY(folder.isValid() && target.isValid());
+        const QSet<Item::Id> ids = createMessages(folder, 3);
+        QCOMPARE(ids.count(), 3);
+
+        int initialBatchSize = 0;
+        int batchSize = 0;
+        int processed = 0;
+        bool done = false;
+        if (move) {
+            auto job = new ExpireMoveJob;
+            job->setRemovedMsgs(items(ids));
+            job->setMoveToFolder(target);
+            initialBatchSize = job->batchSize();
+            connect(job, &ExpireMoveJob::expireMovedDone, this, [&, job]() {
+                batchSize = job->batchSize();
+                processed = job->movedCount();
+                done = true;
+            });
+            job->start();
+        } else {
+            auto job = new ExpireDeleteJob;
+            job->setRemovedMsgs(items(ids));
+            initialBatchSize = job->batchSize();
+            connect(job, &ExpireDeleteJob::expireDeleteDone, this, [&, job]() {
+                batchSize = job->batchSize();
+                processed = job->removedCount();
+                done = true;
+            });
+            job->start();
+        }
+        // The batch waits in the session queue longer than the target
+        // duration, a fast server must still get bigger batches
+        QThread::msleep(1500);
+        QTRY_VERIFY_WITH_TIMEOUT(done, 10000);
+        QCOMPARE(processed, 3);
+        QCOMPARE(batchSize, initialBatchSize * 2);
+    }
+
+    void shouldCancelPageWhenKilled()
+    {
+        Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("kill"));
+        QVERIFY(folder.isValid());
+        QVERIFY(createMessage(folder, QDateTime::currentDateTime().addYears(-2)) >= 0);
+        setExpirySettings(folder, false);
+
+        auto job = new MailCommon::ExpireJob(folder, true);
+        QSignalSpy finishedSpy(job, &MailCommon::FolderJob::finished);
+        QPointer<ExpireDeleteJob> deleteJob;
+        int deleteDone = 0;
+        bool cancellable = false;
+        // Kill the job once the page is being removed
+        connect(
+            PimCommon::BroadcastStatus::instance(),
+            &PimCommon::BroadcastStatus::statusMsg,
+            this,
+            [&]() {
+                if (deleteJob || finishedSpy.count() > 0) {
+                    return;
+                }
+                deleteJob = job->findChild<ExpireDeleteJob *>();
+                if (deleteJob) {
+                    connect(deleteJob.data(), &ExpireDeleteJob::expireDeleteDone, this, [&deleteDone]() {
+                        ++deleteDone;
+                    });
+                    cancellable = job->isCancellable();
+                    job->kill();
+                }
+            },
+            Qt::QueuedConnection);
+        job->start();
+        QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 30000);
+        disconnect(PimCommon::BroadcastStatus::instance(), nullptr, this, nullptr);
+        QVERIFY(cancellable);
+        QCOMPARE(deleteDone, 1);
+        QVERIFY(!deleteJob);
+        // No page was completely handled, the next run starts over
+        QVERIFY(!fetchCollection(folder).hasAttribute<MailCommon::ExpireCursorAttribute>());
+    }
+
+private:
+    static Collection fetchCollection(const Collection &folder)
+    {
+        auto job = new CollectionFetchJob(folder, CollectionFetchJob::Base);
+        if (!job->exec() || job->collections().isEmpty()) {
+            qWarning() << job->errorString();
+            return {};
+        }
+        return job->collections().constFirst();
+    }
+
+    static void setExpirySettings(Collection &folder, bool expireMessagesWithoutDate)
+    {
+        auto attribute = folder.attribute<MailCommon::ExpireCollectionAttribute>(Collection::AddIfMissing);
+        attribute->setAutoExpire(true);
+        attribute->setReadExpireAge(1);
+        attribute->setReadExpireUnits(MailCommon::ExpireCollectionAttribute::ExpireDays);
+        attribute->setUnreadExpireAge(1);
+        attribute->setUnreadExpireUnits(MailCommon::ExpireCollectionAttribute::ExpireDays);
+        attribute->setExpireAction(MailCommon::ExpireCollectionAttribute::ExpireDelete);
+        attribute->setExpireMessagesWithValidDate(expireMessagesWithoutDate);
+    }
+
+    static void runExpireJob(Collection folder, bool expireMessagesWithoutDate)
+    {
+        setExpirySettings(folder, expireMessagesWithoutDate);
+        auto job = new MailCommon::ExpireJob(folder, true);
+        QSignalSpy finishedSpy(job, &MailCommon::FolderJob::finished);
+        job->start();
+        QTRY_COMPARE_WITH_TIMEOUT(finishedSpy.count(), 1, 30000);
+    }
+
+    static QSet<Item::Id> itemIds(const Collection &folder)
+    {
+        QSet<Item::Id> ids;
+        auto job = new ItemFetchJob(folder);
+        if (!job->exec()) {
+            qWarning() << job->errorString();
+            return ids;
+        }
+        const Item::List items = job->items();
+        for (const Item &item : items) {
+            ids.insert(item.id());
+        }
+        return ids;
+    }
+
+    static Item::List items(const QSet<Item::Id> &ids)
+    {
+        Item::List items;
+        for (const Item::Id id : ids) {
+            items.append(Item(id));
+        }
+        return items;
+    }
+
+    static QSet<Item::Id> createMessages(const Collection &collection, int count)
+    {
+        QSet<Item::Id> ids;
+        for (int i = 0; i < count; ++i) {
+            const Item::Id id = createMessage(collection, QDateTime::currentDateTime().addYears(-2));
+            if (id >= 0) {
+                ids.insert(id);
+            }
+        }
+        return ids;
+    }
+
+    static Item::Id createMessage(const Collection &collection, const QDateTime &date)
+    {
+        return TestFixtures::createMessage(collection, QStringLiteral("Expiry"), date, {Akonadi::MessageFlags::Seen});
+    }
+
+    Collection mParent;
+};
+
+QTEST_AKONADIMAIN(ExpireJobTest)
+
+#include "expirejobtest.moc"
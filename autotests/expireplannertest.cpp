@@ -0,0 +1,255 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <akonadi/qtest_akonadi.h>
+
+#include <Akonadi/Collection>
+#include <Akonadi/Control>
+#include <Akonadi/Item>
+#include <Akonadi/ItemFetchJob>
+#include <Akonadi/MessageFlags>
+
+#include "collectionpage/attributes/expirecollectionattribute.h"
+#include "job/expirejob.h"
+#include "job/expireplanner.h"
+#include "job/jobscheduler.h"
+#include <MailCommon/MailKernel>
+
+#include <QPointer>
+#include <QSignalSpy>
+#include <QTest>
+
+#include "dummykernel.cpp"
+#include "testfixtures.cpp"
+
+using namespace Akonadi;
+using MailCommon::ExpireCollectionAttribute;
+using MailCommon::ExpirePlanner;
+
+class ExpirePlannerTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+        Akonadi::Control::start();
+
+        auto kernel = new DummyKernel(this);
+        CommonKernel->registerKernelIf(kernel);
+        CommonKernel->registerSettingsIf(kernel);
+
+        mParent = TestFixtures::topLevelCollection(QStringLiteral("res1"));
+        QVERIFY(mParent.isValid());
+    }
+
+    void init()
+    {
+        mScheduler = new MailCommon::JobScheduler(this);
+        // The tasks registered by the tests must not run
+        mScheduler->pause();
+    }
+
+    void cleanup()
+    {
+        delete mScheduler;
+        mScheduler = nullptr;
+    }
+
+    void shouldReportPlanInDryRun()
+    {
+        Collection deleted = TestFixtures::createCollection(mParent, QStringLiteral("dryrundelete"));
+        Collection moved = TestFixtures::createCollection(mParent, QStringLiteral("dryrunmove"));
+        const Collection target = TestFixtures::createCollection(mParent, QStringLiteral("dryruntarget"));
+        QVERIFY(deleted.isValid() && moved.isValid() && target.isValid());
+        QVERIFY(waitForKernelCollection(target));
+        const QSet<Item::Id> deletedIds{createMessage(deleted, true), createMessage(deleted, true), createMessage(deleted, false)};
+        const QSet<Item::Id> movedIds{createMessage(moved, true), createMessage(moved, false)};
+        QVERIFY(!deletedIds.contains(-1) && !movedIds.contains(-1));
+        setExpirySettings(deleted);
+        setExpirySettings(moved, target);
+
+        const PlannerResult result = runPlanner({deleted, moved}, true);
+        QVERIFY(result.finished);
+        QCOMPARE(result.plans.count(), 2);
+        const ExpirePlanner::FolderPlan &deletePlan = result.plans.at(0);
+        QCOMPARE(deletePlan.collection.id(), deleted.id());
+        QCOMPARE(deletePlan.action, ExpireCollectionAttribute::ExpireDelete);
+        QCOMPARE(deletePlan.targetId, Collection::Id(-1));
+        QCOMPARE(deletePlan.scannedCount, 3);
+        QCOMPARE(deletePlan.messageCount, 2);
+        QVERIFY(deletePlan.size > 0);
+        const ExpirePlanner::FolderPlan &movePlan = result.plans.at(1);
+        QCOMPARE(movePlan.collection.id(), moved.id());
+        QCOMPARE(movePlan.action, ExpireCollectionAttribute::ExpireMove);
+        QCOMPARE(movePlan.targetId, target.id());
+        QCOMPARE(movePlan.scannedCount, 2);
+        QCOMPARE(movePlan.messageCount, 1);
+        QCOMPARE(result.messageCount, 3);
+        QCOMPARE(result.size, deletePlan.size + movePlan.size);
+
+        // Nothing was expired
+        QCOMPARE(itemIds(deleted), deletedIds);
+        QCOMPARE(itemIds(moved), movedIds);
+        QVERIFY(itemIds(target).isEmpty());
+    }
+
+    void shouldExpireFolders()
+    {
+        Collection deleted = TestFixtures::createCollection(mParent, QStringLiteral("expiredelete"));
+        Collection moved = TestFixtures::createCollection(mParent, QStringLiteral("expiremove"));
+        Collection alsoMoved = TestFixtures::createCollection(mParent, QStringLiteral("expirealsomove"));
+        const Collection target = TestFixtures::createCollection(mParent, QStringLiteral("expiretarget"));
+        QVERIFY(deleted.isValid() && moved.isValid() && alsoMoved.isValid() && target.isValid());
+        QVERIFY(waitForKernelCollection(target));
+        QVERIFY(createMessage(deleted, true) >= 0);
+        const Item::Id keptId = createMessage(deleted, false);
+        const Item::Id movedId = createMessage(moved, true);
+        const Item::Id alsoMovedId = createMessage(alsoMoved, true);
+        QVERIFY(keptId >= 0 && movedId >= 0 && alsoMovedId >= 0);
+        setExpirySettings(deleted);
+        setExpirySettings(moved, target);
+        setExpirySettings(alsoMoved, target);
+
+        const PlannerResult result = runPlanner({deleted, moved, alsoMoved}, false);
+        QVERIFY(result.finished);
+        QCOMPARE(result.messageCount, 3);
+        QCOMPARE(itemIds(deleted), QSet<Item::Id>{keptId});
+        QVERIFY(itemIds(moved).isEmpty());
+        QVERIFY(itemIds(alsoMoved).isEmpty());
+        QCOMPARE(itemIds(target), (QSet<Item::Id>{movedId, alsoMovedId}));
+    }
+
+    void shouldSkipFoldersWithExpireTask()
+    {
+        Collection scheduled = TestFixtures::createCollection(mParent, QStringLiteral("scheduled"));
+        Collection free = TestFixtures::createCollection(mParent, QStringLiteral("free"));
+        QVERIFY(scheduled.isValid() && free.isValid());
+        const Item::Id scheduledId = createMessage(scheduled, true);
+        QVERIFY(scheduledId >= 0);
+        QVERIFY(createMessage(free, true) >= 0);
+        setExpirySettings(scheduled);
+        setExpirySettings(free);
+
+        mScheduler->registerTask(new MailCommon::ScheduledExpireTask(scheduled, false));
+        QVERIFY(mScheduler->hasTask(MailCommon::ScheduledExpireTask::TypeId, scheduled));
+        QVERIFY(!mScheduler->hasTask(MailCommon::ScheduledExpireTask::TypeId, free));
+
+        const PlannerResult result = runPlanner({scheduled, free}, false);
+        QVERIFY(result.finished);
+        QCOMPARE(result.plans.count(), 1);
+        QCOMPARE(result.plans.constFirst().collection.id(), free.id());
+        QCOMPARE(itemIds(scheduled), QSet<Item::Id>{scheduledId});
+        QVERIFY(itemIds(free).isEmpty());
+    }
+
+    void shouldCancel()
+    {
+        Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("cancel"));
+        QVERIFY(folder.isValid());
+        const QSet<Item::Id> ids{createMessage(folder, true), createMessage(folder, true)};
+        QVERIFY(!ids.contains(-1));
+        setExpirySettings(folder);
+
+        QPointer<ExpirePlanner> planner = new ExpirePlanner;
+        planner->setJobScheduler(mScheduler);
+        planner->setCollections({folder});
+        QSignalSpy finishedSpy(planner.data(), &ExpirePlanner::finished);
+        planner->start();
+        planner->cancel();
+        planner->cancel();
+        QCOMPARE(finishedSpy.count(), 1);
+        QTRY_VERIFY(!planner);
+        QCOMPARE(itemIds(folder), ids);
+    }
+
+private:
+    struct PlannerResult {
+        QList<ExpirePlanner::FolderPlan> plans;
+        int messageCount = 0;
+        qint64 size = 0;
+        bool finished = false;
+    };
+
+    PlannerResult runPlanner(const Collection::List &collections, bool dryRun) const
+    {
+        PlannerResult result;
+        auto planner = new ExpirePlanner;
+        planner->setJobScheduler(mScheduler);
+        planner->setCollections(collections);
+        planner->setDryRun(dryRun);
+        // The planner deletes itself once finished
+        connect(planner, &ExpirePlanner::finished, planner, [planner, &result]() {
+            result.plans = planner->plans();
+            result.messageCount = planner->messageCount();
+            result.size = planner->size();
+            result.finished = true;
+        });
+        planner->start();
+        if (!QTest::qWaitFor(
+                [&result]() {
+                    return result.finished;
+                },
+                30000)) {
+            qWarning() << "The planner did not finish";
+        }
+        return result;
+    }
+
+    static void setExpirySettings(Collection &folder, const Collection &target = {})
+    {
+        auto attribute = folder.attribute<ExpireCollectionAttribute>(Collection::AddIfMissing);
+        attribute->setAutoExpire(true);
+        attribute->setReadExpireAge(1);
+        attribute->setReadExpireUnits(ExpireCollectionAttribute::ExpireDays);
+        attribute->setUnreadExpireAge(1);
+        attribute->setUnreadExpireUnits(ExpireCollectionAttribute::ExpireDays);
+        if (target.isValid()) {
+            attribute->setExpireAction(ExpireCollectionAttribute::ExpireMove);
+            attribute->setExpireToFolderId(target.id());
+        } else {
+            attribute->setExpireAction(ExpireCollectionAttribute::ExpireDelete);
+        }
+    }
+
+    static bool waitForKernelCollection(const Collection &collection)
+    {
+        // Move targets are looked up in the collection model of the kernel
+        return QTest::qWaitFor(
+            [&collection]() {
+                return CommonKernel->collectionFromId(collection.id()).isValid();
+            },
+            10000);
+    }
+
+    static QSet<Item::Id> itemIds(const Collection &folder)
+    {
+        QSet<Item::Id> ids;
+        auto job = new ItemFetchJob(folder);
+        if (!job->exec()) {
+            qWarning() << job->errorString();
+            return ids;
+        }
+        const Item::List items = job->items();
+        for (const Item &item : items) {
+            ids.insert(item.id());
+        }
+        return ids;
+    }
+
+    static Item::Id createMessage(const Collection &collection, bool old)
+    {
+        const QDateTime date = old ? QDateTime::currentDateTime().addYears(-2) : QDateTime::currentDateTime();
+        return TestFixtures::createMessage(collection, QStringLiteral("Expiry"), date, {Akonadi::MessageFlags::Seen});
+    }
+
+    Collection mParent;
+    MailCommon::JobScheduler *mScheduler = nullptr;
+};
+
+QTEST_AKONADIMAIN(ExpirePlannerTest)
+
+#include "expireplannertest.moc"
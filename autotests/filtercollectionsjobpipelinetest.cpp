@@ -0,0 +1,92 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <akonadi/qtest_akonadi.h>
+
+#include <Akonadi/Collection>
+#include <Akonadi/Control>
+#include <Akonadi/Item>
+#include <Akonadi/ItemFetchJob>
+#include <Akonadi/MessageStatus>
+
+#include "filter/filteractions/filteractionsetstatus.h"
+#include "filter/filtercollectionsjob.h"
+#include "filter/mailfilter.h"
+
+#include <QTest>
+
+#include "testfixtures.cpp"
+
+using namespace Akonadi;
+
+class FilterCollectionsJobPipelineTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+        Akonadi::Control::start();
+
+        mParent = TestFixtures::topLevelCollection(QStringLiteral("res1"));
+        QVERIFY(mParent.isValid());
+    }
+
+    void shouldApplyFiltersOnAllItems()
+    {
+        const Collection folder = TestFixtures::createCollection(mParent, QStringLiteral("pipeline"));
+        QVERIFY(folder.isValid());
+        QSet<Item::Id> reports;
+        QSet<Item::Id> others;
+        for (int i = 0; i < 7; ++i) {
+            const Item::Id reportId = TestFixtures::createMessage(folder, QStringLiteral("Weekly report %1").arg(i));
+            const Item::Id otherId = TestFixtures::createMessage(folder, QStringLiteral("Invoice %1").arg(i));
+            QVERIFY(reportId >= 0 && otherId >= 0);
+            reports.insert(reportId);
+            others.insert(otherId);
+        }
+
+        MailCommon::MailFilter filter;
+        filter.setApplyOnExplicit(true);
+        filter.pattern()->append(MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("report")));
+        auto action = new MailCommon::FilterActionSetStatus;
+        action->argsFromString(QStringLiteral("G"));
+        QVERIFY(!action->isEmpty());
+        filter.actions()->append(action);
+
+        // Several pages, each evaluated on the thread pool while the next one is fetched
+        auto job = new MailCommon::FilterCollectionsJob({folder}, {&filter}, MailCommon::FilterManager::Explicit);
+        job->setPageSize(3);
+        // The job deletes itself once finished
+        qint64 total = -1;
+        qint64 processed = -1;
+        connect(job, &MailCommon::FilterCollectionsJob::finished, this, [&]() {
+            total = job->totalCount();
+            processed = job->processedCount();
+        });
+        job->start();
+        QTRY_VERIFY_WITH_TIMEOUT(processed >= 0, 30000);
+        QCOMPARE(total, reports.count() + others.count());
+        QCOMPARE(processed, reports.count() + others.count());
+
+        auto fetchJob = new ItemFetchJob(folder);
+        QVERIFY(fetchJob->exec());
+        const Item::List items = fetchJob->items();
+        QCOMPARE(items.count(), reports.count() + others.count());
+        for (const Item &item : items) {
+            Akonadi::MessageStatus status;
+            status.setStatusFromFlags(item.flags());
+            QCOMPARE(status.isImportant(), reports.contains(item.id()));
+        }
+    }
+
+private:
+    Collection mParent;
+};
+
+QTEST_AKONADIMAIN(FilterCollectionsJobPipelineTest)
+
+#include "filtercollectionsjobpipelinetest.moc"
@@ -0,0 +1,181 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <akonadi/qtest_akonadi.h>
+
+#include <Akonadi/Collection>
+#include <Akonadi/Control>
+#include <Akonadi/SpecialMailCollections>
+
+#include <KIdentityManagementCore/Identity>
+#include <KIdentityManagementCore/IdentityManager>
+
+#include <MailCommon/MailKernel>
+
+#include <KConfig>
+#include <KConfigGroup>
+
+#include <QSignalSpy>
+#include <QTest>
+
+#include "dummykernel.cpp"
+#include "testfixtures.cpp"
+
+using namespace Akonadi;
+using MailCommon::Kernel;
+
+// The identities of DummyKernel are read-only
+class IdentityKernel : public DummyKernel
+{
+public:
+    explicit IdentityKernel(QObject *parent)
+        : DummyKernel(parent)
+        , mIdentityManager(new KIdentityManagementCore::IdentityManager(false, this))
+    {
+    }
+
+    KIdentityManagementCore::IdentityManager *identityManager() override
+    {
+        return mIdentityManager;
+    }
+
+private:
+    KIdentityManagementCore::IdentityManager *const mIdentityManager;
+};
+
+class FolderRolesTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+
+        // Make the first test resource the one of the default special collections,
+        // before SpecialMailCollections reads its settings
+        KConfig config(QStringLiteral("specialmailcollectionsrc"));
+        config.group(QStringLiteral("SpecialCollections")).writeEntry("DefaultResourceId", QStringLiteral("akonadi_knut_resource_0"));
+        config.sync();
+
+        Akonadi::Control::start();
+
+        mKernel = new IdentityKernel(this);
+        CommonKernel->registerKernelIf(mKernel);
+        CommonKernel->registerSettingsIf(mKernel);
+
+        mParent = TestFixtures::topLevelCollection(QStringLiteral("res1"));
+        QVERIFY(mParent.isValid());
+        for (const QString &name : {QStringLiteral("drafts"),
+                                    QStringLiteral("templates"),
+                                    QStringLiteral("sent"),
+                                    QStringLiteral("spam"),
+                                    QStringLiteral("inbox"),
+                                    QStringLiteral("outbox"),
+                                    QStringLiteral("trash")}) {
+            const Collection collection = TestFixtures::createCollection(mParent, name);
+            QVERIFY(collection.isValid());
+            mFolders.insert(name, collection);
+        }
+
+        // Build the role index, so that the tests check how it is updated
+        QCOMPARE(roles(QStringLiteral("drafts")), Kernel::SpecialFolderRoles(Kernel::NoRole));
+    }
+
+    void shouldFollowIdentityChanges()
+    {
+        QSignalSpy spy(CommonKernel, &Kernel::specialFolderRolesChanged);
+        KIdentityManagementCore::IdentityManager *manager = mKernel->identityManager();
+
+        KIdentityManagementCore::Identity &identity = manager->newFromScratch(QStringLiteral("Folder roles"));
+        identity.setDrafts(folderId(QStringLiteral("drafts")));
+        identity.setTemplates(folderId(QStringLiteral("templates")));
+        identity.setFcc(folderId(QStringLiteral("sent")));
+        identity.setSpam(folderId(QStringLiteral("spam")));
+        const uint uoid = identity.uoid();
+        manager->commit();
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(roles(QStringLiteral("drafts")), Kernel::SpecialFolderRoles(Kernel::DraftsRole));
+        QCOMPARE(roles(QStringLiteral("templates")), Kernel::SpecialFolderRoles(Kernel::TemplatesRole));
+        QCOMPARE(roles(QStringLiteral("sent")), Kernel::SpecialFolderRoles(Kernel::SentMailRole));
+        QCOMPARE(roles(QStringLiteral("spam")), Kernel::SpecialFolderRoles(Kernel::SpamRole));
+        QVERIFY(CommonKernel->folderIsDrafts(mFolders.value(QStringLiteral("drafts"))));
+        QVERIFY(CommonKernel->folderIsSentMailFolder(mFolders.value(QStringLiteral("sent"))));
+        QVERIFY(CommonKernel->folderIsSpams(mFolders.value(QStringLiteral("spam"))));
+
+        // Folders which change roles, or lose them
+        KIdentityManagementCore::Identity &modified = manager->modifyIdentityForUoid(uoid);
+        modified.setDrafts(folderId(QStringLiteral("templates")));
+        modified.setDisabledSpam(true);
+        manager->commit();
+        QCOMPARE(spy.count(), 2);
+        QCOMPARE(roles(QStringLiteral("drafts")), Kernel::SpecialFolderRoles(Kernel::NoRole));
+        QCOMPARE(roles(QStringLiteral("templates")), Kernel::DraftsRole | Kernel::TemplatesRole);
+        QCOMPARE(roles(QStringLiteral("spam")), Kernel::SpecialFolderRoles(Kernel::NoRole));
+        QVERIFY(!CommonKernel->folderIsSpams(mFolders.value(QStringLiteral("spam"))));
+
+        // A change which doesn't touch the folders leaves the index alone
+        manager->modifyIdentityForUoid(uoid).setFullName(QStringLiteral("Someone Else"));
+        manager->commit();
+        QCOMPARE(spy.count(), 2);
+
+        QVERIFY(manager->removeIdentity(QStringLiteral("Folder roles")));
+        manager->commit();
+        QCOMPARE(spy.count(), 3);
+        QCOMPARE(roles(QStringLiteral("templates")), Kernel::SpecialFolderRoles(Kernel::NoRole));
+        QCOMPARE(roles(QStringLiteral("sent")), Kernel::SpecialFolderRoles(Kernel::NoRole));
+    }
+
+    void shouldFollowDefaultCollectionsChanged()
+    {
+        QSignalSpy spy(CommonKernel, &Kernel::specialFolderRolesChanged);
+        SpecialMailCollections *specialCollections = SpecialMailCollections::self();
+
+        QVERIFY(specialCollections->registerCollection(SpecialMailCollections::Inbox, folder(QStringLiteral("inbox"))));
+        QTRY_COMPARE(roles(QStringLiteral("inbox")), Kernel::SpecialFolderRoles(Kernel::InboxRole));
+        QVERIFY(spy.count() >= 1);
+
+        QVERIFY(specialCollections->registerCollection(SpecialMailCollections::Outbox, folder(QStringLiteral("outbox"))));
+        QVERIFY(specialCollections->registerCollection(SpecialMailCollections::Trash, folder(QStringLiteral("trash"))));
+        QTRY_COMPARE(roles(QStringLiteral("outbox")), Kernel::SpecialFolderRoles(Kernel::OutboxRole));
+        QTRY_COMPARE(roles(QStringLiteral("trash")), Kernel::SpecialFolderRoles(Kernel::TrashRole));
+        QVERIFY(CommonKernel->folderIsDraftOrOutbox(mFolders.value(QStringLiteral("outbox"))));
+        QVERIFY(CommonKernel->folderIsTrash(mFolders.value(QStringLiteral("trash"))));
+
+        // Another folder becomes the default inbox
+        QVERIFY(specialCollections->unregisterCollection(folder(QStringLiteral("inbox"))));
+        QVERIFY(specialCollections->registerCollection(SpecialMailCollections::Inbox, folder(QStringLiteral("spam"))));
+        QTRY_COMPARE(roles(QStringLiteral("inbox")), Kernel::SpecialFolderRoles(Kernel::NoRole));
+        QTRY_COMPARE(roles(QStringLiteral("spam")), Kernel::SpecialFolderRoles(Kernel::InboxRole));
+        QCOMPARE(roles(QStringLiteral("outbox")), Kernel::SpecialFolderRoles(Kernel::OutboxRole));
+    }
+
+private:
+    Kernel::SpecialFolderRoles roles(const QString &name) const
+    {
+        return CommonKernel->specialFolderRoles(mFolders.value(name));
+    }
+
+    QString folderId(const QString &name) const
+    {
+        return QString::number(mFolders.value(name).id());
+    }
+
+    // SpecialMailCollections files the folders by resource
+    Collection folder(const QString &name) const
+    {
+        Collection collection = mFolders.value(name);
+        collection.setResource(QStringLiteral("akonadi_knut_resource_0"));
+        return collection;
+    }
+
+    IdentityKernel *mKernel = nullptr;
+    Collection mParent;
+    QHash<QString, Collection> mFolders;
+};
+
+QTEST_AKONADIMAIN(FolderRolesTest)
+
+#include "folderrolestest.moc"
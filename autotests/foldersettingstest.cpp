@@ -0,0 +1,150 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <akonadi/qtest_akonadi.h>
+
+#include <Akonadi/Collection>
+
+#include <MailCommon/FolderSettings>
+#include <MailCommon/MailKernel>
+
+#include <KConfigGroup>
+
+#include <QTest>
+
+#include <thread>
+#include <vector>
+
+#include "dummykernel.cpp"
+
+using namespace Akonadi;
+using MailCommon::FolderSettings;
+
+class FolderSettingsTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+
+        auto kernel = new DummyKernel(this);
+        CommonKernel->registerKernelIf(kernel);
+        CommonKernel->registerSettingsIf(kernel);
+    }
+
+    void cleanup()
+    {
+        FolderSettings::clearCache();
+        FolderSettings::setCacheCapacity(512);
+    }
+
+    void shouldEvictLeastRecentlyUsed()
+    {
+        // A single settings per shard, and both folders in the same shard
+        FolderSettings::setCacheCapacity(1);
+        const Collection first = collection(16);
+        const Collection second = collection(32);
+
+        const quint64 evictions = FolderSettings::cacheEvictionCount();
+        const quint64 misses = FolderSettings::cacheMissCount();
+        const quint64 hits = FolderSettings::cacheHitCount();
+
+        QVERIFY(FolderSettings::forCollection(first));
+        QVERIFY(FolderSettings::forCollection(first));
+        QCOMPARE(FolderSettings::cacheHitCount(), hits + 1);
+        QCOMPARE(FolderSettings::cacheEvictionCount(), evictions);
+
+        QVERIFY(FolderSettings::forCollection(second));
+        QCOMPARE(FolderSettings::cacheEvictionCount(), evictions + 1);
+
+        // Nobody held the first settings, they are created again
+        QVERIFY(FolderSettings::forCollection(first));
+        QCOMPARE(FolderSettings::cacheMissCount(), misses + 3);
+        QCOMPARE(FolderSettings::cacheEvictionCount(), evictions + 2);
+    }
+
+    void shouldReturnHeldInstanceAfterEviction()
+    {
+        FolderSettings::setCacheCapacity(1);
+        const Collection first = collection(16);
+        const Collection second = collection(32);
+
+        const QSharedPointer<FolderSettings> held = FolderSettings::forCollection(first);
+        held->setPutRepliesInSameFolder(true);
+        const quint64 evictions = FolderSettings::cacheEvictionCount();
+        QVERIFY(FolderSettings::forCollection(second));
+        QCOMPARE(FolderSettings::cacheEvictionCount(), evictions + 1);
+
+        // Two instances for one folder would overwrite each other's changes
+        const QSharedPointer<FolderSettings> again = FolderSettings::forCollection(first);
+        QCOMPARE(again.data(), held.data());
+        QVERIFY(again->putRepliesInSameFolder());
+    }
+
+    void shouldOnlyWriteFieldsReadOrChanged()
+    {
+        const Collection folder = collection(48);
+        KConfigGroup group(KernelIf->config(), FolderSettings::configGroupName(folder));
+        group.deleteGroup();
+
+        QSharedPointer<FolderSettings> settings = FolderSettings::forCollection(folder);
+        settings->setHideInSelectionDialog(true);
+
+        // Changed elsewhere after the settings were created, but never read by them
+        group.writeEntry("PutRepliesInSameFolder", true);
+        group.writeEntry("Shortcut", QStringLiteral("Ctrl+Shift+X"));
+
+        settings.reset();
+        FolderSettings::clearCache();
+
+        QVERIFY(group.readEntry("HideInSelectionDialog", false));
+        QVERIFY(group.readEntry("PutRepliesInSameFolder", false));
+        QCOMPARE(group.readEntry("Shortcut"), QStringLiteral("Ctrl+Shift+X"));
+    }
+
+    void shouldReadEachFieldOnceFromSeveralThreads()
+    {
+        const Collection folder = collection(64);
+        KConfigGroup group(KernelIf->config(), FolderSettings::configGroupName(folder));
+        group.writeEntry("PutRepliesInSameFolder", true);
+        group.writeEntry("HideInSelectionDialog", true);
+        // Other threads get their own KSharedConfig, reading the file
+        QVERIFY(group.sync());
+
+        const QSharedPointer<FolderSettings> settings = FolderSettings::forCollection(folder);
+        const quint64 loads = FolderSettings::configLoadCount();
+
+        std::atomic<int> failures = 0;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.emplace_back([&settings, &failures]() {
+                for (int j = 0; j < 100; ++j) {
+                    if (!settings->putRepliesInSameFolder() || !settings->hideInSelectionDialog()) {
+                        ++failures;
+                    }
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        QCOMPARE(failures.load(), 0);
+        QCOMPARE(FolderSettings::configLoadCount(), loads + 2);
+    }
+
+private:
+    static Collection collection(Collection::Id id)
+    {
+        Collection collection(id);
+        collection.setResource(QStringLiteral("akonadi_knut_resource_0"));
+        return collection;
+    }
+};
+
+QTEST_AKONADIMAIN(FolderSettingsTest)
+
+#include "foldersettingstest.moc"
@@ -0,0 +1,255 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <akonadi/qtest_akonadi.h>
+
+#include <Akonadi/Collection>
+#include <Akonadi/CollectionStatistics>
+#include <Akonadi/Control>
+#include <Akonadi/EntityTreeModel>
+
+#include <MailCommon/FolderTreeView>
+#include <MailCommon/MailKernel>
+
+#include <QStandardItemModel>
+#include <QTest>
+
+#include <algorithm>
+
+#include "dummykernel.cpp"
+
+using namespace Akonadi;
+
+class FolderTreeViewTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void initTestCase()
+    {
+        AkonadiTest::checkTestIsIsolated();
+        Akonadi::Control::start();
+
+        auto kernel = new DummyKernel(this);
+        CommonKernel->registerKernelIf(kernel);
+        CommonKernel->registerSettingsIf(kernel);
+    }
+
+    void init()
+    {
+        // A (read)
+        //   A1 (read)
+        //   A2
+        // B (read)
+        //   B1
+        // C
+        // D (read)
+        mModel = new QStandardItemModel(this);
+        QStandardItem *a = folderItem(QStringLiteral("A"), 0);
+        a->appendRow(folderItem(QStringLiteral("A1"), 0));
+        a->appendRow(folderItem(QStringLiteral("A2"), 2));
+        QStandardItem *b = folderItem(QStringLiteral("B"), 0);
+        b->appendRow(folderItem(QStringLiteral("B1"), 3));
+        mModel->appendRow(a);
+        mModel->appendRow(b);
+        mModel->appendRow(folderItem(QStringLiteral("C"), 1));
+        mModel->appendRow(folderItem(QStringLiteral("D"), 0));
+
+        mView = new MailCommon::FolderTreeView;
+        mView->disableSaveConfig();
+        mView->setModel(mModel);
+    }
+
+    void cleanup()
+    {
+        delete mView;
+        mView = nullptr;
+        delete mModel;
+        mModel = nullptr;
+    }
+
+    void shouldSelectUnreadFoldersInDisplayOrder()
+    {
+        QCOMPARE(walk(true), (QStringList{QStringLiteral("A2"), QStringLiteral("B1"), QStringLiteral("C")}));
+        QCOMPARE(walk(false), (QStringList{QStringLiteral("C"), QStringLiteral("B1"), QStringLiteral("A2")}));
+    }
+
+    void shouldWrapAround()
+    {
+        select(QStringLiteral("C"));
+        mView->selectNextUnreadFolder();
+        QCOMPARE(currentName(), QStringLiteral("A2"));
+
+        mView->selectPrevUnreadFolder();
+        QCOMPARE(currentName(), QStringLiteral("C"));
+
+        // Nothing else is unread: stay on the only unread folder
+        setUnreadCount(QStringLiteral("A2"), 0);
+        setUnreadCount(QStringLiteral("B1"), 0);
+        select(QStringLiteral("C"));
+        mView->selectNextUnreadFolder();
+        QCOMPARE(currentName(), QStringLiteral("C"));
+        mView->selectPrevUnreadFolder();
+        QCOMPARE(currentName(), QStringLiteral("C"));
+    }
+
+    void shouldFollowUnreadCountChanges()
+    {
+        // Build the list, then change it
+        QCOMPARE(walk(true), unreadFolders());
+        setUnreadCount(QStringLiteral("A1"), 5);
+        setUnreadCount(QStringLiteral("B1"), 0);
+        setUnreadCount(QStringLiteral("D"), 1);
+        QCOMPARE(unreadFolders(), (QStringList{QStringLiteral("A1"), QStringLiteral("A2"), QStringLiteral("C"), QStringLiteral("D")}));
+        checkWalks();
+    }
+
+    void shouldFollowInsertedFolders()
+    {
+        QCOMPARE(walk(true), unreadFolders());
+
+        // A subtree before the unread folders of B, one after all, and one in front
+        QStandardItem *b = findItem(QStringLiteral("B"));
+        QStandardItem *b0 = folderItem(QStringLiteral("B0"), 1);
+        b0->appendRow(folderItem(QStringLiteral("B00"), 4));
+        b0->appendRow(folderItem(QStringLiteral("B01"), 0));
+        b->insertRow(0, b0);
+        mModel->appendRow(folderItem(QStringLiteral("E"), 1));
+        mModel->insertRow(0, folderItem(QStringLiteral("Z"), 1));
+        QCOMPARE(unreadFolders(),
+                 (QStringList{QStringLiteral("Z"),
+                              QStringLiteral("A2"),
+                              QStringLiteral("B0"),
+                              QStringLiteral("B00"),
+                              QStringLiteral("B1"),
+                              QStringLiteral("C"),
+                              QStringLiteral("E")}));
+        checkWalks();
+    }
+
+    void shouldFollowRemovedFolders()
+    {
+        QCOMPARE(walk(true), unreadFolders());
+
+        // B and its unread child
+        select(QStringLiteral("A2"));
+        mModel->removeRow(findItem(QStringLiteral("B"))->row());
+        mView->selectNextUnreadFolder();
+        QCOMPARE(currentName(), QStringLiteral("C"));
+
+        findItem(QStringLiteral("A"))->removeRow(1);
+        QCOMPARE(unreadFolders(), QStringList{QStringLiteral("C")});
+        checkWalks();
+    }
+
+    void shouldFollowResort()
+    {
+        QCOMPARE(walk(true), unreadFolders());
+
+        mModel->sort(0, Qt::DescendingOrder);
+        QCOMPARE(unreadFolders(), (QStringList{QStringLiteral("C"), QStringLiteral("B1"), QStringLiteral("A2")}));
+        checkWalks();
+
+        // Changes after the re-sort land at their new position
+        setUnreadCount(QStringLiteral("A1"), 1);
+        setUnreadCount(QStringLiteral("D"), 1);
+        QCOMPARE(unreadFolders(), (QStringList{QStringLiteral("D"), QStringLiteral("C"), QStringLiteral("B1"), QStringLiteral("A2"), QStringLiteral("A1")}));
+        checkWalks();
+    }
+
+private:
+    static QStandardItem *folderItem(const QString &name, int unreadCount)
+    {
+        static Collection::Id nextId = 100000;
+        Collection collection(nextId++);
+        collection.setName(name);
+        CollectionStatistics statistics;
+        statistics.setUnreadCount(unreadCount);
+        collection.setStatistics(statistics);
+
+        auto item = new QStandardItem(name);
+        item->setData(QVariant::fromValue(collection), EntityTreeModel::CollectionRole);
+        return item;
+    }
+
+    QStandardItem *findItem(const QString &name) const
+    {
+        const QModelIndexList indexes = mModel->match(mModel->index(0, 0), Qt::DisplayRole, name, 1, Qt::MatchExactly | Qt::MatchRecursive);
+        return indexes.isEmpty() ? nullptr : mModel->itemFromIndex(indexes.constFirst());
+    }
+
+    void setUnreadCount(const QString &name, int unreadCount) const
+    {
+        QStandardItem *item = findItem(name);
+        QVERIFY(item);
+        auto collection = item->data(EntityTreeModel::CollectionRole).value<Collection>();
+        CollectionStatistics statistics = collection.statistics();
+        statistics.setUnreadCount(unreadCount);
+        collection.setStatistics(statistics);
+        item->setData(QVariant::fromValue(collection), EntityTreeModel::CollectionRole);
+    }
+
+    void select(const QString &name) const
+    {
+        QStandardItem *item = findItem(name);
+        QVERIFY(item);
+        mView->setCurrentIndex(item->index());
+    }
+
+    QString currentName() const
+    {
+        return mView->currentIndex().data().toString();
+    }
+
+    // The unread folders in display order, computed from scratch
+    QStringList unreadFolders(const QModelIndex &parent = {}) const
+    {
+        QStringList names;
+        for (int row = 0; row < mModel->rowCount(parent); ++row) {
+            const QModelIndex index = mModel->index(row, 0, parent);
+            if (index.data(EntityTreeModel::CollectionRole).value<Collection>().statistics().unreadCount() > 0) {
+                names.append(index.data().toString());
+            }
+            names += unreadFolders(index);
+        }
+        return names;
+    }
+
+    // The folders selected by next (or previous) unread from no selection,
+    // until the first one comes again
+    QStringList walk(bool forward) const
+    {
+        mView->setCurrentIndex({});
+        QStringList names;
+        for (int i = 0; i < 100; ++i) {
+            if (forward) {
+                mView->selectNextUnreadFolder();
+            } else {
+                mView->selectPrevUnreadFolder();
+            }
+            if (!mView->currentIndex().isValid() || names.contains(currentName())) {
+                break;
+            }
+            names.append(currentName());
+        }
+        return names;
+    }
+
+    void checkWalks() const
+    {
+        const QStringList expected = unreadFolders();
+        QStringList reversed = expected;
+        std::reverse(reversed.begin(), reversed.end());
+        QCOMPARE(walk(true), expected);
+        QCOMPARE(walk(false), reversed);
+    }
+
+    QStandardItemModel *mModel = nullptr;
+    MailCommon::FolderTreeView *mView = nullptr;
+};
+
+QTEST_AKONADIMAIN(FolderTreeViewTest)
+
+#include "foldertreeviewtest.moc"
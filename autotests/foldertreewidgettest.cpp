@@ -28,13 +28,17 @@
 #include "folder/entitycollectionorderproxymodel.h"
 #include <MailCommon/FolderTreeView>
 #include <MailCommon/FolderTreeWidget>
+#include <MailCommon/FolderTreeWidgetProxyModel>
 #include <MailCommon/MailKernel>
 
 #include <QDebug>
+#include <QSignalSpy>
 #include <QStandardPaths>
 #include <QTest>
 #include <QTreeView>
 
+#include <algorithm>
+
 #include "dummykernel.cpp"
 
 // #define SHOW_WIDGET
@@ -279,7 +283,43 @@ private Q_SLOTS:
         QVERIFY(!mFolderTreeWidget->currentIndex().isValid());
     }
 
+    void shouldUpdateResourceFoldersWhenGoingOffline()
+    {
+        mFolderTreeWidget->applyFilter(QString());
+        MailCommon::FolderTreeWidgetProxyModel *proxy = mFolderTreeWidget->folderTreeWidgetProxyModel();
+        const QPersistentModelIndex res1Index = proxy->index(collectNames(proxy).indexOf("res1"), 0);
+        QVERIFY(res1Index.isValid());
+        QTRY_COMPARE(proxy->rowCount(res1Index), 1);
+        const QPersistentModelIndex sub1Index = proxy->index(0, 0, res1Index);
+        QCOMPARE(sub1Index.data().toString(), QStringLiteral("sub1"));
+        // Reading the display text caches the state of the resource
+        QCOMPARE(res1Index.data().toString(), QStringLiteral("res1"));
+
+        AgentInstance agent = AgentManager::self()->instance(res1Index.data(EntityTreeModel::CollectionRole).value<Collection>().resource());
+        QVERIFY(agent.isValid());
+        QSignalSpy spy(proxy, &QAbstractItemModel::dataChanged);
+        agent.setIsOnline(false);
+        // The folders below the top-level row are repainted too
+        QTRY_VERIFY(isChanged(spy, sub1Index));
+        QVERIFY(isChanged(spy, res1Index));
+        QCOMPARE(res1Index.data().toString(), QStringLiteral("res1 (Offline)"));
+
+        spy.clear();
+        agent.setIsOnline(true);
+        QTRY_VERIFY(isChanged(spy, sub1Index));
+        QCOMPARE(res1Index.data().toString(), QStringLiteral("res1"));
+    }
+
 private:
+    static bool isChanged(const QSignalSpy &spy, const QModelIndex &index)
+    {
+        return std::any_of(spy.cbegin(), spy.cend(), [&index](const QList<QVariant> &arguments) {
+            const auto topLeft = arguments.at(0).value<QModelIndex>();
+            const auto bottomRight = arguments.at(1).value<QModelIndex>();
+            return topLeft.parent() == index.parent() && topLeft.row() <= index.row() && index.row() <= bottomRight.row();
+        });
+    }
+
     static Collection topLevelCollectionForResource(const QString &identifier)
     {
         // Find out the collection for the resource (as defined in unittestenv/xdglocal/testdata-res*.xml)
@@ -0,0 +1,66 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "testfixtures.h"
+
+#include <Akonadi/CollectionCreateJob>
+#include <Akonadi/CollectionFetchJob>
+#include <Akonadi/ItemCreateJob>
+
+#include <KMime/Message>
+
+#include <QDebug>
+
+Akonadi::Collection TestFixtures::topLevelCollection(const QString &name)
+{
+    auto job = new Akonadi::CollectionFetchJob(Akonadi::Collection::root(), Akonadi::CollectionFetchJob::FirstLevel);
+    if (!job->exec()) {
+        qWarning() << job->errorString();
+        return {};
+    }
+    const Akonadi::Collection::List collections = job->collections();
+    for (const Akonadi::Collection &collection : collections) {
+        if (collection.name() == name) {
+            return collection;
+        }
+    }
+    return {};
+}
+
+Akonadi::Collection TestFixtures::createCollection(const Akonadi::Collection &parent, const QString &name, const QStringList &contentMimeTypes)
+{
+    Akonadi::Collection collection;
+    collection.setParentCollection(parent);
+    collection.setName(name);
+    collection.setContentMimeTypes(contentMimeTypes.isEmpty() ? QStringList{KMime::Message::mimeType()} : contentMimeTypes);
+    auto job = new Akonadi::CollectionCreateJob(collection);
+    if (!job->exec()) {
+        qWarning() << job->errorString();
+        return {};
+    }
+    return job->collection();
+}
+
+Akonadi::Item::Id TestFixtures::createMessage(const Akonadi::Collection &collection, const QString &subject, const QDateTime &date, const Akonadi::Item::Flags &flags)
+{
+    QByteArray content = "From: sender@example.com\nSubject: " + subject.toUtf8() + '\n';
+    if (date.isValid()) {
+        content += "Date: " + date.toString(Qt::RFC2822Date).toLatin1() + '\n';
+    }
+    content += "\nHello\n";
+    auto message = std::make_shared<KMime::Message>();
+    message->setContent(content);
+    message->parse();
+    Akonadi::Item item(KMime::Message::mimeType());
+    item.setPayload(message);
+    item.setFlags(flags);
+    auto job = new Akonadi::ItemCreateJob(item, collection);
+    if (!job->exec()) {
+        qWarning() << job->errorString();
+        return -1;
+    }
+    return job->item().id();
+}
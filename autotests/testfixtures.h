@@ -0,0 +1,29 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <Akonadi/Collection>
+#include <Akonadi/Item>
+
+#include <QDateTime>
+#include <QStringList>
+
+// Factories for the collections and messages used by the isolated Akonadi tests.
+// They run their job synchronously and return an invalid collection, or -1,
+// after printing the error.
+namespace TestFixtures
+{
+// Returns the top-level collection of a test resource, e.g. "res1"
+[[nodiscard]] Akonadi::Collection topLevelCollection(const QString &name);
+
+// Creates a mail folder, which may have subfolders if it has the collection mime type
+[[nodiscard]] Akonadi::Collection createCollection(const Akonadi::Collection &parent, const QString &name, const QStringList &contentMimeTypes = {});
+
+// Creates a message from sender@example.com, with a Date header if date is valid
+[[nodiscard]] Akonadi::Item::Id
+createMessage(const Akonadi::Collection &collection, const QString &subject, const QDateTime &date = {}, const Akonadi::Item::Flags &flags = {});
+}
@@ -5,6 +5,7 @@
 */
 
 #include "collectionpage/attributes/expirecollectionattribute.h"
+#include "collectionpage/attributes/expirecursorattribute.h"
 #include <Akonadi/NewMailNotifierAttribute>
 
 #include <Akonadi/AttributeFactory>
@@ -15,6 +16,7 @@ namespace
 bool dummy()
 {
     Akonadi::AttributeFactory::registerAttribute<MailCommon::ExpireCollectionAttribute>();
+    Akonadi::AttributeFactory::registerAttribute<MailCommon::ExpireCursorAttribute>();
     Akonadi::AttributeFactory::registerAttribute<Akonadi::NewMailNotifierAttribute>();
     return true;
 }
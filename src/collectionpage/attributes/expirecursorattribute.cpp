@@ -0,0 +1,55 @@
+/*
+
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "expirecursorattribute.h"
+#include <QDataStream>
+#include <QIODevice>
+
+using namespace MailCommon;
+
+ExpireCursorAttribute::ExpireCursorAttribute() = default;
+
+QByteArray ExpireCursorAttribute::type() const
+{
+    static const QByteArray sType("expirecursorattribute");
+    return sType;
+}
+
+ExpireCursorAttribute *ExpireCursorAttribute::clone() const
+{
+    auto cursorAttr = new ExpireCursorAttribute();
+    cursorAttr->setCursor(mCursor);
+    return cursorAttr;
+}
+
+QByteArray ExpireCursorAttribute::serialized() const
+{
+    QByteArray result;
+    QDataStream s(&result, QIODevice::WriteOnly);
+    s << mCursor;
+    return result;
+}
+
+void ExpireCursorAttribute::deserialize(const QByteArray &data)
+{
+    QDataStream s(data);
+    mCursor = -1;
+    s >> mCursor;
+    if (s.status() != QDataStream::Ok) {
+        mCursor = -1;
+    }
+}
+
+Akonadi::Item::Id ExpireCursorAttribute::cursor() const
+{
+    return mCursor;
+}
+
+void ExpireCursorAttribute::setCursor(Akonadi::Item::Id id)
+{
+    mCursor = id;
+}
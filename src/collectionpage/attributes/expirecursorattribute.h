@@ -0,0 +1,42 @@
+/*
+
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+
+#include <Akonadi/Attribute>
+#include <Akonadi/Item>
+
+namespace MailCommon
+{
+/**
+ * Position of an interrupted expiry run in a folder.
+ *
+ * Messages are expired in increasing id order, so a resumed run skips the
+ * messages up to cursor(). This is state of the expiry job, it's kept apart
+ * from ExpireCollectionAttribute so that saving it never overwrites the
+ * expiry settings.
+ */
+class MAILCOMMON_TESTS_EXPORT ExpireCursorAttribute : public Akonadi::Attribute
+{
+public:
+    ExpireCursorAttribute();
+
+    [[nodiscard]] QByteArray type() const override;
+    ExpireCursorAttribute *clone() const override;
+    [[nodiscard]] QByteArray serialized() const override;
+    void deserialize(const QByteArray &data) override;
+
+    /// Returns the id of the last message handled, or -1 to start from the beginning.
+    [[nodiscard]] Akonadi::Item::Id cursor() const;
+    void setCursor(Akonadi::Item::Id id);
+
+private:
+    Akonadi::Item::Id mCursor = -1;
+};
+}
@@ -0,0 +1,59 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "expirecursorattributetest.h"
+#include "../attributes/expirecursorattribute.h"
+#include <QTest>
+
+#include <memory>
+
+ExpireCursorAttributeTest::ExpireCursorAttributeTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ExpireCursorAttributeTest::~ExpireCursorAttributeTest() = default;
+
+void ExpireCursorAttributeTest::shouldHaveDefaultValue()
+{
+    MailCommon::ExpireCursorAttribute attr;
+    QCOMPARE(attr.cursor(), (qint64)-1);
+}
+
+void ExpireCursorAttributeTest::shouldCloneAttr()
+{
+    MailCommon::ExpireCursorAttribute attr;
+    attr.setCursor(42);
+    std::unique_ptr<MailCommon::ExpireCursorAttribute> clone(attr.clone());
+    QCOMPARE(clone->cursor(), (qint64)42);
+}
+
+void ExpireCursorAttributeTest::shouldSerializedValue()
+{
+    MailCommon::ExpireCursorAttribute attr;
+    attr.setCursor(42);
+    MailCommon::ExpireCursorAttribute result;
+    result.deserialize(attr.serialized());
+    QCOMPARE(result.cursor(), (qint64)42);
+}
+
+void ExpireCursorAttributeTest::shouldIgnoreInvalidData()
+{
+    MailCommon::ExpireCursorAttribute result;
+    result.setCursor(42);
+    result.deserialize(QByteArray("ab"));
+    QCOMPARE(result.cursor(), (qint64)-1);
+}
+
+void ExpireCursorAttributeTest::shouldHaveType()
+{
+    MailCommon::ExpireCursorAttribute attr;
+    QCOMPARE(attr.type(), QByteArray("expirecursorattribute"));
+}
+
+QTEST_MAIN(ExpireCursorAttributeTest)
+
+#include "moc_expirecursorattributetest.cpp"
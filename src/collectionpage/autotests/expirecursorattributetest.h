@@ -0,0 +1,23 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class ExpireCursorAttributeTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ExpireCursorAttributeTest(QObject *parent = nullptr);
+    ~ExpireCursorAttributeTest() override;
+private Q_SLOTS:
+    void shouldHaveDefaultValue();
+    void shouldCloneAttr();
+    void shouldSerializedValue();
+    void shouldIgnoreInvalidData();
+    void shouldHaveType();
+};
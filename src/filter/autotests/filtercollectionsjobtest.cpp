@@ -0,0 +1,86 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "filtercollectionsjobtest.h"
+#include "../filtercollectionsjob.h"
+#include "../mailfilter.h"
+#include <QSignalSpy>
+#include <QTest>
+
+QTEST_MAIN(FilterCollectionsJobTest)
+
+using namespace MailCommon;
+
+FilterCollectionsJobTest::FilterCollectionsJobTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FilterCollectionsJobTest::~FilterCollectionsJobTest() = default;
+
+void FilterCollectionsJobTest::shouldHaveDefaultValues()
+{
+    FilterCollectionsJob job({}, {}, FilterManager::Explicit);
+    QCOMPARE(job.filterCount(), 0);
+    QCOMPARE(job.requiredPart(), SearchRule::Envelope);
+    QCOMPARE(job.pageSize(), 256);
+    QCOMPARE(job.processedCount(), 0);
+    QCOMPARE(job.totalCount(), 0);
+    QCOMPARE(job.itemsPerSecond(), 0.0);
+
+    job.setPageSize(0);
+    QCOMPARE(job.pageSize(), 1);
+}
+
+void FilterCollectionsJobTest::shouldSelectApplicableFilters()
+{
+    MailFilter filter;
+    filter.setApplyOnInbound(false);
+    filter.setApplyOnExplicit(true);
+    QVERIFY(FilterCollectionsJob::isApplicable(&filter, FilterManager::Explicit));
+    QVERIFY(!FilterCollectionsJob::isApplicable(&filter, FilterManager::Inbound));
+    QVERIFY(FilterCollectionsJob::isApplicable(&filter, FilterManager::All));
+
+    filter.setEnabled(false);
+    QVERIFY(!FilterCollectionsJob::isApplicable(&filter, FilterManager::Explicit));
+
+    MailFilter inboundFilter;
+    inboundFilter.setApplyOnExplicit(false);
+    FilterCollectionsJob job({}, {&filter, &inboundFilter}, FilterManager::Inbound);
+    QCOMPARE(job.filterCount(), 1);
+}
+
+void FilterCollectionsJobTest::shouldFetchRequiredPart()
+{
+    MailFilter subjectFilter;
+    subjectFilter.pattern()->append(SearchRule::createInstance("subject", SearchRule::FuncContains, QStringLiteral("foo")));
+    MailFilter bodyFilter;
+    bodyFilter.pattern()->append(SearchRule::createInstance("<body>", SearchRule::FuncContains, QStringLiteral("foo")));
+
+    FilterCollectionsJob envelopeJob({}, {&subjectFilter}, FilterManager::Explicit);
+    QCOMPARE(envelopeJob.requiredPart(), SearchRule::Envelope);
+
+    FilterCollectionsJob completeJob({}, {&subjectFilter, &bodyFilter}, FilterManager::Explicit);
+    QCOMPARE(completeJob.filterCount(), 2);
+    QCOMPARE(completeJob.requiredPart(), SearchRule::CompleteMessage);
+
+    bodyFilter.setEnabled(false);
+    FilterCollectionsJob disabledJob({}, {&subjectFilter, &bodyFilter}, FilterManager::Explicit);
+    QCOMPARE(disabledJob.requiredPart(), SearchRule::Envelope);
+}
+
+void FilterCollectionsJobTest::shouldFinishWithoutFilters()
+{
+    auto job = new FilterCollectionsJob({Akonadi::Collection(42)}, {}, FilterManager::Explicit);
+    QSignalSpy finishedSpy(job, &FilterCollectionsJob::finished);
+    job->start();
+    QCOMPARE(finishedSpy.count(), 1);
+    QCOMPARE(job->totalCount(), 0);
+    QSignalSpy destroyedSpy(job, &QObject::destroyed);
+    QVERIFY(destroyedSpy.wait());
+}
+
+#include "moc_filtercollectionsjobtest.cpp"
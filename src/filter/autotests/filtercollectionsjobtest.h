@@ -0,0 +1,22 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class FilterCollectionsJobTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FilterCollectionsJobTest(QObject *parent = nullptr);
+    ~FilterCollectionsJobTest() override;
+private Q_SLOTS:
+    void shouldHaveDefaultValues();
+    void shouldSelectApplicableFilters();
+    void shouldFetchRequiredPart();
+    void shouldFinishWithoutFilters();
+};
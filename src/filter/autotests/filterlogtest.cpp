@@ -6,6 +6,8 @@
 
 #include "filterlogtest.h"
 #include "filter/filterlog.h"
+#include "search/searchrule/searchrule.h"
+#include <QSignalSpy>
 #include <QStandardPaths>
 #include <QTest>
 
@@ -26,6 +28,7 @@ void FilterLogTest::cleanup()
     log->setContentTypeEnabled(MailCommon::FilterLog::RuleResult, true);
     log->setContentTypeEnabled(MailCommon::FilterLog::PatternResult, true);
     log->setContentTypeEnabled(MailCommon::FilterLog::AppliedAction, true);
+    log->setMaxLogSize(512 * 1024);
 }
 
 void FilterLogTest::shouldHaveDefaultValues()
@@ -116,4 +119,59 @@ void FilterLogTest::shouldClearLog()
     QCOMPARE(log->logEntries().size(), 0);
 }
 
+void FilterLogTest::shouldAddRuleResult()
+{
+    auto log = MailCommon::FilterLog::instance();
+    const MailCommon::SearchRule::Ptr rule =
+        MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("<foo>"));
+    log->addRuleResult(*rule, true);
+    QVERIFY(log->logEntries().isEmpty());
+
+    log->setLogging(true);
+    log->addRuleResult(*rule, true, QStringLiteral("a <foo> b"));
+    log->addRuleResult(*rule, false);
+    const QStringList entries = log->logEntries();
+    QCOMPARE(entries.size(), 2);
+    QVERIFY(entries.at(0).startsWith(u'['));
+    QVERIFY(entries.at(0).contains(QStringLiteral("<font color=#00FF00>1 = </font>")));
+    QVERIFY(entries.at(0).contains(MailCommon::FilterLog::recode(rule->asString())));
+    QVERIFY(entries.at(0).contains(QStringLiteral("( <i>a &lt;foo&gt; b</i> )")));
+    QVERIFY(entries.at(1).contains(QStringLiteral("<font color=#FF0000>0 = </font>")));
+    QVERIFY(!entries.at(1).contains(QStringLiteral("<i>")));
+
+    log->setContentTypeEnabled(MailCommon::FilterLog::RuleResult, false);
+    log->addRuleResult(*rule, true);
+    QCOMPARE(log->logEntries().size(), 2);
+}
+
+void FilterLogTest::shouldDiscardOldestEntries()
+{
+    auto log = MailCommon::FilterLog::instance();
+    log->setLogging(true);
+    log->setMaxLogSize(1024);
+    for (int i = 0; i < 1000; ++i) {
+        log->add(QString::number(i).rightJustified(10, u'0'), MailCommon::FilterLog::Meta);
+    }
+    const QStringList entries = log->logEntries();
+    QVERIFY(!entries.isEmpty());
+    QVERIFY(entries.size() < 103);
+    QCOMPARE(entries.last(), QStringLiteral("0000000999"));
+    for (int i = 1; i < entries.size(); ++i) {
+        QCOMPARE(entries.at(i).toInt(), entries.at(i - 1).toInt() + 1);
+    }
+}
+
+void FilterLogTest::shouldSignalEntriesInBatch()
+{
+    auto log = MailCommon::FilterLog::instance();
+    QSignalSpy spy(log, &MailCommon::FilterLog::logEntryAdded);
+    log->setLogging(true);
+    log->add(QStringLiteral("foo"), MailCommon::FilterLog::Meta);
+    log->add(QStringLiteral("bar"), MailCommon::FilterLog::Meta);
+    QCOMPARE(spy.count(), 0);
+    QTRY_COMPARE(spy.count(), 2);
+    QCOMPARE(spy.at(0).at(0).toString(), QStringLiteral("foo"));
+    QCOMPARE(spy.at(1).at(0).toString(), QStringLiteral("bar"));
+}
+
 #include "moc_filterlogtest.cpp"
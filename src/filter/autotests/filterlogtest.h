@@ -21,4 +21,7 @@ private Q_SLOTS:
     void shouldAddLogEntries();
     void shouldAllowSpecificLogEntries();
     void shouldClearLog();
+    void shouldAddRuleResult();
+    void shouldDiscardOldestEntries();
+    void shouldSignalEntriesInBatch();
 };
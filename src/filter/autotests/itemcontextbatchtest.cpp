@@ -0,0 +1,167 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "itemcontextbatchtest.h"
+#include "../itemcontext.h"
+#include "../itemcontextbatch.h"
+#include <Akonadi/Tag>
+#include <QTest>
+
+QTEST_MAIN(ItemContextBatchTest)
+
+using namespace MailCommon;
+
+static ItemContext createContext(Akonadi::Item::Id id, const Akonadi::Item::Flags &flags, Akonadi::Collection::Id target = -1)
+{
+    Akonadi::Item item(id);
+    item.setParentCollection(Akonadi::Collection(1));
+    item.setFlags(flags);
+    ItemContext context(item, false);
+    if (!flags.isEmpty()) {
+        context.setNeedsFlagStore();
+    }
+    if (target != -1) {
+        context.setMoveTargetCollection(Akonadi::Collection(target));
+    }
+    return context;
+}
+
+ItemContextBatchTest::ItemContextBatchTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ItemContextBatchTest::~ItemContextBatchTest() = default;
+
+void ItemContextBatchTest::shouldHaveDefaultValues()
+{
+    ItemContextBatch batch;
+    QCOMPARE(batch.maximumSize(), 500);
+    QCOMPARE(batch.flushInterval(), 1000);
+    QCOMPARE(batch.pendingCount(), 0);
+    QCOMPARE(batch.pendingJobCount(), 0);
+    QCOMPARE(batch.runningJobCount(), 0);
+    QVERIFY(batch.isIdle());
+    QCOMPARE(batch.committedItemCount(), 0);
+    QCOMPARE(batch.jobCount(), 0);
+
+    batch.setMaximumSize(0);
+    QCOMPARE(batch.maximumSize(), 1);
+    batch.setFlushInterval(0);
+    QCOMPARE(batch.flushInterval(), 0);
+}
+
+void ItemContextBatchTest::shouldGroupJobs()
+{
+    ItemContextBatch batch;
+    batch.setFlushInterval(0);
+    // Same flags: one modify job
+    batch.add(createContext(1, {"\\SEEN"}));
+    batch.add(createContext(2, {"\\SEEN"}));
+    // Other flags: a second one
+    batch.add(createContext(3, {"\\SEEN", "\\FLAGGED"}));
+    // Two targets: two move jobs
+    batch.add(createContext(4, {}, 10));
+    batch.add(createContext(5, {}, 10));
+    batch.add(createContext(6, {}, 11));
+    // Already in the target: nothing to do
+    batch.add(createContext(7, {}, 1));
+
+    // Deletions: one delete job, nothing else for these items
+    ItemContext deleted = createContext(8, {"\\SEEN"}, 12);
+    deleted.setDeleteItem();
+    batch.add(deleted);
+    ItemContext deleted2 = createContext(9, {}, 12);
+    deleted2.setDeleteItem();
+    batch.add(deleted2);
+
+    QCOMPARE(batch.pendingCount(), 9);
+    QCOMPARE(batch.pendingJobCount(), 5);
+    QVERIFY(!batch.isIdle());
+    batch.clear();
+}
+
+void ItemContextBatchTest::shouldKeepFlagsAndTagsOfEachItem()
+{
+    ItemContextBatch batch;
+    batch.setFlushInterval(0);
+
+    // Different changes leading to the same flags
+    ItemContext unset = createContext(1, {"\\SEEN", "\\FLAGGED"});
+    unset.item().clearFlag("\\FLAGGED");
+    batch.add(unset);
+    ItemContext set = createContext(2, {});
+    set.item().setFlag("\\SEEN");
+    set.setNeedsFlagStore();
+    batch.add(set);
+    // Same flags, different tags
+    ItemContext tagged = createContext(3, {"\\SEEN"});
+    tagged.item().setTag(Akonadi::Tag(5));
+    batch.add(tagged);
+    ItemContext tagged2 = createContext(4, {"\\SEEN"});
+    tagged2.item().setTag(Akonadi::Tag(6));
+    batch.add(tagged2);
+    batch.add(createContext(5, {"\\FLAGGED"}));
+
+    const QHash<Akonadi::Item::Id, QSet<QByteArray>> expectedFlags = {
+        {1, {"\\SEEN"}},
+        {2, {"\\SEEN"}},
+        {3, {"\\SEEN"}},
+        {4, {"\\SEEN"}},
+        {5, {"\\FLAGGED"}},
+    };
+    const QHash<Akonadi::Item::Id, Akonadi::Tag::Id> expectedTags = {{3, 5}, {4, 6}};
+
+    // A batch modification applies the flags and tags of its first item to all of them
+    QHash<Akonadi::Item::Id, QSet<QByteArray>> storedFlags;
+    QHash<Akonadi::Item::Id, Akonadi::Tag::List> storedTags;
+    const QList<Akonadi::Item::List> modifications = batch.pendingModifications();
+    for (const Akonadi::Item::List &items : modifications) {
+        QVERIFY(!items.isEmpty());
+        for (const Akonadi::Item &item : items) {
+            QVERIFY(!storedFlags.contains(item.id()));
+            storedFlags.insert(item.id(), items.constFirst().flags());
+            storedTags.insert(item.id(), items.constFirst().tags());
+        }
+    }
+    QCOMPARE(storedFlags, expectedFlags);
+    for (auto it = storedTags.cbegin(); it != storedTags.cend(); ++it) {
+        if (expectedTags.contains(it.key())) {
+            QCOMPARE(it.value().size(), 1);
+            QCOMPARE(it.value().constFirst().id(), expectedTags.value(it.key()));
+        } else {
+            QVERIFY(it.value().isEmpty());
+        }
+    }
+    // One job for items 1 and 2, one per tagged item, one for item 5
+    QCOMPARE(modifications.size(), 4);
+    QCOMPARE(batch.pendingJobCount(), 4);
+    batch.clear();
+}
+
+void ItemContextBatchTest::shouldReplacePendingContext()
+{
+    ItemContextBatch batch;
+    batch.setFlushInterval(0);
+    batch.add(createContext(1, {"\\SEEN"}));
+    batch.add(createContext(1, {"\\SEEN"}, 10));
+    QCOMPARE(batch.pendingCount(), 1);
+    QCOMPARE(batch.pendingJobCount(), 2);
+    batch.clear();
+}
+
+void ItemContextBatchTest::shouldClearPendingContexts()
+{
+    ItemContextBatch batch;
+    batch.add(createContext(1, {"\\SEEN"}));
+    QCOMPARE(batch.pendingCount(), 1);
+    batch.clear();
+    QCOMPARE(batch.pendingCount(), 0);
+    QCOMPARE(batch.pendingJobCount(), 0);
+    QVERIFY(batch.isIdle());
+}
+
+#include "moc_itemcontextbatchtest.cpp"
@@ -0,0 +1,23 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class ItemContextBatchTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ItemContextBatchTest(QObject *parent = nullptr);
+    ~ItemContextBatchTest() override;
+private Q_SLOTS:
+    void shouldHaveDefaultValues();
+    void shouldGroupJobs();
+    void shouldKeepFlagsAndTagsOfEachItem();
+    void shouldReplacePendingContext();
+    void shouldClearPendingContexts();
+};
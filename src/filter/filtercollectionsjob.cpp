@@ -0,0 +1,396 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "filtercollectionsjob.h"
+#include "filteractions/filteraction.h"
+#include "filterlog.h"
+#include "itemcontext.h"
+#include "itemcontextbatch.h"
+#include "mailcommon_debug.h"
+#include "mailfilter.h"
+#include "search/searchpatternindex.h"
+#include "search/searchrule/contactemailindex.h"
+#include "search/searchrule/itemstatussnapshot.h"
+
+#include <Akonadi/ItemFetchJob>
+#include <Akonadi/ItemFetchScope>
+#include <Akonadi/MessageParts>
+#include <KMime/Message>
+
+#include <QElapsedTimer>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace MailCommon;
+
+namespace
+{
+SearchRule::RequiredPart filterRequiredPart(const MailFilter *filter)
+{
+    // MailFilter::requiredPart() also checks the account, which does not
+    // apply to explicit filtering of collections
+    int requiredPart = filter->pattern()->requiredPart();
+    const QList<FilterAction *> *actions = filter->actions();
+    for (const FilterAction *action : *actions) {
+        requiredPart = qMax(requiredPart, static_cast<int>(action->requiredPart()));
+    }
+    return static_cast<SearchRule::RequiredPart>(requiredPart);
+}
+
+bool usesContactIndex(const SearchPattern *pattern)
+{
+    return std::any_of(pattern->cbegin(), pattern->cend(), [](const SearchRule::Ptr &rule) {
+        switch (rule->function()) {
+        case SearchRule::FuncIsInAddressbook:
+        case SearchRule::FuncIsNotInAddressbook:
+        case SearchRule::FuncIsInCategory:
+        case SearchRule::FuncIsNotInCategory:
+            return true;
+        default:
+            return false;
+        }
+    });
+}
+}
+
+class Q_DECL_HIDDEN FilterCollectionsJob::FilterCollectionsJobPrivate
+{
+public:
+    explicit FilterCollectionsJobPrivate(FilterCollectionsJob *qq)
+        : q(qq)
+        , mBatch(new ItemContextBatch(qq))
+    {
+    }
+
+    ~FilterCollectionsJobPrivate()
+    {
+        // The workers use the filters and the index
+        mPool.waitForDone();
+    }
+
+    void scheduleNext();
+    void listNextCollection();
+    void fetchPage();
+    void startEvaluation(const Akonadi::Item::List &items);
+    void evaluationDone(const Akonadi::Item::List &items, const std::vector<QBitArray> &matches);
+    void applyFilters(ItemContext &context, const QBitArray &matches) const;
+    [[nodiscard]] bool canEvaluateInThreads() const;
+    void finish();
+
+    FilterCollectionsJob *const q;
+    ItemContextBatch *const mBatch;
+    Akonadi::Collection::List mCollections;
+    std::vector<std::unique_ptr<MailFilter>> mFilters;
+    SearchPatternIndex mIndex;
+    Akonadi::Item::List mPendingItems;
+    Akonadi::Item::List mFetchedPage;
+    QElapsedTimer mTimer;
+    qint64 mElapsed = -1;
+    qint64 mProcessed = 0;
+    qint64 mTotal = 0;
+    int mPageSize = 256;
+    SearchRule::RequiredPart mRequiredPart = SearchRule::Envelope;
+    bool mApplyOnOutbound = false;
+    bool mUsesContactIndex = false;
+    bool mListing = false;
+    bool mFetching = false;
+    bool mEvaluating = false;
+    bool mKilled = false;
+    bool mFinished = false;
+    // Declared last, so that it is destroyed first
+    QThreadPool mPool;
+};
+
+void FilterCollectionsJob::FilterCollectionsJobPrivate::scheduleNext()
+{
+    if (!mKilled) {
+        if (!mEvaluating && !mFetchedPage.isEmpty()) {
+            startEvaluation(std::exchange(mFetchedPage, {}));
+        }
+        // Keep one page fetched ahead of the one being evaluated
+        if (!mFetching && mFetchedPage.isEmpty() && !mPendingItems.isEmpty()) {
+            fetchPage();
+        }
+        if (!mListing && mPendingItems.size() < mPageSize && !mCollections.isEmpty()) {
+            listNextCollection();
+        }
+    }
+    if (mListing || mFetching || mEvaluating) {
+        return;
+    }
+    if (mKilled || (mCollections.isEmpty() && mPendingItems.isEmpty() && mFetchedPage.isEmpty())) {
+        // The actions already ran, their changes have to be stored even when killed
+        mBatch->flush();
+        if (mBatch->isIdle()) {
+            finish();
+        }
+    }
+}
+
+void FilterCollectionsJob::FilterCollectionsJobPrivate::listNextCollection()
+{
+    mListing = true;
+    // Only list the ids, the messages are fetched page by page
+    auto job = new Akonadi::ItemFetchJob(mCollections.takeFirst(), q);
+    job->fetchScope().fetchFullPayload(false);
+    job->fetchScope().setFetchModificationTime(false);
+    job->fetchScope().setFetchRemoteIdentification(false);
+    connect(job, &KJob::result, q, [this](KJob *job) {
+        mListing = false;
+        if (job->error()) {
+            qCWarning(MAILCOMMON_LOG) << "Failed to list the items of a collection:" << job->errorString();
+        } else {
+            const Akonadi::Item::List items = static_cast<Akonadi::ItemFetchJob *>(job)->items();
+            const qsizetype previousCount = mPendingItems.size();
+            for (const Akonadi::Item &item : items) {
+                if (item.mimeType() == KMime::Message::mimeType()) {
+                    mPendingItems.append(Akonadi::Item(item.id()));
+                }
+            }
+            mTotal += mPendingItems.size() - previousCount;
+            Q_EMIT q->progress(mProcessed, mTotal);
+        }
+        scheduleNext();
+    });
+}
+
+void FilterCollectionsJob::FilterCollectionsJobPrivate::fetchPage()
+{
+    const Akonadi::Item::List page = mPendingItems.mid(0, mPageSize);
+    mPendingItems.remove(0, page.size());
+    mFetching = true;
+
+    auto job = new Akonadi::ItemFetchJob(page, q);
+    switch (mRequiredPart) {
+    case SearchRule::Envelope:
+        job->fetchScope().fetchPayloadPart(Akonadi::MessagePart::Envelope);
+        break;
+    case SearchRule::Header:
+        job->fetchScope().fetchPayloadPart(Akonadi::MessagePart::Header);
+        break;
+    case SearchRule::CompleteMessage:
+        job->fetchScope().fetchFullPayload();
+        break;
+    }
+    job->fetchScope().setAncestorRetrieval(Akonadi::ItemFetchScope::Parent);
+    connect(job, &KJob::result, q, [this, pageSize = page.size()](KJob *job) {
+        mFetching = false;
+        if (job->error()) {
+            qCWarning(MAILCOMMON_LOG) << "Failed to fetch the items to filter:" << job->errorString();
+            mProcessed += pageSize;
+            Q_EMIT q->progress(mProcessed, mTotal);
+        } else {
+            mFetchedPage += static_cast<Akonadi::ItemFetchJob *>(job)->items();
+        }
+        scheduleNext();
+    });
+}
+
+bool FilterCollectionsJob::FilterCollectionsJobPrivate::canEvaluateInThreads() const
+{
+    // Logged entries of the messages would be interleaved, and the contact
+    // search used until the contact index is loaded needs the main thread.
+    if (FilterLog::instance()->isLogging()) {
+        return false;
+    }
+    return !mUsesContactIndex || ContactEmailIndex::self()->isLoaded();
+}
+
+void FilterCollectionsJob::FilterCollectionsJobPrivate::startEvaluation(const Akonadi::Item::List &items)
+{
+    mEvaluating = true;
+    const qsizetype count = items.size();
+    if (!canEvaluateInThreads() || count < 2) {
+        std::vector<QBitArray> matches;
+        matches.reserve(count);
+        for (const Akonadi::Item &item : items) {
+            matches.push_back(mIndex.matches(item));
+        }
+        QMetaObject::invokeMethod(
+            q,
+            [this, items, matches]() {
+                evaluationDone(items, matches);
+            },
+            Qt::QueuedConnection);
+        return;
+    }
+
+    // The patterns are compiled and only read from now on, and each message
+    // is only used by a single worker.
+    const qsizetype chunkSize = (count + mPool.maxThreadCount() - 1) / mPool.maxThreadCount();
+    const qsizetype chunkCount = (count + chunkSize - 1) / chunkSize;
+    auto matches = std::make_shared<std::vector<QBitArray>>(count);
+    auto remaining = std::make_shared<QAtomicInt>(chunkCount);
+    for (qsizetype start = 0; start < count; start += chunkSize) {
+        const qsizetype end = qMin(start + chunkSize, count);
+        mPool.start([this, items, matches, remaining, start, end]() {
+            for (qsizetype i = start; i < end; ++i) {
+                (*matches)[i] = mIndex.matches(items.at(i));
+            }
+            if (!remaining->deref()) {
+                QMetaObject::invokeMethod(
+                    q,
+                    [this, items, matches]() {
+                        evaluationDone(items, *matches);
+                    },
+                    Qt::QueuedConnection);
+            }
+        });
+    }
+}
+
+void FilterCollectionsJob::FilterCollectionsJobPrivate::evaluationDone(const Akonadi::Item::List &items, const std::vector<QBitArray> &matches)
+{
+    mEvaluating = false;
+    for (qsizetype i = 0; i < items.size(); ++i) {
+        ItemContext context(items.at(i), mRequiredPart == SearchRule::CompleteMessage);
+        applyFilters(context, matches.at(i));
+        mBatch->add(context);
+    }
+
+    mProcessed += items.size();
+    Q_EMIT q->progress(mProcessed, mTotal);
+    scheduleNext();
+}
+
+void FilterCollectionsJob::FilterCollectionsJobPrivate::applyFilters(ItemContext &context, const QBitArray &matches) const
+{
+    bool itemChanged = false;
+    // Shared by the status rules of all filters, as long as no action changes the flags
+    ItemStatusSnapshot statusSnapshot(context.item());
+    for (std::size_t i = 0; i < mFilters.size(); ++i) {
+        const MailFilter *filter = mFilters.at(i).get();
+        // The actions of a previous filter may have changed what the pattern
+        // looks at, in which case the precomputed result is stale.
+        const bool match = itemChanged ? filter->pattern()->matches(context.item()) : matches.testBit(i);
+        if (!match) {
+            continue;
+        }
+        bool stopIt = false;
+        if (filter->execActions(context, stopIt, mApplyOnOutbound) == MailFilter::CriticalError) {
+            qCWarning(MAILCOMMON_LOG) << "Critical error while applying filter" << filter->name() << "on item" << context.item().id();
+            return;
+        }
+        itemChanged = context.needsFlagStore() || context.needsPayloadStore();
+        if (context.needsFlagStore()) {
+            statusSnapshot.invalidate();
+        }
+        if (stopIt) {
+            return;
+        }
+    }
+}
+
+void FilterCollectionsJob::FilterCollectionsJobPrivate::finish()
+{
+    if (mFinished) {
+        return;
+    }
+    mFinished = true;
+    mElapsed = mTimer.elapsed();
+    Q_EMIT q->finished();
+    q->deleteLater();
+}
+
+FilterCollectionsJob::FilterCollectionsJob(const Akonadi::Collection::List &collections,
+                                           const QList<MailCommon::MailFilter *> &filters,
+                                           FilterManager::FilterSet set,
+                                           QObject *parent)
+    : QObject(parent)
+    , d(new FilterCollectionsJobPrivate(this))
+{
+    d->mCollections = collections;
+    connect(d->mBatch, &ItemContextBatch::idle, this, [this]() {
+        d->scheduleNext();
+    });
+    d->mApplyOnOutbound = set & FilterManager::Outbound;
+
+    QList<const SearchPattern *> patterns;
+    for (const MailFilter *filter : filters) {
+        if (!isApplicable(filter, set)) {
+            continue;
+        }
+        auto copy = std::make_unique<MailFilter>(*filter);
+        d->mRequiredPart = qMax(d->mRequiredPart, filterRequiredPart(copy.get()));
+        d->mUsesContactIndex = d->mUsesContactIndex || usesContactIndex(copy->pattern());
+        patterns.append(copy->pattern());
+        d->mFilters.push_back(std::move(copy));
+    }
+    d->mIndex.setPatterns(patterns);
+}
+
+FilterCollectionsJob::~FilterCollectionsJob() = default;
+
+void FilterCollectionsJob::start()
+{
+    d->mTimer.start();
+    if (d->mFilters.empty()) {
+        d->mCollections.clear();
+    }
+    if (d->mUsesContactIndex) {
+        // Start loading the contact index, so that the patterns can be
+        // evaluated on the thread pool as soon as possible
+        ContactEmailIndex::self();
+    }
+    d->scheduleNext();
+}
+
+void FilterCollectionsJob::kill()
+{
+    d->mKilled = true;
+    d->scheduleNext();
+}
+
+int FilterCollectionsJob::filterCount() const
+{
+    return d->mFilters.size();
+}
+
+SearchRule::RequiredPart FilterCollectionsJob::requiredPart() const
+{
+    return d->mRequiredPart;
+}
+
+int FilterCollectionsJob::pageSize() const
+{
+    return d->mPageSize;
+}
+
+void FilterCollectionsJob::setPageSize(int size)
+{
+    d->mPageSize = qMax(1, size);
+}
+
+qint64 FilterCollectionsJob::processedCount() const
+{
+    return d->mProcessed;
+}
+
+qint64 FilterCollectionsJob::totalCount() const
+{
+    return d->mTotal;
+}
+
+double FilterCollectionsJob::itemsPerSecond() const
+{
+    const qint64 elapsed = d->mFinished ? d->mElapsed : (d->mTimer.isValid() ? d->mTimer.elapsed() : 0);
+    return elapsed > 0 ? d->mProcessed * 1000.0 / elapsed : 0.0;
+}
+
+bool FilterCollectionsJob::isApplicable(const MailFilter *filter, FilterManager::FilterSet set)
+{
+    if (!filter->isEnabled()) {
+        return false;
+    }
+    return ((set & FilterManager::Inbound) && filter->applyOnInbound()) || ((set & FilterManager::Outbound) && filter->applyOnOutbound())
+        || ((set & FilterManager::BeforeOutbound) && filter->applyBeforeOutbound()) || ((set & FilterManager::Explicit) && filter->applyOnExplicit())
+        || ((set & FilterManager::AllFolders) && filter->applyOnAllFoldersInbound());
+}
+
+#include "moc_filtercollectionsjob.cpp"
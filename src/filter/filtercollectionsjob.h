@@ -0,0 +1,105 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "filtermanager.h"
+#include "mailcommon_private_export.h"
+
+#include <Akonadi/Collection>
+#include <Akonadi/Item>
+
+#include <QObject>
+
+#include <memory>
+
+class KJob;
+
+namespace MailCommon
+{
+class ItemContext;
+class MailFilter;
+
+/**
+ * @short Applies filters on all messages of a list of collections in-process.
+ *
+ * The messages are fetched in pages, with only the part required by the
+ * applicable filters. The next page is fetched while the patterns of all
+ * filters are matched against the current one on a thread pool, through a
+ * SearchPatternIndex. The filter actions then run in the main thread, and
+ * the resulting changes are written back in bulk through an ItemContextBatch.
+ *
+ * The job works on copies of the filters and deletes itself when finished.
+ */
+class MAILCOMMON_TESTS_EXPORT FilterCollectionsJob : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Creates a job applying the \a filters that belong to \a set on
+     * all messages of \a collections.
+     */
+    FilterCollectionsJob(const Akonadi::Collection::List &collections,
+                         const QList<MailCommon::MailFilter *> &filters,
+                         FilterManager::FilterSet set,
+                         QObject *parent = nullptr);
+    ~FilterCollectionsJob() override;
+
+    /**
+     * Starts the job.
+     */
+    void start();
+
+    /**
+     * Stops the job once the current page is committed.
+     */
+    void kill();
+
+    /**
+     * Returns the number of filters applied by the job.
+     */
+    [[nodiscard]] int filterCount() const;
+
+    /**
+     * Returns the message part fetched for each message.
+     */
+    [[nodiscard]] SearchRule::RequiredPart requiredPart() const;
+
+    /**
+     * Returns the number of messages fetched per page.
+     */
+    [[nodiscard]] int pageSize() const;
+    void setPageSize(int size);
+
+    /**
+     * Returns the number of messages processed so far.
+     */
+    [[nodiscard]] qint64 processedCount() const;
+
+    /**
+     * Returns the number of messages found so far in the collections.
+     */
+    [[nodiscard]] qint64 totalCount() const;
+
+    /**
+     * Returns the number of messages processed per second.
+     */
+    [[nodiscard]] double itemsPerSecond() const;
+
+    /**
+     * Returns whether \a filter belongs to \a set.
+     */
+    [[nodiscard]] static bool isApplicable(const MailCommon::MailFilter *filter, FilterManager::FilterSet set);
+
+Q_SIGNALS:
+    void progress(qint64 processed, qint64 total);
+    void finished();
+
+private:
+    class FilterCollectionsJobPrivate;
+    std::unique_ptr<FilterCollectionsJobPrivate> const d;
+};
+}
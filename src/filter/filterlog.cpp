@@ -5,12 +5,17 @@
 */
 
 #include "filterlog.h"
+#include "search/searchrule/searchrule.h"
 
 #include "mailcommon_debug.h"
 
 #include <QFile>
+#include <QMetaMethod>
+#include <QMutex>
 #include <QTime>
 
+#include <atomic>
+
 #include <sys/stat.h>
 
 using namespace MailCommon;
@@ -18,6 +23,20 @@ using namespace MailCommon;
 class Q_DECL_HIDDEN FilterLog::FilterLogPrivate
 {
 public:
+    // A log entry, formatted to text only when it is read
+    struct Record {
+        QString text;
+        // Rule results
+        QByteArray field;
+        QString contents;
+        qint64 sequence = 0;
+        int time = -1; // msecs since midnight, -1 for entries without timestamp
+        FilterLog::ContentType type = FilterLog::Meta;
+        SearchRule::Function function = SearchRule::FuncNone;
+        bool isRuleResult = false;
+        bool result = false;
+    };
+
     FilterLogPrivate(FilterLog *qq)
         : q(qq)
         , mMaxLogSize(512 * 1024)
@@ -27,36 +46,168 @@ public:
 
     static FilterLog *mSelf;
 
+    [[nodiscard]] static QString format(const Record &record);
+    [[nodiscard]] static long recordSize(const Record &record);
+    [[nodiscard]] bool isEnabled(FilterLog::ContentType type) const;
+    [[nodiscard]] QStringList entries() const;
+    void append(Record &&record);
+    void removeFirst();
+    void emitPendingSignals();
+
     FilterLog *const q;
-    QStringList mLogEntries;
+    mutable QMutex mMutex;
+    // Ring buffer of mCount records starting at mFirst, grown when full
+    QList<Record> mRecords;
+    qsizetype mFirst = 0;
+    qsizetype mCount = 0;
+    qint64 mNextSequence = 0;
+    qint64 mSignaledSequence = 0;
     long mMaxLogSize;
     long mCurrentLogSize = 0;
-    int mAllowedTypes;
-    bool mLogging = false;
+    std::atomic<int> mAllowedTypes;
+    std::atomic<bool> mLogging = false;
+    bool mSignalScheduled = false;
+    bool mShrunk = false;
 
     void checkLogSize();
 };
 
 using namespace Qt::Literals::StringLiterals;
+
+QString FilterLog::FilterLogPrivate::format(const Record &record)
+{
+    QString entry;
+    if (record.isRuleResult) {
+        entry = (record.result ? QStringLiteral("<font color=#00FF00>1 = </font>") : QStringLiteral("<font color=#FF0000>0 = </font>"));
+        entry += FilterLog::recode(SearchRule::asString(record.field, record.function, record.contents));
+        if (!record.text.isEmpty()) {
+            entry += QLatin1StringView(" ( <i>") + FilterLog::recode(record.text) + QLatin1StringView("</i> )");
+        }
+    } else {
+        entry = record.text;
+    }
+    if (record.time >= 0) {
+        entry = u'[' + QTime::fromMSecsSinceStartOfDay(record.time).toString() + QLatin1StringView("] ") + entry;
+    }
+    return entry;
+}
+
+long FilterLog::FilterLogPrivate::recordSize(const Record &record)
+{
+    // An estimate of the formatted length, computing it would defeat the purpose
+    long size = record.text.size();
+    if (record.isRuleResult) {
+        size += record.field.size() + record.contents.size() + 64;
+    }
+    if (record.time >= 0) {
+        size += 11;
+    }
+    return size;
+}
+
+bool FilterLog::FilterLogPrivate::isEnabled(FilterLog::ContentType type) const
+{
+    return mLogging.load(std::memory_order_relaxed) && (mAllowedTypes.load(std::memory_order_relaxed) & type);
+}
+
+QStringList FilterLog::FilterLogPrivate::entries() const
+{
+    QMutexLocker locker(&mMutex);
+    QStringList list;
+    list.reserve(mCount);
+    for (qsizetype i = 0; i < mCount; ++i) {
+        list.append(format(mRecords.at((mFirst + i) % mRecords.size())));
+    }
+    return list;
+}
+
+void FilterLog::FilterLogPrivate::append(Record &&record)
+{
+    if (record.type & ~FilterLog::Meta) {
+        record.time = QTime::currentTime().msecsSinceStartOfDay();
+    }
+    bool scheduleSignal = false;
+    {
+        QMutexLocker locker(&mMutex);
+        if (mCount == mRecords.size()) {
+            // Full: linearize into a buffer twice as large
+            QList<Record> records;
+            records.reserve(qMax<qsizetype>(64, mRecords.size() * 2));
+            for (qsizetype i = 0; i < mCount; ++i) {
+                records.append(std::move(mRecords[(mFirst + i) % mRecords.size()]));
+            }
+            records.resize(records.capacity());
+            mRecords = std::move(records);
+            mFirst = 0;
+        }
+        record.sequence = mNextSequence++;
+        mCurrentLogSize += recordSize(record);
+        mRecords[(mFirst + mCount) % mRecords.size()] = std::move(record);
+        ++mCount;
+        checkLogSize();
+        scheduleSignal = !mSignalScheduled;
+        mSignalScheduled = true;
+    }
+    if (scheduleSignal) {
+        QMetaObject::invokeMethod(
+            q,
+            [this]() {
+                emitPendingSignals();
+            },
+            Qt::QueuedConnection);
+    }
+}
+
+void FilterLog::FilterLogPrivate::removeFirst()
+{
+    Record &record = mRecords[mFirst];
+    mCurrentLogSize -= recordSize(record);
+    record = Record();
+    mFirst = (mFirst + 1) % mRecords.size();
+    --mCount;
+}
+
+void FilterLog::FilterLogPrivate::emitPendingSignals()
+{
+    QStringList newEntries;
+    bool shrunk = false;
+    {
+        QMutexLocker locker(&mMutex);
+        mSignalScheduled = false;
+        shrunk = std::exchange(mShrunk, false);
+        if (q->isSignalConnected(QMetaMethod::fromSignal(&FilterLog::logEntryAdded))) {
+            for (qsizetype i = 0; i < mCount; ++i) {
+                const Record &record = mRecords.at((mFirst + i) % mRecords.size());
+                if (record.sequence >= mSignaledSequence) {
+                    newEntries.append(format(record));
+                }
+            }
+        }
+        mSignaledSequence = mNextSequence;
+    }
+    for (const QString &entry : std::as_const(newEntries)) {
+        Q_EMIT q->logEntryAdded(entry);
+    }
+    if (shrunk) {
+        Q_EMIT q->logShrinked();
+    }
+}
+
 void FilterLog::FilterLogPrivate::checkLogSize()
 {
+    // Called with mMutex locked
     if (mCurrentLogSize > mMaxLogSize && mMaxLogSize > -1) {
         qCDebug(MAILCOMMON_LOG) << "Filter log: memory limit reached, starting to discard old items, size =" << QString::number(mCurrentLogSize);
 
         // avoid some kind of hysteresis, shrink the log to 90% of its maximum
-        while (mCurrentLogSize > (mMaxLogSize * 0.9)) {
-            QStringList::Iterator it = mLogEntries.begin();
-            if (it != mLogEntries.end()) {
-                mCurrentLogSize -= (*it).length();
-                mLogEntries.erase(it);
-                qCDebug(MAILCOMMON_LOG) << "Filter log: new size =" << QString::number(mCurrentLogSize);
-            } else {
-                qCDebug(MAILCOMMON_LOG) << "Filter log: size reduction disaster!";
-                q->clear();
-            }
+        while (mCount > 0 && mCurrentLogSize > (mMaxLogSize * 0.9)) {
+            removeFirst();
         }
-
-        Q_EMIT q->logShrinked();
+        if (mCount == 0) {
+            mCurrentLogSize = 0;
+        }
+        qCDebug(MAILCOMMON_LOG) << "Filter log: new size =" << QString::number(mCurrentLogSize);
+        mShrunk = true;
     }
 }
 
@@ -80,7 +231,7 @@ FilterLog *FilterLog::instance()
 
 bool FilterLog::isLogging() const
 {
-    return d->mLogging;
+    return d->mLogging.load(std::memory_order_relaxed);
 }
 
 void FilterLog::setLogging(bool active)
@@ -100,13 +251,22 @@ void FilterLog::setMaxLogSize(long size)
         size = 1024;
     }
 
-    d->mMaxLogSize = size;
+    bool shrunk = false;
+    {
+        QMutexLocker locker(&d->mMutex);
+        d->mMaxLogSize = size;
+        d->checkLogSize();
+        shrunk = std::exchange(d->mShrunk, false);
+    }
     Q_EMIT logStateChanged();
-    d->checkLogSize();
+    if (shrunk) {
+        Q_EMIT logShrinked();
+    }
 }
 
 long FilterLog::maxLogSize() const
 {
+    QMutexLocker locker(&d->mMutex);
     return d->mMaxLogSize;
 }
 
@@ -123,23 +283,31 @@ void FilterLog::setContentTypeEnabled(ContentType contentType, bool enable)
 
 bool FilterLog::isContentTypeEnabled(ContentType contentType) const
 {
-    return d->mAllowedTypes & contentType;
+    return d->mAllowedTypes.load(std::memory_order_relaxed) & contentType;
 }
 
 void FilterLog::add(const QString &logEntry, ContentType contentType)
 {
-    if (isLogging() && (d->mAllowedTypes & contentType)) {
-        QString timedLog;
-        if (contentType & ~Meta) {
-            timedLog = u'[' + QTime::currentTime().toString() + QLatin1StringView("] ") + logEntry;
-        } else {
-            timedLog = logEntry;
-        }
+    if (d->isEnabled(contentType)) {
+        FilterLogPrivate::Record record;
+        record.text = logEntry;
+        record.type = contentType;
+        d->append(std::move(record));
+    }
+}
 
-        d->mLogEntries.append(timedLog);
-        Q_EMIT logEntryAdded(timedLog);
-        d->mCurrentLogSize += timedLog.length();
-        d->checkLogSize();
+void FilterLog::addRuleResult(const SearchRule &rule, bool result, const QString &value)
+{
+    if (d->isEnabled(RuleResult)) {
+        FilterLogPrivate::Record record;
+        record.text = value;
+        record.field = rule.field();
+        record.contents = rule.contents();
+        record.type = RuleResult;
+        record.function = rule.function();
+        record.isRuleResult = true;
+        record.result = result;
+        d->append(std::move(record));
     }
 }
 
@@ -150,19 +318,23 @@ void FilterLog::addSeparator()
 
 void FilterLog::clear()
 {
-    d->mLogEntries.clear();
+    QMutexLocker locker(&d->mMutex);
+    d->mRecords.clear();
+    d->mFirst = 0;
+    d->mCount = 0;
     d->mCurrentLogSize = 0;
 }
 
 QStringList FilterLog::logEntries() const
 {
-    return d->mLogEntries;
+    return d->entries();
 }
 
 void FilterLog::dump()
 {
     qCDebug(MAILCOMMON_LOG) << "----- starting filter log -----";
-    for (const QString &entry : std::as_const(d->mLogEntries)) {
+    const QStringList entries = d->entries();
+    for (const QString &entry : entries) {
         qCDebug(MAILCOMMON_LOG) << entry;
     }
     qCDebug(MAILCOMMON_LOG) << "------ end of filter log ------";
@@ -177,7 +349,8 @@ bool FilterLog::saveToFile(const QString &fileName) const
 
     file.write("<html>\n<body>\n");
     file.write("<meta http-equiv=\"content-type\" content=\"text/html; charset=UTF-8\">\n");
-    for (const QString &entry : std::as_const(d->mLogEntries)) {
+    const QStringList entries = d->entries();
+    for (const QString &entry : entries) {
         const QString line = QLatin1StringView("<p>") + entry + QLatin1StringView("</p>") + u'\n';
         file.write(line.toLocal8Bit());
     }
@@ -13,6 +13,8 @@
 #include <memory>
 namespace MailCommon
 {
+class SearchRule;
+
 /*!
  * \class MailCommon::FilterLog
  * \inmodule MailCommon
@@ -31,6 +33,11 @@ namespace MailCommon
  * A signal is emitted whenever a new logentry is added,
  * when the log was cleared or any log state was changed.
  *
+ * Entries are kept as structured records in a ring buffer and only
+ * formatted to text when they are read, saved or signaled. Entries can
+ * be added from any thread; the signals are emitted in batches from the
+ * thread of the log.
+ *
  * \author Andreas Gungl <a.gungl@gmx.de>
  */
 class MAILCOMMON_EXPORT FilterLog : public QObject
@@ -94,6 +101,15 @@ public:
      */
     void add(const QString &entry, ContentType type);
 
+    /*!
+     * Adds the \a result of matching \a rule to the log, under the
+     * RuleResult content type. The optional \a value is the message
+     * content the rule was matched against.
+     *
+     * The entry is formatted only when the log is read.
+     */
+    void addRuleResult(const SearchRule &rule, bool result, const QString &value = QString());
+
     /*!
      * Adds a separator line to the log.
      */
@@ -129,7 +145,9 @@ public:
 
 Q_SIGNALS:
     /*!
-     * This signal is emitted whenever a new \a entry has been added to the log.
+     * This signal is emitted for each \a entry added to the log. The entries
+     * added since the last return to the event loop are signaled together,
+     * and are only formatted if the signal is connected.
      */
     void logEntryAdded(const QString &entry);
 
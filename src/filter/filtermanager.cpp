@@ -8,6 +8,7 @@
 #include "mailcommon_debug.h"
 
 #include "filteractions/filteractiondict.h"
+#include "filtercollectionsjob.h"
 #include "filterimporterexporter.h"
 #include "mailfilteragentinterface.h"
 #include <Akonadi/Monitor>
@@ -17,6 +18,7 @@
 #include <Akonadi/TagFetchScope>
 #include <KConfigGroup>
 
+#include <QPointer>
 #include <QTimer>
 
 namespace MailCommon
@@ -36,6 +38,8 @@ public:
     void readConfig();
     void writeConfig(bool withSync = true) const;
     void clear();
+    bool startFiltering(const Akonadi::Collection::List &collections, const QList<MailCommon::MailFilter *> &filters, FilterSet set);
+    bool canFilterInProcess() const;
 
     QMap<QUrl, QString> mTagList;
     static FilterManager *mInstance;
@@ -45,6 +49,10 @@ public:
     OrgFreedesktopAkonadiMailFilterAgentInterface *mMailFilterAgentInterface = nullptr;
     QList<MailCommon::MailFilter *> mFilters;
     Akonadi::Monitor *const mMonitor;
+    QPointer<FilterCollectionsJob> mFilterJob;
+    qint64 mFilteredItemCount = 0;
+    qint64 mTotalItemCount = 0;
+    double mFilteredItemsPerSecond = 0.0;
     bool mInitialized = false;
 };
 
@@ -231,6 +239,11 @@ void FilterManager::filter(const Akonadi::Collection &collection, FilterSet set)
 
 void FilterManager::filter(const Akonadi::Collection::List &collections, FilterSet set) const
 {
+    if (d->canFilterInProcess()) {
+        d->startFiltering(collections, d->mFilters, set);
+        return;
+    }
+
     QList<qint64> colIds;
     colIds.reserve(collections.size());
     for (const auto &col : collections) {
@@ -247,6 +260,17 @@ void FilterManager::filter(const Akonadi::Collection &collection, const QStringL
 
 void FilterManager::filter(const Akonadi::Collection::List &collections, const QStringList &listFilters, FilterSet set) const
 {
+    if (d->canFilterInProcess()) {
+        QList<MailCommon::MailFilter *> filters;
+        for (MailCommon::MailFilter *filter : std::as_const(d->mFilters)) {
+            if (listFilters.contains(filter->identifier())) {
+                filters.append(filter);
+            }
+        }
+        d->startFiltering(collections, filters, set);
+        return;
+    }
+
     QList<qint64> colIds;
     colIds.reserve(collections.size());
     for (const auto &col : collections) {
@@ -279,6 +303,74 @@ void FilterManager::filter(const Akonadi::Item::List &messages, SearchRule::Requ
     d->mMailFilterAgentInterface->applySpecificFilters(itemIds, static_cast<int>(requiredPart), listFilters);
 }
 
+bool FilterManager::FilterManagerPrivate::canFilterInProcess() const
+{
+    // The filters are only known here once read, and a running filtering
+    // must not be restarted: let the agent handle the request then
+    return mInitialized && !mFilterJob;
+}
+
+bool FilterManager::FilterManagerPrivate::startFiltering(const Akonadi::Collection::List &collections,
+                                                         const QList<MailCommon::MailFilter *> &filters,
+                                                         FilterSet set)
+{
+    if (mFilterJob) {
+        qCWarning(MAILCOMMON_LOG) << "Filters are already being applied";
+        return false;
+    }
+    mFilteredItemCount = 0;
+    mTotalItemCount = 0;
+    mFilteredItemsPerSecond = 0.0;
+
+    auto job = new FilterCollectionsJob(collections, filters, set, q);
+    QObject::connect(job, &FilterCollectionsJob::progress, q, [this, job](qint64 processed, qint64 total) {
+        mFilteredItemCount = processed;
+        mTotalItemCount = total;
+        mFilteredItemsPerSecond = job->itemsPerSecond();
+        Q_EMIT q->filteringProgress(processed, total);
+    });
+    QObject::connect(job, &FilterCollectionsJob::finished, q, [this, job]() {
+        mFilteredItemsPerSecond = job->itemsPerSecond();
+        mFilterJob.clear();
+        Q_EMIT q->filteringFinished();
+    });
+    mFilterJob = job;
+    job->start();
+    return true;
+}
+
+bool FilterManager::applyFilters(const Akonadi::Collection::List &collections, FilterSet set)
+{
+    return d->startFiltering(collections, d->mFilters, set);
+}
+
+void FilterManager::cancelFiltering()
+{
+    if (d->mFilterJob) {
+        d->mFilterJob->kill();
+    }
+}
+
+bool FilterManager::isFiltering() const
+{
+    return d->mFilterJob;
+}
+
+qint64 FilterManager::filteredItemCount() const
+{
+    return d->mFilteredItemCount;
+}
+
+qint64 FilterManager::totalItemCount() const
+{
+    return d->mTotalItemCount;
+}
+
+double FilterManager::filteredItemsPerSecond() const
+{
+    return d->mFilteredItemsPerSecond;
+}
+
 void FilterManager::setFilters(const QList<MailCommon::MailFilter *> &filters)
 {
     beginUpdate();
@@ -98,7 +98,7 @@ public:
     /*!
      * Process all messages in given collection by applying the filters rules one
      * by one. You can select which set of filters (incoming or outgoing)
-     * should be used.
+     * should be used. See filter(const Akonadi::Collection::List &, FilterSet).
      */
     void filter(const Akonadi::Collection &collection, FilterSet set = Explicit) const;
 
@@ -111,11 +111,16 @@ public:
      * Process all messages in given collections by applying the filters rules one
      * by one. You can select which set of filters (incoming or outgoing)
      * should be used.
+     *
+     * Once the filters are read (see initialized()), they are applied in this
+     * process like applyFilters() does. Until then, or while a filtering is
+     * already running, the request is forwarded to the mail filter agent.
      */
     void filter(const Akonadi::Collection::List &collections, FilterSet set = Explicit) const;
 
     /*!
-     * Apply specified filters on all messages in given collection
+     * Apply specified filters on all messages in given collection, in this
+     * process or through the mail filter agent like filter() above.
      */
     void filter(const Akonadi::Collection::List &collections, const QStringList &listFilters, FilterSet set = Explicit) const;
 
@@ -131,6 +136,45 @@ public:
 
     void filter(const Akonadi::Item::List &messages, SearchRule::RequiredPart requiredPart, const QStringList &listFilters) const;
 
+    /*!
+     * Applies the filters of the given \a set on all messages in \a collections
+     * in this process, instead of forwarding the request to the mail filter agent.
+     * The filter() overloads taking collections use it once the filters are read.
+     *
+     * The messages are fetched in pages with only the part needed by the
+     * filters, the patterns are matched on a thread pool and the resulting
+     * changes are written back in bulk. Progress is reported through
+     * filteringProgress() and filteringFinished().
+     *
+     * Returns \ false if a filtering is already running.
+     */
+    bool applyFilters(const Akonadi::Collection::List &collections, FilterSet set = Explicit);
+
+    /*!
+     * Stops the filtering started by applyFilters().
+     */
+    void cancelFiltering();
+
+    /*!
+     * Returns whether a filtering started by applyFilters() is running.
+     */
+    [[nodiscard]] bool isFiltering() const;
+
+    /*!
+     * Returns the number of messages processed by the current or last filtering.
+     */
+    [[nodiscard]] qint64 filteredItemCount() const;
+
+    /*!
+     * Returns the number of messages found so far by the current or last filtering.
+     */
+    [[nodiscard]] qint64 totalItemCount() const;
+
+    /*!
+     * Returns the number of messages filtered per second by the current or last filtering.
+     */
+    [[nodiscard]] double filteredItemsPerSecond() const;
+
     /// Manage filters interface
 
     /*!
@@ -192,6 +236,16 @@ Q_SIGNALS:
 
     void loadingFiltersDone();
 
+    /*!
+     * This signal is emitted when messages were processed by applyFilters().
+     */
+    void filteringProgress(qint64 processed, qint64 total);
+
+    /*!
+     * This signal is emitted when the filtering started by applyFilters() is done.
+     */
+    void filteringFinished();
+
 private:
     MAILCOMMON_NO_EXPORT FilterManager();
 
@@ -0,0 +1,258 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "itemcontextbatch.h"
+#include "itemcontext.h"
+#include "mailcommon_debug.h"
+
+#include <Akonadi/ItemDeleteJob>
+#include <Akonadi/ItemModifyJob>
+#include <Akonadi/ItemMoveJob>
+
+#include <QHash>
+#include <QMap>
+#include <QTimer>
+
+#include <algorithm>
+
+using namespace MailCommon;
+
+class Q_DECL_HIDDEN ItemContextBatch::ItemContextBatchPrivate
+{
+public:
+    struct Plan {
+        Akonadi::Item::List payloadChanges;
+        Akonadi::Item::List tagChanges;
+        QMap<QList<QByteArray>, Akonadi::Item::List> flagChanges;
+        QMap<Akonadi::Collection::Id, Akonadi::Item::List> moves;
+        Akonadi::Item::List deletions;
+
+        [[nodiscard]] int jobCount() const
+        {
+            return payloadChanges.size() + tagChanges.size() + flagChanges.size() + moves.size() + (deletions.isEmpty() ? 0 : 1);
+        }
+    };
+
+    explicit ItemContextBatchPrivate(ItemContextBatch *qq)
+        : q(qq)
+    {
+        mTimer.setSingleShot(true);
+    }
+
+    [[nodiscard]] Plan plan() const;
+    void startJob(KJob *job, qsizetype itemCount);
+
+    ItemContextBatch *const q;
+    QList<ItemContext> mContexts;
+    QHash<Akonadi::Item::Id, qsizetype> mContextIndex;
+    QTimer mTimer;
+    qint64 mCommittedItemCount = 0;
+    qint64 mJobCount = 0;
+    int mMaximumSize = 500;
+    int mRunningJobs = 0;
+};
+
+ItemContextBatch::ItemContextBatchPrivate::Plan ItemContextBatch::ItemContextBatchPrivate::plan() const
+{
+    Plan plan;
+    for (ItemContext context : mContexts) {
+        const Akonadi::Item &item = context.item();
+        if (context.deleteItem()) {
+            plan.deletions.append(item);
+            continue;
+        }
+        if (context.needsPayloadStore()) {
+            plan.payloadChanges.append(item);
+        } else if (context.needsFlagStore() && !item.tags().isEmpty()) {
+            // A batch modification sends the tag changes of its first item
+            // for all of them. Items are not fetched with their tags, so the
+            // tags can't be overwritten either: store these one by one.
+            plan.tagChanges.append(item);
+        } else if (context.needsFlagStore()) {
+            // A batch modification sends the flags of its first item for all
+            // of them, so group by the complete flag set and overwrite it
+            // rather than sending the added and removed flags.
+            Akonadi::Item overwrite(item);
+            overwrite.setFlags(item.flags());
+            QList<QByteArray> flags(item.flags().cbegin(), item.flags().cend());
+            std::sort(flags.begin(), flags.end());
+            plan.flagChanges[flags].append(overwrite);
+        }
+        const Akonadi::Collection target = context.moveTargetCollection();
+        if (target.isValid() && target != item.parentCollection()) {
+            plan.moves[target.id()].append(item);
+        }
+    }
+    return plan;
+}
+
+void ItemContextBatch::ItemContextBatchPrivate::startJob(KJob *job, qsizetype itemCount)
+{
+    ++mRunningJobs;
+    ++mJobCount;
+    connect(job, &KJob::result, q, [this, itemCount](KJob *job) {
+        --mRunningJobs;
+        if (job->error()) {
+            qCWarning(MAILCOMMON_LOG) << "Failed to store the filtered items:" << job->errorString();
+        } else {
+            mCommittedItemCount += itemCount;
+        }
+        if (q->isIdle()) {
+            Q_EMIT q->idle();
+        }
+    });
+}
+
+ItemContextBatch::ItemContextBatch(QObject *parent)
+    : QObject(parent)
+    , d(new ItemContextBatchPrivate(this))
+{
+    d->mTimer.setInterval(1000);
+    connect(&d->mTimer, &QTimer::timeout, this, &ItemContextBatch::flush);
+}
+
+ItemContextBatch::~ItemContextBatch()
+{
+    flush();
+}
+
+void ItemContextBatch::setMaximumSize(int size)
+{
+    d->mMaximumSize = qMax(1, size);
+}
+
+int ItemContextBatch::maximumSize() const
+{
+    return d->mMaximumSize;
+}
+
+void ItemContextBatch::setFlushInterval(int msec)
+{
+    d->mTimer.setInterval(qMax(0, msec));
+    if (msec <= 0) {
+        d->mTimer.stop();
+    }
+}
+
+int ItemContextBatch::flushInterval() const
+{
+    return d->mTimer.interval();
+}
+
+void ItemContextBatch::add(const ItemContext &context)
+{
+    ItemContext copy(context);
+    const Akonadi::Item::Id id = copy.item().id();
+    const auto it = d->mContextIndex.constFind(id);
+    if (it != d->mContextIndex.cend()) {
+        d->mContexts[it.value()] = copy;
+        return;
+    }
+    d->mContextIndex.insert(id, d->mContexts.size());
+    d->mContexts.append(copy);
+
+    if (d->mContexts.size() >= d->mMaximumSize) {
+        flush();
+    } else if (!d->mTimer.isActive() && d->mTimer.interval() > 0) {
+        d->mTimer.start();
+    }
+}
+
+void ItemContextBatch::flush()
+{
+    d->mTimer.stop();
+    if (d->mContexts.isEmpty()) {
+        return;
+    }
+    const ItemContextBatchPrivate::Plan plan = d->plan();
+    d->mContexts.clear();
+    d->mContextIndex.clear();
+
+    // The jobs of a session run in order, so the items are modified before
+    // being moved.
+    for (const Akonadi::Item &item : plan.payloadChanges) {
+        auto job = new Akonadi::ItemModifyJob(item);
+        job->disableRevisionCheck();
+        d->startJob(job, 1);
+    }
+    for (const Akonadi::Item &item : plan.tagChanges) {
+        auto job = new Akonadi::ItemModifyJob(item);
+        job->setIgnorePayload(true);
+        job->disableRevisionCheck();
+        d->startJob(job, 1);
+    }
+    for (auto it = plan.flagChanges.cbegin(), end = plan.flagChanges.cend(); it != end; ++it) {
+        auto job = new Akonadi::ItemModifyJob(it.value());
+        job->setIgnorePayload(true);
+        job->disableRevisionCheck();
+        d->startJob(job, it.value().size());
+    }
+    for (auto it = plan.moves.cbegin(), end = plan.moves.cend(); it != end; ++it) {
+        d->startJob(new Akonadi::ItemMoveJob(it.value(), Akonadi::Collection(it.key())), it.value().size());
+    }
+    if (!plan.deletions.isEmpty()) {
+        d->startJob(new Akonadi::ItemDeleteJob(plan.deletions), plan.deletions.size());
+    }
+    if (isIdle()) {
+        // Nothing had to be stored
+        Q_EMIT idle();
+    }
+}
+
+void ItemContextBatch::clear()
+{
+    d->mTimer.stop();
+    d->mContexts.clear();
+    d->mContextIndex.clear();
+}
+
+int ItemContextBatch::pendingCount() const
+{
+    return d->mContexts.size();
+}
+
+int ItemContextBatch::pendingJobCount() const
+{
+    return d->plan().jobCount();
+}
+
+QList<Akonadi::Item::List> ItemContextBatch::pendingModifications() const
+{
+    const ItemContextBatchPrivate::Plan plan = d->plan();
+    QList<Akonadi::Item::List> modifications;
+    for (const Akonadi::Item &item : plan.payloadChanges) {
+        modifications.append({item});
+    }
+    for (const Akonadi::Item &item : plan.tagChanges) {
+        modifications.append({item});
+    }
+    for (const Akonadi::Item::List &items : plan.flagChanges) {
+        modifications.append(items);
+    }
+    return modifications;
+}
+
+int ItemContextBatch::runningJobCount() const
+{
+    return d->mRunningJobs;
+}
+
+bool ItemContextBatch::isIdle() const
+{
+    return d->mContexts.isEmpty() && d->mRunningJobs == 0;
+}
+
+qint64 ItemContextBatch::committedItemCount() const
+{
+    return d->mCommittedItemCount;
+}
+
+qint64 ItemContextBatch::jobCount() const
+{
+    return d->mJobCount;
+}
+
+#include "moc_itemcontextbatch.cpp"
@@ -0,0 +1,135 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_export.h"
+
+#include <Akonadi/Item>
+
+#include <QObject>
+
+#include <memory>
+
+namespace MailCommon
+{
+class ItemContext;
+
+/*!
+ * \class MailCommon::ItemContextBatch
+ * \inmodule MailCommon
+ * \inheaderfile MailCommon/ItemContextBatch
+ *
+ * \brief Writes back the changes recorded in item contexts in bulk.
+ *
+ * Instead of storing each ItemContext with its own jobs, the contexts are
+ * accumulated and flushed in groups: one ItemMoveJob per target collection,
+ * one ItemModifyJob per set of flags, one ItemDeleteJob for the deleted
+ * items, and one ItemModifyJob per item whose payload or tags changed.
+ *
+ * The contexts are flushed when maximumSize() of them are pending, when
+ * flushInterval() elapsed since the first of them was added, or when
+ * flush() is called. Pending contexts are flushed on destruction.
+ */
+class MAILCOMMON_EXPORT ItemContextBatch : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * Creates an empty batch.
+     */
+    explicit ItemContextBatch(QObject *parent = nullptr);
+
+    /*!
+     * Destroys the batch after flushing it.
+     */
+    ~ItemContextBatch() override;
+
+    /*!
+     * Sets the number of pending contexts which triggers a flush.
+     */
+    void setMaximumSize(int size);
+
+    /*!
+     * Returns the number of pending contexts which triggers a flush. The default is 500.
+     */
+    [[nodiscard]] int maximumSize() const;
+
+    /*!
+     * Sets the time in milliseconds after which pending contexts are flushed.
+     * With 0, they are only flushed by size or explicitly.
+     */
+    void setFlushInterval(int msec);
+
+    /*!
+     * Returns the time in milliseconds after which pending contexts are flushed. The default is 1000.
+     */
+    [[nodiscard]] int flushInterval() const;
+
+    /*!
+     * Adds the changes recorded in \a context. A context added for an item
+     * which is already pending replaces the previous one.
+     */
+    void add(const ItemContext &context);
+
+    /*!
+     * Starts the jobs for all pending contexts.
+     */
+    void flush();
+
+    /*!
+     * Drops all pending contexts without storing them.
+     */
+    void clear();
+
+    /*!
+     * Returns the number of contexts waiting for the next flush.
+     */
+    [[nodiscard]] int pendingCount() const;
+
+    /*!
+     * Returns the number of jobs the next flush would start.
+     */
+    [[nodiscard]] int pendingJobCount() const;
+
+    /*!
+     * Returns the items of each ItemModifyJob the next flush would start.
+     * The items of a list share the same flags and carry no tags.
+     */
+    [[nodiscard]] QList<Akonadi::Item::List> pendingModifications() const;
+
+    /*!
+     * Returns the number of jobs started by previous flushes which are still running.
+     */
+    [[nodiscard]] int runningJobCount() const;
+
+    /*!
+     * Returns whether nothing is pending nor running.
+     */
+    [[nodiscard]] bool isIdle() const;
+
+    /*!
+     * Returns the number of item changes written back so far.
+     */
+    [[nodiscard]] qint64 committedItemCount() const;
+
+    /*!
+     * Returns the number of jobs started so far.
+     */
+    [[nodiscard]] qint64 jobCount() const;
+
+Q_SIGNALS:
+    /*!
+     * This signal is emitted when the last running job finished and no
+     * context is pending.
+     */
+    void idle();
+
+private:
+    class ItemContextBatchPrivate;
+    std::unique_ptr<ItemContextBatchPrivate> const d;
+};
+}
@@ -0,0 +1,292 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "foldersearchindextest.h"
+#include "../foldersearchindex_p.h"
+#include "../hierarchicalfoldermatcher_p.h"
+
+#include <Akonadi/EntityTreeModel>
+
+#include <QStandardItemModel>
+#include <QTest>
+
+using MailCommon::FolderSearchIndex;
+using MailCommon::HierarchicalFolderMatcher;
+
+FolderSearchIndexTest::FolderSearchIndexTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FolderSearchIndexTest::~FolderSearchIndexTest() = default;
+
+void FolderSearchIndexTest::init()
+{
+    mModel = new QStandardItemModel(this);
+    QStandardItem *root = mModel->invisibleRootItem();
+
+    QStandardItem *inbox = addFolder(root, QStringLiteral("Inbox"));
+    addFolder(inbox, QStringLiteral("Archive 2024"));
+    addFolder(addFolder(inbox, QStringLiteral("Archive 2025")), QStringLiteral("Projects"));
+    QStandardItem *lists = addFolder(inbox, QStringLiteral("Lists"));
+    addFolder(lists, QStringLiteral("KDE"));
+    addFolder(lists, QStringLiteral("Qt-Interest"));
+    QStandardItem *work = addFolder(root, QStringLiteral("Work"));
+    addFolder(addFolder(work, QStringLiteral("Projects")), QStringLiteral("Foo Bar"));
+    addFolder(work, QStringLiteral("Archive"));
+    addFolder(addFolder(root, QStringLiteral("Straße")), QStringLiteral("Größe"));
+
+    // Connected to the model before any proxy, like in EntityCollectionOrderProxyModel
+    mIndex = new FolderSearchIndex;
+    mIndex->setModel(mModel);
+}
+
+void FolderSearchIndexTest::cleanup()
+{
+    delete mIndex;
+    mIndex = nullptr;
+    delete mModel;
+    mModel = nullptr;
+}
+
+QStandardItem *FolderSearchIndexTest::addFolder(QStandardItem *parent, const QString &name)
+{
+    auto item = new QStandardItem(name);
+    item->setData(mNextId++, Akonadi::EntityTreeModel::CollectionIdRole);
+    parent->appendRow(item);
+    return item;
+}
+
+QStandardItem *FolderSearchIndexTest::findFolder(const QString &name) const
+{
+    const QModelIndexList indexes = mModel->match(mModel->index(0, 0), Qt::DisplayRole, name, 1, Qt::MatchExactly | Qt::MatchRecursive);
+    return indexes.isEmpty() ? nullptr : mModel->itemFromIndex(indexes.constFirst());
+}
+
+QStringList FolderSearchIndexTest::mismatches(const QString &filter, Qt::CaseSensitivity caseSensitivity)
+{
+    mIndex->setFilter(filter, caseSensitivity);
+    HierarchicalFolderMatcher matcher;
+    matcher.setFilter(filter, caseSensitivity);
+    QStringList result;
+    collectMismatches(matcher, QModelIndex(), result);
+    return result;
+}
+
+void FolderSearchIndexTest::collectMismatches(HierarchicalFolderMatcher &matcher, const QModelIndex &parent, QStringList &result)
+{
+    for (int row = 0; row < mModel->rowCount(parent); ++row) {
+        const QModelIndex index = mModel->index(row, 0, parent);
+        const std::optional<bool> indexed = mIndex->matches(index);
+        // The proxy falls back to the matcher when the index doesn't know the folder
+        const bool expected = matcher.isNull() || matcher.matches(mModel, index);
+        if (indexed.value_or(expected) != expected || (!matcher.isNull() && !indexed)) {
+            result.append(index.data().toString());
+        }
+        collectMismatches(matcher, index, result);
+    }
+}
+
+void FolderSearchIndexTest::shouldMatchLikeMatcher_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::newRow("empty") << QString();
+    QTest::newRow("substring") << QStringLiteral("arch");
+    QTest::newRow("upper case") << QStringLiteral("ARCH");
+    QTest::newRow("children") << QStringLiteral("inbox/");
+    QTest::newRow("with parent") << QStringLiteral("/projects");
+    QTest::newRow("path") << QStringLiteral("inbox/arch");
+    QTest::newRow("grandparent") << QStringLiteral("inbox//proj");
+    QTest::newRow("too deep") << QStringLiteral("inbox///");
+    QTest::newRow("wildcard") << QStringLiteral("ar*24");
+    QTest::newRow("any character") << QStringLiteral("k?e");
+    QTest::newRow("set") << QStringLiteral("[kq]");
+    QTest::newRow("wildcard path") << QStringLiteral("w*k/p*s/");
+    QTest::newRow("escape") << QStringLiteral("foo\\ bar");
+    QTest::newRow("dash") << QStringLiteral("qt-");
+    QTest::newRow("non-ASCII") << QStringLiteral("straße/grö");
+    QTest::newRow("non-ASCII upper case") << QStringLiteral("GRÖSSE");
+}
+
+void FolderSearchIndexTest::shouldMatchLikeMatcher()
+{
+    QFETCH(QString, filter);
+    QCOMPARE(mismatches(filter, Qt::CaseInsensitive), QStringList());
+    QCOMPARE(mismatches(filter, Qt::CaseSensitive), QStringList());
+}
+
+void FolderSearchIndexTest::shouldNarrowLikeMatcherWhileTyping_data()
+{
+    QTest::addColumn<QString>("filter");
+    QTest::newRow("folder") << QStringLiteral("Archive 2025");
+    QTest::newRow("path") << QStringLiteral("inbox/archive 2024");
+    QTest::newRow("deep path") << QStringLiteral("Work/Projects/Foo bar");
+    QTest::newRow("parent only") << QStringLiteral("lists/");
+    QTest::newRow("wildcard in the middle") << QStringLiteral("ar*ve 2025");
+    QTest::newRow("non-ASCII") << QStringLiteral("straße/größe");
+    QTest::newRow("non-ASCII upper case") << QStringLiteral("STRASSE");
+}
+
+void FolderSearchIndexTest::shouldNarrowLikeMatcherWhileTyping()
+{
+    QFETCH(QString, filter);
+    for (const auto caseSensitivity : {Qt::CaseInsensitive, Qt::CaseSensitive}) {
+        // Each step only re-tests the previous hits when it can
+        for (qsizetype length = 1; length <= filter.size(); ++length) {
+            const QString typed = filter.left(length);
+            QVERIFY2(mismatches(typed, caseSensitivity).isEmpty(), qPrintable(typed));
+        }
+        // Deleting characters widens the result again
+        for (qsizetype length = filter.size() - 1; length > 0; --length) {
+            const QString typed = filter.left(length);
+            QVERIFY2(mismatches(typed, caseSensitivity).isEmpty(), qPrintable(typed));
+        }
+    }
+    // Switching the case sensitivity keeps the same filter text
+    QCOMPARE(mismatches(filter, Qt::CaseInsensitive), QStringList());
+    QCOMPARE(mismatches(filter, Qt::CaseSensitive), QStringList());
+    QCOMPARE(mismatches(filter, Qt::CaseInsensitive), QStringList());
+}
+
+void FolderSearchIndexTest::shouldFollowRenames()
+{
+    QCOMPARE(mismatches(QStringLiteral("inbox/arch"), Qt::CaseInsensitive), QStringList());
+
+    // A renamed parent changes what its children match
+    findFolder(QStringLiteral("Inbox"))->setText(QStringLiteral("Mailbox"));
+    QCOMPARE(mismatches(QStringLiteral("inbox/arch"), Qt::CaseInsensitive), QStringList());
+    findFolder(QStringLiteral("Work"))->setText(QStringLiteral("Inbox"));
+    QCOMPARE(mismatches(QStringLiteral("inbox/arch"), Qt::CaseInsensitive), QStringList());
+
+    // Narrowing after a rename
+    findFolder(QStringLiteral("Archive 2024"))->setText(QStringLiteral("Old"));
+    QCOMPARE(mismatches(QStringLiteral("mailbox/ar"), Qt::CaseInsensitive), QStringList());
+    findFolder(QStringLiteral("Old"))->setText(QStringLiteral("Archive 2023"));
+    QCOMPARE(mismatches(QStringLiteral("mailbox/arc"), Qt::CaseInsensitive), QStringList());
+    QCOMPARE(mismatches(QStringLiteral("mailbox/archive 2023"), Qt::CaseInsensitive), QStringList());
+
+    // Renamed to a non-ASCII name while narrowing
+    QCOMPARE(mismatches(QStringLiteral("gr"), Qt::CaseInsensitive), QStringList());
+    findFolder(QStringLiteral("Lists"))->setText(QStringLiteral("GRÖSSE"));
+    QCOMPARE(mismatches(QStringLiteral("grö"), Qt::CaseInsensitive), QStringList());
+}
+
+void FolderSearchIndexTest::shouldFollowInsertsAndRemovals()
+{
+    QCOMPARE(mismatches(QStringLiteral("arc"), Qt::CaseInsensitive), QStringList());
+
+    // Folders inserted between two keystrokes
+    QStandardItem *inbox = findFolder(QStringLiteral("Inbox"));
+    addFolder(inbox, QStringLiteral("Archive 2026"));
+    QStandardItem *other = new QStandardItem(QStringLiteral("Other"));
+    other->setData(mNextId++, Akonadi::EntityTreeModel::CollectionIdRole);
+    auto archived = new QStandardItem(QStringLiteral("Archived"));
+    archived->setData(mNextId++, Akonadi::EntityTreeModel::CollectionIdRole);
+    other->appendRow(archived);
+    mModel->insertRow(0, other);
+    QCOMPARE(mismatches(QStringLiteral("arch"), Qt::CaseInsensitive), QStringList());
+    QCOMPARE(mismatches(QStringLiteral("archi"), Qt::CaseInsensitive), QStringList());
+
+    // Removed folders, then folders inserted where they were
+    QStandardItem *archive2025 = findFolder(QStringLiteral("Archive 2025"));
+    inbox->removeRow(archive2025->row());
+    QCOMPARE(mismatches(QStringLiteral("archiv"), Qt::CaseInsensitive), QStringList());
+    mModel->removeRow(findFolder(QStringLiteral("Work"))->row());
+    QCOMPARE(mismatches(QStringLiteral("archive"), Qt::CaseInsensitive), QStringList());
+    addFolder(addFolder(inbox, QStringLiteral("Archive 2025")), QStringLiteral("Archive"));
+    QCOMPARE(mismatches(QStringLiteral("archive "), Qt::CaseInsensitive), QStringList());
+    QCOMPARE(mismatches(QStringLiteral("inbox/archive"), Qt::CaseInsensitive), QStringList());
+
+    // Enough removals to rebuild the index
+    while (mModel->rowCount() > 1) {
+        mModel->removeRow(0);
+    }
+    QCOMPARE(mismatches(QStringLiteral("a"), Qt::CaseInsensitive), QStringList());
+    addFolder(mModel->invisibleRootItem(), QStringLiteral("Archive"));
+    QCOMPARE(mismatches(QStringLiteral("ar"), Qt::CaseInsensitive), QStringList());
+}
+
+void FolderSearchIndexTest::shouldMatchUnicodeLikeMatcher_data()
+{
+    QTest::addColumn<QString>("filter");
+    // Characters whose case folding is not a simple lower casing, or which
+    // have more than two case forms
+    const QStringList filters{
+        QStringLiteral("ss"),
+        QStringLiteral("ß"),
+        QStringLiteral("ẞ"),
+        QStringLiteral("σ"),
+        QStringLiteral("ς"),
+        QStringLiteral("Σ"),
+        QStringLiteral("i"),
+        QStringLiteral("I"),
+        QStringLiteral("İ"),
+        QStringLiteral("ı"),
+        QStringLiteral("k"),
+        QStringLiteral("K"), // Kelvin sign
+        QStringLiteral("s"),
+        QStringLiteral("ſ"),
+        QStringLiteral("fi"),
+        QStringLiteral("ﬁ"),
+        QStringLiteral("ǆ"),
+        QStringLiteral("ǅ"),
+        QStringLiteral("Ǆ"),
+        QStringLiteral("µ"),
+        QStringLiteral("μ"),
+        QStringLiteral("Ꭰ"), // Cherokee, folds to upper case
+        QStringLiteral("ꭰ"),
+        QStringLiteral("𐐀"), // Deseret, outside the BMP
+        QStringLiteral("𐐨"),
+        QStringLiteral("unicode/ς"),
+    };
+    for (const QString &filter : filters) {
+        QTest::newRow(filter.toUtf8().constData()) << filter;
+    }
+}
+
+void FolderSearchIndexTest::shouldMatchUnicodeLikeMatcher()
+{
+    QFETCH(QString, filter);
+    QStandardItem *unicode = addFolder(mModel->invisibleRootItem(), QStringLiteral("Unicode"));
+    const QStringList names{
+        QStringLiteral("Straße"),
+        QStringLiteral("STRASSE"),
+        QStringLiteral("STRAẞE"),
+        QStringLiteral("ΣΊΣΥΦΟΣ"),
+        QStringLiteral("σίσυφος"),
+        QStringLiteral("İstanbul"),
+        QStringLiteral("istanbul"),
+        QStringLiteral("ISTANBUL"),
+        QStringLiteral("ıi"),
+        QStringLiteral("Kelvin"),
+        QStringLiteral("kelvin"),
+        QStringLiteral("KELVIN"),
+        QStringLiteral("ſun"),
+        QStringLiteral("ﬁle"),
+        QStringLiteral("file"),
+        QStringLiteral("ǅungla"),
+        QStringLiteral("ǆ"),
+        QStringLiteral("µs"),
+        QStringLiteral("Μs"),
+        QStringLiteral("ᏌᏊ ꭰꮿ"),
+        QStringLiteral("𐐨𐐯"),
+        QStringLiteral("𐐀𐐇"),
+    };
+    for (const QString &name : names) {
+        addFolder(unicode, name);
+    }
+    QCOMPARE(mismatches(filter, Qt::CaseInsensitive), QStringList());
+    QCOMPARE(mismatches(filter, Qt::CaseSensitive), QStringList());
+
+    // Typed after an ASCII prefix, so that only the previous hits are tested again
+    const QString typed = QStringLiteral("s") + filter;
+    QCOMPARE(mismatches(typed.left(1), Qt::CaseInsensitive), QStringList());
+    QCOMPARE(mismatches(typed, Qt::CaseInsensitive), QStringList());
+}
+
+QTEST_MAIN(FolderSearchIndexTest)
+
+#include "moc_foldersearchindextest.cpp"
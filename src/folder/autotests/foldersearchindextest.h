@@ -0,0 +1,49 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+
+class QModelIndex;
+class QStandardItem;
+class QStandardItemModel;
+
+namespace MailCommon
+{
+class FolderSearchIndex;
+class HierarchicalFolderMatcher;
+}
+
+class FolderSearchIndexTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FolderSearchIndexTest(QObject *parent = nullptr);
+    ~FolderSearchIndexTest() override;
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void shouldMatchLikeMatcher_data();
+    void shouldMatchLikeMatcher();
+    void shouldNarrowLikeMatcherWhileTyping_data();
+    void shouldNarrowLikeMatcherWhileTyping();
+    void shouldFollowRenames();
+    void shouldFollowInsertsAndRemovals();
+    void shouldMatchUnicodeLikeMatcher_data();
+    void shouldMatchUnicodeLikeMatcher();
+
+private:
+    QStandardItem *addFolder(QStandardItem *parent, const QString &name);
+    QStandardItem *findFolder(const QString &name) const;
+    // Returns the folders for which the index and HierarchicalFolderMatcher disagree
+    QStringList mismatches(const QString &filter, Qt::CaseSensitivity caseSensitivity);
+    void collectMismatches(MailCommon::HierarchicalFolderMatcher &matcher, const QModelIndex &parent, QStringList &result);
+    QStandardItemModel *mModel = nullptr;
+    MailCommon::FolderSearchIndex *mIndex = nullptr;
+    qint64 mNextId = 1;
+};
@@ -6,6 +6,7 @@
 */
 
 #include "entitycollectionorderproxymodel.h"
+#include "foldersearchindex_p.h"
 #include "hierarchicalfoldermatcher_p.h"
 #include "kernel/mailkernel.h"
 #include "mailcommon_debug.h"
@@ -70,6 +71,7 @@ public:
     QMap<Akonadi::Collection::Id, int> collectionRanks;
     QStringList topLevelOrder;
     HierarchicalFolderMatcher matcher;
+    FolderSearchIndex folderIndex;
     bool manualSortingActive = false;
 };
 
@@ -86,6 +88,7 @@ EntityCollectionOrderProxyModel::EntityCollectionOrderProxyModel(QObject *parent
             &Akonadi::SpecialMailCollections::collectionsChanged,
             this,
             &EntityCollectionOrderProxyModel::slotSpecialCollectionsChanged);
+    connect(Kernel::self(), &Kernel::specialFolderRolesChanged, this, &EntityCollectionOrderProxyModel::slotSpecialCollectionsChanged);
 }
 
 EntityCollectionOrderProxyModel::~EntityCollectionOrderProxyModel()
@@ -163,6 +166,8 @@ void EntityCollectionOrderProxyModel::setFolderMatcher(const HierarchicalFolderM
     beginFilterChange();
 #endif
     d->matcher = matcher;
+    d->folderIndex.setRole(filterRole());
+    d->folderIndex.setFilter(matcher.filter(), matcher.caseSensitivity());
 #if QT_VERSION >= QT_VERSION_CHECK(6, 10, 0)
     endFilterChange(QSortFilterProxyModel::Direction::Rows);
 #else
@@ -176,7 +181,27 @@ bool EntityCollectionOrderProxyModel::filterAcceptsRow(int sourceRow, const QMod
         return EntityOrderProxyModel::filterAcceptsRow(sourceRow, sourceParent);
     }
     const QModelIndex sourceIndex = sourceModel()->index(sourceRow, filterKeyColumn(), sourceParent);
+    if (const std::optional<bool> indexed = d->folderIndex.matches(sourceIndex)) {
+        return *indexed;
+    }
     return d->matcher.matches(sourceModel(), sourceIndex, filterRole());
 }
 
+QModelIndex EntityCollectionOrderProxyModel::findFirstMatch(const QModelIndex &start) const
+{
+    return HierarchicalFolderMatcher::findFirstMatch(this, start, [this](const QModelIndex &idx) {
+        if (const std::optional<bool> indexed = d->folderIndex.matches(idx)) {
+            return *indexed;
+        }
+        return d->matcher.matches(this, idx, filterRole());
+    });
+}
+
+void EntityCollectionOrderProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+    // Connect the index first, so it is updated before this proxy filters new or changed rows
+    d->folderIndex.setModel(sourceModel);
+    EntityOrderProxyModel::setSourceModel(sourceModel);
+}
+
 #include "moc_entitycollectionorderproxymodel.cpp"
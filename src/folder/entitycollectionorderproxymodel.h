@@ -65,6 +65,16 @@ public:
      */
     void setFolderMatcher(const HierarchicalFolderMatcher &matcher);
 
+    /*!
+     * Returns the first folder matching the current folder matcher, searching
+     * from \a start and wrapping around, or an invalid index.
+     */
+    [[nodiscard]] QModelIndex findFirstMatch(const QModelIndex &start) const;
+
+    /*!
+     */
+    void setSourceModel(QAbstractItemModel *sourceModel) override;
+
 public Q_SLOTS:
     /*!
      */
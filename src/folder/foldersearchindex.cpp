@@ -0,0 +1,321 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "foldersearchindex_p.h"
+
+#include <Akonadi/EntityTreeModel>
+
+#include <QAbstractItemModel>
+#include <QModelIndex>
+
+using namespace MailCommon;
+
+namespace
+{
+bool hasWildcard(QStringView text)
+{
+    for (const QChar c : text) {
+        if (c == u'*' || c == u'?' || c == u'[' || c == u']' || c == u'\\') {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool isAscii(QStringView text)
+{
+    for (const QChar c : text) {
+        if (c.unicode() >= 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+FolderSearchIndex::FolderSearchIndex() = default;
+
+FolderSearchIndex::~FolderSearchIndex()
+{
+    for (const QMetaObject::Connection &connection : std::as_const(mConnections)) {
+        QObject::disconnect(connection);
+    }
+}
+
+void FolderSearchIndex::setModel(const QAbstractItemModel *model)
+{
+    if (mModel == model) {
+        return;
+    }
+    for (const QMetaObject::Connection &connection : std::as_const(mConnections)) {
+        QObject::disconnect(connection);
+    }
+    mConnections.clear();
+    mModel = model;
+    invalidate();
+    if (!mModel) {
+        return;
+    }
+
+    mConnections << QObject::connect(mModel, &QAbstractItemModel::rowsInserted, [this](const QModelIndex &parent, int first, int last) {
+        slotRowsInserted(parent, first, last);
+    });
+    mConnections << QObject::connect(mModel, &QAbstractItemModel::rowsAboutToBeRemoved, [this](const QModelIndex &parent, int first, int last) {
+        slotRowsAboutToBeRemoved(parent, first, last);
+    });
+    mConnections << QObject::connect(mModel,
+                                     &QAbstractItemModel::dataChanged,
+                                     [this](const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles) {
+                                         slotDataChanged(topLeft, bottomRight, roles);
+                                     });
+    // Moves and layout changes can reparent folders, start again from the model
+    mConnections << QObject::connect(mModel, &QAbstractItemModel::rowsMoved, [this]() {
+        invalidate();
+    });
+    mConnections << QObject::connect(mModel, &QAbstractItemModel::layoutChanged, [this]() {
+        invalidate();
+    });
+    mConnections << QObject::connect(mModel, &QAbstractItemModel::modelReset, [this]() {
+        invalidate();
+    });
+}
+
+void FolderSearchIndex::setRole(int role)
+{
+    if (mRole != role) {
+        mRole = role;
+        invalidate();
+    }
+}
+
+void FolderSearchIndex::setFilter(const QString &filter, Qt::CaseSensitivity caseSensitivity)
+{
+    // Appending to the last sub-pattern of a plain filter can only remove hits
+    const bool narrowing = mHitsValid && !mFilter.isEmpty() && caseSensitivity == mCaseSensitivity && filter.startsWith(mFilter) && !hasWildcard(filter)
+        && !QStringView(filter).mid(mFilter.size()).contains(u'/');
+
+    mFilter = filter;
+    mCaseSensitivity = caseSensitivity;
+    mParts.clear();
+    if (!filter.isEmpty()) {
+        const auto patternOptions =
+            caseSensitivity == Qt::CaseInsensitive ? QRegularExpression::CaseInsensitiveOption : QRegularExpression::NoPatternOption;
+        const auto parts = QStringView(filter).split(u'/');
+        mParts.reserve(parts.size());
+        for (const QStringView part : parts) {
+            Part compiled;
+            // Same semantic as HierarchicalFolderMatcher
+            compiled.regExp = QRegularExpression{QRegularExpression::wildcardToRegularExpression(u'*' + part + u'*'), patternOptions};
+            if (!hasWildcard(part)) {
+                compiled.text = caseSensitivity == Qt::CaseInsensitive ? part.toString().toCaseFolded() : part.toString();
+                compiled.matcher.setPattern(compiled.text);
+                compiled.plain = true;
+                compiled.ascii = isAscii(part);
+            }
+            mParts.push_back(std::move(compiled));
+        }
+    }
+
+    if (!narrowing) {
+        mHitsValid = false;
+        return;
+    }
+    for (std::size_t i = 0; i < mEntries.size(); ++i) {
+        if (mHits[i]) {
+            mHits[i] = entryMatches(int(i));
+        }
+    }
+}
+
+std::optional<bool> FolderSearchIndex::matches(const QModelIndex &index)
+{
+    if (!mModel || mParts.empty()) {
+        return std::nullopt;
+    }
+    if (!mBuilt) {
+        build();
+    }
+    if (!mHitsValid) {
+        updateAllHits();
+    }
+
+    const int position = positionOf(index);
+    if (position < 0) {
+        return std::nullopt;
+    }
+    return mHits[position] != 0;
+}
+
+void FolderSearchIndex::invalidate()
+{
+    mEntries.clear();
+    mHits.clear();
+    mPositions.clear();
+    mRemovedCount = 0;
+    mBuilt = false;
+    mHitsValid = false;
+}
+
+void FolderSearchIndex::build()
+{
+    invalidate();
+    mBuilt = true;
+    const int rowCount = mModel->rowCount();
+    for (int row = 0; row < rowCount; ++row) {
+        addSubtree(mModel->index(row, 0), -1);
+    }
+}
+
+void FolderSearchIndex::addSubtree(const QModelIndex &index, int parent)
+{
+    const QVariant id = index.data(Akonadi::EntityTreeModel::CollectionIdRole);
+    if (!id.isValid()) {
+        // not a folder
+        return;
+    }
+
+    Entry entry;
+    entry.id = id.toLongLong();
+    entry.parent = parent;
+    entry.name = index.data(mRole).toString();
+    entry.foldedName = entry.name.toCaseFolded();
+    entry.ascii = isAscii(entry.name);
+    const int position = int(mEntries.size());
+    mPositions.insert(entry.id, position);
+    mEntries.push_back(std::move(entry));
+    if (mHitsValid) {
+        mHits.push_back(entryMatches(position));
+    }
+
+    const int rowCount = mModel->rowCount(index);
+    for (int row = 0; row < rowCount; ++row) {
+        addSubtree(mModel->index(row, 0, index), position);
+    }
+}
+
+void FolderSearchIndex::removeSubtree(const QModelIndex &index)
+{
+    const int position = positionOf(index);
+    if (position < 0) {
+        return;
+    }
+    Entry &entry = mEntries[position];
+    entry.removed = true;
+    mPositions.remove(entry.id);
+    ++mRemovedCount;
+
+    const int rowCount = mModel->rowCount(index);
+    for (int row = 0; row < rowCount; ++row) {
+        removeSubtree(mModel->index(row, 0, index));
+    }
+}
+
+int FolderSearchIndex::positionOf(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return -1;
+    }
+    const QVariant id = index.siblingAtColumn(0).data(Akonadi::EntityTreeModel::CollectionIdRole);
+    if (!id.isValid()) {
+        return -1;
+    }
+    return mPositions.value(id.toLongLong(), -1);
+}
+
+bool FolderSearchIndex::partMatches(const Part &part, const Entry &entry) const
+{
+    // Case folding and the case insensitive matching of QRegularExpression
+    // only agree on ASCII text
+    if (part.plain && (mCaseSensitivity == Qt::CaseSensitive || (part.ascii && entry.ascii))) {
+        return part.text.isEmpty() || part.matcher.indexIn(mCaseSensitivity == Qt::CaseInsensitive ? entry.foldedName : entry.name) != -1;
+    }
+    return part.regExp.match(entry.name).hasMatch();
+}
+
+bool FolderSearchIndex::entryMatches(int position) const
+{
+    // The last sub-pattern is matched against the folder, the previous ones against its ancestors
+    for (auto it = mParts.crbegin(); it != mParts.crend(); ++it) {
+        if (position < 0) {
+            return false;
+        }
+        const Entry &entry = mEntries[position];
+        if (!partMatches(*it, entry)) {
+            return false;
+        }
+        position = entry.parent;
+    }
+    return true;
+}
+
+void FolderSearchIndex::updateAllHits()
+{
+    mHits.assign(mEntries.size(), 0);
+    for (std::size_t i = 0; i < mEntries.size(); ++i) {
+        if (!mEntries[i].removed) {
+            mHits[i] = entryMatches(int(i));
+        }
+    }
+    mHitsValid = true;
+}
+
+void FolderSearchIndex::slotRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (!mBuilt) {
+        return;
+    }
+    int parentPosition = -1;
+    if (parent.isValid()) {
+        parentPosition = positionOf(parent);
+        if (parentPosition < 0) {
+            return;
+        }
+    }
+    for (int row = first; row <= last; ++row) {
+        addSubtree(mModel->index(row, 0, parent), parentPosition);
+    }
+}
+
+void FolderSearchIndex::slotRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (!mBuilt) {
+        return;
+    }
+    for (int row = first; row <= last; ++row) {
+        removeSubtree(mModel->index(row, 0, parent));
+    }
+    // Too many tombstones, rebuild on the next query
+    if (mRemovedCount > int(mEntries.size()) / 2) {
+        invalidate();
+    }
+}
+
+void FolderSearchIndex::slotDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles)
+{
+    if (!mBuilt || topLeft.column() > 0) {
+        return;
+    }
+    if (!roles.isEmpty() && !roles.contains(mRole)) {
+        return;
+    }
+    const QModelIndex parent = topLeft.parent();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex index = mModel->index(row, 0, parent);
+        const int position = positionOf(index);
+        if (position < 0) {
+            continue;
+        }
+        Entry &entry = mEntries[position];
+        const QString name = index.data(mRole).toString();
+        if (name != entry.name) {
+            entry.name = name;
+            entry.foldedName = name.toCaseFolded();
+            entry.ascii = isAscii(name);
+            // Descendants match against this name too
+            mHitsValid = false;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+
+#include <Akonadi/Collection>
+
+#include <QHash>
+#include <QList>
+#include <QMetaObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringMatcher>
+
+#include <optional>
+#include <vector>
+
+class QAbstractItemModel;
+class QModelIndex;
+
+namespace MailCommon
+{
+/* This class answers HierarchicalFolderMatcher queries for the folders of a
+ * model without going back to the model for every row.
+ *
+ * The folders are kept in a flat array, in which every entry stores the name
+ * of the folder, its case folded form and the position of its parent, so the
+ * path of a folder is walked without calling QAbstractItemModel::data().
+ * The array is built on the first query and then follows the row signals of
+ * the model; folders are looked up by collection id, which is the same in
+ * every proxy stacked on the model.
+ *
+ * The result of the current filter is kept for every folder. When the user
+ * appends characters to a filter without wildcards or "/", only the previous
+ * hits are tested again. Plain sub-patterns are matched with QStringMatcher
+ * on the folded names, which uses Qt's vectorized string search. Sub-patterns
+ * with wildcards fall back to QRegularExpression, and so does ignoring case
+ * when the sub-pattern or the name is not ASCII: QString::toCaseFolded() and
+ * QRegularExpression::CaseInsensitiveOption don't treat every Unicode
+ * character the same way.
+ *
+ * The model signals are connected in setModel(), which has to be called before
+ * a proxy filtering with this index connects to the same model, so that the
+ * index is up to date when the proxy filters new or changed rows.
+ */
+class MAILCOMMON_TESTS_EXPORT FolderSearchIndex
+{
+public:
+    FolderSearchIndex();
+    ~FolderSearchIndex();
+
+    FolderSearchIndex(const FolderSearchIndex &) = delete;
+    FolderSearchIndex &operator=(const FolderSearchIndex &) = delete;
+
+    void setModel(const QAbstractItemModel *model);
+    void setRole(int role);
+
+    void setFilter(const QString &filter, Qt::CaseSensitivity caseSensitivity);
+
+    /* Returns whether the folder at index matches the filter, or nothing when
+     * the index does not refer to a known folder.
+     */
+    [[nodiscard]] std::optional<bool> matches(const QModelIndex &index);
+
+private:
+    struct Entry {
+        Akonadi::Collection::Id id = -1;
+        int parent = -1;
+        QString name;
+        QString foldedName;
+        bool ascii = true;
+        bool removed = false;
+    };
+
+    struct Part {
+        QString text;
+        QStringMatcher matcher;
+        QRegularExpression regExp;
+        // Without wildcards, text and matcher are set
+        bool plain = false;
+        bool ascii = false;
+    };
+
+    void invalidate();
+    void build();
+    void addSubtree(const QModelIndex &index, int parent);
+    void removeSubtree(const QModelIndex &index);
+    [[nodiscard]] int positionOf(const QModelIndex &index) const;
+    [[nodiscard]] bool partMatches(const Part &part, const Entry &entry) const;
+    [[nodiscard]] bool entryMatches(int position) const;
+    void updateAllHits();
+
+    void slotRowsInserted(const QModelIndex &parent, int first, int last);
+    void slotRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void slotRowsMoved(const QModelIndex &parent, int first, int last, const QModelIndex &destination);
+    void slotDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QList<int> &roles);
+
+    const QAbstractItemModel *mModel = nullptr;
+    QList<QMetaObject::Connection> mConnections;
+    std::vector<Entry> mEntries;
+    std::vector<char> mHits;
+    QHash<Akonadi::Collection::Id, int> mPositions;
+    std::vector<Part> mParts;
+    QString mFilter;
+    Qt::CaseSensitivity mCaseSensitivity = Qt::CaseInsensitive;
+    int mRole = Qt::DisplayRole;
+    int mRemovedCount = 0;
+    bool mBuilt = false;
+    bool mHitsValid = false;
+};
+}
@@ -19,43 +19,190 @@ using namespace Akonadi;
 #include <KIdentityManagementCore/Identity>
 #include <KIdentityManagementCore/IdentityManager>
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QMutex>
 #include <QMutexLocker>
 #include <QSharedPointer>
+#include <QWeakPointer>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
 
 namespace MailCommon
 {
-static QMutex mapMutex;
-static QMap<Collection::Id, QSharedPointer<FolderSettings>> fcMap;
+namespace
+{
+// Settings cache sharded by collection id, so lookups of different folders
+// don't contend for a single lock. Each shard evicts its least recently used
+// settings once it holds more than its share of the capacity.
+class FolderSettingsCache
+{
+public:
+    static constexpr int ShardCount = 16;
+
+    struct Entry {
+        QSharedPointer<FolderSettings> settings; // null once evicted
+        QWeakPointer<FolderSettings> alive; // valid as long as anybody holds the settings
+        quint64 lastUse = 0;
+    };
+
+    struct Shard {
+        QMutex mutex;
+        QHash<Collection::Id, Entry> entries;
+        int cachedCount = 0;
+        quint64 clock = 0;
+    };
+
+    Shard &shard(Collection::Id id)
+    {
+        return shards[static_cast<quint64>(id) % ShardCount];
+    }
+
+    // must be called with the shard locked, the evicted settings are
+    // released by the caller once it has unlocked the shard
+    void evict(Shard &shard, QList<QSharedPointer<FolderSettings>> &evicted)
+    {
+        const int shardCapacity = std::max(1, capacity.load() / ShardCount);
+        if (shard.cachedCount <= shardCapacity) {
+            return;
+        }
+
+        for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+            if (!it->settings && it->alive.isNull()) {
+                it = shard.entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        while (shard.cachedCount > shardCapacity) {
+            auto oldest = shard.entries.end();
+            for (auto it = shard.entries.begin(); it != shard.entries.end(); ++it) {
+                if (it->settings && (oldest == shard.entries.end() || it->lastUse < oldest->lastUse)) {
+                    oldest = it;
+                }
+            }
+            evicted.append(std::exchange(oldest->settings, {}));
+            --shard.cachedCount;
+            ++evictions;
+        }
+    }
+
+    // all settings still alive, whether cached or only held by callers
+    QList<QSharedPointer<FolderSettings>> liveSettings()
+    {
+        QList<QSharedPointer<FolderSettings>> result;
+        for (auto &shard : shards) {
+            QMutexLocker lock(&shard.mutex);
+            for (const auto &entry : std::as_const(shard.entries)) {
+                if (auto settings = entry.settings ? entry.settings : entry.alive.toStrongRef()) {
+                    result.append(settings);
+                }
+            }
+        }
+        return result;
+    }
+
+    QList<QSharedPointer<FolderSettings>> clear()
+    {
+        QList<QSharedPointer<FolderSettings>> cleared;
+        for (auto &shard : shards) {
+            QMutexLocker lock(&shard.mutex);
+            for (const auto &entry : std::as_const(shard.entries)) {
+                if (entry.settings) {
+                    cleared.append(entry.settings);
+                }
+            }
+            shard.entries.clear();
+            shard.cachedCount = 0;
+        }
+        return cleared;
+    }
+
+    std::array<Shard, ShardCount> shards;
+    std::atomic<int> capacity = 512;
+    std::atomic<quint64> hits = 0;
+    std::atomic<quint64> misses = 0;
+    std::atomic<quint64> evictions = 0;
+    std::atomic<quint64> loads = 0;
+    std::atomic<qint64> loadTime = 0;
+};
+}
+
+Q_GLOBAL_STATIC(FolderSettingsCache, sCache)
 
 QSharedPointer<FolderSettings> FolderSettings::forCollection(const Akonadi::Collection &coll, bool writeConfig)
 {
-    QMutexLocker lock(&mapMutex);
-
-    QSharedPointer<FolderSettings> sptr = fcMap.value(coll.id());
+    FolderSettingsCache *cache = sCache();
+    auto &shard = cache->shard(coll.id());
+
+    QSharedPointer<FolderSettings> sptr;
+    // released after unlocking the shard, destroying them writes the config
+    QList<QSharedPointer<FolderSettings>> evicted;
+    bool created = false;
+    {
+        QMutexLocker lock(&shard.mutex);
+
+        auto it = shard.entries.find(coll.id());
+        if (it != shard.entries.end()) {
+            sptr = it->settings;
+            if (!sptr) {
+                // evicted, but still held by someone: hand out the same instance again
+                sptr = it->alive.toStrongRef();
+                if (sptr) {
+                    it->settings = sptr;
+                    ++shard.cachedCount;
+                }
+            }
+        }
 
-    if (sptr.isNull()) {
-        sptr = QSharedPointer<FolderSettings>(new FolderSettings(coll, writeConfig));
-        fcMap.insert(coll.id(), sptr);
-    } else {
-        sptr->setCollection(coll);
-        if (!sptr->isWriteConfig() && writeConfig) {
-            sptr->setWriteConfig(true);
+        if (sptr) {
+            ++cache->hits;
+            it->lastUse = ++shard.clock;
+            sptr->setCollection(coll);
+            if (!sptr->isWriteConfig() && writeConfig) {
+                sptr->setWriteConfig(true);
+            }
+        } else {
+            ++cache->misses;
+            sptr = QSharedPointer<FolderSettings>(new FolderSettings(coll, writeConfig));
+            shard.entries.insert(coll.id(), {sptr, sptr, ++shard.clock});
+            ++shard.cachedCount;
+            created = true;
         }
+        cache->evict(shard, evicted);
     }
 
+    if (created) {
+        subscribeToIdentityChanges();
+    }
     return sptr;
 }
 
+void FolderSettings::subscribeToIdentityChanges()
+{
+    // a single connection for all folders rather than one per FolderSettings
+    static std::once_flag subscribed;
+    std::call_once(subscribed, []() {
+        auto identityManager = KernelIf->identityManager();
+        connect(identityManager, qOverload<>(&KIdentityManagementCore::IdentityManager::changed), identityManager, []() {
+            const auto folders = sCache()->liveSettings();
+            for (const auto &settings : folders) {
+                settings->slotIdentitiesChanged();
+            }
+        });
+    });
+}
+
 FolderSettings::FolderSettings(const Akonadi::Collection &col, bool writeconfig)
     : mCollection(col)
     , mWriteConfig(writeconfig)
 {
     Q_ASSERT(col.isValid());
-    mIdentity = KernelIf->identityManager()->defaultIdentity().uoid();
-
     readConfig();
-    connect(KernelIf->identityManager(), qOverload<>(&KIdentityManagementCore::IdentityManager::changed), this, &FolderSettings::slotIdentitiesChanged);
 }
 
 FolderSettings::~FolderSettings()
@@ -68,30 +215,65 @@ FolderSettings::~FolderSettings()
 
 MessageViewer::Viewer::DisplayFormatMessage FolderSettings::formatMessage() const
 {
+    ensureConfigLoaded(FormatMessageField);
     return mFormatMessage;
 }
 
 void FolderSettings::setFormatMessage(MessageViewer::Viewer::DisplayFormatMessage formatMessage)
 {
     mFormatMessage = formatMessage;
+    mLoadedFields |= FormatMessageField;
 }
 
 void FolderSettings::clearCache()
 {
-    QMutexLocker lock(&mapMutex);
-    fcMap.clear();
+    // the returned settings are released outside of the cache locks
+    sCache()->clear();
 }
 
 void FolderSettings::resetHtmlFormat()
 {
-    QMutexLocker lock(&mapMutex);
-    QMap<Collection::Id, QSharedPointer<FolderSettings>>::const_iterator i = fcMap.constBegin();
-    while (i != fcMap.constEnd()) {
-        i.value()->setFormatMessage(MessageViewer::Viewer::UseGlobalSetting);
-        ++i;
+    const auto folders = sCache()->liveSettings();
+    for (const auto &settings : folders) {
+        settings->setFormatMessage(MessageViewer::Viewer::UseGlobalSetting);
     }
 }
 
+void FolderSettings::setCacheCapacity(int capacity)
+{
+    sCache()->capacity = std::max(capacity, 1);
+}
+
+int FolderSettings::cacheCapacity()
+{
+    return sCache()->capacity;
+}
+
+quint64 FolderSettings::cacheHitCount()
+{
+    return sCache()->hits;
+}
+
+quint64 FolderSettings::cacheMissCount()
+{
+    return sCache()->misses;
+}
+
+quint64 FolderSettings::cacheEvictionCount()
+{
+    return sCache()->evictions;
+}
+
+quint64 FolderSettings::configLoadCount()
+{
+    return sCache()->loads;
+}
+
+qint64 FolderSettings::configLoadTime()
+{
+    return sCache()->loadTime;
+}
+
 bool FolderSettings::isWriteConfig() const
 {
     return mWriteConfig;
@@ -153,6 +335,13 @@ void FolderSettings::setCollection(const Akonadi::Collection &collection)
 }
 
 void FolderSettings::slotIdentitiesChanged()
+{
+    if (mLoadedFields & IdentityField) {
+        updateIdentity();
+    }
+}
+
+void FolderSettings::updateIdentity() const
 {
     uint defaultIdentity = KernelIf->identityManager()->defaultIdentity().uoid();
     // The default identity may have changed, therefore set it again if necessary
@@ -175,17 +364,6 @@ QString FolderSettings::configGroupName(const Akonadi::Collection &col)
 void FolderSettings::readConfig()
 {
     KConfigGroup configGroup(KernelIf->config(), configGroupName(mCollection));
-    mMailingListEnabled = configGroup.readEntry("MailingListEnabled", false);
-    mMailingList.readConfig(configGroup);
-
-    mUseDefaultIdentity = configGroup.readEntry("UseDefaultIdentity", true);
-    uint defaultIdentity = KernelIf->identityManager()->defaultIdentity().uoid();
-    mIdentity = configGroup.readEntry("Identity", defaultIdentity);
-    slotIdentitiesChanged();
-
-    mPutRepliesInSameFolder = configGroup.readEntry("PutRepliesInSameFolder", false);
-    mHideInSelectionDialog = configGroup.readEntry("HideInSelectionDialog", false);
-
     if (configGroup.hasKey(QStringLiteral("IgnoreNewMail"))) {
         if (configGroup.readEntry(QStringLiteral("IgnoreNewMail"), false)) {
             // migrate config.
@@ -197,16 +375,63 @@ void FolderSettings::readConfig()
         configGroup.deleteEntry("IgnoreNewMail");
     }
 
-    const QString shortcut(configGroup.readEntry("Shortcut"));
-    if (!shortcut.isEmpty()) {
-        QKeySequence sc(shortcut);
-        setShortcut(sc);
+    // the settings themselves are read when first accessed
+    mLoadedFields = 0;
+}
+
+void FolderSettings::ensureConfigLoaded(ConfigField field) const
+{
+    if (mLoadedFields.load(std::memory_order_acquire) & field) {
+        return;
     }
+    QMutexLocker locker(&mConfigMutex);
+    // another thread may have read it while we were waiting
+    if (mLoadedFields.load(std::memory_order_relaxed) & field) {
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
 
-    mFormatMessage = static_cast<MessageViewer::Viewer::DisplayFormatMessage>(
-        configGroup.readEntry("displayFormatOverride", static_cast<int>(MessageViewer::Viewer::UseGlobalSetting)));
+    KConfigGroup configGroup(KernelIf->config(), configGroupName(mCollection));
+    switch (field) {
+    case IdentityField: {
+        mUseDefaultIdentity = configGroup.readEntry("UseDefaultIdentity", true);
+        uint defaultIdentity = KernelIf->identityManager()->defaultIdentity().uoid();
+        mIdentity = configGroup.readEntry("Identity", defaultIdentity);
+        updateIdentity();
+        break;
+    }
+    case MailingListField:
+        mMailingListEnabled = configGroup.readEntry("MailingListEnabled", false);
+        mMailingList.readConfig(configGroup);
+        break;
+    case PutRepliesInSameFolderField:
+        mPutRepliesInSameFolder = configGroup.readEntry("PutRepliesInSameFolder", false);
+        break;
+    case HideInSelectionDialogField:
+        mHideInSelectionDialog = configGroup.readEntry("HideInSelectionDialog", false);
+        break;
+    case ShortcutField: {
+        const QString shortcut(configGroup.readEntry("Shortcut"));
+        if (!shortcut.isEmpty()) {
+            mShortcut = QKeySequence(shortcut);
+        }
+        break;
+    }
+    case FormatMessageField:
+        mFormatMessage = static_cast<MessageViewer::Viewer::DisplayFormatMessage>(
+            configGroup.readEntry("displayFormatOverride", static_cast<int>(MessageViewer::Viewer::UseGlobalSetting)));
+        break;
+    case HtmlLoadExtPreferenceField:
+        mFolderHtmlLoadExtPreference = configGroup.readEntry("htmlLoadExternalOverride", false);
+        break;
+    }
+    mLoadedFields.fetch_or(field, std::memory_order_release);
 
-    mFolderHtmlLoadExtPreference = configGroup.readEntry("htmlLoadExternalOverride", false);
+    FolderSettingsCache *cache = sCache();
+    ++cache->loads;
+    cache->loadTime += timer.nsecsElapsed();
 }
 
 bool FolderSettings::isValid() const
@@ -216,86 +441,105 @@ bool FolderSettings::isValid() const
 
 void FolderSettings::writeConfig() const
 {
+    // settings never read nor changed are still as stored in the config
+    if (!mLoadedFields) {
+        return;
+    }
     const QString res = resource();
     if (res.isEmpty()) {
         return;
     }
     KConfigGroup configGroup(KernelIf->config(), configGroupName(mCollection));
 
-    if (mMailingListEnabled) {
-        configGroup.writeEntry("MailingListEnabled", mMailingListEnabled);
-    } else {
-        configGroup.deleteEntry("MailingListEnabled");
+    if (mLoadedFields & MailingListField) {
+        if (mMailingListEnabled) {
+            configGroup.writeEntry("MailingListEnabled", mMailingListEnabled);
+        } else {
+            configGroup.deleteEntry("MailingListEnabled");
+        }
+        mMailingList.writeConfig(configGroup);
     }
-    mMailingList.writeConfig(configGroup);
-
-    if (!mUseDefaultIdentity) {
-        configGroup.writeEntry("UseDefaultIdentity", mUseDefaultIdentity);
-        uint defaultIdentityId = -1;
 
-        if (PimCommon::Util::isImapResource(res)) {
-            MailCommon::ResourceReadConfigFile resourceFile(res);
-            KConfigGroup grp = resourceFile.group(QStringLiteral("cache"));
-            if (grp.isValid()) {
-                defaultIdentityId = grp.readEntry(QStringLiteral("AccountIdentity"), -1);
+    if (mLoadedFields & IdentityField) {
+        if (!mUseDefaultIdentity) {
+            configGroup.writeEntry("UseDefaultIdentity", mUseDefaultIdentity);
+            uint defaultIdentityId = -1;
+
+            if (PimCommon::Util::isImapResource(res)) {
+                MailCommon::ResourceReadConfigFile resourceFile(res);
+                KConfigGroup grp = resourceFile.group(QStringLiteral("cache"));
+                if (grp.isValid()) {
+                    defaultIdentityId = grp.readEntry(QStringLiteral("AccountIdentity"), -1);
+                }
+            } else {
+                defaultIdentityId = KernelIf->identityManager()->defaultIdentity().uoid();
             }
-        } else {
-            defaultIdentityId = KernelIf->identityManager()->defaultIdentity().uoid();
-        }
 
-        if (mIdentity != defaultIdentityId) {
-            configGroup.writeEntry("Identity", mIdentity);
+            if (mIdentity != defaultIdentityId) {
+                configGroup.writeEntry("Identity", mIdentity);
+            } else {
+                configGroup.deleteEntry("Identity");
+            }
         } else {
             configGroup.deleteEntry("Identity");
+            configGroup.deleteEntry("UseDefaultIdentity");
         }
-    } else {
-        configGroup.deleteEntry("Identity");
-        configGroup.deleteEntry("UseDefaultIdentity");
     }
 
-    if (mPutRepliesInSameFolder) {
-        configGroup.writeEntry("PutRepliesInSameFolder", mPutRepliesInSameFolder);
-    } else {
-        configGroup.deleteEntry("PutRepliesInSameFolder");
+    if (mLoadedFields & PutRepliesInSameFolderField) {
+        if (mPutRepliesInSameFolder) {
+            configGroup.writeEntry("PutRepliesInSameFolder", mPutRepliesInSameFolder);
+        } else {
+            configGroup.deleteEntry("PutRepliesInSameFolder");
+        }
     }
-    if (mHideInSelectionDialog) {
-        configGroup.writeEntry("HideInSelectionDialog", mHideInSelectionDialog);
-    } else {
-        configGroup.deleteEntry("HideInSelectionDialog");
+    if (mLoadedFields & HideInSelectionDialogField) {
+        if (mHideInSelectionDialog) {
+            configGroup.writeEntry("HideInSelectionDialog", mHideInSelectionDialog);
+        } else {
+            configGroup.deleteEntry("HideInSelectionDialog");
+        }
     }
 
-    if (!mShortcut.isEmpty()) {
-        configGroup.writeEntry("Shortcut", mShortcut.toString());
-    } else {
-        configGroup.deleteEntry("Shortcut");
+    if (mLoadedFields & ShortcutField) {
+        if (!mShortcut.isEmpty()) {
+            configGroup.writeEntry("Shortcut", mShortcut.toString());
+        } else {
+            configGroup.deleteEntry("Shortcut");
+        }
     }
 
-    if (mFormatMessage != MessageViewer::Viewer::Unknown) {
+    if ((mLoadedFields & FormatMessageField) && mFormatMessage != MessageViewer::Viewer::Unknown) {
         if (mFormatMessage == MessageViewer::Viewer::UseGlobalSetting) {
             configGroup.deleteEntry("displayFormatOverride");
         } else {
             configGroup.writeEntry("displayFormatOverride", static_cast<int>(mFormatMessage));
         }
     }
-    if (mFolderHtmlLoadExtPreference) {
-        configGroup.writeEntry("htmlLoadExternalOverride", mFolderHtmlLoadExtPreference);
-    } else {
-        configGroup.deleteEntry("htmlLoadExternalOverride");
+    if (mLoadedFields & HtmlLoadExtPreferenceField) {
+        if (mFolderHtmlLoadExtPreference) {
+            configGroup.writeEntry("htmlLoadExternalOverride", mFolderHtmlLoadExtPreference);
+        } else {
+            configGroup.deleteEntry("htmlLoadExternalOverride");
+        }
     }
 }
 
 void FolderSettings::setShortcut(const QKeySequence &sc)
 {
     mShortcut = sc;
+    mLoadedFields |= ShortcutField;
 }
 
 const QKeySequence &FolderSettings::shortcut() const
 {
+    ensureConfigLoaded(ShortcutField);
     return mShortcut;
 }
 
 void FolderSettings::setUseDefaultIdentity(bool useDefaultIdentity)
 {
+    ensureConfigLoaded(IdentityField);
     if (mUseDefaultIdentity != useDefaultIdentity) {
         mUseDefaultIdentity = useDefaultIdentity;
         if (mUseDefaultIdentity) {
@@ -307,11 +551,13 @@ void FolderSettings::setUseDefaultIdentity(bool useDefaultIdentity)
 
 bool FolderSettings::useDefaultIdentity() const
 {
+    ensureConfigLoaded(IdentityField);
     return mUseDefaultIdentity;
 }
 
 void FolderSettings::setIdentity(uint identity)
 {
+    ensureConfigLoaded(IdentityField);
     if (mIdentity != identity) {
         mIdentity = identity;
         KernelIf->syncConfig();
@@ -333,16 +579,19 @@ QString FolderSettings::resource() const
 
 bool FolderSettings::folderHtmlLoadExtPreference() const
 {
+    ensureConfigLoaded(HtmlLoadExtPreferenceField);
     return mFolderHtmlLoadExtPreference;
 }
 
 void FolderSettings::setFolderHtmlLoadExtPreference(bool folderHtmlLoadExtPreference)
 {
     mFolderHtmlLoadExtPreference = folderHtmlLoadExtPreference;
+    mLoadedFields |= HtmlLoadExtPreferenceField;
 }
 
 uint FolderSettings::fallBackIdentity() const
 {
+    ensureConfigLoaded(IdentityField);
     int identityId = -1;
     MailCommon::ResourceReadConfigFile resourceFile(resource());
     KConfigGroup grp = resourceFile.group(QStringLiteral("cache"));
@@ -364,6 +613,7 @@ uint FolderSettings::fallBackIdentity() const
 
 uint FolderSettings::identity() const
 {
+    ensureConfigLoaded(IdentityField);
     if (mUseDefaultIdentity) {
         return fallBackIdentity();
     }
@@ -372,6 +622,7 @@ uint FolderSettings::identity() const
 
 QString FolderSettings::mailingListPostAddress() const
 {
+    ensureConfigLoaded(MailingListField);
     if (mMailingList.features() & MailingList::Post) {
         QList<QUrl> post = mMailingList.postUrls();
         QList<QUrl>::const_iterator end(post.constEnd());
@@ -389,6 +640,7 @@ QString FolderSettings::mailingListPostAddress() const
 
 void FolderSettings::setMailingListEnabled(bool enabled)
 {
+    ensureConfigLoaded(MailingListField);
     if (mMailingListEnabled != enabled) {
         mMailingListEnabled = enabled;
         writeConfig();
@@ -397,11 +649,13 @@ void FolderSettings::setMailingListEnabled(bool enabled)
 
 bool FolderSettings::isMailingListEnabled() const
 {
+    ensureConfigLoaded(MailingListField);
     return mMailingListEnabled;
 }
 
 void FolderSettings::setMailingList(const MailingList &mlist)
 {
+    ensureConfigLoaded(MailingListField);
     if (mMailingList == mlist) {
         return;
     }
@@ -412,27 +666,32 @@ void FolderSettings::setMailingList(const MailingList &mlist)
 
 MessageCore::MailingList FolderSettings::mailingList() const
 {
+    ensureConfigLoaded(MailingListField);
     return mMailingList;
 }
 
 bool FolderSettings::putRepliesInSameFolder() const
 {
+    ensureConfigLoaded(PutRepliesInSameFolderField);
     return mPutRepliesInSameFolder;
 }
 
 void FolderSettings::setPutRepliesInSameFolder(bool b)
 {
     mPutRepliesInSameFolder = b;
+    mLoadedFields |= PutRepliesInSameFolderField;
 }
 
 bool FolderSettings::hideInSelectionDialog() const
 {
+    ensureConfigLoaded(HideInSelectionDialogField);
     return mHideInSelectionDialog;
 }
 
 void FolderSettings::setHideInSelectionDialog(bool hide)
 {
     mHideInSelectionDialog = hide;
+    mLoadedFields |= HideInSelectionDialogField;
 }
 }
 
@@ -17,6 +17,9 @@ using MessageCore::MailingList;
 
 #include <KSharedConfig>
 #include <QKeySequence>
+#include <QMutex>
+
+#include <atomic>
 
 namespace MailCommon
 {
@@ -34,6 +37,13 @@ class MAILCOMMON_EXPORT FolderSettings : public QObject
 
 public:
     /*!
+     * Returns the settings of \a coll.
+     *
+     * Settings are kept in a sharded cache holding at most cacheCapacity()
+     * entries; the least recently used ones are dropped first. As long as a
+     * caller holds on to a dropped instance, the same instance is returned
+     * for its collection. The config is only read when a setting is first
+     * accessed, which is safe from several threads at once.
      */
     static QSharedPointer<FolderSettings> forCollection(const Akonadi::Collection &coll, bool writeConfig = true);
 
@@ -55,6 +65,35 @@ public:
      */
     static void resetHtmlFormat();
 
+    /*!
+     * Sets the maximum number of settings kept in the cache to \a capacity.
+     */
+    static void setCacheCapacity(int capacity);
+    /*!
+     */
+    [[nodiscard]] static int cacheCapacity();
+
+    /*!
+     * Returns the number of forCollection() calls served from the cache.
+     */
+    [[nodiscard]] static quint64 cacheHitCount();
+    /*!
+     * Returns the number of forCollection() calls which created new settings.
+     */
+    [[nodiscard]] static quint64 cacheMissCount();
+    /*!
+     * Returns the number of settings dropped from the cache to stay within its capacity.
+     */
+    [[nodiscard]] static quint64 cacheEvictionCount();
+    /*!
+     * Returns the number of settings fields read from the config.
+     */
+    [[nodiscard]] static quint64 configLoadCount();
+    /*!
+     * Returns the total time spent reading settings from the config, in nanoseconds.
+     */
+    [[nodiscard]] static qint64 configLoadTime();
+
     /*!
      */
     [[nodiscard]] bool isWriteConfig() const;
@@ -66,6 +105,7 @@ public:
      */
     void writeConfig() const;
     /*!
+     * Drops the values read so far, they are read again from the config on next access.
      */
     void readConfig();
 
@@ -190,29 +230,48 @@ protected Q_SLOTS:
     void slotIdentitiesChanged();
 
 private:
+    /*! Settings read from the config independently of each other */
+    enum ConfigField {
+        IdentityField = 1,
+        MailingListField = 2,
+        PutRepliesInSameFolderField = 4,
+        HideInSelectionDialogField = 8,
+        ShortcutField = 16,
+        FormatMessageField = 32,
+        HtmlLoadExtPreferenceField = 64,
+    };
+
     explicit MAILCOMMON_NO_EXPORT FolderSettings(const Akonadi::Collection &col, bool writeconfig);
     [[nodiscard]] MAILCOMMON_NO_EXPORT QString resource() const;
+    MAILCOMMON_NO_EXPORT void ensureConfigLoaded(ConfigField field) const;
+    MAILCOMMON_NO_EXPORT void updateIdentity() const;
+    MAILCOMMON_NO_EXPORT static void subscribeToIdentityChanges();
 
     Akonadi::Collection mCollection;
 
+    /*! The ConfigField values read from the config or set since */
+    mutable std::atomic<int> mLoadedFields = 0;
+    /*! Serializes reading the fields, the getters may be called from several threads */
+    mutable QMutex mConfigMutex;
+
     /*! Mailing list attributes */
-    bool mMailingListEnabled = false;
-    MailingList mMailingList;
+    mutable bool mMailingListEnabled = false;
+    mutable MailingList mMailingList;
 
-    bool mUseDefaultIdentity = true;
-    uint mIdentity;
+    mutable bool mUseDefaultIdentity = true;
+    mutable uint mIdentity = 0;
 
-    MessageViewer::Viewer::DisplayFormatMessage mFormatMessage = MessageViewer::Viewer::Unknown;
+    mutable MessageViewer::Viewer::DisplayFormatMessage mFormatMessage = MessageViewer::Viewer::Unknown;
     /*! Should replies to messages in this folder be put in here? */
-    bool mPutRepliesInSameFolder = false;
+    mutable bool mPutRepliesInSameFolder = false;
 
     /*! Should this folder be hidden in the folder selection dialog? */
-    bool mHideInSelectionDialog = false;
+    mutable bool mHideInSelectionDialog = false;
 
-    bool mFolderHtmlLoadExtPreference = false;
+    mutable bool mFolderHtmlLoadExtPreference = false;
 
     /*! shortcut associated with this folder or null, if none is configured. */
-    QKeySequence mShortcut;
+    mutable QKeySequence mShortcut;
     bool mWriteConfig = true;
 };
 }
@@ -23,6 +23,8 @@
 #include <QHeaderView>
 #include <QMouseEvent>
 
+#include <algorithm>
+
 using namespace MailCommon;
 
 FolderTreeView::FolderTreeView(QWidget *parent, bool showUnreadCount)
@@ -652,29 +654,179 @@ QModelIndex FolderTreeView::indexAbove(const QModelIndex &current) const
     return lastChild(previousSibling);
 }
 
-QModelIndex FolderTreeView::nextUnreadCollection(const QModelIndex &current, SearchDirection direction) const
+// position of an index in the tree, compares in display (pre-)order
+static QList<int> displayPath(QModelIndex index)
 {
-    QModelIndex index = current;
-    while (true) {
-        if (direction == ForwardSearch) {
-            index = indexBelow(index);
-        } else if (direction == BackwardSearch) {
-            index = indexAbove(index);
+    QList<int> path;
+    while (index.isValid()) {
+        path.prepend(index.row());
+        index = index.parent();
+    }
+    return path;
+}
+
+static bool displayedBefore(const QModelIndex &lhs, const QModelIndex &rhs)
+{
+    return displayPath(lhs) < displayPath(rhs);
+}
+
+static bool hasUnreadMail(const QModelIndex &index)
+{
+    const auto collection = index.data(Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
+    return collection.isValid() && collection.statistics().unreadCount() > 0;
+}
+
+// appends the unread folders of rows first..last of parent and their subtrees in display order
+static void collectUnreadFolders(const QAbstractItemModel *model, const QModelIndex &parent, int first, int last, QList<QPersistentModelIndex> &folders)
+{
+    for (int row = first; row <= last; ++row) {
+        const QModelIndex index = model->index(row, 0, parent);
+        if (hasUnreadMail(index)) {
+            folders.append(index);
+        }
+        const int childCount = model->rowCount(index);
+        if (childCount > 0) {
+            collectUnreadFolders(model, index, 0, childCount - 1, folders);
         }
+    }
+}
+
+void FolderTreeView::setModel(QAbstractItemModel *newModel)
+{
+    for (const auto &connection : std::as_const(mUnreadFoldersConnections)) {
+        disconnect(connection);
+    }
+    mUnreadFoldersConnections.clear();
+    mUnreadFolders.clear();
+    mUnreadFoldersValid = false;
+
+    Akonadi::EntityTreeView::setModel(newModel);
+
+    if (!newModel) {
+        return;
+    }
 
-        if (!index.isValid()) { // reach end or top of the model
-            return {};
+    const auto invalidate = [this]() {
+        mUnreadFolders.clear();
+        mUnreadFoldersValid = false;
+    };
+    // the persistent indexes follow the rows, only their relative order can change
+    const auto reorder = [this]() {
+        mUnreadFoldersSorted = false;
+    };
+    mUnreadFoldersConnections = {
+        connect(newModel, &QAbstractItemModel::dataChanged, this, &FolderTreeView::slotUnreadFoldersDataChanged),
+        connect(newModel, &QAbstractItemModel::rowsInserted, this, &FolderTreeView::slotUnreadFoldersRowsInserted),
+        connect(newModel, &QAbstractItemModel::rowsRemoved, this, &FolderTreeView::slotUnreadFoldersRowsRemoved),
+        connect(newModel, &QAbstractItemModel::rowsMoved, this, reorder),
+        connect(newModel, &QAbstractItemModel::layoutChanged, this, reorder),
+        connect(newModel, &QAbstractItemModel::modelReset, this, invalidate),
+    };
+}
+
+void FolderTreeView::ensureUnreadFolders() const
+{
+    if (!mUnreadFoldersValid) {
+        mUnreadFolders.clear();
+        const int rowCount = model()->rowCount();
+        if (rowCount > 0) {
+            collectUnreadFolders(model(), QModelIndex(), 0, rowCount - 1, mUnreadFolders);
         }
+        mUnreadFoldersValid = true;
+        mUnreadFoldersSorted = true;
+    } else if (!mUnreadFoldersSorted) {
+        QList<std::pair<QList<int>, QPersistentModelIndex>> folders;
+        folders.reserve(mUnreadFolders.size());
+        for (const auto &index : std::as_const(mUnreadFolders)) {
+            if (index.isValid()) {
+                folders.append({displayPath(index), index});
+            }
+        }
+        std::sort(folders.begin(), folders.end(), [](const auto &lhs, const auto &rhs) {
+            return lhs.first < rhs.first;
+        });
+        mUnreadFolders.clear();
+        for (const auto &folder : std::as_const(folders)) {
+            mUnreadFolders.append(folder.second);
+        }
+        mUnreadFoldersSorted = true;
+    }
+}
 
-        // check if the index is a collection
-        const auto collection = index.data(Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
+void FolderTreeView::slotUnreadFoldersDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (!mUnreadFoldersValid || !topLeft.isValid()) {
+        return;
+    }
+    ensureUnreadFolders();
+
+    const QModelIndex parent = topLeft.parent();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex index = model()->index(row, 0, parent);
+        const auto it = std::lower_bound(mUnreadFolders.begin(), mUnreadFolders.end(), index, displayedBefore);
+        const bool listed = it != mUnreadFolders.end() && *it == index;
+        const bool unread = hasUnreadMail(index);
+        if (unread && !listed) {
+            mUnreadFolders.insert(it, index);
+        } else if (!unread && listed) {
+            mUnreadFolders.erase(it);
+        }
+    }
+}
 
-        if (collection.isValid()) {
-            // check if it is unread
-            if (collection.statistics().unreadCount() > 0) {
-                if (!MailCommon::Util::ignoreNewMailInFolder(collection)) {
-                    return index; // we found the next unread collection
-                }
+void FolderTreeView::slotUnreadFoldersRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (!mUnreadFoldersValid) {
+        return;
+    }
+    ensureUnreadFolders();
+
+    // the inserted rows and their subtrees are contiguous in display order
+    QList<QPersistentModelIndex> folders;
+    collectUnreadFolders(model(), parent, first, last, folders);
+    if (folders.isEmpty()) {
+        return;
+    }
+    const auto position = std::lower_bound(mUnreadFolders.cbegin(), mUnreadFolders.cend(), folders.constFirst(), displayedBefore) - mUnreadFolders.cbegin();
+    mUnreadFolders = mUnreadFolders.mid(0, position) + folders + mUnreadFolders.mid(position);
+}
+
+void FolderTreeView::slotUnreadFoldersRowsRemoved()
+{
+    mUnreadFolders.removeIf([](const QPersistentModelIndex &index) {
+        return !index.isValid();
+    });
+}
+
+QModelIndex FolderTreeView::nextUnreadCollection(const QModelIndex &current, SearchDirection direction) const
+{
+    ensureUnreadFolders();
+
+    const auto accept = [](const QPersistentModelIndex &index) {
+        return index.isValid() && hasUnreadMail(index)
+            && !MailCommon::Util::ignoreNewMailInFolder(index.data(Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>());
+    };
+
+    // an invalid start position is before the first (forward) or after the last (backward) folder
+    if (direction == ForwardSearch) {
+        auto it = mUnreadFolders.cbegin();
+        if (current.isValid()) {
+            it = std::upper_bound(mUnreadFolders.cbegin(), mUnreadFolders.cend(), current, displayedBefore);
+        }
+        for (; it != mUnreadFolders.cend(); ++it) {
+            if (accept(*it)) {
+                return *it; // we found the next unread collection
+            }
+        }
+    } else if (direction == BackwardSearch) {
+        auto it = mUnreadFolders.cend();
+        if (current.isValid()) {
+            it = std::lower_bound(mUnreadFolders.cbegin(), mUnreadFolders.cend(), current, displayedBefore);
+        }
+        while (it != mUnreadFolders.cbegin()) {
+            --it;
+            if (accept(*it)) {
+                return *it;
             }
         }
     }
@@ -14,6 +14,9 @@
 #include <Akonadi/Collection>
 #include <Akonadi/EntityTreeView>
 
+#include <QList>
+#include <QPersistentModelIndex>
+
 class QMouseEvent;
 
 namespace Akonadi
@@ -94,6 +97,10 @@ public:
      */
     void setEnableDragDrop(bool enabled);
 
+    /*!
+     */
+    void setModel(QAbstractItemModel *model) override;
+
 protected:
     enum Move {
         Next = 0,
@@ -187,10 +194,22 @@ private:
     MAILCOMMON_NO_EXPORT bool allowedToEnterFolder(const Akonadi::Collection &, bool) const;
     MAILCOMMON_NO_EXPORT bool trySelectNextUnreadFolder(const QModelIndex &, SearchDirection, bool);
 
+    MAILCOMMON_NO_EXPORT void ensureUnreadFolders() const;
+    MAILCOMMON_NO_EXPORT void slotUnreadFoldersDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    MAILCOMMON_NO_EXPORT void slotUnreadFoldersRowsInserted(const QModelIndex &parent, int first, int last);
+    MAILCOMMON_NO_EXPORT void slotUnreadFoldersRowsRemoved();
+
     FolderTreeWidget::ToolTipDisplayPolicy mToolTipDisplayPolicy;
     FolderTreeWidget::SortingPolicy mSortingPolicy;
     Akonadi::CollectionStatisticsDelegate *mCollectionStatisticsDelegate = nullptr;
     bool mbDisableContextMenuAndExtraColumn = false;
     bool mbDisableSaveConfig = false;
+
+    // Folders with unread mail, in tree display order. Built lazily on the
+    // first unread navigation and then kept up to date from the model signals.
+    mutable QList<QPersistentModelIndex> mUnreadFolders;
+    mutable bool mUnreadFoldersValid = false;
+    mutable bool mUnreadFoldersSorted = true;
+    QList<QMetaObject::Connection> mUnreadFoldersConnections;
 };
 }
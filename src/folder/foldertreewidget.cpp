@@ -328,7 +328,7 @@ void FolderTreeWidget::applyFilter(const QString &filter)
     const QAbstractItemModel *const model = d->folderTreeView->model();
     const QModelIndex current = d->folderTreeView->currentIndex();
     const QModelIndex start = current.isValid() ? current : model->index(0, 0);
-    const QModelIndex firstMatch = matcher.findFirstMatch(model, start);
+    const QModelIndex firstMatch = d->entityOrderProxy->findFirstMatch(start);
     if (firstMatch.isValid()) {
         d->folderTreeView->setCurrentIndex(firstMatch);
         // This will expand to the selected item if necessary.
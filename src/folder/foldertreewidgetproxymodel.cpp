@@ -28,39 +28,138 @@ using namespace MailCommon;
 class FolderTreeWidgetProxyModel::FolderTreeWidgetProxyModelPrivate
 {
 public:
+    // What data(), flags() and filterAcceptsRow() need to know about an agent
+    struct ResourceState {
+        QStringList activities;
+        bool broken = false;
+        bool online = true;
+        bool activitiesEnabled = false;
+    };
+
+    struct QuotaState {
+        qreal percentage = 0.0;
+        bool exceeded = false;
+    };
+
     explicit FolderTreeWidgetProxyModelPrivate(FolderTreeWidgetProxyModel *qq)
         : q(qq)
     {
     }
 
+    static ResourceState stateFromInstance(const Akonadi::AgentInstance &instance)
+    {
+        ResourceState state;
+        state.broken = (instance.status() == Akonadi::AgentInstance::Broken);
+        state.online = instance.isOnline();
+        state.activitiesEnabled = instance.activitiesEnabled();
+        state.activities = instance.activities();
+        return state;
+    }
+
+    const ResourceState &resourceState(const QString &resource)
+    {
+        auto it = resourceStates.find(resource);
+        if (it == resourceStates.end()) {
+            it = resourceStates.insert(resource, stateFromInstance(Akonadi::AgentManager::self()->instance(resource)));
+        }
+        return it.value();
+    }
+
+    void updateResourceState(const Akonadi::AgentInstance &instance)
+    {
+        const auto it = resourceStates.find(instance.identifier());
+        if (it == resourceStates.end()) {
+            // Never asked for, nothing displayed depends on it
+            return;
+        }
+        const ResourceState state = stateFromInstance(instance);
+        const bool displayChanged = (state.broken != it->broken || state.online != it->online);
+        const bool filterChanged = (state.activitiesEnabled != it->activitiesEnabled || state.activities != it->activities);
+        *it = state;
+
+        if (filterChanged && accountActivities) {
+            q->slotInvalidateFilter();
+        }
+        if (displayChanged) {
+            // The foreground and the flags of every folder of the resource depend
+            // on it, and the folders of a resource are below its top-level rows
+            const int rowCount = q->rowCount();
+            for (int row = 0; row < rowCount; ++row) {
+                const QModelIndex index = q->index(row, 0);
+                const auto collection = index.data(Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
+                if (collection.resource() == instance.identifier()) {
+                    Q_EMIT q->dataChanged(index, index.siblingAtColumn(q->columnCount() - 1));
+                    emitSubtreeChanged(index);
+                }
+            }
+        }
+    }
+
+    // Emits dataChanged() for all the descendants of parent
+    void emitSubtreeChanged(const QModelIndex &parent)
+    {
+        const int rowCount = q->rowCount(parent);
+        if (rowCount == 0) {
+            return;
+        }
+        Q_EMIT q->dataChanged(q->index(0, 0, parent), q->index(rowCount - 1, q->columnCount(parent) - 1, parent));
+        for (int row = 0; row < rowCount; ++row) {
+            emitSubtreeChanged(q->index(row, 0, parent));
+        }
+    }
+
     bool checkQuotaExcedded(const QModelIndex &index, qreal &percentage)
     {
-        if (threshold >= 0.0) {
-            if (index.model()->hasChildren(index)) {
-                const int rowCount = index.model()->rowCount(index);
-                for (int row = 0; row < rowCount; row++) {
-                    const QModelIndex firstIndex = q->mapToSource(index.model()->index(row, 0, index));
-
-                    const auto collectionFirst = q->sourceModel()->data(firstIndex, Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
-                    if (collectionFirst.isValid() && collectionFirst.hasAttribute<Akonadi::CollectionQuotaAttribute>()) {
-                        const auto quota = collectionFirst.attribute<Akonadi::CollectionQuotaAttribute>();
-
-                        if (quota->currentValue() > -1 && quota->maximumValue() > 0) {
-                            percentage = (100.0 * quota->currentValue()) / quota->maximumValue();
-                            if (percentage >= threshold) {
-                                return true;
-                            }
+        if (threshold < 0.0) {
+            return false;
+        }
+        const Akonadi::Collection::Id id = index.data(Akonadi::EntityTreeModel::CollectionIdRole).toLongLong();
+        auto it = quotaStates.constFind(id);
+        if (it == quotaStates.cend()) {
+            it = quotaStates.insert(id, computeQuota(index));
+        }
+        percentage = it->percentage;
+        return it->exceeded;
+    }
+
+    QuotaState computeQuota(const QModelIndex &index) const
+    {
+        QuotaState state;
+        if (index.model()->hasChildren(index)) {
+            const int rowCount = index.model()->rowCount(index);
+            for (int row = 0; row < rowCount; row++) {
+                const QModelIndex firstIndex = q->mapToSource(index.model()->index(row, 0, index));
+
+                const auto collectionFirst = q->sourceModel()->data(firstIndex, Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
+                if (collectionFirst.isValid() && collectionFirst.hasAttribute<Akonadi::CollectionQuotaAttribute>()) {
+                    const auto quota = collectionFirst.attribute<Akonadi::CollectionQuotaAttribute>();
+
+                    if (quota->currentValue() > -1 && quota->maximumValue() > 0) {
+                        state.percentage = (100.0 * quota->currentValue()) / quota->maximumValue();
+                        if (state.percentage >= threshold) {
+                            state.exceeded = true;
+                            return state;
                         }
                     }
                 }
             }
         }
-        return false;
+        return state;
+    }
+
+    void invalidateQuota(const QModelIndex &parent)
+    {
+        // Only the direct children of a top-level folder count for its quota
+        if (parent.isValid() && !parent.parent().isValid()) {
+            quotaStates.remove(parent.data(Akonadi::EntityTreeModel::CollectionIdRole).toLongLong());
+        }
     }
 
     Akonadi::AccountActivitiesAbstract *accountActivities = nullptr;
     QSet<QString> includedMimeTypes;
     Akonadi::MimeTypeChecker checker;
+    QHash<QString, ResourceState> resourceStates;
+    QHash<Akonadi::Collection::Id, QuotaState> quotaStates;
 
     QColor brokenAccountColor;
     qreal threshold = -1.0;
@@ -86,6 +185,33 @@ FolderTreeWidgetProxyModel::FolderTreeWidgetProxyModel(QObject *parent, FolderTr
     if (option & HideOutboxFolder) {
         d->hideOutboxFolder = true;
     }
+
+    Akonadi::AgentManager *agentManager = Akonadi::AgentManager::self();
+    const auto updateResourceState = [this](const Akonadi::AgentInstance &instance) {
+        d->updateResourceState(instance);
+    };
+    connect(agentManager, &Akonadi::AgentManager::instanceStatusChanged, this, updateResourceState);
+    connect(agentManager, &Akonadi::AgentManager::instanceOnline, this, updateResourceState);
+    connect(agentManager, &Akonadi::AgentManager::instanceAdded, this, updateResourceState);
+    connect(agentManager, &Akonadi::AgentManager::instanceRemoved, this, [this](const Akonadi::AgentInstance &instance) {
+        d->resourceStates.remove(instance.identifier());
+    });
+
+    connect(this, &QAbstractItemModel::dataChanged, this, [this](const QModelIndex &topLeft) {
+        d->invalidateQuota(topLeft.parent());
+    });
+    connect(this, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex &parent) {
+        d->invalidateQuota(parent);
+    });
+    connect(this, &QAbstractItemModel::rowsRemoved, this, [this](const QModelIndex &parent) {
+        d->invalidateQuota(parent);
+    });
+    connect(this, &QAbstractItemModel::modelReset, this, [this]() {
+        d->quotaStates.clear();
+    });
+    connect(this, &QAbstractItemModel::layoutChanged, this, [this]() {
+        d->quotaStates.clear();
+    });
     readConfig();
 }
 
@@ -93,7 +219,10 @@ FolderTreeWidgetProxyModel::~FolderTreeWidgetProxyModel() = default;
 
 void FolderTreeWidgetProxyModel::setWarningThreshold(qreal threshold)
 {
-    d->threshold = threshold;
+    if (d->threshold != threshold) {
+        d->threshold = threshold;
+        d->quotaStates.clear();
+    }
 }
 
 void FolderTreeWidgetProxyModel::readConfig()
@@ -108,8 +237,7 @@ Qt::ItemFlags FolderTreeWidgetProxyModel::flags(const QModelIndex &index) const
         const QModelIndex rowIndex = sourceIndex.sibling(sourceIndex.row(), 0);
         const auto collection = sourceModel()->data(rowIndex, Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
         if (!MailCommon::Util::isVirtualCollection(collection)) {
-            const Akonadi::AgentInstance instance = Akonadi::AgentManager::self()->instance(collection.resource());
-            if (instance.status() == Akonadi::AgentInstance::Broken) {
+            if (d->resourceState(collection.resource()).broken) {
                 return QSortFilterProxyModel::flags(sourceIndex) & ~(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
             }
         }
@@ -180,9 +308,9 @@ bool FolderTreeWidgetProxyModel::filterAcceptsRow(int sourceRow, const QModelInd
 
     const auto collection = sourceModel()->data(modelIndex, Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
     if (d->accountActivities) {
-        const Akonadi::AgentInstance instance = Akonadi::AgentManager::self()->instance(collection.resource());
-        if (instance.activitiesEnabled()) {
-            if (!d->accountActivities->filterAcceptsRow(instance.activities())) {
+        const auto &state = d->resourceState(collection.resource());
+        if (state.activitiesEnabled) {
+            if (!d->accountActivities->filterAcceptsRow(state.activities)) {
                 return false;
             }
         }
@@ -221,9 +349,7 @@ QVariant FolderTreeWidgetProxyModel::data(const QModelIndex &index, int role) co
         const auto collection = sourceModel()->data(rowIndex, Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
 
         if (!MailCommon::Util::isVirtualCollection(collection)) {
-            const Akonadi::AgentInstance instance = Akonadi::AgentManager::self()->instance(collection.resource());
-
-            if (instance.status() == Akonadi::AgentInstance::Broken) {
+            if (d->resourceState(collection.resource()).broken) {
                 if (!d->brokenAccountColor.isValid()) {
                     const KColorScheme scheme(QPalette::Active, KColorScheme::View);
                     d->brokenAccountColor = scheme.foreground(KColorScheme::NegativeText).color();
@@ -236,9 +362,8 @@ QVariant FolderTreeWidgetProxyModel::data(const QModelIndex &index, int role) co
         const QModelIndex rowIndex = sourceIndex.sibling(sourceIndex.row(), 0);
         const auto collection = sourceModel()->data(rowIndex, Akonadi::EntityTreeModel::CollectionRole).value<Akonadi::Collection>();
         if (!MailCommon::Util::isVirtualCollection(collection)) {
-            const Akonadi::AgentInstance instance = Akonadi::AgentManager::self()->instance(collection.resource());
             if (collection.parentCollection() == Akonadi::Collection::root()) {
-                if (!instance.isOnline()) {
+                if (!d->resourceState(collection.resource()).online) {
                     return i18n("%1 (Offline)", Akonadi::EntityRightsFilterModel::data(index, role).toString());
                 }
                 qreal percentage = 0.0;
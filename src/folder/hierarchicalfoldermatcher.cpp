@@ -22,6 +22,8 @@ bool HierarchicalFolderMatcher::isNull() const
 
 void HierarchicalFolderMatcher::setFilter(const QString &filter, Qt::CaseSensitivity caseSensitivity)
 {
+    filterText = filter;
+    filterCaseSensitivity = caseSensitivity;
     filterRegExps.clear();
     if (filter.isEmpty()) {
         return;
@@ -36,6 +38,16 @@ void HierarchicalFolderMatcher::setFilter(const QString &filter, Qt::CaseSensiti
     });
 }
 
+QString HierarchicalFolderMatcher::filter() const
+{
+    return filterText;
+}
+
+Qt::CaseSensitivity HierarchicalFolderMatcher::caseSensitivity() const
+{
+    return filterCaseSensitivity;
+}
+
 bool HierarchicalFolderMatcher::matches(const QAbstractItemModel *model, const QModelIndex &start, int role)
 {
     if (!start.isValid()) {
@@ -59,6 +71,15 @@ bool HierarchicalFolderMatcher::matches(const QAbstractItemModel *model, const Q
 }
 
 QModelIndex HierarchicalFolderMatcher::findFirstMatch(const QAbstractItemModel *model, const QModelIndex &start, int role)
+{
+    return findFirstMatch(model, start, [this, model, role](const QModelIndex &idx) {
+        return matches(model, idx, role);
+    });
+}
+
+QModelIndex HierarchicalFolderMatcher::findFirstMatch(const QAbstractItemModel *model,
+                                                      const QModelIndex &start,
+                                                      const std::function<bool(const QModelIndex &)> &matchesIndex)
 {
     // inspired by QAbstractItemModel::match(), but using our own matching
     QModelIndex result;
@@ -75,13 +96,13 @@ QModelIndex HierarchicalFolderMatcher::findFirstMatch(const QAbstractItemModel *
             if (!idx.isValid()) {
                 continue;
             }
-            if (matches(model, idx, role)) {
+            if (matchesIndex(idx)) {
                 result = idx;
                 break;
             }
             const auto idxAsParent = filterKeyColumn != 0 ? idx.siblingAtColumn(0) : idx;
             if (model->hasChildren(idxAsParent)) {
-                result = findFirstMatch(model, model->index(0, filterKeyColumn, idxAsParent), role);
+                result = findFirstMatch(model, model->index(0, filterKeyColumn, idxAsParent), matchesIndex);
             }
         }
         // prepare for the next iteration
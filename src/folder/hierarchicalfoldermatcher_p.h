@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include "mailcommon_private_export.h"
+
 #include <QString>
+#include <functional>
 #include <vector>
 
 class QAbstractItemModel;
@@ -50,7 +53,7 @@ namespace MailCommon
  *   * I also think that the behavior of the original request isn't really
  *     intuitive, at least for people who know file path globbing.
  */
-class HierarchicalFolderMatcher
+class MAILCOMMON_TESTS_EXPORT HierarchicalFolderMatcher
 {
 public:
     HierarchicalFolderMatcher();
@@ -59,11 +62,20 @@ public:
 
     void setFilter(const QString &filter, Qt::CaseSensitivity caseSensitivity);
 
+    [[nodiscard]] QString filter() const;
+    [[nodiscard]] Qt::CaseSensitivity caseSensitivity() const;
+
     [[nodiscard]] bool matches(const QAbstractItemModel *model, const QModelIndex &start, int role = Qt::DisplayRole);
 
     [[nodiscard]] QModelIndex findFirstMatch(const QAbstractItemModel *model, const QModelIndex &start, int role = Qt::DisplayRole);
 
+    // Same traversal as above, but the rows are tested with matchesIndex
+    [[nodiscard]] static QModelIndex
+    findFirstMatch(const QAbstractItemModel *model, const QModelIndex &start, const std::function<bool(const QModelIndex &)> &matchesIndex);
+
 private:
     std::vector<QRegularExpression> filterRegExps;
+    QString filterText;
+    Qt::CaseSensitivity filterCaseSensitivity = Qt::CaseInsensitive;
 };
 }
@@ -0,0 +1,334 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "jobschedulertest.h"
+#include "../jobscheduler.h"
+
+#include <QTest>
+
+#include <algorithm>
+
+using MailCommon::JobScheduler;
+using MailCommon::ScheduledJob;
+using MailCommon::ScheduledTask;
+
+// A job which runs until the test deletes it
+class FakeScheduledJob : public ScheduledJob
+{
+public:
+    FakeScheduledJob(const Akonadi::Collection &folder, bool immediate)
+        : ScheduledJob(folder, immediate)
+    {
+    }
+
+    [[nodiscard]] qint64 folderId() const
+    {
+        return mSrcFolder.id();
+    }
+
+protected:
+    void execute() override
+    {
+    }
+};
+
+class FakeScheduledTask : public ScheduledTask
+{
+public:
+    FakeScheduledTask(const Akonadi::Collection &folder,
+                      bool immediate,
+                      int typeId,
+                      int priority,
+                      QList<QPointer<FakeScheduledJob>> &jobs,
+                      QList<qint64> &startedFolders,
+                      int &deletedTasks)
+        : ScheduledTask(folder, immediate)
+        , mTypeId(typeId)
+        , mPriority(priority)
+        , mJobs(jobs)
+        , mStartedFolders(startedFolders)
+        , mDeletedTasks(deletedTasks)
+    {
+    }
+
+    ~FakeScheduledTask() override
+    {
+        ++mDeletedTasks;
+    }
+
+    ScheduledJob *run() override
+    {
+        auto job = new FakeScheduledJob(folder(), isImmediate());
+        mJobs.append(job);
+        mStartedFolders.append(folder().id());
+        return job;
+    }
+
+    [[nodiscard]] int taskTypeId() const override
+    {
+        return mTypeId;
+    }
+
+    [[nodiscard]] int priority() const override
+    {
+        return mPriority;
+    }
+
+private:
+    const int mTypeId;
+    const int mPriority;
+    QList<QPointer<FakeScheduledJob>> &mJobs;
+    QList<qint64> &mStartedFolders;
+    int &mDeletedTasks;
+};
+
+JobSchedulerTest::JobSchedulerTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+JobSchedulerTest::~JobSchedulerTest() = default;
+
+void JobSchedulerTest::init()
+{
+    mScheduler = new JobScheduler(this);
+}
+
+void JobSchedulerTest::cleanup()
+{
+    delete mScheduler;
+    mScheduler = nullptr;
+    mJobs.clear();
+    mStartedFolders.clear();
+    mDeletedTasks = 0;
+}
+
+void JobSchedulerTest::registerTask(qint64 folderId, const QString &resource, bool immediate, int typeId, int priority)
+{
+    Akonadi::Collection folder(folderId);
+    folder.setResource(resource);
+    mScheduler->registerTask(new FakeScheduledTask(folder, immediate, typeId, priority, mJobs, mStartedFolders, mDeletedTasks));
+}
+
+void JobSchedulerTest::finishJob(qint64 folderId)
+{
+    for (const QPointer<FakeScheduledJob> &job : std::as_const(mJobs)) {
+        if (job && job->folderId() == folderId) {
+            // Like a job finishing on its own, FolderJob emits finished() from its destructor
+            delete job.data();
+            return;
+        }
+    }
+    QFAIL("No job running for this folder");
+}
+
+QList<qint64> JobSchedulerTest::sorted(QList<qint64> folders)
+{
+    std::sort(folders.begin(), folders.end());
+    return folders;
+}
+
+QList<qint64> JobSchedulerTest::runningFolders() const
+{
+    QList<qint64> folders;
+    for (const QPointer<FakeScheduledJob> &job : mJobs) {
+        if (job) {
+            folders.append(job->folderId());
+        }
+    }
+    return folders;
+}
+
+void JobSchedulerTest::shouldHaveDefaultValue()
+{
+    QCOMPARE(mScheduler->maximumConcurrentJobs(), 1);
+    QCOMPARE(mScheduler->maximumJobsPerResource(), 1);
+    QCOMPARE(mScheduler->pendingTaskCount(), 0);
+    QCOMPARE(mScheduler->runningJobCount(), 0);
+
+    mScheduler->setMaximumConcurrentJobs(0);
+    mScheduler->setMaximumJobsPerResource(-1);
+    QCOMPARE(mScheduler->maximumConcurrentJobs(), 1);
+    QCOMPARE(mScheduler->maximumJobsPerResource(), 1);
+}
+
+void JobSchedulerTest::shouldRunJobsUpToConcurrencyLimit()
+{
+    registerTask(1, QStringLiteral("res1"), true);
+    registerTask(2, QStringLiteral("res2"), true);
+    registerTask(3, QStringLiteral("res3"), true);
+    // One job at a time by default
+    QCOMPARE(runningFolders(), QList<qint64>{1});
+    QCOMPARE(mScheduler->pendingTaskCount(), 2);
+
+    mScheduler->setMaximumConcurrentJobs(2);
+    QTRY_COMPARE(runningFolders(), (QList<qint64>{1, 2}));
+    QCOMPARE(mScheduler->runningJobCount(), 2);
+    QCOMPARE(mScheduler->pendingTaskCount(), 1);
+
+    finishJob(1);
+    QTRY_COMPARE(runningFolders(), (QList<qint64>{2, 3}));
+    QCOMPARE(mScheduler->pendingTaskCount(), 0);
+
+    finishJob(2);
+    finishJob(3);
+    QCOMPARE(mScheduler->runningJobCount(), 0);
+    QCOMPARE(mDeletedTasks, 3);
+    QCOMPARE(mStartedFolders, (QList<qint64>{1, 2, 3}));
+}
+
+void JobSchedulerTest::shouldLimitJobsPerResource()
+{
+    mScheduler->setMaximumConcurrentJobs(4);
+    registerTask(1, QStringLiteral("res1"), true);
+    registerTask(2, QStringLiteral("res1"), true);
+    registerTask(3, QStringLiteral("res1"), true);
+    registerTask(4, QStringLiteral("res2"), true);
+    // The tasks of res1 wait although the scheduler could run more jobs
+    QCOMPARE(runningFolders(), (QList<qint64>{1, 4}));
+    QCOMPARE(mScheduler->pendingTaskCount(), 2);
+    QTest::qWait(50);
+    QCOMPARE(runningFolders(), (QList<qint64>{1, 4}));
+
+    mScheduler->setMaximumJobsPerResource(2);
+    QTRY_COMPARE(runningFolders(), (QList<qint64>{1, 4, 2}));
+    QCOMPARE(mScheduler->pendingTaskCount(), 1);
+
+    // A finished job of res2 doesn't let a third job of res1 run
+    finishJob(4);
+    QTest::qWait(50);
+    QCOMPARE(runningFolders(), (QList<qint64>{1, 2}));
+
+    finishJob(1);
+    QTRY_COMPARE(runningFolders(), (QList<qint64>{2, 3}));
+    QCOMPARE(mScheduler->pendingTaskCount(), 0);
+}
+
+void JobSchedulerTest::shouldRunTasksByImmediacyPriorityAndAge()
+{
+    registerTask(1, QStringLiteral("res1"), true);
+    QCOMPARE(runningFolders(), QList<qint64>{1});
+
+    registerTask(2, QStringLiteral("res2"), false, 1, 0);
+    registerTask(3, QStringLiteral("res3"), false, 1, 5);
+    registerTask(4, QStringLiteral("res4"), false, 1, 0);
+    registerTask(5, QStringLiteral("res5"), true, 1, 0);
+    registerTask(6, QStringLiteral("res6"), false, 1, 5);
+    QCOMPARE(mScheduler->pendingTaskCount(), 5);
+
+    // Each finished job starts the next task from the event loop
+    for (qint64 expected : {5, 3, 6, 2, 4}) {
+        finishJob(runningFolders().constFirst());
+        QTRY_COMPARE(runningFolders(), QList<qint64>{expected});
+    }
+    QCOMPARE(mStartedFolders, (QList<qint64>{1, 5, 3, 6, 2, 4}));
+}
+
+void JobSchedulerTest::shouldDetectDuplicateTasks()
+{
+    const Akonadi::Collection folder(10);
+
+    registerTask(10, QStringLiteral("res1"), false, 1);
+    registerTask(10, QStringLiteral("res1"), false, 1);
+    QCOMPARE(mScheduler->pendingTaskCount(), 1);
+    QCOMPARE(mDeletedTasks, 1);
+
+    // Another type, or another folder
+    registerTask(10, QStringLiteral("res1"), false, 2);
+    registerTask(11, QStringLiteral("res1"), false, 1);
+    QCOMPARE(mScheduler->pendingTaskCount(), 3);
+    // Tasks of type 0 are never merged
+    registerTask(10, QStringLiteral("res1"), false, 0);
+    registerTask(10, QStringLiteral("res1"), false, 0);
+    QCOMPARE(mScheduler->pendingTaskCount(), 5);
+    QCOMPARE(mDeletedTasks, 1);
+
+    QVERIFY(mScheduler->hasTask(1, folder));
+    QVERIFY(mScheduler->hasTask(2, folder));
+    QVERIFY(!mScheduler->hasTask(3, folder));
+    QVERIFY(!mScheduler->hasTask(2, Akonadi::Collection(11)));
+
+    // A task identical to a running one may wait for it
+    const Akonadi::Collection running(20);
+    registerTask(20, QStringLiteral("res2"), true, 3);
+    QCOMPARE(runningFolders(), QList<qint64>{20});
+    QVERIFY(mScheduler->hasTask(3, running));
+    registerTask(20, QStringLiteral("res2"), true, 3);
+    QCOMPARE(mScheduler->pendingTaskCount(), 6);
+    QCOMPARE(mDeletedTasks, 1);
+    // But only once
+    registerTask(20, QStringLiteral("res2"), true, 3);
+    QCOMPARE(mScheduler->pendingTaskCount(), 6);
+    QCOMPARE(mDeletedTasks, 2);
+
+    finishJob(20);
+    QTRY_COMPARE(runningFolders(), QList<qint64>{20});
+    QCOMPARE(mScheduler->pendingTaskCount(), 5);
+    QVERIFY(mScheduler->hasTask(3, running));
+    finishJob(20);
+    QVERIFY(!mScheduler->hasTask(3, running));
+}
+
+void JobSchedulerTest::shouldPromoteDuplicateToImmediate()
+{
+    // Deferred tasks wait for a minute
+    registerTask(1, QStringLiteral("res1"), false);
+    registerTask(2, QStringLiteral("res2"), false);
+    QVERIFY(runningFolders().isEmpty());
+
+    // The waiting task runs now, in place of the new one
+    registerTask(2, QStringLiteral("res2"), true);
+    QCOMPARE(runningFolders(), QList<qint64>{2});
+    QCOMPARE(mScheduler->pendingTaskCount(), 1);
+    QCOMPARE(mDeletedTasks, 1);
+
+    // A promoted task runs before older deferred tasks
+    registerTask(3, QStringLiteral("res3"), false);
+    registerTask(3, QStringLiteral("res3"), true);
+    QCOMPARE(mScheduler->pendingTaskCount(), 2);
+    QCOMPARE(mDeletedTasks, 2);
+    // Already immediate: nothing changes
+    registerTask(3, QStringLiteral("res3"), true);
+    QCOMPARE(mScheduler->pendingTaskCount(), 2);
+    QCOMPARE(mDeletedTasks, 3);
+
+    finishJob(2);
+    QTRY_COMPARE(runningFolders(), QList<qint64>{3});
+    finishJob(3);
+    QTRY_COMPARE(runningFolders(), QList<qint64>{1});
+    QCOMPARE(mStartedFolders, (QList<qint64>{2, 3, 1}));
+}
+
+void JobSchedulerTest::shouldRefileInterruptedJobs()
+{
+    mScheduler->setMaximumConcurrentJobs(2);
+    registerTask(1, QStringLiteral("res1"), true);
+    registerTask(2, QStringLiteral("res2"), true);
+    QCOMPARE(runningFolders(), (QList<qint64>{1, 2}));
+
+    // Scheduled jobs are cancellable: pausing kills them and keeps their tasks
+    mScheduler->pause();
+    QVERIFY(runningFolders().isEmpty());
+    QCOMPARE(mScheduler->runningJobCount(), 0);
+    QCOMPARE(mScheduler->pendingTaskCount(), 2);
+    QCOMPARE(mDeletedTasks, 0);
+
+    registerTask(3, QStringLiteral("res3"), true);
+    QVERIFY(runningFolders().isEmpty());
+
+    // The interrupted jobs are restarted first, in no particular order
+    mScheduler->resume();
+    QCOMPARE(sorted(runningFolders()), (QList<qint64>{1, 2}));
+    finishJob(1);
+    QTRY_COMPARE(sorted(runningFolders()), (QList<qint64>{2, 3}));
+    QCOMPARE(mStartedFolders.count(), 5);
+    QCOMPARE(mStartedFolders.constLast(), qint64(3));
+    QCOMPARE(mDeletedTasks, 1);
+}
+
+QTEST_MAIN(JobSchedulerTest)
+
+#include "moc_jobschedulertest.cpp"
@@ -0,0 +1,48 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QPointer>
+
+class FakeScheduledJob;
+
+namespace MailCommon
+{
+class JobScheduler;
+}
+
+class JobSchedulerTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit JobSchedulerTest(QObject *parent = nullptr);
+    ~JobSchedulerTest() override;
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void shouldHaveDefaultValue();
+    void shouldRunJobsUpToConcurrencyLimit();
+    void shouldLimitJobsPerResource();
+    void shouldRunTasksByImmediacyPriorityAndAge();
+    void shouldDetectDuplicateTasks();
+    void shouldPromoteDuplicateToImmediate();
+    void shouldRefileInterruptedJobs();
+
+private:
+    void registerTask(qint64 folderId, const QString &resource, bool immediate, int typeId = 1, int priority = 0);
+    void finishJob(qint64 folderId);
+    // The folders of the running jobs, in the order they were started
+    [[nodiscard]] QList<qint64> runningFolders() const;
+    [[nodiscard]] static QList<qint64> sorted(QList<qint64> folders);
+
+    MailCommon::JobScheduler *mScheduler = nullptr;
+    QList<QPointer<FakeScheduledJob>> mJobs;
+    QList<qint64> mStartedFolders;
+    int mDeletedTasks = 0;
+};
@@ -24,6 +24,7 @@
 #include <KZip>
 
 #include <QFileInfo>
+#include <QLocale>
 #include <QTimer>
 
 using namespace MailCommon;
@@ -76,45 +77,89 @@ void BackupJob::setRecursive(bool recursive)
     mRecursive = recursive;
 }
 
-bool BackupJob::queueFolders(const Akonadi::Collection &root)
-{
-    mPendingFolders.append(root);
-    if (mRecursive) {
-        // FIXME: Get rid of the exec()
-        // We could do a recursive CollectionFetchJob, but we only fetch the first level
-        // and then recurse manually. This is needed because a recursive fetch doesn't
-        // sort the collections the way we want. We need all first level children to be
-        // in the mPendingFolders list before all second level children, so that the
-        // directories for the first level are written before the directories in the
-        // second level, in the archive file.
-        auto job = new Akonadi::CollectionFetchJob(root, Akonadi::CollectionFetchJob::FirstLevel);
-        job->fetchScope().setAncestorRetrieval(Akonadi::CollectionFetchScope::All);
-        job->exec();
-        if (job->error()) {
-            qCWarning(MAILCOMMON_LOG) << job->errorString();
-            abort(i18n("Unable to retrieve folder list."));
-            return false;
+void BackupJob::queueFolders()
+{
+    // The root folder may lack its name, fetch it first
+    auto job = new Akonadi::CollectionFetchJob(mRootFolder, Akonadi::CollectionFetchJob::Base, this);
+    connect(job, &Akonadi::CollectionFetchJob::result, this, &BackupJob::onRootFolderFetched);
+}
+
+void BackupJob::onRootFolderFetched(KJob *job)
+{
+    if (job->error() || static_cast<Akonadi::CollectionFetchJob *>(job)->collections().isEmpty()) {
+        qCWarning(MAILCOMMON_LOG) << job->errorString();
+        abort(i18n("Unable to retrieve folder list."));
+        return;
+    }
+    mRootFolder = static_cast<Akonadi::CollectionFetchJob *>(job)->collections().constFirst();
+    if (!mRecursive) {
+        buildFolderTree({});
+        return;
+    }
+
+    // One recursive fetch, the folders are ordered by level in buildFolderTree()
+    auto fetchJob = new Akonadi::CollectionFetchJob(mRootFolder, Akonadi::CollectionFetchJob::Recursive, this);
+    connect(fetchJob, &Akonadi::CollectionFetchJob::result, this, &BackupJob::onSubFoldersFetched);
+}
+
+void BackupJob::onSubFoldersFetched(KJob *job)
+{
+    if (job->error()) {
+        qCWarning(MAILCOMMON_LOG) << job->errorString();
+        abort(i18n("Unable to retrieve folder list."));
+        return;
+    }
+    buildFolderTree(static_cast<Akonadi::CollectionFetchJob *>(job)->collections());
+}
+
+void BackupJob::buildFolderTree(const Akonadi::Collection::List &subFolders)
+{
+    mFolders.clear();
+    mFolders.reserve(subFolders.size() + 1);
+    mFolders.insert(mRootFolder.id(), FolderNode{mRootFolder, {}, {}, {}});
+    for (const Akonadi::Collection &collection : subFolders) {
+        mFolders.insert(collection.id(), FolderNode{collection, {}, {}, {}});
+    }
+    for (const Akonadi::Collection &collection : subFolders) {
+        const auto parent = mFolders.find(collection.parentCollection().id());
+        if (parent != mFolders.end()) {
+            parent->children.append(collection.id());
         }
+    }
 
-        const Akonadi::Collection::List lstCols = job->collections();
-        for (const Akonadi::Collection &collection : lstCols) {
-            if (!queueFolders(collection)) {
-                return false;
-            }
+    // Breadth first, so that all first level folders are written before the
+    // second level ones in the archive, and the paths of the parents are known.
+    FolderNode &root = mFolders[mRootFolder.id()];
+    root.path = mRootFolder.name();
+    root.subdirPath = u'.' + mRootFolder.name() + QLatin1StringView(".directory");
+    mPendingFolders = {mRootFolder};
+    for (qsizetype i = 0; i < mPendingFolders.size(); ++i) {
+        const FolderNode &node = mFolders[mPendingFolders.at(i).id()];
+        const QString subdirPath = node.subdirPath;
+        const QList<Akonadi::Collection::Id> children = node.children;
+        for (const Akonadi::Collection::Id childId : children) {
+            FolderNode &child = mFolders[childId];
+            const QString name = child.collection.name();
+            child.path = subdirPath + u'/' + name;
+            child.subdirPath = subdirPath + QLatin1StringView("/.") + name + QLatin1StringView(".directory");
+            mPendingFolders.append(child.collection);
         }
     }
-    mAllFolders = mPendingFolders;
-    return true;
+    // Folders not connected to the root are not archived
+    for (auto it = mFolders.begin(); it != mFolders.end();) {
+        if (it->path.isEmpty() && it.key() != mRootFolder.id()) {
+            it = mFolders.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    startArchiving();
 }
 
 bool BackupJob::hasChildren(const Akonadi::Collection &collection) const
 {
-    for (const Akonadi::Collection &curCol : std::as_const(mAllFolders)) {
-        if (collection == curCol.parentCollection()) {
-            return true;
-        }
-    }
-    return false;
+    const auto it = mFolders.constFind(collection.id());
+    return it != mFolders.cend() && !it->children.isEmpty();
 }
 
 void BackupJob::cancelJob()
@@ -139,10 +184,10 @@ void BackupJob::abort(const QString &errorMessage)
         mArchive->close();
     }
 
-    if (mCurrentJob) {
-        mCurrentJob->kill();
-        mCurrentJob = nullptr;
+    for (Akonadi::ItemFetchJob *job : std::as_const(mFetchJobs)) {
+        job->kill();
     }
+    mFetchJobs.clear();
 
     if (mProgressItem) {
         mProgressItem->setComplete();
@@ -207,50 +252,73 @@ void BackupJob::finish()
 
 void BackupJob::archiveNextMessage()
 {
+    mArchiveNextMessageQueued = false;
     if (mAborted) {
         return;
     }
 
-    if (mPendingMessages.isEmpty()) {
+    if (mPendingMessages.isEmpty() && mFetchJobs.isEmpty()) {
         qCDebug(MAILCOMMON_LOG) << "===> All messages done in folder " << mCurrentFolder.name();
         archiveNextFolder();
         return;
     }
 
-    const Akonadi::Item item = mPendingMessages.takeFirst();
-    qCDebug(MAILCOMMON_LOG) << "Fetching item with ID" << item.id() << "for folder" << mCurrentFolder.name();
-
-    mCurrentJob = new Akonadi::ItemFetchJob(item);
-    mCurrentJob->fetchScope().fetchFullPayload(true);
-    connect(mCurrentJob, &Akonadi::ItemFetchJob::result, this, &BackupJob::itemFetchJobResult);
+    // Keep a window of fetch jobs running, bounded by their number and by the
+    // estimated size of the messages they fetch, while the results are written.
+    while (!mPendingMessages.isEmpty() && mFetchJobs.size() < mMaximumRunningFetchJobs) {
+        if (!mFetchJobs.isEmpty() && mBufferedBytes >= mMaximumBufferedBytes) {
+            break;
+        }
+        qsizetype count = 0;
+        qint64 batchBytes = 0;
+        while (count < mPendingMessages.size() && count < mFetchBatchSize) {
+            const qint64 size = mPendingMessages.at(count).size();
+            if (count > 0 && mBufferedBytes + batchBytes + size > mMaximumBufferedBytes) {
+                break;
+            }
+            batchBytes += size;
+            ++count;
+        }
+        const Akonadi::Item::List batch = mPendingMessages.mid(0, count);
+        mPendingMessages.remove(0, count);
+        qCDebug(MAILCOMMON_LOG) << "Fetching" << batch.size() << "items for folder" << mCurrentFolder.name();
+
+        auto job = new Akonadi::ItemFetchJob(batch, this);
+        job->fetchScope().fetchFullPayload(true);
+        job->setProperty("batchBytes", batchBytes);
+        connect(job, &Akonadi::ItemFetchJob::result, this, &BackupJob::itemFetchJobResult);
+        mFetchJobs.append(job);
+        mBufferedBytes += batchBytes;
+    }
 }
 
-void BackupJob::processMessage(const Akonadi::Item &item)
+bool BackupJob::processMessage(const Akonadi::Item &item)
 {
     if (mAborted) {
-        return;
+        return false;
+    }
+    if (!item.hasPayload<std::shared_ptr<KMime::Message>>()) {
+        // Skipping it would let "archive and delete" remove a message which is not in the archive
+        qCWarning(MAILCOMMON_LOG) << "Item" << item.id() << "has no message payload";
+        abort(i18n("Unable to retrieve a message in folder '%1'.", mCurrentFolder.name()));
+        return false;
     }
 
     const auto message = item.payload<std::shared_ptr<KMime::Message>>();
-    qCDebug(MAILCOMMON_LOG) << "Processing message with subject " << message->subject(KMime::CreatePolicy::DontCreate);
     const QByteArray messageData = message->encodedContent();
     const qint64 messageSize = messageData.size();
     const QString messageName = QString::number(item.id());
     const QString fileName = pathForCollection(mCurrentFolder) + QLatin1StringView("/cur/") + messageName;
 
     // PORT ME: user and group!
-    qCDebug(MAILCOMMON_LOG) << "AKONDI PORT: disabled code here!";
     if (!mArchive->writeFile(fileName, messageData, archivePerms, QStringLiteral("user"), QStringLiteral("group"), mArchiveTime, mArchiveTime, mArchiveTime)) {
         abort(i18n("Failed to write a message into the archive folder '%1'.", mCurrentFolder.name()));
-        return;
+        return false;
     }
 
     ++mArchivedMessages;
     mArchivedSize += messageSize;
-
-    // Use a singleshot timer, otherwise the job started in archiveNextMessage()
-    // will hang
-    QTimer::singleShot(0, this, &BackupJob::archiveNextMessage);
+    return true;
 }
 
 void BackupJob::itemFetchJobResult(KJob *job)
@@ -259,19 +327,76 @@ void BackupJob::itemFetchJobResult(KJob *job)
         return;
     }
 
-    Q_ASSERT(job == mCurrentJob);
-    mCurrentJob = nullptr;
+    auto fetchJob = qobject_cast<Akonadi::ItemFetchJob *>(job);
+    Q_ASSERT(fetchJob);
+    Q_ASSERT(mFetchJobs.contains(fetchJob));
+    mFetchJobs.removeOne(fetchJob);
+    mBufferedBytes -= job->property("batchBytes").toLongLong();
 
     if (job->error()) {
         Q_ASSERT(mCurrentFolder.isValid());
         qCWarning(MAILCOMMON_LOG) << job->errorString();
         abort(i18n("Downloading a message in folder '%1' failed.", mCurrentFolder.name()));
-    } else {
-        auto fetchJob = qobject_cast<Akonadi::ItemFetchJob *>(job);
-        Q_ASSERT(fetchJob);
-        Q_ASSERT(fetchJob->items().size() == 1);
-        processMessage(fetchJob->items().constFirst());
+        return;
+    }
+
+    const Akonadi::Item::List items = fetchJob->items();
+    for (const Akonadi::Item &item : items) {
+        if (!processMessage(item)) {
+            return;
+        }
     }
+    updateProgressStatus();
+
+    // Use a singleshot timer, otherwise the jobs started in archiveNextMessage()
+    // will hang. Several fetch jobs can finish before it fires, only queue one
+    // call: a second one would see no work left as well and skip a folder.
+    if (!mArchiveNextMessageQueued) {
+        mArchiveNextMessageQueued = true;
+        QTimer::singleShot(0, this, &BackupJob::archiveNextMessage);
+    }
+}
+
+void BackupJob::updateProgressStatus()
+{
+    const qint64 elapsed = mArchiveTimer.elapsed();
+    if (!mProgressItem || elapsed - mLastStatusUpdate < 1000) {
+        return;
+    }
+    mLastStatusUpdate = elapsed;
+    const QLocale locale;
+    KFormat format;
+    mProgressItem->setStatus(i18n("Archiving folder %1 (%2 messages/s, %3/s)",
+                                  mCurrentFolder.name(),
+                                  locale.toString(messagesPerSecond(), 'f', 1),
+                                  format.formatByteSize(bytesPerSecond())));
+}
+
+double BackupJob::messagesPerSecond() const
+{
+    const qint64 elapsed = mArchiveTimer.isValid() ? mArchiveTimer.elapsed() : 0;
+    return elapsed > 0 ? mArchivedMessages * 1000.0 / elapsed : 0.0;
+}
+
+double BackupJob::bytesPerSecond() const
+{
+    const qint64 elapsed = mArchiveTimer.isValid() ? mArchiveTimer.elapsed() : 0;
+    return elapsed > 0 ? mArchivedSize * 1000.0 / elapsed : 0.0;
+}
+
+void BackupJob::setFetchBatchSize(int count)
+{
+    mFetchBatchSize = qMax(1, count);
+}
+
+void BackupJob::setMaximumRunningFetchJobs(int count)
+{
+    mMaximumRunningFetchJobs = qMax(1, count);
+}
+
+void BackupJob::setMaximumBufferedBytes(qint64 bytes)
+{
+    mMaximumBufferedBytes = qMax<qint64>(0, bytes);
 }
 
 bool BackupJob::writeDirHelper(const QString &directoryPath)
@@ -281,41 +406,18 @@ bool BackupJob::writeDirHelper(const QString &directoryPath)
     return mArchive->writeDir(directoryPath, QStringLiteral("user"), QStringLiteral("group"), 040755, mArchiveTime, mArchiveTime, mArchiveTime);
 }
 
-QString BackupJob::collectionName(const Akonadi::Collection &collection) const
-{
-    for (const Akonadi::Collection &curCol : std::as_const(mAllFolders)) {
-        if (curCol == collection) {
-            return curCol.name();
-        }
-    }
-    Q_ASSERT(false);
-    return {};
-}
-
 QString BackupJob::pathForCollection(const Akonadi::Collection &collection) const
 {
-    QString fullPath = collectionName(collection);
-    Akonadi::Collection curCol = collection.parentCollection();
-    if (collection != mRootFolder) {
-        Q_ASSERT(curCol.isValid());
-        while (curCol != mRootFolder) {
-            fullPath.prepend(u'.' + collectionName(curCol) + QLatin1StringView(".directory/"));
-            curCol = curCol.parentCollection();
-        }
-        Q_ASSERT(curCol == mRootFolder);
-        fullPath.prepend(u'.' + collectionName(curCol) + QLatin1StringView(".directory/"));
-    }
-    return fullPath;
+    const auto it = mFolders.constFind(collection.id());
+    Q_ASSERT(it != mFolders.cend());
+    return it != mFolders.cend() ? it->path : QString();
 }
 
 QString BackupJob::subdirPathForCollection(const Akonadi::Collection &collection) const
 {
-    QString path = pathForCollection(collection);
-    const int parentDirEndIndex = path.lastIndexOf(collection.name());
-    Q_ASSERT(parentDirEndIndex != -1);
-    path.truncate(parentDirEndIndex);
-    path.append(u'.' + collection.name() + QLatin1StringView(".directory"));
-    return path;
+    const auto it = mFolders.constFind(collection.id());
+    Q_ASSERT(it != mFolders.cend());
+    return it != mFolders.cend() ? it->subdirPath : QString();
 }
 
 void BackupJob::archiveNextFolder()
@@ -382,10 +484,11 @@ void BackupJob::start()
     Q_ASSERT(!mMailArchivePath.isEmpty());
     Q_ASSERT(mRootFolder.isValid());
 
-    if (!queueFolders(mRootFolder)) {
-        return;
-    }
+    queueFolders();
+}
 
+void BackupJob::startArchiving()
+{
     switch (mArchiveType) {
     case Zip: {
         KZip *zip = new KZip(mMailArchivePath.path());
@@ -414,6 +517,7 @@ void BackupJob::start()
     mProgressItem->setUsesBusyIndicator(true);
     connect(mProgressItem.data(), &KPIM::ProgressItem::progressItemCanceled, this, &BackupJob::cancelJob);
 
+    mArchiveTimer.start();
     archiveNextFolder();
 }
 
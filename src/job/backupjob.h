@@ -16,6 +16,8 @@
 #include <QUrl>
 
 #include <QDateTime>
+#include <QHash>
+#include <QElapsedTimer>
 #include <QObject>
 #include <QPointer>
 
@@ -109,6 +111,35 @@ public:
      */
     void setRealPath(const QString &path);
 
+    /*!
+     * Sets the number of messages fetched by each item fetch job.
+     *
+     * \param count The number of messages per fetch job, 50 by default
+     */
+    void setFetchBatchSize(int count);
+    /*!
+     * Sets the number of item fetch jobs running at the same time.
+     *
+     * \param count The number of concurrent fetch jobs, 4 by default
+     */
+    void setMaximumRunningFetchJobs(int count);
+    /*!
+     * Sets the estimated size of the messages being fetched above which no
+     * further fetch job is started. At least one fetch job always runs.
+     *
+     * \param bytes The memory cap in bytes, 64 MiB by default
+     */
+    void setMaximumBufferedBytes(qint64 bytes);
+
+    /*!
+     * Returns the number of messages archived per second so far.
+     */
+    [[nodiscard]] double messagesPerSecond() const;
+    /*!
+     * Returns the number of bytes archived per second so far.
+     */
+    [[nodiscard]] double bytesPerSecond() const;
+
     /*!
      * Starts the backup job.
      */
@@ -133,8 +164,13 @@ private:
     MAILCOMMON_NO_EXPORT void archiveNextFolder();
     MAILCOMMON_NO_EXPORT void onArchiveNextFolderDone(KJob *job);
     MAILCOMMON_NO_EXPORT void archiveNextMessage();
-    [[nodiscard]] MAILCOMMON_NO_EXPORT bool queueFolders(const Akonadi::Collection &root);
-    MAILCOMMON_NO_EXPORT void processMessage(const Akonadi::Item &item);
+    MAILCOMMON_NO_EXPORT void queueFolders();
+    MAILCOMMON_NO_EXPORT void onRootFolderFetched(KJob *job);
+    MAILCOMMON_NO_EXPORT void onSubFoldersFetched(KJob *job);
+    MAILCOMMON_NO_EXPORT void buildFolderTree(const Akonadi::Collection::List &subFolders);
+    MAILCOMMON_NO_EXPORT void startArchiving();
+    [[nodiscard]] MAILCOMMON_NO_EXPORT bool processMessage(const Akonadi::Item &item);
+    MAILCOMMON_NO_EXPORT void updateProgressStatus();
     [[nodiscard]] MAILCOMMON_NO_EXPORT QString pathForCollection(const Akonadi::Collection &collection) const;
     [[nodiscard]] MAILCOMMON_NO_EXPORT QString subdirPathForCollection(const Akonadi::Collection &collection) const;
     [[nodiscard]] MAILCOMMON_NO_EXPORT bool hasChildren(const Akonadi::Collection &collection) const;
@@ -142,11 +178,13 @@ private:
     MAILCOMMON_NO_EXPORT void abort(const QString &errorMessage);
     [[nodiscard]] MAILCOMMON_NO_EXPORT bool writeDirHelper(const QString &directoryPath);
 
-    // Helper function to return the name of the given collection.
-    // Some Collection's don't have the name fetched. However, in mAllFolders,
-    // we have a list of Collection's that have that information in them, so
-    // we can just look it up there.
-    [[nodiscard]] MAILCOMMON_NO_EXPORT QString collectionName(const Akonadi::Collection &collection) const;
+    // A folder to archive, with its archive paths computed once
+    struct FolderNode {
+        Akonadi::Collection collection;
+        QString path;
+        QString subdirPath;
+        QList<Akonadi::Collection::Id> children;
+    };
 
     QString mRealPath;
     QUrl mMailArchivePath;
@@ -156,17 +194,24 @@ private:
     KArchive *mArchive = nullptr;
     QWidget *const mParentWidget;
     int mArchivedMessages = 0;
-    uint mArchivedSize = 0;
+    qint64 mArchivedSize = 0;
     QPointer<KPIM::ProgressItem> mProgressItem;
     bool mAborted = false;
     bool mDeleteFoldersAfterCompletion = false;
     bool mRecursive = true;
 
     Akonadi::Collection::List mPendingFolders;
-    Akonadi::Collection::List mAllFolders;
+    QHash<Akonadi::Collection::Id, FolderNode> mFolders;
     Akonadi::Collection mCurrentFolder;
     Akonadi::Item::List mPendingMessages;
-    Akonadi::ItemFetchJob *mCurrentJob = nullptr;
+    QList<Akonadi::ItemFetchJob *> mFetchJobs;
+    QElapsedTimer mArchiveTimer;
+    qint64 mLastStatusUpdate = 0;
+    qint64 mBufferedBytes = 0;
+    qint64 mMaximumBufferedBytes = 64 * 1024 * 1024;
+    int mFetchBatchSize = 50;
+    int mMaximumRunningFetchJobs = 4;
     bool mDisplayMessageBox = true;
+    bool mArchiveNextMessageQueued = false;
 };
 }
@@ -0,0 +1,191 @@
+/**
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "expirebatchjob.h"
+#include "mailcommon_debug.h"
+#include <Akonadi/Job>
+#include <PimCommon/BroadcastStatus>
+using PimCommon::BroadcastStatus;
+
+#include <algorithm>
+
+namespace
+{
+// Batches are resized to take about this long on the server
+constexpr qint64 targetBatchDuration = 1000;
+constexpr int minimumBatchSize = 20;
+constexpr int maximumBatchSize = 1000;
+}
+
+ExpireBatchJob::ExpireBatchJob(QObject *parent)
+    : QObject{parent}
+{
+}
+
+ExpireBatchJob::~ExpireBatchJob() = default;
+
+Akonadi::Item::List ExpireBatchJob::removedMsgs() const
+{
+    return mRemovedMsgs;
+}
+
+void ExpireBatchJob::setRemovedMsgs(const Akonadi::Item::List &newRemovedMsgs)
+{
+    mRemovedMsgs = newRemovedMsgs;
+}
+
+void ExpireBatchJob::start()
+{
+    if (mRemovedMsgs.isEmpty()) {
+        qCDebug(MAILCOMMON_LOG) << metaObject()->className() << ": nothing to do";
+        finished();
+        return;
+    }
+    mElapsedTimer.start();
+    startBatches();
+}
+
+void ExpireBatchJob::startBatches()
+{
+    while (!mCanceled && mRunningJobs.count() < mMaximumRunningJobs && mNextIndex < mRemovedMsgs.count()) {
+        const qsizetype count = std::min<qsizetype>(mBatchSize, mRemovedMsgs.count() - mNextIndex);
+        const Akonadi::Item::List items = mRemovedMsgs.mid(mNextIndex, count);
+        mNextIndex += count;
+        addBatchJob(createBatchJob(items), {static_cast<int>(count)});
+    }
+}
+
+void ExpireBatchJob::addBatchJob(Akonadi::Job *job, const Batch &batch)
+{
+    mRunningJobs.insert(job, batch);
+    // The session queues its jobs, time a batch only once it is sent
+    connect(job, &Akonadi::Job::aboutToStart, this, &ExpireBatchJob::slotJobStarted);
+    connect(job, &Akonadi::Job::result, this, &ExpireBatchJob::slotJobDone);
+}
+
+void ExpireBatchJob::slotJobStarted(Akonadi::Job *job)
+{
+    const auto it = mRunningJobs.find(job);
+    if (it != mRunningJobs.end()) {
+        it->startTime = mElapsedTimer.elapsed();
+    }
+}
+
+void ExpireBatchJob::slotJobDone(KJob *job)
+{
+    const auto it = mRunningJobs.constFind(job);
+    if (it == mRunningJobs.cend()) {
+        return;
+    }
+    Batch batch = it.value();
+    mRunningJobs.erase(it);
+    if (batch.startTime >= 0) {
+        batch.duration += mElapsedTimer.elapsed() - batch.startTime;
+        batch.startTime = -1;
+    }
+    batchJobDone(job, batch);
+}
+
+void ExpireBatchJob::adaptBatchSize(qint64 duration)
+{
+    if (duration < targetBatchDuration / 2) {
+        mBatchSize = std::min(mBatchSize * 2, maximumBatchSize);
+    } else if (duration > targetBatchDuration * 2) {
+        mBatchSize = std::max(mBatchSize / 2, minimumBatchSize);
+    }
+}
+
+void ExpireBatchJob::cancel()
+{
+    if (mFinished) {
+        return;
+    }
+    mCanceled = true;
+    const QList<KJob *> jobs = mRunningJobs.keys();
+    mRunningJobs.clear();
+    for (KJob *job : jobs) {
+        job->kill(KJob::Quietly);
+    }
+    BroadcastStatus::instance()->setStatusMsg(statusMessage());
+    finished();
+}
+
+void ExpireBatchJob::batchDone(const Batch &batch, int error)
+{
+    if (error) {
+        mFailedCount += batch.count;
+        if (error == Akonadi::Job::UserCanceled) {
+            // Don't send the remaining batches
+            mCanceled = true;
+        }
+    } else {
+        mProcessedCount += batch.count;
+        // Adapt the size of the next batches to the latency of this one
+        adaptBatchSize(batch.duration);
+    }
+
+    startBatches();
+    BroadcastStatus::instance()->setStatusMsg(statusMessage());
+    if (!mRunningJobs.isEmpty()) {
+        return;
+    }
+    qCDebug(MAILCOMMON_LOG) << metaObject()->className() << ": processed" << mProcessedCount << "messages," << mFailedCount << "failed, at"
+                            << messagesPerSecond() << "messages/s";
+    finished();
+}
+
+void ExpireBatchJob::finished()
+{
+    if (mFinished) {
+        return;
+    }
+    mFinished = true;
+    emitDone();
+    deleteLater();
+}
+
+int ExpireBatchJob::maximumRunningJobs() const
+{
+    return mMaximumRunningJobs;
+}
+
+void ExpireBatchJob::setMaximumRunningJobs(int count)
+{
+    mMaximumRunningJobs = std::max(1, count);
+}
+
+int ExpireBatchJob::batchSize() const
+{
+    return mBatchSize;
+}
+
+int ExpireBatchJob::failedCount() const
+{
+    return mFailedCount;
+}
+
+double ExpireBatchJob::messagesPerSecond() const
+{
+    const qint64 elapsed = mElapsedTimer.isValid() ? mElapsedTimer.elapsed() : 0;
+    return elapsed > 0 ? mProcessedCount * 1000.0 / elapsed : 0.0;
+}
+
+bool ExpireBatchJob::isCanceled() const
+{
+    return mCanceled;
+}
+
+bool ExpireBatchJob::isRunning() const
+{
+    return !mRunningJobs.isEmpty();
+}
+
+int ExpireBatchJob::processedCount() const
+{
+    return mProcessedCount;
+}
+
+#include "moc_expirebatchjob.cpp"
@@ -0,0 +1,104 @@
+/**
+ * SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+ *
+ *  SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+#include <Akonadi/Item>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+
+class KJob;
+namespace Akonadi
+{
+class Job;
+}
+
+/**
+ * Base class of the expiry jobs which process messages in batches of Akonadi
+ * jobs. At most maximumRunningJobs() batches are sent to the Akonadi server at
+ * a time, and the batch size adapts so that a batch takes about one second on
+ * the server. The time a batch waits in the session queue is not counted.
+ *
+ * Subclasses create the Akonadi job of a batch and handle its result.
+ */
+class MAILCOMMON_TESTS_EXPORT ExpireBatchJob : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ExpireBatchJob(QObject *parent = nullptr);
+    ~ExpireBatchJob() override;
+
+    [[nodiscard]] Akonadi::Item::List removedMsgs() const;
+    void setRemovedMsgs(const Akonadi::Item::List &newRemovedMsgs);
+
+    void start();
+
+    /**
+     * Stops processing messages: the batches not started yet are dropped and
+     * the running ones are killed. The done signal of the job is emitted.
+     */
+    void cancel();
+
+    [[nodiscard]] int maximumRunningJobs() const;
+    void setMaximumRunningJobs(int count);
+
+    /// Returns the number of messages sent in the next batch.
+    [[nodiscard]] int batchSize() const;
+    /// Returns the number of messages that could not be processed.
+    [[nodiscard]] int failedCount() const;
+    /// Returns the number of messages processed per second since start().
+    [[nodiscard]] double messagesPerSecond() const;
+
+protected:
+    struct Batch {
+        int count = 0;
+        // When the running Akonadi job was sent to the server, -1 while queued
+        qint64 startTime = -1;
+        // Server time of the Akonadi jobs of this batch already done
+        qint64 duration = 0;
+    };
+
+    /// Returns the Akonadi job which processes @p items.
+    virtual Akonadi::Job *createBatchJob(const Akonadi::Item::List &items) = 0;
+    /**
+     * Called when an Akonadi job of @p batch is done. Implementations either
+     * continue the batch with addBatchJob() or call batchDone().
+     */
+    virtual void batchJobDone(KJob *job, const Batch &batch) = 0;
+    /// Returns the status message for the current progress of the job.
+    [[nodiscard]] virtual QString statusMessage() const = 0;
+    /// Emits the done signal of the job.
+    virtual void emitDone() = 0;
+
+    /// Runs @p job as part of @p batch.
+    void addBatchJob(Akonadi::Job *job, const Batch &batch);
+    /// Records the result of @p batch and sends the next batches.
+    void batchDone(const Batch &batch, int error);
+
+    [[nodiscard]] bool isCanceled() const;
+    [[nodiscard]] bool isRunning() const;
+    /// Returns the number of messages processed so far.
+    [[nodiscard]] int processedCount() const;
+
+private:
+    void slotJobStarted(Akonadi::Job *job);
+    void slotJobDone(KJob *job);
+    void adaptBatchSize(qint64 duration);
+    void startBatches();
+    void finished();
+    Akonadi::Item::List mRemovedMsgs;
+    QHash<KJob *, Batch> mRunningJobs;
+    QElapsedTimer mElapsedTimer;
+    qsizetype mNextIndex = 0;
+    int mBatchSize = 100;
+    int mMaximumRunningJobs = 4;
+    int mProcessedCount = 0;
+    int mFailedCount = 0;
+    bool mCanceled = false;
+    bool mFinished = false;
+};
@@ -8,81 +8,48 @@
 #include "mailcommon_debug.h"
 #include <Akonadi/ItemDeleteJob>
 #include <KLocalizedString>
-#include <PimCommon/BroadcastStatus>
-using PimCommon::BroadcastStatus;
 
 ExpireDeleteJob::ExpireDeleteJob(QObject *parent)
-    : QObject{parent}
+    : ExpireBatchJob{parent}
 {
 }
 
 ExpireDeleteJob::~ExpireDeleteJob() = default;
 
-Akonadi::Item::List ExpireDeleteJob::removedMsgs() const
+Akonadi::Job *ExpireDeleteJob::createBatchJob(const Akonadi::Item::List &items)
 {
-    return mRemovedMsgs;
+    return new Akonadi::ItemDeleteJob(items, this);
 }
 
-void ExpireDeleteJob::setRemovedMsgs(const Akonadi::Item::List &newRemovedMsgs)
+void ExpireDeleteJob::batchJobDone(KJob *job, const Batch &batch)
 {
-    mRemovedMsgs = newRemovedMsgs;
+    if (job->error()) {
+        qCCritical(MAILCOMMON_LOG) << job->error() << job->errorString();
+    }
+    batchDone(batch, job->error());
 }
 
-void ExpireDeleteJob::start()
+QString ExpireDeleteJob::statusMessage() const
 {
-    if (mRemovedMsgs.isEmpty()) {
-        qCDebug(MAILCOMMON_LOG) << "ExpireDeleteJob: nothing to do";
-        finished();
-        return;
+    if (isRunning()) {
+        return i18n("Removed %1 of %2 old messages from folder %3 (%4 messages/s)…",
+                    removedCount(),
+                    removedMsgs().count(),
+                    mSourceFolderName,
+                    qRound(messagesPerSecond()));
     }
-    Akonadi::Item::List ids;
-    ids.reserve(100);
-    for (const Akonadi::Item &item : std::as_const(mRemovedMsgs)) {
-        ids.append(item);
-        if (ids.count() >= 100) {
-            auto job = new Akonadi::ItemDeleteJob(ids, this);
-            mRunningJobs.append(job);
-            connect(job, &Akonadi::ItemDeleteJob::result, this, &ExpireDeleteJob::slotExpireDone);
-            ids.clear();
-            ids.reserve(100);
-        }
+    if (isCanceled()) {
+        return i18n("Removing old messages from folder %1 was canceled.", mSourceFolderName);
     }
-    if (!ids.isEmpty()) {
-        auto job = new Akonadi::ItemDeleteJob(ids, this);
-        mRunningJobs.append(job);
-        connect(job, &Akonadi::ItemDeleteJob::result, this, &ExpireDeleteJob::slotExpireDone);
+    if (failedCount() > 0) {
+        return i18n("Removing old messages from folder %1 failed.", mSourceFolderName);
     }
+    return i18np("Removed 1 old message from folder %2.", "Removed %1 old messages from folder %2.", removedCount(), mSourceFolderName);
 }
 
-void ExpireDeleteJob::slotExpireDone(KJob *job)
+void ExpireDeleteJob::emitDone()
 {
-    if (job->error()) {
-        qCCritical(MAILCOMMON_LOG) << job->error() << job->errorString();
-    }
-    QString msg;
-    const int error = job->error();
-    switch (error) {
-    case KJob::NoError:
-        msg = i18np("Removed 1 old message from folder %2.", "Removed %1 old messages from folder %2.", mRemovedMsgs.count(), mSourceFolderName);
-        break;
-
-    case Akonadi::Job::UserCanceled:
-        msg = i18n("Removing old messages from folder %1 was canceled.", mSourceFolderName);
-        break;
-
-    default: // any other error
-        msg = i18n("Removing old messages from folder %1 failed.", mSourceFolderName);
-        break;
-    }
-
-    // TODO cancel all job when user cancel it.
-    // Return when we have an error.
-
-    mRunningJobs.removeOne(job);
-    if (mRunningJobs.isEmpty()) {
-        finished();
-    }
-    BroadcastStatus::instance()->setStatusMsg(msg);
+    Q_EMIT expireDeleteDone();
 }
 
 QString ExpireDeleteJob::sourceFolderName() const
@@ -95,10 +62,9 @@ void ExpireDeleteJob::setSourceFolderName(const QString &newSourceFolderName)
     mSourceFolderName = newSourceFolderName;
 }
 
-void ExpireDeleteJob::finished()
+int ExpireDeleteJob::removedCount() const
 {
-    Q_EMIT expireDeleteDone();
-    deleteLater();
+    return processedCount();
 }
 
 #include "moc_expiredeletejob.cpp"
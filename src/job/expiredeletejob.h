@@ -6,31 +6,34 @@
 
 #pragma once
 
-#include <Akonadi/Item>
-#include <QObject>
+#include "expirebatchjob.h"
+#include "mailcommon_private_export.h"
 
-class ExpireDeleteJob : public QObject
+/**
+ * Removes the expired messages, in batches of ItemDeleteJob.
+ */
+class MAILCOMMON_TESTS_EXPORT ExpireDeleteJob : public ExpireBatchJob
 {
     Q_OBJECT
 public:
     explicit ExpireDeleteJob(QObject *parent = nullptr);
     ~ExpireDeleteJob() override;
 
-    [[nodiscard]] Akonadi::Item::List removedMsgs() const;
-    void setRemovedMsgs(const Akonadi::Item::List &newRemovedMsgs);
-
-    void start();
-
     [[nodiscard]] QString sourceFolderName() const;
     void setSourceFolderName(const QString &newSourceFolderName);
 
+    /// Returns the number of messages removed so far.
+    [[nodiscard]] int removedCount() const;
+
 Q_SIGNALS:
     void expireDeleteDone();
 
+protected:
+    Akonadi::Job *createBatchJob(const Akonadi::Item::List &items) override;
+    void batchJobDone(KJob *job, const Batch &batch) override;
+    [[nodiscard]] QString statusMessage() const override;
+    void emitDone() override;
+
 private:
-    void finished();
-    void slotExpireDone(KJob *job);
     QString mSourceFolderName;
-    Akonadi::Item::List mRemovedMsgs;
-    QList<KJob *> mRunningJobs;
 };
@@ -6,6 +6,7 @@
 
 #include "expirejob.h"
 #include "collectionpage/attributes/expirecollectionattribute.h"
+#include "collectionpage/attributes/expirecursorattribute.h"
 #include "expiredeletejob.h"
 #include "expiremovejob.h"
 #include "kernel/mailkernel.h"
@@ -16,16 +17,21 @@ using PimCommon::BroadcastStatus;
 
 #include <KLocalizedString>
 
+#include <Akonadi/CollectionModifyJob>
 #include <Akonadi/ItemDeleteJob>
 #include <Akonadi/ItemFetchJob>
 #include <Akonadi/ItemFetchScope>
 #include <Akonadi/ItemModifyJob>
 #include <Akonadi/ItemMoveJob>
+#include <Akonadi/ItemSearchJob>
 #include <Akonadi/MessageFlags>
 #include <Akonadi/MessageParts>
 #include <Akonadi/MessageStatus>
+#include <Akonadi/SearchQuery>
 #include <KMime/Message>
 
+#include <algorithm>
+
 /*
  Testcases for folder expiry:
   Automatic expiry:
@@ -40,6 +46,9 @@ using PimCommon::BroadcastStatus;
 */
 
 using namespace MailCommon;
+
+static bool sSearchQueryEnabled = false;
+
 ExpireJob::ExpireJob(const Akonadi::Collection &folder, bool immediate)
     : ScheduledJob(folder, immediate)
 {
@@ -52,6 +61,18 @@ ExpireJob::~ExpireJob()
 
 void ExpireJob::kill()
 {
+    // Stop expiring the current page. It isn't counted as handled, the
+    // next run checks it again.
+    if (mDeleteJob) {
+        disconnect(mDeleteJob, nullptr, this, nullptr);
+        mDeleteJob->cancel();
+    }
+    if (mMoveJob) {
+        disconnect(mMoveJob, nullptr, this, nullptr);
+        mMoveJob->cancel();
+    }
+    // Let the next run resume after the pages already handled
+    saveCursor(mCursor);
     ScheduledJob::kill();
 }
 
@@ -59,44 +80,195 @@ void ExpireJob::execute()
 {
     const MailCommon::ExpireCollectionAttribute *expirationAttribute = mSrcFolder.attribute<MailCommon::ExpireCollectionAttribute>();
     if (expirationAttribute) {
-        mMaxUnreadTime = 0;
-        mMaxReadTime = 0;
-        int unreadDays;
-        int readDays;
         mExpireMessagesWithoutInvalidDate = expirationAttribute->expireMessagesWithValidDate();
-        expirationAttribute->daysToExpire(unreadDays, readDays);
-
-        if (unreadDays > 0) {
-            qCDebug(MAILCOMMON_LOG) << "ExpireJob: deleting unread older than" << unreadDays << "days";
-            mMaxUnreadTime = QDateTime::currentSecsSinceEpoch() - unreadDays * 3600 * 24;
-        }
-        if (readDays > 0) {
-            qCDebug(MAILCOMMON_LOG) << "ExpireJob: deleting read older than" << readDays << "days";
-            mMaxReadTime = QDateTime::currentSecsSinceEpoch() - readDays * 3600 * 24;
-        }
+        expiryTimes(expirationAttribute, mMaxUnreadTime, mMaxReadTime);
 
         if ((mMaxUnreadTime == 0) && (mMaxReadTime == 0)) {
             qCDebug(MAILCOMMON_LOG) << "ExpireJob: nothing to do";
             deleteLater();
             return;
         }
+
+        if (expirationAttribute->expireAction() == MailCommon::ExpireCollectionAttribute::ExpireMove) {
+            mExpireByMove = true;
+            mMoveToFolder = Kernel::self()->collectionFromId(expirationAttribute->expireToFolderId());
+            if (!mMoveToFolder.isValid()) {
+                const QString str = i18n(
+                    "Cannot expire messages from folder %1: destination "
+                    "folder %2 not found",
+                    mSrcFolder.name(),
+                    expirationAttribute->expireToFolderId());
+                qCWarning(MAILCOMMON_LOG) << str;
+                BroadcastStatus::instance()->setStatusMsg(str);
+                deleteLater();
+                return;
+            }
+        }
+
+        if (const auto cursorAttribute = mSrcFolder.attribute<MailCommon::ExpireCursorAttribute>()) {
+            mCursor = cursorAttribute->cursor();
+        }
+        mSavedCursor = mCursor;
     } else {
         deleteLater();
         return;
     }
-    qCDebug(MAILCOMMON_LOG) << "ExpireJob: starting to expire in folder" << mSrcFolder.name();
+    if (mCursor >= 0) {
+        qCDebug(MAILCOMMON_LOG) << "ExpireJob: resuming to expire in folder" << mSrcFolder.name() << "after message" << mCursor;
+    } else {
+        qCDebug(MAILCOMMON_LOG) << "ExpireJob: starting to expire in folder" << mSrcFolder.name();
+    }
     slotDoWork();
     // do nothing here, we might be deleted!
 }
 
+void ExpireJob::expiryTimes(const ExpireCollectionAttribute *attribute, qint64 &maxUnreadTime, qint64 &maxReadTime)
+{
+    maxUnreadTime = 0;
+    maxReadTime = 0;
+    int unreadDays;
+    int readDays;
+    attribute->daysToExpire(unreadDays, readDays);
+
+    if (unreadDays > 0) {
+        qCDebug(MAILCOMMON_LOG) << "ExpireJob: deleting unread older than" << unreadDays << "days";
+        maxUnreadTime = QDateTime::currentSecsSinceEpoch() - unreadDays * 3600 * 24;
+    }
+    if (readDays > 0) {
+        qCDebug(MAILCOMMON_LOG) << "ExpireJob: deleting read older than" << readDays << "days";
+        maxReadTime = QDateTime::currentSecsSinceEpoch() - readDays * 3600 * 24;
+    }
+}
+
+bool ExpireJob::isExpired(const Akonadi::Item &item, qint64 maxUnreadTime, qint64 maxReadTime, bool expireMessagesWithoutDate)
+{
+    if (!item.hasPayload<std::shared_ptr<KMime::Message>>()) {
+        return false;
+    }
+
+    const auto mb = item.payload<std::shared_ptr<KMime::Message>>();
+    Akonadi::MessageStatus status;
+    status.setStatusFromFlags(item.flags());
+    if ((status.isImportant() || status.isToAct() || status.isWatched()) && SettingsIf->excludeImportantMailFromExpiry()) {
+        return false;
+    }
+
+    auto mailDate = mb->date(KMime::CreatePolicy::DontCreate);
+    if (!mailDate) {
+        return expireMessagesWithoutDate;
+    }
+    const time_t maxTime = status.isRead() ? maxReadTime : maxUnreadTime;
+    return mailDate->dateTime().toSecsSinceEpoch() < maxTime;
+}
+
+int ExpireJob::scannedCount() const
+{
+    return mScannedCount;
+}
+
+int ExpireJob::candidateCount() const
+{
+    return mCandidateCount + mRemovedMsgs.count();
+}
+
+bool ExpireJob::usedSearchQuery() const
+{
+    return mUsedSearchQuery;
+}
+
+void ExpireJob::setSearchQueryEnabled(bool enabled)
+{
+    sSearchQueryEnabled = enabled;
+}
+
+bool ExpireJob::searchQueryEnabled()
+{
+    return sSearchQueryEnabled;
+}
+
+bool ExpireJob::selectsWithSearchQuery(bool expireMessagesWithoutDate)
+{
+    // Messages without a Date header cannot be found by a date query
+    return sSearchQueryEnabled && !expireMessagesWithoutDate;
+}
+
 void ExpireJob::slotDoWork()
 {
+    if (selectsWithSearchQuery(mExpireMessagesWithoutInvalidDate)) {
+        startSearch();
+    } else {
+        startFullScan();
+    }
+}
+
+void ExpireJob::startSearch()
+{
+    using namespace Akonadi;
+
+    // Select (read and older than the read cutoff) or (unread and older
+    // than the unread cutoff). The index only knows dates, so the cutoff
+    // day is included and checkItems() applies the exact limits.
+    Akonadi::MessageStatus readStatus;
+    readStatus.setRead(true);
+    const QVariant seenFlag = readStatus.statusFlags().values().first();
+
+    SearchQuery query(SearchTerm::RelOr);
+    const auto addCutoff = [&](qint64 maxTime, bool read) {
+        if (maxTime == 0) {
+            return;
+        }
+        SearchTerm term(SearchTerm::RelAnd);
+        const QDate cutoffDate = QDateTime::fromSecsSinceEpoch(maxTime).date().addDays(1);
+        term.addSubTerm(EmailSearchTerm(EmailSearchTerm::HeaderOnlyDate, cutoffDate, SearchTerm::CondLessThan));
+        EmailSearchTerm statusTerm(EmailSearchTerm::MessageStatus, seenFlag, SearchTerm::CondContains);
+        statusTerm.setIsNegated(!read);
+        term.addSubTerm(statusTerm);
+        query.addTerm(term);
+    };
+    addCutoff(mMaxReadTime, true);
+    addCutoff(mMaxUnreadTime, false);
+
+    // Only the ids are needed here, the envelopes are fetched page by page
+    auto job = new ItemSearchJob(query, this);
+    job->setSearchCollections({mSrcFolder});
+    job->setRecursive(false);
+    job->setRemoteSearchEnabled(false);
+    job->setMimeTypes({KMime::Message::mimeType()});
+    job->fetchScope().fetchFullPayload(false);
+    job->fetchScope().setAncestorRetrieval(ItemFetchScope::Parent);
+    connect(job, &ItemSearchJob::result, this, &ExpireJob::itemSearchResult);
+}
+
+void ExpireJob::startFullScan()
+{
+    // Only the ids are needed here, the envelopes are fetched page by page
     auto job = new Akonadi::ItemFetchJob(mSrcFolder, this);
-    job->fetchScope().fetchPayloadPart(Akonadi::MessagePart::Envelope);
-    connect(job, &Akonadi::ItemFetchJob::result, this, &ExpireJob::itemFetchResult);
+    job->fetchScope().fetchFullPayload(false);
+    job->fetchScope().setFetchModificationTime(false);
+    job->fetchScope().setFetchRemoteIdentification(false);
+    connect(job, &Akonadi::ItemFetchJob::result, this, &ExpireJob::itemListResult);
+}
+
+void ExpireJob::itemSearchResult(KJob *job)
+{
+    if (job->error()) {
+        // No search backend or no index: scan the whole folder instead
+        qCDebug(MAILCOMMON_LOG) << "ExpireJob: search query failed, falling back to a full scan:" << job->errorString();
+        startFullScan();
+        return;
+    }
+
+    mUsedSearchQuery = true;
+    Akonadi::Item::List items = qobject_cast<Akonadi::ItemSearchJob *>(job)->items();
+    // Be defensive about what the search backend returns
+    items.removeIf([this](const Akonadi::Item &item) {
+        return item.parentCollection().isValid() && item.parentCollection().id() != mSrcFolder.id();
+    });
+    setPendingItems(items);
+    fetchNextPage();
 }
 
-void ExpireJob::itemFetchResult(KJob *job)
+void ExpireJob::itemListResult(KJob *job)
 {
     if (job->error()) {
         qCWarning(MAILCOMMON_LOG) << job->errorString();
@@ -104,99 +276,159 @@ void ExpireJob::itemFetchResult(KJob *job)
         return;
     }
 
-    const Akonadi::Item::List items = qobject_cast<Akonadi::ItemFetchJob *>(job)->items();
+    setPendingItems(qobject_cast<Akonadi::ItemFetchJob *>(job)->items());
+    fetchNextPage();
+}
+
+void ExpireJob::setPendingItems(const Akonadi::Item::List &items)
+{
+    mPendingIds.clear();
+    mPendingIds.reserve(items.count());
     for (const Akonadi::Item &item : items) {
-        if (!item.hasPayload<std::shared_ptr<KMime::Message>>()) {
-            continue;
+        // Skip what an interrupted run already handled
+        if (item.id() > mCursor) {
+            mPendingIds.append(item.id());
         }
+    }
+    std::sort(mPendingIds.begin(), mPendingIds.end());
+    mNextIndex = 0;
+}
 
-        const auto mb = item.payload<std::shared_ptr<KMime::Message>>();
-        Akonadi::MessageStatus status;
-        status.setStatusFromFlags(item.flags());
-        if ((status.isImportant() || status.isToAct() || status.isWatched()) && SettingsIf->excludeImportantMailFromExpiry()) {
-            continue;
-        }
+void ExpireJob::fetchNextPage()
+{
+    if (mNextIndex >= mPendingIds.count()) {
+        done();
+        return;
+    }
 
-        auto mailDate = mb->date(KMime::CreatePolicy::DontCreate);
-        if (!mailDate) {
-            if (mExpireMessagesWithoutInvalidDate) {
-                mRemovedMsgs.append(item);
-            }
-        } else {
-            const time_t maxTime = status.isRead() ? mMaxReadTime : mMaxUnreadTime;
-            if (mailDate->dateTime().toSecsSinceEpoch() < maxTime) {
-                mRemovedMsgs.append(item);
-            }
-        }
+    const qsizetype end = std::min<qsizetype>(mNextIndex + PageSize, mPendingIds.count());
+    Akonadi::Item::List page;
+    page.reserve(end - mNextIndex);
+    for (qsizetype i = mNextIndex; i < end; ++i) {
+        page.append(Akonadi::Item(mPendingIds.at(i)));
     }
+    mNextIndex = end;
+    mPageLastId = mPendingIds.at(end - 1);
 
-    done();
+    auto job = new Akonadi::ItemFetchJob(page, this);
+    job->fetchScope().fetchPayloadPart(Akonadi::MessagePart::Envelope);
+    connect(job, &Akonadi::ItemFetchJob::result, this, &ExpireJob::pageFetchResult);
 }
 
-void ExpireJob::done()
+void ExpireJob::pageFetchResult(KJob *job)
 {
-    bool moving = false;
-    if (!mRemovedMsgs.isEmpty()) {
-        const int count = mRemovedMsgs.count();
-
-        // The command shouldn't kill us because it opens the folder
-        mCancellable = false;
-
-        const MailCommon::ExpireCollectionAttribute *expirationAttribute = mSrcFolder.attribute<MailCommon::ExpireCollectionAttribute>();
-        QString str;
-        if (expirationAttribute) {
-            const QString srcFolderName{mSrcFolder.name()};
-            if (expirationAttribute->expireAction() == MailCommon::ExpireCollectionAttribute::ExpireDelete) {
-                // Expire by deletion, i.e. move to null target folder
-                qCDebug(MAILCOMMON_LOG) << "ExpireJob: finished expiring in folder" << srcFolderName << count << "messages to remove.";
-                auto job = new ExpireDeleteJob(this);
-                job->setRemovedMsgs(mRemovedMsgs);
-                job->setSourceFolderName(srcFolderName);
-                connect(job, &ExpireDeleteJob::expireDeleteDone, this, &ExpireJob::slotExpireDeleteDone);
-                moving = true;
-                str = i18np("Removing 1 old message from folder %2…", "Removing %1 old messages from folder %2...", count, srcFolderName);
-                job->start();
-            } else {
-                // Expire by moving
-                mMoveToFolder = Kernel::self()->collectionFromId(expirationAttribute->expireToFolderId());
-                if (!mMoveToFolder.isValid()) {
-                    str = i18n(
-                        "Cannot expire messages from folder %1: destination "
-                        "folder %2 not found",
-                        srcFolderName,
-                        expirationAttribute->expireToFolderId());
-                    qCWarning(MAILCOMMON_LOG) << str;
-                } else {
-                    qCDebug(MAILCOMMON_LOG) << "ExpireJob: finished expiring in folder" << srcFolderName << mRemovedMsgs.count() << "messages to move to"
-                                            << mMoveToFolder.name();
-
-                    auto job = new ExpireMoveJob(this);
-                    job->setRemovedMsgs(mRemovedMsgs);
-                    job->setSrcFolderName(srcFolderName);
-                    job->setMoveToFolder(mMoveToFolder);
-                    connect(job, &ExpireMoveJob::expireMovedDone, this, &ExpireJob::slotExpireDeleteDone);
-                    job->start();
-                    moving = true;
-                    str = i18np("Moving 1 old message from folder %2 to folder %3…",
-                                "Moving %1 old messages from folder %2 to folder %3…",
-                                count,
-                                srcFolderName,
-                                mMoveToFolder.name());
-                }
-            }
-        }
-        if (!str.isEmpty()) {
-            BroadcastStatus::instance()->setStatusMsg(str);
+    if (job->error()) {
+        // Most likely messages removed meanwhile. Stop without moving the
+        // cursor past this page, the next run will check it again.
+        qCWarning(MAILCOMMON_LOG) << "ExpireJob: cannot fetch messages of folder" << mSrcFolder.name() << job->errorString();
+        saveCursor(mCursor);
+        deleteLater();
+        return;
+    }
+
+    checkItems(qobject_cast<Akonadi::ItemFetchJob *>(job)->items());
+    expirePage();
+}
+
+void ExpireJob::checkItems(const Akonadi::Item::List &items)
+{
+    mScannedCount += items.count();
+    for (const Akonadi::Item &item : items) {
+        if (isExpired(item, mMaxUnreadTime, mMaxReadTime, mExpireMessagesWithoutInvalidDate)) {
+            mRemovedMsgs.append(item);
         }
     }
+}
 
-    if (!moving) {
-        deleteLater();
+void ExpireJob::expirePage()
+{
+    if (mRemovedMsgs.isEmpty()) {
+        pageDone();
+        return;
     }
+
+    const int count = mRemovedMsgs.count();
+    const QString srcFolderName{mSrcFolder.name()};
+
+    QString str;
+    if (!mExpireByMove) {
+        // Expire by deletion, i.e. move to null target folder
+        qCDebug(MAILCOMMON_LOG) << "ExpireJob: expiring in folder" << srcFolderName << count << "messages to remove.";
+        auto job = new ExpireDeleteJob(this);
+        mDeleteJob = job;
+        job->setRemovedMsgs(mRemovedMsgs);
+        job->setSourceFolderName(srcFolderName);
+        connect(job, &ExpireDeleteJob::expireDeleteDone, this, &ExpireJob::slotPageExpired);
+        str = i18np("Removing 1 old message from folder %2…", "Removing %1 old messages from folder %2...", count, srcFolderName);
+        job->start();
+    } else {
+        // Expire by moving
+        qCDebug(MAILCOMMON_LOG) << "ExpireJob: expiring in folder" << srcFolderName << count << "messages to move to" << mMoveToFolder.name();
+
+        auto job = new ExpireMoveJob(this);
+        mMoveJob = job;
+        job->setRemovedMsgs(mRemovedMsgs);
+        job->setSrcFolderName(srcFolderName);
+        job->setMoveToFolder(mMoveToFolder);
+        connect(job, &ExpireMoveJob::expireMovedDone, this, &ExpireJob::slotPageExpired);
+        job->start();
+        str = i18np("Moving 1 old message from folder %2 to folder %3…",
+                    "Moving %1 old messages from folder %2 to folder %3…",
+                    count,
+                    srcFolderName,
+                    mMoveToFolder.name());
+    }
+    BroadcastStatus::instance()->setStatusMsg(str);
+}
+
+void ExpireJob::slotPageExpired()
+{
+    mCandidateCount += mRemovedMsgs.count();
+    mRemovedMsgs.clear();
+    pageDone();
 }
 
-void ExpireJob::slotExpireDeleteDone()
+void ExpireJob::pageDone()
+{
+    mCursor = mPageLastId;
+    // Persisting the cursor modifies the collection, so not after every page
+    if (++mPagesSinceSave >= 10) {
+        saveCursor(mCursor);
+    }
+    fetchNextPage();
+}
+
+void ExpireJob::saveCursor(Akonadi::Item::Id cursor)
+{
+    if (cursor == mSavedCursor) {
+        return;
+    }
+    mSavedCursor = cursor;
+    mPagesSinceSave = 0;
+
+    // Only touch the cursor attribute: the expiry settings may have been
+    // changed since this job started. Let the job outlive us when we are killed.
+    Akonadi::Collection collection(mSrcFolder.id());
+    if (cursor >= 0) {
+        auto attribute = collection.attribute<MailCommon::ExpireCursorAttribute>(Akonadi::Collection::AddIfMissing);
+        attribute->setCursor(cursor);
+    } else {
+        collection.removeAttribute<MailCommon::ExpireCursorAttribute>();
+    }
+    auto job = new Akonadi::CollectionModifyJob(collection);
+    connect(job, &Akonadi::CollectionModifyJob::result, job, [](KJob *job) {
+        if (job->error()) {
+            qCWarning(MAILCOMMON_LOG) << "ExpireJob: cannot save the expiry cursor" << job->errorString();
+        }
+    });
+}
+
+void ExpireJob::done()
 {
+    qCDebug(MAILCOMMON_LOG) << "ExpireJob:" << candidateCount() << "candidates out of" << mScannedCount << "scanned messages in folder" << mSrcFolder.name()
+                            << (mUsedSearchQuery ? "(search query)" : "(full scan)");
+    // The run is complete, the next one starts from the beginning
+    saveCursor(-1);
     deleteLater();
 }
 
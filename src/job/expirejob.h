@@ -7,15 +7,22 @@
 #pragma once
 
 #include "jobscheduler.h"
+#include "mailcommon_private_export.h"
 
 #include <Akonadi/Collection>
 #include <Akonadi/Item>
 
+#include <QPointer>
+
 class KJob;
+class ExpireDeleteJob;
+class ExpireMoveJob;
 
 namespace MailCommon
 {
-class ExpireJob : public ScheduledJob
+class ExpireCollectionAttribute;
+
+class MAILCOMMON_TESTS_EXPORT ExpireJob : public ScheduledJob
 {
     Q_OBJECT
 public:
@@ -25,17 +32,71 @@ public:
     void execute() override;
     void kill() override;
 
+    /// Returns the number of items fetched and checked against the expiry rules.
+    [[nodiscard]] int scannedCount() const;
+    /// Returns the number of items found to be expired.
+    [[nodiscard]] int candidateCount() const;
+    /// Returns whether the candidates were selected by a server-side search query
+    /// rather than by scanning the whole folder.
+    [[nodiscard]] bool usedSearchQuery() const;
+
+    /// Enables selecting the candidates with a server-side search query. A
+    /// search only finds indexed messages, so this must only be enabled when
+    /// the search index is known to be complete. Disabled by default, every
+    /// folder is then scanned.
+    static void setSearchQueryEnabled(bool enabled);
+    [[nodiscard]] static bool searchQueryEnabled();
+
+    /// Returns whether a run with \a expireMessagesWithoutDate selects its
+    /// candidates with a search query: messages without a date can't be found
+    /// by one, so they always need a full scan.
+    [[nodiscard]] static bool selectsWithSearchQuery(bool expireMessagesWithoutDate);
+
+    /// The number of messages fetched, checked and expired at a time.
+    static constexpr int PageSize = 500;
+
+    /// Computes the limits of the expiry settings \a attribute: messages older than
+    /// these (in seconds since epoch) are expired, 0 meaning no expiry.
+    static void expiryTimes(const ExpireCollectionAttribute *attribute, qint64 &maxUnreadTime, qint64 &maxReadTime);
+    /// Returns whether \a item, fetched with its envelope, has to be expired.
+    [[nodiscard]] static bool isExpired(const Akonadi::Item &item, qint64 maxUnreadTime, qint64 maxReadTime, bool expireMessagesWithoutDate);
+
 private:
     void slotDoWork();
-    void slotExpireDone(KJob *job);
-    void itemFetchResult(KJob *job);
+    void startSearch();
+    void startFullScan();
+    void itemSearchResult(KJob *job);
+    void itemListResult(KJob *job);
+    void setPendingItems(const Akonadi::Item::List &items);
+    void fetchNextPage();
+    void pageFetchResult(KJob *job);
+    void checkItems(const Akonadi::Item::List &items);
+    void expirePage();
+    void slotPageExpired();
+    void pageDone();
+    void saveCursor(Akonadi::Item::Id cursor);
     void done();
-    void slotExpireDeleteDone();
 
+    // Ids of the messages left to check, in increasing order
+    QList<Akonadi::Item::Id> mPendingIds;
+    qsizetype mNextIndex = 0;
+    Akonadi::Item::Id mPageLastId = -1;
+    // Messages of the current page to expire
     Akonadi::Item::List mRemovedMsgs;
+    // Removes or moves them, canceled when we are killed
+    QPointer<ExpireDeleteJob> mDeleteJob;
+    QPointer<ExpireMoveJob> mMoveJob;
+    // Last message id of the pages completely handled, see ExpireCursorAttribute
+    Akonadi::Item::Id mCursor = -1;
+    Akonadi::Item::Id mSavedCursor = -1;
+    int mPagesSinceSave = 0;
     qint64 mMaxUnreadTime = 0;
     qint64 mMaxReadTime = 0;
+    int mScannedCount = 0;
+    int mCandidateCount = 0;
     bool mExpireMessagesWithoutInvalidDate = false;
+    bool mUsedSearchQuery = false;
+    bool mExpireByMove = false;
     Akonadi::Collection mMoveToFolder;
 };
 
@@ -52,6 +113,9 @@ public:
 
     ~ScheduledExpireTask() override = default;
 
+    /// The type of the expire tasks, see JobScheduler::hasTask().
+    static constexpr int TypeId = 1;
+
     ScheduledJob *run() override
     {
         return folder().isValid() ? new ExpireJob(folder(), isImmediate()) : nullptr;
@@ -59,7 +123,7 @@ public:
 
     int taskTypeId() const override
     {
-        return 1;
+        return TypeId;
     }
 };
 } // namespace
@@ -10,58 +10,84 @@
 #include <Akonadi/ItemModifyJob>
 #include <Akonadi/ItemMoveJob>
 #include <KLocalizedString>
-#include <PimCommon/BroadcastStatus>
-
-using PimCommon::BroadcastStatus;
 
 ExpireMoveJob::ExpireMoveJob(QObject *parent)
-    : QObject{parent}
+    : ExpireBatchJob{parent}
 {
 }
 
 ExpireMoveJob::~ExpireMoveJob() = default;
 
-Akonadi::Item::List ExpireMoveJob::removedMsgs() const
-{
-    return mRemovedMsgs;
-}
-
-void ExpireMoveJob::setRemovedMsgs(const Akonadi::Item::List &newRemovedMsgs)
+Akonadi::Job *ExpireMoveJob::createBatchJob(const Akonadi::Item::List &items)
 {
-    mRemovedMsgs = newRemovedMsgs;
+    return new Akonadi::ItemMoveJob(items, mMoveToFolder, this);
 }
 
-void ExpireMoveJob::start()
+void ExpireMoveJob::batchJobDone(KJob *job, const Batch &batch)
 {
-    if (mRemovedMsgs.isEmpty()) {
-        qCDebug(MAILCOMMON_LOG) << "ExpireMoveJob: nothing to do. Bug ?";
-        finished();
+    auto moveJob = qobject_cast<Akonadi::ItemMoveJob *>(job);
+    if (!moveJob) {
+        if (job->error()) {
+            // The messages were moved, only marking them as read failed
+            qCCritical(MAILCOMMON_LOG) << job->error() << job->errorString();
+        }
+        batchDone(batch, KJob::NoError);
         return;
     }
-    Akonadi::Item::List ids;
-    ids.reserve(100);
-    for (const Akonadi::Item &item : std::as_const(mRemovedMsgs)) {
-        ids.append(item);
-        if (ids.count() >= 100) {
-            auto job = new Akonadi::ItemMoveJob(ids, mMoveToFolder, this);
-            connect(job, &Akonadi::ItemMoveJob::result, this, &ExpireMoveJob::slotMoveDone);
 
-            mRunningJobs.append(job);
-            ids.clear();
-            ids.reserve(100);
+    if (job->error()) {
+        qCCritical(MAILCOMMON_LOG) << job->error() << job->errorString();
+        batchDone(batch, job->error());
+        return;
+    }
+    Akonadi::Item::List newLst;
+    const Akonadi::Item::List lst = moveJob->items();
+    for (Akonadi::Item item : lst) {
+        if (!item.hasFlag(Akonadi::MessageFlags::Seen)) {
+            item.setFlag(Akonadi::MessageFlags::Seen);
+            newLst << item;
         }
     }
-    if (!ids.isEmpty()) {
-        auto job = new Akonadi::ItemMoveJob(ids, mMoveToFolder, this);
-        mRunningJobs.append(job);
-        connect(job, &Akonadi::ItemMoveJob::result, this, &ExpireMoveJob::slotMoveDone);
+    if (!newLst.isEmpty() && !isCanceled()) {
+        // The batch stays in flight until its messages are marked as read
+        auto modifyJob = new Akonadi::ItemModifyJob(newLst, this);
+        modifyJob->disableRevisionCheck();
+        addBatchJob(modifyJob, batch);
+    } else {
+        batchDone(batch, KJob::NoError);
+    }
+}
+
+QString ExpireMoveJob::statusMessage() const
+{
+    if (isRunning()) {
+        return i18n("Moved %1 of %2 old messages from folder %3 to folder %4 (%5 messages/s)…",
+                    movedCount(),
+                    removedMsgs().count(),
+                    mSrcFolderName,
+                    mMoveToFolder.name(),
+                    qRound(messagesPerSecond()));
     }
+    if (isCanceled()) {
+        return i18n(
+            "Moving old messages from folder %1 to folder %2 was "
+            "canceled.",
+            mSrcFolderName,
+            mMoveToFolder.name());
+    }
+    if (failedCount() > 0) {
+        return i18n("Moving old messages from folder %1 to folder %2 failed.", mSrcFolderName, mMoveToFolder.name());
+    }
+    return i18np("Moved 1 old message from folder %2 to folder %3.",
+                 "Moved %1 old messages from folder %2 to folder %3.",
+                 movedCount(),
+                 mSrcFolderName,
+                 mMoveToFolder.name());
 }
 
-void ExpireMoveJob::finished()
+void ExpireMoveJob::emitDone()
 {
     Q_EMIT expireMovedDone();
-    deleteLater();
 }
 
 QString ExpireMoveJob::srcFolderName() const
@@ -84,71 +110,9 @@ void ExpireMoveJob::setMoveToFolder(const Akonadi::Collection &newMoveToFolder)
     mMoveToFolder = newMoveToFolder;
 }
 
-void ExpireMoveJob::slotMoveDone(KJob *job)
-{
-    if (job->error()) {
-        qCCritical(MAILCOMMON_LOG) << job->error() << job->errorString();
-        deleteLater();
-        return;
-    }
-    auto itemjob = qobject_cast<Akonadi::ItemMoveJob *>(job);
-    if (itemjob) {
-        const Akonadi::Item::List lst = itemjob->items();
-        if (!lst.isEmpty()) {
-            Akonadi::Item::List newLst;
-            for (Akonadi::Item item : lst) {
-                if (!item.hasFlag(Akonadi::MessageFlags::Seen)) {
-                    item.setFlag(Akonadi::MessageFlags::Seen);
-                    newLst << item;
-                }
-            }
-            if (!newLst.isEmpty()) {
-                auto modifyJob = new Akonadi::ItemModifyJob(newLst, this);
-                modifyJob->disableRevisionCheck();
-                connect(modifyJob, &Akonadi::ItemModifyJob::result, this, &ExpireMoveJob::slotExpireDone);
-            } else {
-                slotExpireDone(job);
-            }
-        }
-    } else {
-        slotExpireDone(job);
-    }
-}
-
-void ExpireMoveJob::slotExpireDone(KJob *job)
+int ExpireMoveJob::movedCount() const
 {
-    if (job->error()) {
-        qCCritical(MAILCOMMON_LOG) << job->error() << job->errorString();
-    }
-    QString msg;
-    const int error = job->error();
-    switch (error) {
-    case KJob::NoError:
-        msg = i18np("Moved 1 old message from folder %2 to folder %3.",
-                    "Moved %1 old messages from folder %2 to folder %3.",
-                    mRemovedMsgs.count(),
-                    mSrcFolderName,
-                    mMoveToFolder.name());
-        break;
-
-    case Akonadi::Job::UserCanceled:
-        msg = i18n(
-            "Moving old messages from folder %1 to folder %2 was "
-            "canceled.",
-            mSrcFolderName,
-            mMoveToFolder.name());
-        break;
-
-    default: // any other error
-        msg = i18n("Moving old messages from folder %1 to folder %2 failed.", mSrcFolderName, mMoveToFolder.name());
-        break;
-    }
-
-    mRunningJobs.removeOne(job);
-    if (mRunningJobs.isEmpty()) {
-        finished();
-    }
-    BroadcastStatus::instance()->setStatusMsg(msg);
+    return processedCount();
 }
 
 #include "moc_expiremovejob.cpp"
@@ -6,36 +6,40 @@
 
 #pragma once
 
-#include <Akonadi/Item>
-#include <QObject>
+#include "expirebatchjob.h"
+#include "mailcommon_private_export.h"
+#include <Akonadi/Collection>
 
-class ExpireMoveJob : public QObject
+/**
+ * Moves the expired messages to the expiry folder and marks them as read, in
+ * batches. A batch is done once its messages are marked as read.
+ */
+class MAILCOMMON_TESTS_EXPORT ExpireMoveJob : public ExpireBatchJob
 {
     Q_OBJECT
 public:
     explicit ExpireMoveJob(QObject *parent = nullptr);
     ~ExpireMoveJob() override;
 
-    [[nodiscard]] Akonadi::Item::List removedMsgs() const;
-    void setRemovedMsgs(const Akonadi::Item::List &newRemovedMsgs);
-
-    void start();
-
     [[nodiscard]] Akonadi::Collection moveToFolder() const;
     void setMoveToFolder(const Akonadi::Collection &newMoveToFolder);
 
     [[nodiscard]] QString srcFolderName() const;
     void setSrcFolderName(const QString &newSrcFolderName);
 
+    /// Returns the number of messages moved so far.
+    [[nodiscard]] int movedCount() const;
+
 Q_SIGNALS:
     void expireMovedDone();
 
+protected:
+    Akonadi::Job *createBatchJob(const Akonadi::Item::List &items) override;
+    void batchJobDone(KJob *job, const Batch &batch) override;
+    [[nodiscard]] QString statusMessage() const override;
+    void emitDone() override;
+
 private:
-    void slotMoveDone(KJob *job);
-    void slotExpireDone(KJob *job);
-    void finished();
     QString mSrcFolderName;
     Akonadi::Collection mMoveToFolder;
-    Akonadi::Item::List mRemovedMsgs;
-    QList<KJob *> mRunningJobs;
 };
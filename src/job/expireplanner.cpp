@@ -0,0 +1,339 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "expireplanner.h"
+#include "expiredeletejob.h"
+#include "expirejob.h"
+#include "expiremovejob.h"
+#include "jobscheduler.h"
+#include "kernel/mailkernel.h"
+#include "mailcommon_debug.h"
+
+#include <Akonadi/CollectionFetchJob>
+#include <Akonadi/ItemFetchJob>
+#include <Akonadi/ItemFetchScope>
+#include <Akonadi/MessageParts>
+
+#include <KLocalizedString>
+#include <KMime/Message>
+
+#include <QHash>
+#include <QPointer>
+#include <QStringList>
+
+using namespace MailCommon;
+
+class Q_DECL_HIDDEN ExpirePlanner::ExpirePlannerPrivate
+{
+public:
+    struct Move {
+        Akonadi::Item::List items;
+        QStringList sourceNames;
+    };
+
+    explicit ExpirePlannerPrivate(ExpirePlanner *qq)
+        : q(qq)
+    {
+    }
+
+    void fetchCollections();
+    void checkNextCollection();
+    void itemsReceived(const Akonadi::Item::List &items);
+    void collectionChecked(KJob *job);
+    [[nodiscard]] bool hasExpireTask(const Akonadi::Collection &collection) const;
+    void expire();
+    void jobDone();
+    void finish();
+
+    Akonadi::Collection::List mCollections;
+    QList<FolderPlan> mPlans;
+    // Expired messages, per folder
+    QHash<Akonadi::Collection::Id, Akonadi::Item::List> mExpiredItems;
+    Akonadi::Item::List mCurrentItems;
+    // The folder or item fetch job running, and the jobs expiring the messages
+    QPointer<KJob> mFetchJob;
+    QList<QPointer<ExpireDeleteJob>> mDeleteJobs;
+    QList<QPointer<ExpireMoveJob>> mMoveJobs;
+    QPointer<JobScheduler> mScheduler;
+    qint64 mMaxUnreadTime = 0;
+    qint64 mMaxReadTime = 0;
+    int mRunningJobs = 0;
+    bool mExpireMessagesWithoutDate = false;
+    bool mCollectionsSet = false;
+    bool mDryRun = false;
+    bool mSchedulerSet = false;
+    bool mFinished = false;
+    ExpirePlanner *const q;
+};
+
+void ExpirePlanner::ExpirePlannerPrivate::fetchCollections()
+{
+    auto job = new Akonadi::CollectionFetchJob(Akonadi::Collection::root(), Akonadi::CollectionFetchJob::Recursive, q);
+    mFetchJob = job;
+    QObject::connect(job, &Akonadi::CollectionFetchJob::result, q, [this](KJob *job) {
+        if (job->error()) {
+            qCWarning(MAILCOMMON_LOG) << "ExpirePlanner: cannot list the folders" << job->errorString();
+        } else {
+            const Akonadi::Collection::List collections = static_cast<Akonadi::CollectionFetchJob *>(job)->collections();
+            for (const Akonadi::Collection &collection : collections) {
+                const auto attribute = collection.attribute<ExpireCollectionAttribute>();
+                if (attribute && attribute->isAutoExpire()) {
+                    mCollections.append(collection);
+                }
+            }
+        }
+        checkNextCollection();
+    });
+}
+
+void ExpirePlanner::ExpirePlannerPrivate::checkNextCollection()
+{
+    while (!mCollections.isEmpty()) {
+        const Akonadi::Collection collection = mCollections.takeFirst();
+        const auto attribute = collection.attribute<ExpireCollectionAttribute>();
+        if (!attribute) {
+            continue;
+        }
+        ExpireJob::expiryTimes(attribute, mMaxUnreadTime, mMaxReadTime);
+        if (mMaxUnreadTime == 0 && mMaxReadTime == 0) {
+            continue;
+        }
+        if (hasExpireTask(collection)) {
+            qCDebug(MAILCOMMON_LOG) << "ExpirePlanner: folder" << collection.name() << "is already being expired, skipping it";
+            continue;
+        }
+
+        FolderPlan plan;
+        plan.collection = collection;
+        plan.action = attribute->expireAction();
+        if (plan.action == ExpireCollectionAttribute::ExpireMove) {
+            plan.targetId = attribute->expireToFolderId();
+            if (!Kernel::self()->collectionFromId(plan.targetId).isValid()) {
+                qCWarning(MAILCOMMON_LOG) << "ExpirePlanner: cannot expire messages from folder" << collection.name() << ": destination folder"
+                                          << plan.targetId << "not found";
+                continue;
+            }
+        }
+        mExpireMessagesWithoutDate = attribute->expireMessagesWithValidDate();
+        mPlans.append(plan);
+        mCurrentItems.clear();
+
+        // Check the messages as they arrive instead of keeping all the envelopes
+        auto job = new Akonadi::ItemFetchJob(collection, q);
+        mFetchJob = job;
+        job->setDeliveryOption(Akonadi::ItemFetchJob::EmitItemsInBatches);
+        job->fetchScope().fetchPayloadPart(Akonadi::MessagePart::Envelope);
+        QObject::connect(job, &Akonadi::ItemFetchJob::itemsReceived, q, [this](const Akonadi::Item::List &items) {
+            itemsReceived(items);
+        });
+        QObject::connect(job, &Akonadi::ItemFetchJob::result, q, [this](KJob *job) {
+            collectionChecked(job);
+        });
+        return;
+    }
+
+    // All folders are checked
+    qCDebug(MAILCOMMON_LOG) << "ExpirePlanner:" << q->messageCount() << "messages," << q->size() << "bytes to expire in" << mPlans.count() << "folders";
+    if (mDryRun) {
+        finish();
+        return;
+    }
+    expire();
+}
+
+void ExpirePlanner::ExpirePlannerPrivate::itemsReceived(const Akonadi::Item::List &items)
+{
+    FolderPlan &plan = mPlans.last();
+    plan.scannedCount += items.count();
+    for (const Akonadi::Item &item : items) {
+        if (ExpireJob::isExpired(item, mMaxUnreadTime, mMaxReadTime, mExpireMessagesWithoutDate)) {
+            ++plan.messageCount;
+            plan.size += item.size();
+            if (!mDryRun) {
+                // The id is all the delete and move jobs need
+                mCurrentItems.append(Akonadi::Item(item.id()));
+            }
+        }
+    }
+}
+
+void ExpirePlanner::ExpirePlannerPrivate::collectionChecked(KJob *job)
+{
+    FolderPlan &plan = mPlans.last();
+    if (job->error()) {
+        qCWarning(MAILCOMMON_LOG) << "ExpirePlanner: cannot check folder" << plan.collection.name() << job->errorString();
+        plan.messageCount = 0;
+        plan.size = 0;
+    } else if (!mCurrentItems.isEmpty()) {
+        mExpiredItems.insert(plan.collection.id(), mCurrentItems);
+    }
+    mCurrentItems.clear();
+    checkNextCollection();
+}
+
+bool ExpirePlanner::ExpirePlannerPrivate::hasExpireTask(const Akonadi::Collection &collection) const
+{
+    // ExpireJob handles a folder page by page, and would race our jobs
+    return mScheduler && mScheduler->hasTask(ScheduledExpireTask::TypeId, collection);
+}
+
+void ExpirePlanner::ExpirePlannerPrivate::expire()
+{
+    // One pipeline per destination, whatever the number of source folders
+    QHash<Akonadi::Collection::Id, Move> moves;
+    for (const FolderPlan &plan : std::as_const(mPlans)) {
+        const auto it = mExpiredItems.constFind(plan.collection.id());
+        if (it == mExpiredItems.cend()) {
+            continue;
+        }
+        // An expire task may have been registered while the folders were checked
+        if (hasExpireTask(plan.collection)) {
+            qCDebug(MAILCOMMON_LOG) << "ExpirePlanner: folder" << plan.collection.name() << "is already being expired, skipping it";
+            continue;
+        }
+        if (plan.action == ExpireCollectionAttribute::ExpireMove) {
+            Move &move = moves[plan.targetId];
+            move.items += it.value();
+            move.sourceNames.append(plan.collection.name());
+            continue;
+        }
+        auto job = new ExpireDeleteJob(q);
+        job->setRemovedMsgs(it.value());
+        job->setSourceFolderName(plan.collection.name());
+        QObject::connect(job, &ExpireDeleteJob::expireDeleteDone, q, [this]() {
+            jobDone();
+        });
+        mDeleteJobs.append(job);
+        ++mRunningJobs;
+        job->start();
+    }
+    mExpiredItems.clear();
+
+    for (auto it = moves.cbegin(); it != moves.cend(); ++it) {
+        auto job = new ExpireMoveJob(q);
+        job->setRemovedMsgs(it.value().items);
+        job->setSrcFolderName(it.value().sourceNames.join(QLatin1StringView(", ")));
+        job->setMoveToFolder(Kernel::self()->collectionFromId(it.key()));
+        QObject::connect(job, &ExpireMoveJob::expireMovedDone, q, [this]() {
+            jobDone();
+        });
+        mMoveJobs.append(job);
+        ++mRunningJobs;
+        job->start();
+    }
+
+    if (mRunningJobs == 0) {
+        finish();
+    }
+}
+
+void ExpirePlanner::ExpirePlannerPrivate::jobDone()
+{
+    if (--mRunningJobs == 0) {
+        finish();
+    }
+}
+
+void ExpirePlanner::ExpirePlannerPrivate::finish()
+{
+    if (mFinished) {
+        return;
+    }
+    mFinished = true;
+    Q_EMIT q->finished();
+    q->deleteLater();
+}
+
+ExpirePlanner::ExpirePlanner(QObject *parent)
+    : QObject(parent)
+    , d(new ExpirePlannerPrivate(this))
+{
+}
+
+ExpirePlanner::~ExpirePlanner() = default;
+
+void ExpirePlanner::setCollections(const Akonadi::Collection::List &collections)
+{
+    d->mCollections = collections;
+    d->mCollectionsSet = true;
+}
+
+void ExpirePlanner::setDryRun(bool dryRun)
+{
+    d->mDryRun = dryRun;
+}
+
+bool ExpirePlanner::isDryRun() const
+{
+    return d->mDryRun;
+}
+
+void ExpirePlanner::setJobScheduler(JobScheduler *scheduler)
+{
+    d->mScheduler = scheduler;
+    d->mSchedulerSet = true;
+}
+
+void ExpirePlanner::start()
+{
+    if (!d->mSchedulerSet) {
+        d->mScheduler = KernelIf->jobScheduler();
+    }
+    if (d->mCollectionsSet) {
+        d->checkNextCollection();
+    } else {
+        d->fetchCollections();
+    }
+}
+
+void ExpirePlanner::cancel()
+{
+    if (d->mFinished) {
+        return;
+    }
+    d->mCollections.clear();
+    if (d->mFetchJob) {
+        d->mFetchJob->kill();
+    }
+    for (const QPointer<ExpireDeleteJob> &job : std::as_const(d->mDeleteJobs)) {
+        if (job) {
+            disconnect(job, nullptr, this, nullptr);
+            job->cancel();
+        }
+    }
+    for (const QPointer<ExpireMoveJob> &job : std::as_const(d->mMoveJobs)) {
+        if (job) {
+            disconnect(job, nullptr, this, nullptr);
+            job->cancel();
+        }
+    }
+    d->finish();
+}
+
+QList<ExpirePlanner::FolderPlan> ExpirePlanner::plans() const
+{
+    return d->mPlans;
+}
+
+int ExpirePlanner::messageCount() const
+{
+    int count = 0;
+    for (const FolderPlan &plan : std::as_const(d->mPlans)) {
+        count += plan.messageCount;
+    }
+    return count;
+}
+
+qint64 ExpirePlanner::size() const
+{
+    qint64 size = 0;
+    for (const FolderPlan &plan : std::as_const(d->mPlans)) {
+        size += plan.size;
+    }
+    return size;
+}
+
+#include "moc_expireplanner.cpp"
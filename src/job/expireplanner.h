@@ -0,0 +1,131 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_export.h"
+
+#include "mailcommon/expirecollectionattribute.h"
+
+#include <Akonadi/Collection>
+#include <QList>
+#include <QObject>
+
+#include <memory>
+
+namespace MailCommon
+{
+class JobScheduler;
+
+/*!
+ * \class MailCommon::ExpirePlanner
+ * \inmodule MailCommon
+ * \inheaderfile MailCommon/ExpirePlanner
+ *
+ * \brief Expires the old messages of many folders at once.
+ *
+ * The planner checks the messages of every folder with expiry settings in a
+ * single sweep, then removes the expired messages of each folder and moves
+ * the others grouped by destination folder, so folders expiring to the same
+ * archive share the same move jobs. In dry-run mode it only reports how many
+ * messages, and how many bytes, each folder would expire.
+ *
+ * The planner does not run through the JobScheduler. So that it doesn't
+ * expire a folder at the same time as an ExpireJob, the folders with an
+ * expire task waiting or running in the scheduler are skipped, both when
+ * they are checked and when their messages are expired.
+ *
+ * The planner deletes itself after it finished.
+ */
+class MAILCOMMON_EXPORT ExpirePlanner : public QObject
+{
+    Q_OBJECT
+public:
+    /*!
+     * \brief What expiring a folder amounts to.
+     */
+    struct FolderPlan {
+        /*! The expired folder. */
+        Akonadi::Collection collection;
+        /*! Whether the messages are deleted or moved. */
+        ExpireCollectionAttribute::ExpireAction action = ExpireCollectionAttribute::ExpireDelete;
+        /*! The destination folder of moved messages. */
+        Akonadi::Collection::Id targetId = -1;
+        /*! The number of messages checked. */
+        int scannedCount = 0;
+        /*! The number of messages to expire. */
+        int messageCount = 0;
+        /*! The size in bytes of the messages to expire. */
+        qint64 size = 0;
+    };
+
+    /*!
+     * Creates a planner.
+     */
+    explicit ExpirePlanner(QObject *parent = nullptr);
+    /*!
+     * Destroys the planner.
+     */
+    ~ExpirePlanner() override;
+
+    /*!
+     * Sets the folders to expire to \a collections. By default, all the folders
+     * with automatic expiry enabled are expired.
+     */
+    void setCollections(const Akonadi::Collection::List &collections);
+
+    /*!
+     * Sets whether the planner only computes what would be expired (\a dryRun)
+     * instead of expiring it.
+     */
+    void setDryRun(bool dryRun);
+    /*!
+     * Returns whether the planner only computes what would be expired.
+     */
+    [[nodiscard]] bool isDryRun() const;
+
+    /*!
+     * Sets the scheduler whose expire tasks are taken into account to
+     * \a scheduler. By default, the scheduler of the kernel is used.
+     */
+    void setJobScheduler(JobScheduler *scheduler);
+
+    /*!
+     * Starts checking the folders, and expiring them unless in dry-run mode.
+     */
+    void start();
+
+    /*!
+     * Stops checking and expiring the folders. The messages already sent to
+     * the server may still be expired. finished() is emitted.
+     */
+    void cancel();
+
+    /*!
+     * Returns the plan of each folder checked so far.
+     */
+    [[nodiscard]] QList<FolderPlan> plans() const;
+    /*!
+     * Returns the number of messages to expire in all folders.
+     */
+    [[nodiscard]] int messageCount() const;
+    /*!
+     * Returns the size in bytes of the messages to expire in all folders.
+     */
+    [[nodiscard]] qint64 size() const;
+
+Q_SIGNALS:
+    /*!
+     * Emitted when the folders are checked, in dry-run mode, or expired, or
+     * when the planner is canceled.
+     */
+    void finished();
+
+private:
+    class ExpirePlannerPrivate;
+    std::unique_ptr<ExpirePlannerPrivate> const d;
+};
+}
@@ -5,6 +5,13 @@
  */
 
 #include "jobscheduler.h"
+#ifdef DEBUG_SCHEDULER
+#include "mailcommon_debug.h"
+#endif
+
+#include <algorithm>
+#include <utility>
+
 using namespace MailCommon;
 
 ScheduledTask::ScheduledTask(const Akonadi::Collection &folder, bool immediate)
@@ -25,194 +32,280 @@ bool ScheduledTask::isImmediate() const
 
 ScheduledTask::~ScheduledTask() = default;
 
+int ScheduledTask::priority() const
+{
+    return 0;
+}
+
 JobScheduler::JobScheduler(QObject *parent)
     : QObject(parent)
     , mTimer(this)
 {
-    connect(&mTimer, &QTimer::timeout, this, &JobScheduler::slotRunNextJob);
+    mTimer.setSingleShot(true);
+    connect(&mTimer, &QTimer::timeout, this, &JobScheduler::runPendingTasks);
     // No need to start the internal timer yet, we wait for a task to be scheduled
 }
 
 JobScheduler::~JobScheduler()
 {
-    qDeleteAll(mTaskList);
-    mTaskList.clear();
-    delete mCurrentTask;
-    mCurrentTask = nullptr;
-    delete mCurrentJob;
+    for (const auto &[key, task] : mTaskQueue) {
+        delete task;
+    }
+    mTaskQueue.clear();
+    mTaskIndex.clear();
+    const auto runningJobs = std::exchange(mRunningJobs, {});
+    for (auto it = runningJobs.cbegin(); it != runningJobs.cend(); ++it) {
+        disconnect(it.key(), nullptr, this, nullptr);
+        delete it.key();
+        delete it.value().task;
+    }
 }
 
 void JobScheduler::registerTask(ScheduledTask *task)
 {
-    bool immediate = task->isImmediate();
-    int typeId = task->taskTypeId();
+    const bool immediate = task->isImmediate();
+    const int typeId = task->taskTypeId();
     if (typeId) {
-        const Akonadi::Collection folder = task->folder();
         // Search for an identical task already scheduled
-        TaskList::Iterator end(mTaskList.end());
-        for (TaskList::Iterator it = mTaskList.begin(); it != end; ++it) {
-            if ((*it)->taskTypeId() == typeId && (*it)->folder() == folder) {
+        const auto existing = mTaskIndex.constFind({typeId, task->folder().id()});
+        if (existing != mTaskIndex.cend()) {
 #ifdef DEBUG_SCHEDULER
-                qCDebug(MAILCOMMON_LOG) << "JobScheduler: already having task type" << typeId << "for folder" << folder->label();
+            qCDebug(MAILCOMMON_LOG) << "JobScheduler: already having task type" << typeId << "for folder" << task->folder().name();
 #endif
-                delete task;
-                if (!mCurrentTask && immediate) {
-                    ScheduledTask *task = *it;
-                    removeTask(it);
-                    runTaskNow(task);
+            delete task;
+            if (immediate && existing->deferred) {
+                // Run the waiting task as if it had been registered as immediate
+                const TaskKey key = *existing;
+                ScheduledTask *waitingTask = mTaskQueue.at(key);
+                mTaskQueue.erase(key);
+                mTaskIndex.remove({typeId, waitingTask->folder().id()});
+                enqueueTask(waitingTask, true);
+                if (!mPaused) {
+                    runPendingTasks();
                 }
-                return;
             }
+            return;
         }
-        // Note that scheduling an identical task as the one currently running is allowed.
+        // Note that scheduling an identical task as one currently running is allowed.
     }
-    if (!mCurrentTask && immediate) {
-        runTaskNow(task);
-    } else {
 #ifdef DEBUG_SCHEDULER
-        qCDebug(MAILCOMMON_LOG) << "JobScheduler: adding task" << task << "(type" << task->taskTypeId() << ") for folder" << task->folder()
-                                << task->folder().name();
+    qCDebug(MAILCOMMON_LOG) << "JobScheduler: adding task" << task << "(type" << task->taskTypeId() << ") for folder" << task->folder()
+                            << task->folder().name();
 #endif
-        mTaskList.append(task);
-        if (immediate) {
-            ++mPendingImmediateTasks;
-        }
-        if (!mCurrentTask && !mTimer.isActive()) {
-            restartTimer();
+    enqueueTask(task, immediate);
+    if (mPaused) {
+        return;
+    }
+    if (immediate) {
+        runPendingTasks();
+    } else if (!mTimer.isActive() && hasCapacity()) {
+        // Give the application some time before starting background work
+#ifdef DEBUG_SCHEDULER
+        wakeUp(10000); // 10 seconds
+#else
+        wakeUp(1 * 60000); // 1 minute
+#endif
+    }
+}
+
+void JobScheduler::enqueueTask(ScheduledTask *task, bool immediate)
+{
+    const TaskKey key{!immediate, task->priority(), mNextSequence++};
+    mTaskQueue.emplace(key, task);
+    if (task->taskTypeId()) {
+        mTaskIndex.insert({task->taskTypeId(), task->folder().id()}, key);
+    }
+}
+
+JobScheduler::TaskQueue::iterator JobScheduler::removeTask(TaskQueue::iterator it)
+{
+    ScheduledTask *task = it->second;
+    if (task->taskTypeId()) {
+        const auto index = mTaskIndex.constFind({task->taskTypeId(), task->folder().id()});
+        // Only forget the index entry if it refers to this very task
+        if (index != mTaskIndex.cend() && index->sequence == it->first.sequence) {
+            mTaskIndex.erase(index);
         }
     }
+    return mTaskQueue.erase(it);
 }
 
-void JobScheduler::removeTask(TaskList::Iterator &it)
+bool JobScheduler::hasCapacity() const
 {
-    if ((*it)->isImmediate()) {
-        --mPendingImmediateTasks;
+    return mRunningJobs.count() < mMaximumConcurrentJobs;
+}
+
+void JobScheduler::wakeUp(int delay)
+{
+    if (mPaused || mTaskQueue.empty()) {
+        return;
+    }
+    if (!mTimer.isActive() || mTimer.remainingTime() > delay) {
+        mTimer.start(delay);
     }
-    mTaskList.erase(it);
 }
 
-void JobScheduler::interruptCurrentTask()
+void JobScheduler::interruptJob(ScheduledJob *job)
 {
-    Q_ASSERT(mCurrentTask);
+    const RunningJob running = mRunningJobs.take(job);
+    Q_ASSERT(running.task);
 #ifdef DEBUG_SCHEDULER
-    qCDebug(MAILCOMMON_LOG) << "JobScheduler: interrupting job" << mCurrentJob << "for folder" << mCurrentTask->folder()->label();
+    qCDebug(MAILCOMMON_LOG) << "JobScheduler: interrupting job" << job << "for folder" << running.task->folder().name();
 #endif
-    // File it again. This will either delete it or put it in mTaskList.
-    registerTask(mCurrentTask);
-    mCurrentTask = nullptr;
-    mCurrentJob->kill(); // This deletes the job and calls slotJobFinished!
+    if (--mRunningJobsPerResource[running.resource] <= 0) {
+        mRunningJobsPerResource.remove(running.resource);
+    }
+    job->kill(); // This deletes the job; it is no longer known to slotJobFinished
+    // File the task again. This will either delete it or put it in the queue.
+    registerTask(running.task);
 }
 
-void JobScheduler::slotRunNextJob()
+void JobScheduler::runPendingTasks()
 {
-    while (!mCurrentJob) {
+    if (mPaused) {
+        return;
+    }
+    auto it = mTaskQueue.begin();
+    while (it != mTaskQueue.end() && hasCapacity()) {
+        ScheduledTask *task = it->second;
+        // Remove if folder died
+        const Akonadi::Collection folder = task->folder();
+        if (!folder.isValid()) {
 #ifdef DEBUG_SCHEDULER
-        qCDebug(MAILCOMMON_LOG) << "JobScheduler: slotRunNextJob";
+            qCDebug(MAILCOMMON_LOG) << "  folder for task" << task << "was deleted";
 #endif
-        Q_ASSERT(mCurrentTask == nullptr);
-        ScheduledTask *task = nullptr;
-        // Find a task suitable for being run
-        TaskList::Iterator end(mTaskList.end());
-        for (TaskList::Iterator it = mTaskList.begin(); it != end; ++it) {
-            // Remove if folder died
-            const Akonadi::Collection folder = (*it)->folder();
-            if (!folder.isValid()) {
+            it = removeTask(it);
+            delete task;
+            continue;
+        }
+        if (mRunningJobsPerResource.value(folder.resource()) >= mMaximumJobsPerResource) {
+            // Keep it for when a job of this resource finishes
+            ++it;
+            continue;
+        }
 #ifdef DEBUG_SCHEDULER
-                qCDebug(MAILCOMMON_LOG) << "  folder for task" << (*it) << "was deleted";
+        qCDebug(MAILCOMMON_LOG) << "  running task for folder" << folder.name();
 #endif
-                removeTask(it);
-                if (!mTaskList.isEmpty()) {
-                    slotRunNextJob(); // to avoid the mess with invalid iterators :)
-                } else {
-                    mTimer.stop();
-                }
-                return;
-            }
+        removeTask(it);
+        runTaskNow(task);
+        // Starting a job may have changed the queue
+        it = mTaskQueue.begin();
+    }
+}
+
+bool JobScheduler::runTaskNow(ScheduledTask *task)
+{
+    ScheduledJob *job = task->run();
 #ifdef DEBUG_SCHEDULER
-            qCDebug(MAILCOMMON_LOG) << "  looking at folder" << folder.name();
+    qCDebug(MAILCOMMON_LOG) << "JobScheduler: task" << task << "(type" << task->taskTypeId() << ")"
+                            << "for folder" << task->folder().name() << "returned job" << job << (job ? job->metaObject()->className() : nullptr);
 #endif
-            task = *it;
-            removeTask(it);
-            break;
-        }
+    if (!job) { // nothing to do, e.g. folder deleted
+        delete task;
+        return false;
+    }
+    const QString resource = task->folder().resource();
+    mRunningJobs.insert(job, {task, resource});
+    ++mRunningJobsPerResource[resource];
+    connect(job, &ScheduledJob::finished, this, [this, job]() {
+        slotJobFinished(job);
+    });
+    job->start();
+    return true;
+}
 
-        if (!task) { // found nothing to run, i.e. folder was opened
-            return; // Timer keeps running, i.e. try again in 1 minute
-        }
+int JobScheduler::pendingTaskCount() const
+{
+    return static_cast<int>(mTaskQueue.size());
+}
 
-        runTaskNow(task);
-    } // If nothing to do for that task, loop and find another one to run
+int JobScheduler::runningJobCount() const
+{
+    return mRunningJobs.count();
 }
 
-void JobScheduler::restartTimer()
+bool JobScheduler::hasTask(int taskTypeId, const Akonadi::Collection &folder) const
 {
-    if (mPendingImmediateTasks > 0) {
-        slotRunNextJob();
-    } else {
-#ifdef DEBUG_SCHEDULER
-        mTimer.start(10000); // 10 seconds
-#else
-        mTimer.start(1 * 60000); // 1 minute
-#endif
+    if (mTaskIndex.contains({taskTypeId, folder.id()})) {
+        return true;
     }
+    return std::any_of(mRunningJobs.cbegin(), mRunningJobs.cend(), [&](const RunningJob &running) {
+        return running.task->taskTypeId() == taskTypeId && running.task->folder().id() == folder.id();
+    });
 }
 
-void JobScheduler::runTaskNow(ScheduledTask *task)
+void JobScheduler::setMaximumConcurrentJobs(int count)
 {
-    Q_ASSERT(mCurrentTask == nullptr);
-    if (mCurrentTask) {
-        interruptCurrentTask();
+    mMaximumConcurrentJobs = std::max(1, count);
+    if (hasCapacity()) {
+        wakeUp(0);
     }
-    mCurrentTask = task;
-    mTimer.stop();
-    mCurrentJob = mCurrentTask->run();
-#ifdef DEBUG_SCHEDULER
-    qCDebug(MAILCOMMON_LOG) << "JobScheduler: task" << mCurrentTask << "(type" << mCurrentTask->taskTypeId() << ")"
-                            << "for folder" << mCurrentTask->folder()->label() << "returned job" << mCurrentJob << (mCurrentJob ? mCurrentJob->className() : 0);
-#endif
-    if (!mCurrentJob) { // nothing to do, e.g. folder deleted
-        delete mCurrentTask;
-        mCurrentTask = nullptr;
-        if (!mTaskList.isEmpty()) {
-            restartTimer();
-        }
-        return;
+}
+
+int JobScheduler::maximumConcurrentJobs() const
+{
+    return mMaximumConcurrentJobs;
+}
+
+void JobScheduler::setMaximumJobsPerResource(int count)
+{
+    mMaximumJobsPerResource = std::max(1, count);
+    if (hasCapacity()) {
+        wakeUp(0);
     }
-    // Register the job in the folder. This makes it autodeleted if the folder is deleted.
-#if 0
-    mCurrentTask->folder()->storage()->addJob(mCurrentJob);
-#endif
-    connect(mCurrentJob, &ScheduledJob::finished, this, &JobScheduler::slotJobFinished);
-    mCurrentJob->start();
 }
 
-void JobScheduler::slotJobFinished()
+int JobScheduler::maximumJobsPerResource() const
+{
+    return mMaximumJobsPerResource;
+}
+
+void JobScheduler::slotJobFinished(ScheduledJob *job)
 {
-    // Do we need to test for mCurrentJob->error()? What do we do then?
+    // Do we need to test for job->error()? What do we do then?
 #ifdef DEBUG_SCHEDULER
     qCDebug(MAILCOMMON_LOG) << "JobScheduler: slotJobFinished";
 #endif
-    delete mCurrentTask;
-    mCurrentTask = nullptr;
-    mCurrentJob = nullptr;
-    if (!mTaskList.isEmpty()) {
-        restartTimer();
+    const auto it = mRunningJobs.constFind(job);
+    if (it == mRunningJobs.cend()) {
+        // interrupted, see interruptJob()
+        return;
+    }
+    const RunningJob running = it.value();
+    mRunningJobs.erase(it);
+    if (--mRunningJobsPerResource[running.resource] <= 0) {
+        mRunningJobsPerResource.remove(running.resource);
     }
+    delete running.task;
+    // The job is still being destroyed, start the next one from the event loop
+    wakeUp(0);
 }
 
 // D-Bus call to pause any background jobs
 void JobScheduler::pause()
 {
-    mPendingImmediateTasks = 0;
-    if (mCurrentJob && mCurrentJob->isCancellable()) {
-        interruptCurrentTask();
-    }
+    mPaused = true;
     mTimer.stop();
+    const QList<ScheduledJob *> jobs = mRunningJobs.keys();
+    for (ScheduledJob *job : jobs) {
+        if (job->isCancellable()) {
+            interruptJob(job);
+        }
+    }
 }
 
 void JobScheduler::resume()
 {
-    restartTimer();
+    mPaused = false;
+    if (!mTaskQueue.empty() && !mTaskQueue.begin()->first.deferred) {
+        runPendingTasks();
+    } else {
+#ifdef DEBUG_SCHEDULER
+        wakeUp(10000); // 10 seconds
+#else
+        wakeUp(1 * 60000); // 1 minute
+#endif
+    }
 }
 
 ////
@@ -10,11 +10,14 @@
 
 #include <QObject>
 
-#include <QList>
+#include <QHash>
 #include <QTimer>
 
 #include "folderjob.h"
 #include <Akonadi/Collection>
+
+#include <map>
+#include <utility>
 // If this define is set, JobScheduler will show debug output, and related kmkernel
 // timers will be shortened.
 // This is for debugging purposes only, don't commit with it.
@@ -88,6 +91,16 @@ public:
      */
     [[nodiscard]] bool isImmediate() const;
 
+    /*!
+     * The priority of this task among the tasks waiting to be run. Immediate
+     * tasks always run first, then tasks with a higher priority; tasks of
+     * equal priority run in the order they were registered.
+     * The default implementation returns 0.
+     *
+     * \return The priority of this task
+     */
+    [[nodiscard]] virtual int priority() const;
+
 private:
     const Akonadi::Collection mCurrentFolder;
     const bool mImmediate;
@@ -100,10 +113,12 @@ private:
  *
  * The unique JobScheduler instance (owned by kmkernel) implements "background processing"
  * of folder operations (like expiration and compaction). Tasks (things to be done)
- * are registered with the JobScheduler, and it will execute them one at a time,
- * separated by a 1-minute timer. The jobs themselves should use timers to avoid
- * using too much CPU for too long. Tasks for opened folders are not executed until
- * the folder is closed.
+ * are registered with the JobScheduler, which starts running them one minute later
+ * (immediate tasks right away) and then runs the next one as soon as a job finishes.
+ * By default one job runs at a time; setMaximumConcurrentJobs() allows jobs on
+ * folders of different resources to run in parallel, within the limit set by
+ * setMaximumJobsPerResource(). The jobs themselves should use timers to avoid
+ * using too much CPU for too long.
  */
 class MAILCOMMON_EXPORT JobScheduler : public QObject
 {
@@ -138,27 +153,99 @@ public:
      */
     void resume();
 
+    /*!
+     * Sets the maximum number of jobs running at the same time to \a count.
+     * The default is 1, i.e. one job at a time.
+     *
+     * \param count The maximum number of running jobs
+     */
+    void setMaximumConcurrentJobs(int count);
+    /*!
+     * Returns the maximum number of jobs running at the same time.
+     */
+    [[nodiscard]] int maximumConcurrentJobs() const;
+
+    /*!
+     * Sets the maximum number of jobs running at the same time on folders
+     * of a single resource to \a count. The default is 1, so that jobs on
+     * different accounts run in parallel without loading one server more.
+     *
+     * \param count The maximum number of running jobs per resource
+     */
+    void setMaximumJobsPerResource(int count);
+    /*!
+     * Returns the maximum number of jobs running at the same time per resource.
+     */
+    [[nodiscard]] int maximumJobsPerResource() const;
+
+    /*!
+     * Returns the number of tasks waiting to be run.
+     */
+    [[nodiscard]] int pendingTaskCount() const;
+    /*!
+     * Returns the number of jobs currently running.
+     */
+    [[nodiscard]] int runningJobCount() const;
+
+    /*!
+     * Returns whether a task of type \a taskTypeId is waiting or running for
+     * \a folder.
+     *
+     * \param taskTypeId The type of the task, see ScheduledTask::taskTypeId()
+     * \param folder The folder of the task
+     */
+    [[nodiscard]] bool hasTask(int taskTypeId, const Akonadi::Collection &folder) const;
+
 private:
-    // Called by a timer to run the next job
-    MAILCOMMON_NO_EXPORT void slotRunNextJob();
+    // Ordering of the waiting tasks: immediate first, then by priority, then by age
+    struct TaskKey {
+        bool deferred = false;
+        int priority = 0;
+        quint64 sequence = 0;
+        [[nodiscard]] bool operator<(const TaskKey &other) const
+        {
+            if (deferred != other.deferred) {
+                return !deferred;
+            }
+            if (priority != other.priority) {
+                return priority > other.priority;
+            }
+            return sequence < other.sequence;
+        }
+    };
+    using TaskQueue = std::map<TaskKey, ScheduledTask *>;
+    // (task type, folder), to find an identical waiting task
+    using TaskIdentity = std::pair<int, Akonadi::Collection::Id>;
+    struct RunningJob {
+        ScheduledTask *task = nullptr;
+        QString resource;
+    };
+
+    // Runs as many waiting tasks as the limits allow
+    MAILCOMMON_NO_EXPORT void runPendingTasks();
 
-    // Called when the current job terminates
-    MAILCOMMON_NO_EXPORT void slotJobFinished();
-    MAILCOMMON_NO_EXPORT void restartTimer();
-    MAILCOMMON_NO_EXPORT void interruptCurrentTask();
-    MAILCOMMON_NO_EXPORT void runTaskNow(ScheduledTask *task);
-    using TaskList = QList<ScheduledTask *>;
-    MAILCOMMON_NO_EXPORT void removeTask(TaskList::Iterator &it);
+    // Called when a job terminates
+    MAILCOMMON_NO_EXPORT void slotJobFinished(ScheduledJob *job);
+    MAILCOMMON_NO_EXPORT void wakeUp(int delay);
+    MAILCOMMON_NO_EXPORT void interruptJob(ScheduledJob *job);
+    MAILCOMMON_NO_EXPORT void enqueueTask(ScheduledTask *task, bool immediate);
+    MAILCOMMON_NO_EXPORT TaskQueue::iterator removeTask(TaskQueue::iterator it);
+    MAILCOMMON_NO_EXPORT bool runTaskNow(ScheduledTask *task);
+    [[nodiscard]] MAILCOMMON_NO_EXPORT bool hasCapacity() const;
 
 private:
-    TaskList mTaskList; // FIFO of tasks to be run
+    TaskQueue mTaskQueue;
+    QHash<TaskIdentity, TaskKey> mTaskIndex;
+    quint64 mNextSequence = 0;
 
     QTimer mTimer;
-    int mPendingImmediateTasks = 0;
+    bool mPaused = false;
+    int mMaximumConcurrentJobs = 1;
+    int mMaximumJobsPerResource = 1;
 
-    /// Information about the currently running job, if any
-    ScheduledTask *mCurrentTask = nullptr;
-    ScheduledJob *mCurrentJob = nullptr;
+    /// The running jobs, with the task they were created for
+    QHash<ScheduledJob *, RunningJob> mRunningJobs;
+    QHash<QString, int> mRunningJobsPerResource;
 };
 
 /*!
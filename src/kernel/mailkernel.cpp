@@ -53,6 +53,33 @@ Kernel::Kernel(QObject *parent)
     mSettingsIf = nullptr;
     mFilterIf = nullptr;
     mImapResourceManager = new PimCommon::ImapResourceCapabilitiesManager(this);
+
+    // Connected here rather than on first use so that the role index is updated
+    // before any later receiver of these signals queries it.
+    connect(Akonadi::SpecialMailCollections::self(), &Akonadi::SpecialMailCollections::defaultCollectionsChanged, this, [this]() {
+        if (mFolderRolesInitialized) {
+            updateDefaultFolderRoles();
+            if (mergeFolderRoles()) {
+                Q_EMIT specialFolderRolesChanged();
+            }
+        }
+    });
+    connect(Akonadi::SpecialMailCollections::self(),
+            &Akonadi::SpecialMailCollections::collectionsChanged,
+            this,
+            [this](const Akonadi::AgentInstance &agent) {
+                if (mFolderRolesInitialized) {
+                    updateResourceTrashFolder(agent);
+                    if (mergeFolderRoles()) {
+                        Q_EMIT specialFolderRolesChanged();
+                    }
+                }
+            });
+    connect(Akonadi::AgentManager::self(), &Akonadi::AgentManager::instanceRemoved, this, [this](const Akonadi::AgentInstance &agent) {
+        if (mFolderRolesInitialized && mResourceTrashFolders.remove(agent.identifier()) && mergeFolderRoles()) {
+            Q_EMIT specialFolderRolesChanged();
+        }
+    });
 }
 
 Kernel::~Kernel()
@@ -253,78 +280,133 @@ void Kernel::emergencyExit(const QString &reason)
     }
 }
 
-bool Kernel::folderIsDraftOrOutbox(const Akonadi::Collection &col)
+void Kernel::initializeFolderRoles()
 {
-    if (col == Akonadi::SpecialMailCollections::self()->defaultCollection(Akonadi::SpecialMailCollections::Outbox)) {
-        return true;
+    bool changed = false;
+    if (!mFolderRolesInitialized) {
+        mFolderRolesInitialized = true;
+        updateDefaultFolderRoles();
+        const Akonadi::AgentInstance::List lst = MailCommon::Util::agentInstances();
+        for (const Akonadi::AgentInstance &agent : lst) {
+            updateResourceTrashFolder(agent);
+        }
+        changed = true;
     }
 
-    return folderIsDrafts(col);
-}
-
-bool Kernel::folderIsDrafts(const Akonadi::Collection &col)
-{
-    if (col == Akonadi::SpecialMailCollections::self()->defaultCollection(Akonadi::SpecialMailCollections::Drafts)) {
-        return true;
+    // Identities are only known once the kernel interface is registered
+    if (!mIdentityFolderRolesInitialized && kernelIsRegistered()) {
+        mIdentityFolderRolesInitialized = true;
+        connect(KernelIf->identityManager(), qOverload<>(&KIdentityManagementCore::IdentityManager::changed), this, [this]() {
+            updateIdentityFolderRoles();
+            if (mergeFolderRoles()) {
+                Q_EMIT specialFolderRolesChanged();
+            }
+        });
+        updateIdentityFolderRoles();
+        changed = true;
     }
 
-    const QString idString = QString::number(col.id());
-    if (idString.isEmpty()) {
-        return false;
+    if (changed) {
+        mergeFolderRoles();
     }
+}
 
-    // search the identities if the folder matches the drafts-folder
-    const KIdentityManagementCore::IdentityManager *im = KernelIf->identityManager();
-    KIdentityManagementCore::IdentityManager::ConstIterator end(im->end());
-    for (KIdentityManagementCore::IdentityManager::ConstIterator it = im->begin(); it != end; ++it) {
-        if ((*it).drafts() == idString) {
-            return true;
+void Kernel::updateDefaultFolderRoles()
+{
+    static const std::pair<Akonadi::SpecialMailCollections::Type, SpecialFolderRole> defaultFolders[] = {
+        {Akonadi::SpecialMailCollections::Inbox, InboxRole},
+        {Akonadi::SpecialMailCollections::Outbox, OutboxRole},
+        {Akonadi::SpecialMailCollections::SentMail, SentMailRole},
+        {Akonadi::SpecialMailCollections::Trash, TrashRole},
+        {Akonadi::SpecialMailCollections::Drafts, DraftsRole},
+        {Akonadi::SpecialMailCollections::Templates, TemplatesRole},
+        {Akonadi::SpecialMailCollections::Spam, SpamRole},
+    };
+
+    mDefaultFolderRoles.clear();
+    for (const auto &[type, role] : defaultFolders) {
+        const Akonadi::Collection col = Akonadi::SpecialMailCollections::self()->defaultCollection(type);
+        if (col.isValid()) {
+            mDefaultFolderRoles[col.id()] |= role;
         }
     }
-    return false;
 }
 
-bool Kernel::folderIsTemplates(const Akonadi::Collection &col)
+void Kernel::updateResourceTrashFolder(const Akonadi::AgentInstance &agent)
 {
-    if (col == Akonadi::SpecialMailCollections::self()->defaultCollection(Akonadi::SpecialMailCollections::Templates)) {
-        return true;
-    }
-    const QString idString = QString::number(col.id());
-    if (idString.isEmpty()) {
-        return false;
+    const Akonadi::Collection trash = Akonadi::SpecialMailCollections::self()->collection(Akonadi::SpecialMailCollections::Trash, agent);
+    if (trash.isValid()) {
+        mResourceTrashFolders.insert(agent.identifier(), trash.id());
+    } else {
+        mResourceTrashFolders.remove(agent.identifier());
     }
+}
+
+void Kernel::updateIdentityFolderRoles()
+{
+    mIdentityFolderRoles.clear();
+
+    const auto addFolder = [this](const QString &idString, SpecialFolderRole role) {
+        bool ok = false;
+        const Akonadi::Collection::Id id = idString.toLongLong(&ok);
+        if (ok && id >= 0) {
+            mIdentityFolderRoles[id] |= role;
+        }
+    };
 
-    // search the identities if the folder matches the templates-folder
     const KIdentityManagementCore::IdentityManager *im = KernelIf->identityManager();
     KIdentityManagementCore::IdentityManager::ConstIterator end(im->end());
     for (KIdentityManagementCore::IdentityManager::ConstIterator it = im->begin(); it != end; ++it) {
-        if ((*it).templates() == idString) {
-            return true;
+        addFolder((*it).drafts(), DraftsRole);
+        addFolder((*it).templates(), TemplatesRole);
+        addFolder((*it).fcc(), SentMailRole);
+        if (!(*it).disabledSpam()) {
+            addFolder((*it).spam(), SpamRole);
         }
     }
-    return false;
 }
 
-bool Kernel::folderIsSpams(const Akonadi::Collection &col)
+bool Kernel::mergeFolderRoles()
 {
-    if (col == Akonadi::SpecialMailCollections::self()->defaultCollection(Akonadi::SpecialMailCollections::Spam)) {
-        return true;
+    QHash<Akonadi::Collection::Id, SpecialFolderRoles> folderRoles = mIdentityFolderRoles;
+    for (auto it = mDefaultFolderRoles.cbegin(), end = mDefaultFolderRoles.cend(); it != end; ++it) {
+        folderRoles[it.key()] |= it.value();
+    }
+    for (const Akonadi::Collection::Id id : std::as_const(mResourceTrashFolders)) {
+        folderRoles[id] |= TrashRole;
     }
 
-    const QString idString = QString::number(col.id());
-    if (idString.isEmpty()) {
+    if (folderRoles == mFolderRoles) {
         return false;
     }
+    mFolderRoles = std::move(folderRoles);
+    return true;
+}
 
-    // search the identities if the folder matches the drafts-folder
-    const KIdentityManagementCore::IdentityManager *im = KernelIf->identityManager();
-    KIdentityManagementCore::IdentityManager::ConstIterator end(im->end());
-    for (KIdentityManagementCore::IdentityManager::ConstIterator it = im->begin(); it != end; ++it) {
-        if (!(*it).disabledSpam() && (*it).spam() == idString) {
-            return true;
-        }
-    }
-    return false;
+Kernel::SpecialFolderRoles Kernel::specialFolderRoles(const Akonadi::Collection &col)
+{
+    initializeFolderRoles();
+    return mFolderRoles.value(col.id());
+}
+
+bool Kernel::folderIsDraftOrOutbox(const Akonadi::Collection &col)
+{
+    return specialFolderRoles(col).testAnyFlags(OutboxRole | DraftsRole);
+}
+
+bool Kernel::folderIsDrafts(const Akonadi::Collection &col)
+{
+    return specialFolderRoles(col).testFlag(DraftsRole);
+}
+
+bool Kernel::folderIsTemplates(const Akonadi::Collection &col)
+{
+    return specialFolderRoles(col).testFlag(TemplatesRole);
+}
+
+bool Kernel::folderIsSpams(const Akonadi::Collection &col)
+{
+    return specialFolderRoles(col).testFlag(SpamRole);
 }
 
 Akonadi::Collection Kernel::trashCollectionFromResource(const Akonadi::Collection &col)
@@ -339,39 +421,12 @@ Akonadi::Collection Kernel::trashCollectionFromResource(const Akonadi::Collectio
 
 bool Kernel::folderIsTrash(const Akonadi::Collection &col)
 {
-    if (col == Akonadi::SpecialMailCollections::self()->defaultCollection(Akonadi::SpecialMailCollections::Trash)) {
-        return true;
-    }
-
-    const Akonadi::AgentInstance::List lst = MailCommon::Util::agentInstances();
-    for (const Akonadi::AgentInstance &agent : lst) {
-        const Akonadi::Collection trash = Akonadi::SpecialMailCollections::self()->collection(Akonadi::SpecialMailCollections::Trash, agent);
-        if (col == trash) {
-            return true;
-        }
-    }
-    return false;
+    return specialFolderRoles(col).testFlag(TrashRole);
 }
 
 bool Kernel::folderIsSentMailFolder(const Akonadi::Collection &col)
 {
-    if (col == Akonadi::SpecialMailCollections::self()->defaultCollection(Akonadi::SpecialMailCollections::SentMail)) {
-        return true;
-    }
-    const QString idString = QString::number(col.id());
-    if (idString.isEmpty()) {
-        return false;
-    }
-
-    // search the identities if the folder matches the sent-folder
-    const KIdentityManagementCore::IdentityManager *im = KernelIf->identityManager();
-    KIdentityManagementCore::IdentityManager::ConstIterator end(im->end());
-    for (KIdentityManagementCore::IdentityManager::ConstIterator it = im->begin(); it != end; ++it) {
-        if ((*it).fcc() == idString) {
-            return true;
-        }
-    }
-    return false;
+    return specialFolderRoles(col).testFlag(SentMailRole);
 }
 
 bool Kernel::folderIsInbox(const Akonadi::Collection &collection)
@@ -15,6 +15,7 @@
 #include <Akonadi/SpecialMailCollections>
 #include <KSharedConfig>
 
+#include <QHash>
 #include <QObject>
 namespace PimCommon
 {
@@ -46,6 +47,32 @@ class MAILCOMMON_EXPORT Kernel : public QObject
 {
     Q_OBJECT
 public:
+    /*!
+     * \enum MailCommon::Kernel::SpecialFolderRole
+     *
+     * The roles a collection can play as a special mail folder.
+     *
+     * \value NoRole The collection is an ordinary folder
+     * \value InboxRole The default inbox
+     * \value OutboxRole The default outbox
+     * \value SentMailRole The default sent-mail folder or the sent-mail folder of an identity
+     * \value TrashRole The default trash or the trash of a resource
+     * \value DraftsRole The default drafts folder or the drafts folder of an identity
+     * \value TemplatesRole The default templates folder or the templates folder of an identity
+     * \value SpamRole The default spam folder or the spam folder of an identity
+     */
+    enum SpecialFolderRole {
+        NoRole = 0,
+        InboxRole = 1,
+        OutboxRole = 2,
+        SentMailRole = 4,
+        TrashRole = 8,
+        DraftsRole = 16,
+        TemplatesRole = 32,
+        SpamRole = 64,
+    };
+    Q_DECLARE_FLAGS(SpecialFolderRoles, SpecialFolderRole)
+
     /*!
      * Destroys the kernel.
      */
@@ -248,6 +275,15 @@ public:
      */
     [[nodiscard]] bool folderIsSentMailFolder(const Akonadi::Collection &collection);
 
+    /*!
+     * Returns the special folder roles of the given collection.
+     * The roles are looked up in an index which is kept up to date with the
+     * special collections and the identities, so this is a constant time call.
+     * \param collection The collection to check
+     * \return The roles of the collection, NoRole for an ordinary folder
+     */
+    [[nodiscard]] SpecialFolderRoles specialFolderRoles(const Akonadi::Collection &collection);
+
     /*!
      * Checks if the given collection is an inbox folder.
      *
@@ -299,6 +335,11 @@ public:
 
 private:
     void findCreateDefaultCollection(Akonadi::SpecialMailCollections::Type);
+    void initializeFolderRoles();
+    void updateDefaultFolderRoles();
+    void updateResourceTrashFolder(const Akonadi::AgentInstance &agent);
+    void updateIdentityFolderRoles();
+    bool mergeFolderRoles();
 
 private Q_SLOTS:
     void createDefaultCollectionDone(KJob *job);
@@ -313,6 +354,11 @@ Q_SIGNALS:
      * Emitted when a system tray update is requested.
      */
     void requestSystemTrayUpdate();
+    /*!
+     * Emitted when the special folder roles of some collections changed,
+     * after the index used by the folderIs*() methods was updated.
+     */
+    void specialFolderRolesChanged();
 
 private:
     Kernel(QObject *parent = nullptr);
@@ -322,12 +368,21 @@ private:
     IFilter *mFilterIf = nullptr;
     ISettings *mSettingsIf = nullptr;
     PimCommon::ImapResourceCapabilitiesManager *mImapResourceManager = nullptr;
+    // Special folder roles per source, merged into mFolderRoles
+    QHash<Akonadi::Collection::Id, SpecialFolderRoles> mDefaultFolderRoles;
+    QHash<QString, Akonadi::Collection::Id> mResourceTrashFolders;
+    QHash<Akonadi::Collection::Id, SpecialFolderRoles> mIdentityFolderRoles;
+    QHash<Akonadi::Collection::Id, SpecialFolderRoles> mFolderRoles;
+    bool mFolderRolesInitialized = false;
+    bool mIdentityFolderRolesInitialized = false;
 #if MAILCOMMON_HAVE_ACTIVITY_SUPPORT
     PimCommonActivities::ActivitiesBaseManager *mActivitiesBaseManager = nullptr;
 #endif
 };
 }
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(MailCommon::Kernel::SpecialFolderRoles)
+
 #define KernelIf MailCommon::Kernel::self()->kernelIf()
 #define FilterIf MailCommon::Kernel::self()->filterIf()
 #define SettingsIf MailCommon::Kernel::self()->settingsIf()
@@ -0,0 +1,94 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "contactemailindextest.h"
+#include "../searchrule/contactemailindex.h"
+#include <KContacts/Addressee>
+#include <QSignalSpy>
+#include <QTest>
+
+static Akonadi::Item createContact(Akonadi::Item::Id id, const QStringList &emails, const QStringList &categories = {})
+{
+    KContacts::Addressee contact;
+    contact.setEmails(emails);
+    contact.setCategories(categories);
+    Akonadi::Item item(id);
+    item.setMimeType(KContacts::Addressee::mimeType());
+    item.setPayload<KContacts::Addressee>(contact);
+    return item;
+}
+
+ContactEmailIndexTest::ContactEmailIndexTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void ContactEmailIndexTest::shouldHaveDefaultValue()
+{
+    MailCommon::ContactEmailIndex index;
+    QVERIFY(!index.isLoaded());
+    QVERIFY(MailCommon::ContactEmailIndex::negativeCacheSize() > 0);
+
+    QSignalSpy spy(&index, &MailCommon::ContactEmailIndex::loaded);
+    index.setLoaded(true);
+    QVERIFY(index.isLoaded());
+    QCOMPARE(spy.count(), 1);
+    QVERIFY(!index.contains(QStringLiteral("foo@kde.org")));
+}
+
+void ContactEmailIndexTest::shouldFindContactEmails()
+{
+    MailCommon::ContactEmailIndex index;
+    index.setLoaded(true);
+    index.insertContact(createContact(1, {QStringLiteral("Foo@KDE.org"), QStringLiteral("bla@kde.org")}));
+    QVERIFY(index.contains(QStringLiteral("foo@kde.org")));
+    QVERIFY(index.contains(QStringLiteral("bla@kde.org")));
+    QVERIFY(!index.contains(QStringLiteral("unknown@kde.org")));
+}
+
+void ContactEmailIndexTest::shouldFindCategories()
+{
+    MailCommon::ContactEmailIndex index;
+    index.setLoaded(true);
+    index.insertContact(createContact(1, {QStringLiteral("foo@kde.org")}, {QStringLiteral("Work")}));
+    index.insertContact(createContact(2, {QStringLiteral("foo@kde.org")}, {QStringLiteral("Family")}));
+    QVERIFY(index.hasCategory(QStringLiteral("foo@kde.org"), QStringLiteral("Work")));
+    QVERIFY(index.hasCategory(QStringLiteral("foo@kde.org"), QStringLiteral("Family")));
+    QVERIFY(!index.hasCategory(QStringLiteral("foo@kde.org"), QStringLiteral("Friends")));
+    QVERIFY(!index.hasCategory(QStringLiteral("unknown@kde.org"), QStringLiteral("Work")));
+}
+
+void ContactEmailIndexTest::shouldUpdateContact()
+{
+    MailCommon::ContactEmailIndex index;
+    index.setLoaded(true);
+    index.insertContact(createContact(1, {QStringLiteral("foo@kde.org")}, {QStringLiteral("Work")}));
+    index.insertContact(createContact(1, {QStringLiteral("bla@kde.org")}, {QStringLiteral("Family")}));
+    QVERIFY(!index.contains(QStringLiteral("foo@kde.org")));
+    QVERIFY(index.contains(QStringLiteral("bla@kde.org")));
+    QVERIFY(!index.hasCategory(QStringLiteral("bla@kde.org"), QStringLiteral("Work")));
+    QVERIFY(index.hasCategory(QStringLiteral("bla@kde.org"), QStringLiteral("Family")));
+}
+
+void ContactEmailIndexTest::shouldRemoveContact()
+{
+    MailCommon::ContactEmailIndex index;
+    index.setLoaded(true);
+    index.insertContact(createContact(1, {QStringLiteral("foo@kde.org")}));
+    index.insertContact(createContact(2, {QStringLiteral("foo@kde.org")}));
+    index.removeContact(1);
+    QVERIFY(index.contains(QStringLiteral("foo@kde.org")));
+    index.removeContact(2);
+    QVERIFY(!index.contains(QStringLiteral("foo@kde.org")));
+
+    index.insertContact(createContact(3, {QStringLiteral("foo@kde.org")}));
+    index.clear();
+    QVERIFY(!index.contains(QStringLiteral("foo@kde.org")));
+}
+
+QTEST_MAIN(ContactEmailIndexTest)
+
+#include "moc_contactemailindextest.cpp"
@@ -0,0 +1,23 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class ContactEmailIndexTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ContactEmailIndexTest(QObject *parent = nullptr);
+
+private Q_SLOTS:
+    void shouldHaveDefaultValue();
+    void shouldFindContactEmails();
+    void shouldFindCategories();
+    void shouldUpdateContact();
+    void shouldRemoveContact();
+};
@@ -0,0 +1,80 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "itemstatussnapshottest.h"
+#include "../searchrule/itemstatussnapshot.h"
+#include "../searchrule/searchrulestatus.h"
+#include <QTest>
+
+QTEST_MAIN(ItemStatusSnapshotTest)
+
+using namespace MailCommon;
+
+ItemStatusSnapshotTest::ItemStatusSnapshotTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ItemStatusSnapshotTest::~ItemStatusSnapshotTest() = default;
+
+void ItemStatusSnapshotTest::shouldDecodeWithoutSnapshot()
+{
+    Akonadi::Item item(42);
+    item.setFlags({"\\SEEN"});
+    QVERIFY(!ItemStatusSnapshot::hasSnapshot(item));
+    QVERIFY(ItemStatusSnapshot::statusOf(item).isRead());
+
+    item.setFlags({});
+    QVERIFY(!ItemStatusSnapshot::statusOf(item).isRead());
+}
+
+void ItemStatusSnapshotTest::shouldReuseSnapshot()
+{
+    Akonadi::Item item(42);
+    item.setFlags({"\\SEEN"});
+    {
+        ItemStatusSnapshot snapshot(item);
+        QVERIFY(ItemStatusSnapshot::hasSnapshot(item));
+        QVERIFY(ItemStatusSnapshot::statusOf(item).isRead());
+
+        // Decoded once: changing the flags needs an invalidation
+        item.setFlags({});
+        QVERIFY(ItemStatusSnapshot::statusOf(item).isRead());
+        snapshot.invalidate();
+        QVERIFY(!ItemStatusSnapshot::statusOf(item).isRead());
+    }
+    QVERIFY(!ItemStatusSnapshot::hasSnapshot(item));
+}
+
+void ItemStatusSnapshotTest::shouldOnlyApplyToSameItem()
+{
+    Akonadi::Item item(42);
+    item.setFlags({"\\SEEN"});
+    Akonadi::Item other(42);
+    ItemStatusSnapshot snapshot(item);
+    {
+        ItemStatusSnapshot otherSnapshot(other);
+        QVERIFY(ItemStatusSnapshot::statusOf(item).isRead());
+        QVERIFY(!ItemStatusSnapshot::statusOf(other).isRead());
+    }
+    QVERIFY(!ItemStatusSnapshot::hasSnapshot(other));
+    QVERIFY(ItemStatusSnapshot::hasSnapshot(item));
+}
+
+void ItemStatusSnapshotTest::shouldMatchStatusRule()
+{
+    const SearchRuleStatus rule(Akonadi::MessageStatus::statusRead(), SearchRule::FuncContains);
+    Akonadi::Item item(42);
+    item.setFlags({"\\SEEN"});
+    QVERIFY(rule.matches(item));
+    ItemStatusSnapshot snapshot(item);
+    QVERIFY(rule.matches(item));
+    item.setFlags({});
+    snapshot.invalidate();
+    QVERIFY(!rule.matches(item));
+}
+
+#include "moc_itemstatussnapshottest.cpp"
@@ -0,0 +1,22 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class ItemStatusSnapshotTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ItemStatusSnapshotTest(QObject *parent = nullptr);
+    ~ItemStatusSnapshotTest() override;
+private Q_SLOTS:
+    void shouldDecodeWithoutSnapshot();
+    void shouldReuseSnapshot();
+    void shouldOnlyApplyToSameItem();
+    void shouldMatchStatusRule();
+};
@@ -0,0 +1,104 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "messageheaderscannertest.h"
+#include "../searchrule/messageheaderscanner.h"
+#include <KMime/Message>
+#include <QTest>
+
+MessageHeaderScannerTest::MessageHeaderScannerTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+void MessageHeaderScannerTest::shouldHaveDefaultValue()
+{
+    MailCommon::MessageHeaderScanner scanner;
+    QVERIFY(scanner.head().isEmpty());
+    QCOMPARE(scanner.fieldCount(), 0);
+    QVERIFY(!scanner.hasHeader("From"));
+    QVERIFY(scanner.value("From").isEmpty());
+}
+
+void MessageHeaderScannerTest::shouldFindHeaders()
+{
+    const QByteArray head =
+        "From: foo@kde.org\r\n"
+        "List-Id: KDE PIM <kde-pim.kde.org>\r\n"
+        "X-Spam-Flag: YES\r\n"
+        "X-Spam-Flag: NO\r\n";
+    MailCommon::MessageHeaderScanner scanner(head);
+    QCOMPARE(scanner.fieldCount(), 4);
+    QVERIFY(scanner.hasHeader("list-id"));
+    QCOMPARE(scanner.value("LIST-ID"), QStringLiteral("KDE PIM <kde-pim.kde.org>"));
+    QCOMPARE(scanner.value("x-spam-flag"), QStringLiteral("YES"));
+    QVERIFY(!scanner.hasHeader("X-Spam"));
+}
+
+void MessageHeaderScannerTest::shouldUnfoldHeaders()
+{
+    const QByteArray head =
+        "Subject: a long\n"
+        "\tsubject line\n"
+        "X-Custom: value\n";
+    MailCommon::MessageHeaderScanner scanner(head);
+    QCOMPARE(scanner.fieldCount(), 2);
+    QCOMPARE(scanner.rawValue("subject"), QByteArray("a long\tsubject line"));
+    QCOMPARE(scanner.value("X-Custom"), QStringLiteral("value"));
+}
+
+void MessageHeaderScannerTest::shouldDecodeHeaders()
+{
+    MailCommon::MessageHeaderScanner scanner("X-Custom: =?utf-8?q?caf=C3=A9?=\n");
+    QCOMPARE(scanner.value("X-Custom"), QStringLiteral("café"));
+}
+
+void MessageHeaderScannerTest::shouldDecodeUnencodedHeadersLikeKMime_data()
+{
+    QTest::addColumn<QByteArray>("head");
+    QTest::newRow("latin1") << QByteArray("Subject: caf\xE9 cr\xE8me\n");
+    QTest::newRow("utf8") << QByteArray("Subject: caf\xC3\xA9 cr\xC3\xA8me\n");
+    QTest::newRow("encoded") << QByteArray("Subject: =?iso-8859-1?q?caf=E9?= cr\xE8me\n");
+}
+
+void MessageHeaderScannerTest::shouldDecodeUnencodedHeadersLikeKMime()
+{
+    QFETCH(QByteArray, head);
+    auto message = std::make_shared<KMime::Message>();
+    message->setContent(head + "\nbody\n");
+    message->parse();
+
+    MailCommon::MessageHeaderScanner scanner(head);
+    const QString value = scanner.value("Subject");
+    QCOMPARE(value, message->subject()->asUnicodeString());
+    QVERIFY(!value.contains(QChar::ReplacementCharacter));
+}
+
+void MessageHeaderScannerTest::shouldStopAtBody()
+{
+    const QByteArray data =
+        "From: foo@kde.org\n"
+        "\n"
+        "X-Custom: not a header\n";
+    MailCommon::MessageHeaderScanner scanner(data);
+    QCOMPARE(scanner.fieldCount(), 1);
+    QVERIFY(!scanner.hasHeader("X-Custom"));
+}
+
+void MessageHeaderScannerTest::shouldReuseScanner()
+{
+    const QByteArray head = "X-Custom: foo\n";
+    const MailCommon::MessageHeaderScanner &scanner = MailCommon::MessageHeaderScanner::forHead(head);
+    QCOMPARE(&MailCommon::MessageHeaderScanner::forHead(head), &scanner);
+    QCOMPARE(scanner.value("X-Custom"), QStringLiteral("foo"));
+
+    const QByteArray otherHead = "X-Custom: bla\n";
+    QCOMPARE(MailCommon::MessageHeaderScanner::forHead(otherHead).value("X-Custom"), QStringLiteral("bla"));
+}
+
+QTEST_MAIN(MessageHeaderScannerTest)
+
+#include "moc_messageheaderscannertest.cpp"
@@ -0,0 +1,26 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class MessageHeaderScannerTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MessageHeaderScannerTest(QObject *parent = nullptr);
+
+private Q_SLOTS:
+    void shouldHaveDefaultValue();
+    void shouldFindHeaders();
+    void shouldUnfoldHeaders();
+    void shouldDecodeHeaders();
+    void shouldDecodeUnencodedHeadersLikeKMime_data();
+    void shouldDecodeUnencodedHeadersLikeKMime();
+    void shouldStopAtBody();
+    void shouldReuseScanner();
+};
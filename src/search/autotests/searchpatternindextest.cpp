@@ -0,0 +1,164 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "searchpatternindextest.h"
+#include "../searchpattern.h"
+#include "../searchpatternindex.h"
+#include <KMime/Message>
+#include <QTest>
+
+QTEST_MAIN(SearchPatternIndexTest)
+
+using namespace MailCommon;
+
+static Akonadi::Item createItem(const QByteArray &data)
+{
+    auto msgPtr = std::make_shared<KMime::Message>();
+    msgPtr->setContent(data);
+    msgPtr->parse();
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(msgPtr);
+    item.setFlags({"\\SEEN"});
+    return item;
+}
+
+static std::shared_ptr<SearchPattern> createPattern(SearchPattern::Operator op, const QList<SearchRule::Ptr> &rules)
+{
+    auto pattern = std::make_shared<SearchPattern>();
+    pattern->setOp(op);
+    for (const SearchRule::Ptr &rule : rules) {
+        pattern->append(rule);
+    }
+    return pattern;
+}
+
+SearchPatternIndexTest::SearchPatternIndexTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SearchPatternIndexTest::~SearchPatternIndexTest() = default;
+
+void SearchPatternIndexTest::shouldHaveDefaultValues()
+{
+    SearchPatternIndex index;
+    QVERIFY(index.patterns().isEmpty());
+    QCOMPARE(index.indexedRuleCount(), 0);
+    QVERIFY(index.matches(createItem("Subject: foo\n\nbody\n")).isEmpty());
+}
+
+void SearchPatternIndexTest::shouldIndexHeaderRules()
+{
+    const auto pattern = createPattern(SearchPattern::OpAnd,
+                                       {SearchRule::createInstance("subject", SearchRule::FuncContains, QStringLiteral("report")),
+                                        SearchRule::createInstance("from", SearchRule::FuncEquals, QStringLiteral("foo@kde.org")),
+                                        SearchRule::createInstance("subject", SearchRule::FuncRegExp, QStringLiteral("rep.*")),
+                                        SearchRule::createInstance("<status>", SearchRule::FuncContains, QStringLiteral("Read")),
+                                        SearchRule::createInstance("<body>", SearchRule::FuncContains, QStringLiteral("report"))});
+    SearchPatternIndex index;
+    index.setPatterns({pattern.get()});
+    QCOMPARE(index.patterns().count(), 1);
+    QCOMPARE(index.indexedRuleCount(), 2);
+}
+
+void SearchPatternIndexTest::shouldMatchLikeSearchPattern_data()
+{
+    QTest::addColumn<QByteArray>("message");
+    QTest::newRow("report") << QByteArray(
+        "From: foo@kde.org\n"
+        "To: bla@kde.org\n"
+        "Subject: Weekly Report\n"
+        "X-Mailing-List: kde-pim@kde.org\n"
+        "\n"
+        "Body text\n");
+    QTest::newRow("other") << QByteArray(
+        "From: Bar <bar@example.com>\n"
+        "To: foo@kde.org\n"
+        "Subject: weekly reporting\n"
+        "\n"
+        "Body report\n");
+    QTest::newRow("no-subject") << QByteArray(
+        "From: foo@kde.org\n"
+        "\n"
+        "Weekly Report\n");
+    // Equals compares case folded values, unlike QString::toLower()
+    QTest::newRow("final-sigma") << QByteArray(
+        "From: foo@kde.org\n"
+        "Subject: =?UTF-8?B?zqPOpM6GzqPOmc6j?=\n"
+        "\n"
+        "Body text\n");
+    QTest::newRow("long-s") << QByteArray(
+        "From: foo@kde.org\n"
+        "Subject: =?UTF-8?B?U3RyYcOfZQ==?=\n"
+        "\n"
+        "Body text\n");
+}
+
+void SearchPatternIndexTest::shouldMatchLikeSearchPattern()
+{
+    QFETCH(QByteArray, message);
+    const QList<std::shared_ptr<SearchPattern>> patterns = {
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncContains, QStringLiteral("report"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncContainsNot, QStringLiteral("port"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncStartWith, QStringLiteral("Weekly"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncNotStartWith, QStringLiteral("Weekly"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncEquals, QStringLiteral("weekly report"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncNotEqual, QStringLiteral("weekly report"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncEquals, QStringLiteral("στάσις"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncNotEqual, QStringLiteral("στάσις"))}),
+        createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncEquals, QStringLiteral("ſtraße"))}),
+        createPattern(SearchPattern::OpOr,
+                      {SearchRule::createInstance("from", SearchRule::FuncContains, QStringLiteral("example.com")),
+                       SearchRule::createInstance("x-mailing-list", SearchRule::FuncContains, QStringLiteral("kde-pim"))}),
+        createPattern(SearchPattern::OpAnd,
+                      {SearchRule::createInstance("from", SearchRule::FuncContains, QStringLiteral("foo")),
+                       SearchRule::createInstance("<body>", SearchRule::FuncContains, QStringLiteral("report"))}),
+        createPattern(SearchPattern::OpAnd,
+                      {SearchRule::createInstance("To", SearchRule::FuncContains, QStringLiteral("kde.org")),
+                       SearchRule::createInstance("subject", SearchRule::FuncRegExp, QStringLiteral("^weekly"))}),
+        createPattern(SearchPattern::OpAll, {SearchRule::createInstance("subject", SearchRule::FuncContains, QStringLiteral("nothing"))}),
+        createPattern(SearchPattern::OpAnd, {}),
+    };
+
+    QList<const SearchPattern *> patternList;
+    for (const auto &pattern : patterns) {
+        patternList.append(pattern.get());
+    }
+    SearchPatternIndex index;
+    index.setPatterns(patternList);
+
+    const Akonadi::Item item = createItem(message);
+    for (bool ignoreBody : {false, true}) {
+        const QBitArray result = index.matches(item, ignoreBody);
+        QCOMPARE(result.size(), patterns.size());
+        for (qsizetype i = 0; i < patterns.size(); ++i) {
+            QCOMPARE(result.testBit(i), patterns.at(i)->matches(item, ignoreBody));
+        }
+    }
+}
+
+void SearchPatternIndexTest::shouldCaseFoldEqualsRules()
+{
+    // Final sigma and long s only compare equal once case folded
+    const auto sigma = createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncEquals, QStringLiteral("στάσις"))});
+    const auto longS = createPattern(SearchPattern::OpAnd, {SearchRule::createInstance("subject", SearchRule::FuncEquals, QStringLiteral("ſtraße"))});
+    SearchPatternIndex index;
+    index.setPatterns({sigma.get(), longS.get()});
+
+    const Akonadi::Item sigmaItem = createItem("Subject: =?UTF-8?B?zqPOpM6GzqPOmc6j?=\n\nBody text\n");
+    QVERIFY(sigma->matches(sigmaItem));
+    QBitArray result = index.matches(sigmaItem);
+    QVERIFY(result.testBit(0));
+    QVERIFY(!result.testBit(1));
+
+    const Akonadi::Item longSItem = createItem("Subject: =?UTF-8?B?U3RyYcOfZQ==?=\n\nBody text\n");
+    QVERIFY(longS->matches(longSItem));
+    result = index.matches(longSItem);
+    QVERIFY(!result.testBit(0));
+    QVERIFY(result.testBit(1));
+}
+
+#include "moc_searchpatternindextest.cpp"
@@ -0,0 +1,23 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class SearchPatternIndexTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SearchPatternIndexTest(QObject *parent = nullptr);
+    ~SearchPatternIndexTest() override;
+private Q_SLOTS:
+    void shouldHaveDefaultValues();
+    void shouldIndexHeaderRules();
+    void shouldMatchLikeSearchPattern_data();
+    void shouldMatchLikeSearchPattern();
+    void shouldCaseFoldEqualsRules();
+};
@@ -5,9 +5,31 @@
 */
 
 #include "searchpatterntest.h"
+#include "../../filter/filterlog.h"
 #include "../searchpattern.h"
+#include <KMime/Message>
 #include <QTest>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
+static Akonadi::Item createItem()
+{
+    const QByteArray data =
+        "From: foo@kde.org\n"
+        "Subject: Weekly Report\n"
+        "\n"
+        "Body text\n";
+    auto msgPtr = std::make_shared<KMime::Message>();
+    msgPtr->setContent(data);
+    msgPtr->parse();
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(msgPtr);
+    item.setFlags({"\\SEEN"});
+    return item;
+}
+
 SearchPatternTest::SearchPatternTest(QObject *parent)
     : QObject(parent)
 {
@@ -66,6 +88,119 @@ void SearchPatternTest::shouldRuleRequirePart()
     QCOMPARE(rule->requiredPart(), part);
 }
 
+void SearchPatternTest::shouldEvaluateCheapRulesFirst()
+{
+    MailCommon::SearchPattern pattern;
+    const MailCommon::SearchRule::Ptr bodyRule = MailCommon::SearchRule::createInstance("<body>", MailCommon::SearchRule::FuncRegExp, QStringLiteral("text"));
+    const MailCommon::SearchRule::Ptr subjectRule = MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("report"));
+    const MailCommon::SearchRule::Ptr statusRule = MailCommon::SearchRule::createInstance("<status>", MailCommon::SearchRule::FuncContains, QStringLiteral("Read"));
+    pattern.append(bodyRule);
+    pattern.append(subjectRule);
+    pattern.append(statusRule);
+
+    QVERIFY(statusRule->cost() < subjectRule->cost());
+    QVERIFY(subjectRule->cost() < bodyRule->cost());
+    const QList<MailCommon::SearchRule::Ptr> order = pattern.evaluationOrder();
+    QCOMPARE(order.count(), 3);
+    QCOMPARE(order.at(0), statusRule);
+    QCOMPARE(order.at(1), subjectRule);
+    QCOMPARE(order.at(2), bodyRule);
+}
+
+void SearchPatternTest::shouldMoveDecisiveRulesForward()
+{
+    MailCommon::SearchPattern pattern;
+    pattern.setOp(MailCommon::SearchPattern::OpAnd);
+    const MailCommon::SearchRule::Ptr alwaysTrue = MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("weekly"));
+    const MailCommon::SearchRule::Ptr alwaysFalse = MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("invoice"));
+    pattern.append(alwaysTrue);
+    pattern.append(alwaysFalse);
+    QCOMPARE(pattern.evaluationOrder().constFirst(), alwaysTrue);
+
+    const Akonadi::Item item = createItem();
+    for (int i = 0; i < 100; ++i) {
+        QVERIFY(!pattern.matches(item));
+    }
+    QCOMPARE(pattern.evaluationOrder().constFirst(), alwaysFalse);
+}
+
+void SearchPatternTest::shouldKeepMatchResult()
+{
+    const Akonadi::Item item = createItem();
+    MailCommon::SearchPattern pattern;
+    pattern.append(MailCommon::SearchRule::createInstance("<body>", MailCommon::SearchRule::FuncContains, QStringLiteral("body")));
+    pattern.append(MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("weekly")));
+
+    pattern.setOp(MailCommon::SearchPattern::OpAnd);
+    QVERIFY(pattern.matches(item));
+    pattern.last()->setContents(QStringLiteral("invoice"));
+    QVERIFY(!pattern.matches(item));
+    QVERIFY(!pattern.matches(item, true));
+
+    pattern.setOp(MailCommon::SearchPattern::OpOr);
+    QVERIFY(pattern.matches(item));
+    // The body rule is ignored
+    QVERIFY(!pattern.matches(item, true));
+
+    const MailCommon::SearchPattern copy(pattern);
+    QCOMPARE(copy.count(), pattern.count());
+    QVERIFY(copy.first() != pattern.first());
+    QVERIFY(copy.matches(item));
+}
+
+void SearchPatternTest::shouldMatchFromSeveralThreads()
+{
+    MailCommon::SearchPattern pattern;
+    pattern.setOp(MailCommon::SearchPattern::OpAnd);
+    const MailCommon::SearchRule::Ptr alwaysTrue = MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("weekly"));
+    const MailCommon::SearchRule::Ptr alwaysFalse = MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("invoice"));
+    pattern.append(alwaysTrue);
+    pattern.append(alwaysFalse);
+    pattern.compile();
+
+    const Akonadi::Item item = createItem();
+    std::atomic<int> wrongResults = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&pattern, &item, &wrongResults]() {
+            for (int j = 0; j < 250; ++j) {
+                if (pattern.matches(item)) {
+                    ++wrongResults;
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    QCOMPARE(wrongResults.load(), 0);
+    QCOMPARE(pattern.evaluationOrder().constFirst(), alwaysFalse);
+}
+
+void SearchPatternTest::shouldEvaluateInListOrderWhileLogging()
+{
+    MailCommon::SearchPattern pattern;
+    pattern.setOp(MailCommon::SearchPattern::OpOr);
+    const MailCommon::SearchRule::Ptr subjectRule = MailCommon::SearchRule::createInstance("subject", MailCommon::SearchRule::FuncContains, QStringLiteral("invoice"));
+    const MailCommon::SearchRule::Ptr statusRule = MailCommon::SearchRule::createInstance("<status>", MailCommon::SearchRule::FuncContains, QStringLiteral("Important"));
+    pattern.append(subjectRule);
+    pattern.append(statusRule);
+    QCOMPARE(pattern.evaluationOrder().constFirst(), statusRule);
+
+    MailCommon::FilterLog *log = MailCommon::FilterLog::instance();
+    log->clear();
+    log->setContentTypeEnabled(MailCommon::FilterLog::RuleResult, true);
+    log->setLogging(true);
+    QVERIFY(!pattern.matches(createItem()));
+    log->setLogging(false);
+
+    const QStringList entries = log->logEntries();
+    log->clear();
+    QCOMPARE(entries.count(), 2);
+    QVERIFY(entries.at(0).contains(QLatin1StringView("invoice")));
+    QVERIFY(entries.at(1).contains(QLatin1StringView("Important")));
+}
+
 QTEST_MAIN(SearchPatternTest)
 
 #include "moc_searchpatterntest.cpp"
@@ -17,4 +17,9 @@ public:
 private Q_SLOTS:
     void shouldRuleRequirePart_data();
     void shouldRuleRequirePart();
+    void shouldEvaluateCheapRulesFirst();
+    void shouldMoveDecisiveRulesForward();
+    void shouldKeepMatchResult();
+    void shouldMatchFromSeveralThreads();
+    void shouldEvaluateInListOrderWhileLogging();
 };
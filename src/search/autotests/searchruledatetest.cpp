@@ -82,6 +82,44 @@ void SearchRuleDateTest::shouldMatchDate()
     QCOMPARE(searchrule.matches(item), match);
 }
 
+void SearchRuleDateTest::shouldMatchRawDateHeader()
+{
+    auto msgPtr = std::make_shared<KMime::Message>();
+    msgPtr->setContent(
+        "From: foo@kde.org\r\n"
+        "Date: Tue, 5 May 2015 10:00:00 +0000\r\n"
+        "Subject: test\r\n"
+        "\r\n"
+        "body\r\n");
+    msgPtr->parse();
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(msgPtr);
+
+    MailCommon::SearchRuleDate searchrule("<date>", MailCommon::SearchRule::FuncEquals, QDate(2015, 5, 5).toString(Qt::ISODate));
+    QVERIFY(searchrule.matches(item));
+    MailCommon::SearchRuleDate searchrule2("<date>", MailCommon::SearchRule::FuncIsLess, QDate(2015, 5, 5).toString(Qt::ISODate));
+    QVERIFY(!searchrule2.matches(item));
+}
+
+void SearchRuleDateTest::shouldRecompileWhenContentsChange()
+{
+    auto msgPtr = std::make_shared<KMime::Message>();
+    msgPtr->date(KMime::CreatePolicy::Create)->setDateTime(QDate(2015, 5, 5).startOfDay());
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(msgPtr);
+
+    MailCommon::SearchRuleDate searchrule("<date>", MailCommon::SearchRule::FuncEquals, QDate(2015, 5, 5).toString(Qt::ISODate));
+    QVERIFY(searchrule.matches(item));
+    QVERIFY(searchrule.isCompiled());
+
+    searchrule.setContents(QDate(2015, 5, 6).toString(Qt::ISODate));
+    QVERIFY(!searchrule.isCompiled());
+    QVERIFY(!searchrule.matches(item));
+
+    searchrule.setContents(QStringLiteral("foo"));
+    QVERIFY(searchrule.isEmpty());
+}
+
 QTEST_MAIN(SearchRuleDateTest)
 
 #include "moc_searchruledatetest.cpp"
@@ -20,4 +20,6 @@ private Q_SLOTS:
     void shouldBeEmpty();
     void shouldMatchDate();
     void shouldMatchDate_data();
+    void shouldMatchRawDateHeader();
+    void shouldRecompileWhenContentsChange();
 };
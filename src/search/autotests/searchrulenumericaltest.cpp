@@ -6,6 +6,7 @@
 
 #include "searchrulenumericaltest.h"
 #include "../searchrule/searchrulenumerical.h"
+#include <KMime/Message>
 #include <QTest>
 SearchRuleNumericalTest::SearchRuleNumericalTest(QObject *parent)
     : QObject(parent)
@@ -61,6 +62,51 @@ void SearchRuleNumericalTest::shouldMatchNumericalsize()
 #endif
 }
 
+void SearchRuleNumericalTest::shouldMatchSize()
+{
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(std::make_shared<KMime::Message>());
+    item.setSize(1000);
+
+    QVERIFY(MailCommon::SearchRuleNumerical("<size>", MailCommon::SearchRule::FuncEquals, QStringLiteral("1000")).matches(item));
+    QVERIFY(MailCommon::SearchRuleNumerical("<size>", MailCommon::SearchRule::FuncIsGreater, QStringLiteral("999")).matches(item));
+    QVERIFY(!MailCommon::SearchRuleNumerical("<size>", MailCommon::SearchRule::FuncIsLess, QStringLiteral("1000")).matches(item));
+    QVERIFY(MailCommon::SearchRuleNumerical("<size>", MailCommon::SearchRule::FuncContains, QStringLiteral("00")).matches(item));
+    QVERIFY(MailCommon::SearchRuleNumerical("<size>", MailCommon::SearchRule::FuncRegExp, QStringLiteral("^10+$")).matches(item));
+    QVERIFY(!MailCommon::SearchRuleNumerical("<size>", MailCommon::SearchRule::FuncNotRegExp, QStringLiteral("^10+$")).matches(item));
+    QVERIFY(!MailCommon::SearchRuleNumerical("<foo>", MailCommon::SearchRule::FuncEquals, QStringLiteral("1000")).matches(item));
+}
+
+void SearchRuleNumericalTest::shouldMatchAgeInDays()
+{
+    const QDateTime date = QDateTime::currentDateTime().addDays(-10);
+    auto msgPtr = std::make_shared<KMime::Message>();
+    msgPtr->setContent("From: foo@kde.org\r\nDate: " + date.toString(Qt::RFC2822Date).toLatin1() + "\r\nSubject: test\r\n\r\nbody\r\n");
+    msgPtr->parse();
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(msgPtr);
+
+    QVERIFY(MailCommon::SearchRuleNumerical("<age in days>", MailCommon::SearchRule::FuncIsGreater, QStringLiteral("5")).matches(item));
+    QVERIFY(MailCommon::SearchRuleNumerical("<age in days>", MailCommon::SearchRule::FuncIsLess, QStringLiteral("20")).matches(item));
+    QVERIFY(!MailCommon::SearchRuleNumerical("<age in days>", MailCommon::SearchRule::FuncIsGreater, QStringLiteral("15")).matches(item));
+}
+
+void SearchRuleNumericalTest::shouldRecompileWhenContentsChange()
+{
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(std::make_shared<KMime::Message>());
+    item.setSize(1000);
+
+    MailCommon::SearchRuleNumerical searchrule("<size>", MailCommon::SearchRule::FuncIsGreater, QStringLiteral("500"));
+    QVERIFY(searchrule.matches(item));
+    searchrule.setContents(QStringLiteral("2000"));
+    QVERIFY(!searchrule.matches(item));
+    searchrule.setField("<age in days>");
+    QCOMPARE(searchrule.cost(), 5);
+    searchrule.setContents(QStringLiteral("foo"));
+    QVERIFY(searchrule.isEmpty());
+}
+
 QTEST_MAIN(SearchRuleNumericalTest)
 
 #include "moc_searchrulenumericaltest.cpp"
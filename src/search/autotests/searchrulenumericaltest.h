@@ -20,4 +20,7 @@ private Q_SLOTS:
     void shouldHaveRequirePart();
     void shouldMatchNumericalsize();
     void shouldMatchNumericalsize_data();
+    void shouldMatchSize();
+    void shouldMatchAgeInDays();
+    void shouldRecompileWhenContentsChange();
 };
@@ -6,7 +6,26 @@
 
 #include "searchrulestringtest.h"
 #include "../searchrule/searchrulestring.h"
+#include <KMime/Message>
 #include <QTest>
+Q_DECLARE_METATYPE(MailCommon::SearchRule::Function)
+
+static Akonadi::Item createItem()
+{
+    const QByteArray data =
+        "From: Foo Bar <foo@kde.org>\n"
+        "To: kde@example.com\n"
+        "Subject: Weekly Report\n"
+        "X-Custom: Some Value\n"
+        "\n"
+        "Body text\n";
+    auto msgPtr = std::make_shared<KMime::Message>();
+    msgPtr->setContent(data);
+    msgPtr->parse();
+    Akonadi::Item item;
+    item.setPayload<std::shared_ptr<KMime::Message>>(msgPtr);
+    return item;
+}
 
 SearchRuleStringTest::SearchRuleStringTest(QObject *parent)
     : QObject(parent)
@@ -54,10 +73,77 @@ void SearchRuleStringTest::shouldHaveRequirePart_data()
 
 void SearchRuleStringTest::shouldMatchString()
 {
+    QFETCH(QByteArray, field);
+    QFETCH(MailCommon::SearchRule::Function, function);
+    QFETCH(QString, contents);
+    QFETCH(bool, match);
+    MailCommon::SearchRuleString searchrule(field, function, contents);
+    QCOMPARE(searchrule.matches(createItem()), match);
+    QVERIFY(searchrule.isCompiled());
 }
 
 void SearchRuleStringTest::shouldMatchString_data()
 {
+    QTest::addColumn<QByteArray>("field");
+    QTest::addColumn<MailCommon::SearchRule::Function>("function");
+    QTest::addColumn<QString>("contents");
+    QTest::addColumn<bool>("match");
+
+    QTest::newRow("contains") << QByteArray("subject") << MailCommon::SearchRule::FuncContains << QStringLiteral("REPORT") << true;
+    QTest::newRow("containsnot") << QByteArray("subject") << MailCommon::SearchRule::FuncContainsNot << QStringLiteral("report") << false;
+    QTest::newRow("equals") << QByteArray("subject") << MailCommon::SearchRule::FuncEquals << QStringLiteral("weekly report") << true;
+    QTest::newRow("notequal") << QByteArray("subject") << MailCommon::SearchRule::FuncNotEqual << QStringLiteral("weekly report") << false;
+    QTest::newRow("regexp") << QByteArray("subject") << MailCommon::SearchRule::FuncRegExp << QStringLiteral("^week.*RT$") << true;
+    QTest::newRow("notregexp") << QByteArray("subject") << MailCommon::SearchRule::FuncNotRegExp << QStringLiteral("^daily") << true;
+    QTest::newRow("startwith") << QByteArray("subject") << MailCommon::SearchRule::FuncStartWith << QStringLiteral("Weekly") << true;
+    QTest::newRow("endwith address") << QByteArray("from") << MailCommon::SearchRule::FuncEndWith << QStringLiteral("kde.org") << true;
+    QTest::newRow("isgreater") << QByteArray("subject") << MailCommon::SearchRule::FuncIsGreater << QStringLiteral("a") << true;
+    QTest::newRow("custom header") << QByteArray("X-Custom") << MailCommon::SearchRule::FuncContains << QStringLiteral("value") << true;
+    QTest::newRow("recipients") << QByteArray("<recipients>") << MailCommon::SearchRule::FuncContains << QStringLiteral("example.com") << true;
+    QTest::newRow("body") << QByteArray("<body>") << MailCommon::SearchRule::FuncContains << QStringLiteral("body text") << true;
+}
+
+void SearchRuleStringTest::shouldRecompileWhenChanged()
+{
+    const Akonadi::Item item = createItem();
+    MailCommon::SearchRuleString searchrule(QByteArray("subject"), MailCommon::SearchRule::FuncContains, QStringLiteral("report"));
+    QVERIFY(!searchrule.isCompiled());
+    QVERIFY(searchrule.matches(item));
+    QVERIFY(searchrule.isCompiled());
+
+    searchrule.setContents(QStringLiteral("invoice"));
+    QVERIFY(!searchrule.isCompiled());
+    QVERIFY(!searchrule.matches(item));
+
+    searchrule.setFunction(MailCommon::SearchRule::FuncContainsNot);
+    QVERIFY(!searchrule.isCompiled());
+    QVERIFY(searchrule.matches(item));
+
+    searchrule.setField(QByteArray("X-Custom"));
+    searchrule.setContents(QStringLiteral("value"));
+    QVERIFY(!searchrule.isCompiled());
+    QVERIFY(!searchrule.matches(item));
+}
+
+void SearchRuleStringTest::shouldCompileFromRequiredPart()
+{
+    // requiredPart() is const but compiles the rule, see SearchRule::compile()
+    MailCommon::SearchRuleString searchrule(QByteArray("subject"), MailCommon::SearchRule::FuncContains, QStringLiteral("report"));
+    QVERIFY(!searchrule.isCompiled());
+    QCOMPARE(searchrule.requiredPart(), MailCommon::SearchRule::Envelope);
+    QVERIFY(searchrule.isCompiled());
+
+    searchrule.setField(QByteArray("<body>"));
+    QVERIFY(!searchrule.isCompiled());
+    QCOMPARE(searchrule.cost(), 200);
+    QVERIFY(searchrule.isCompiled());
+
+    // Once compiled, the const methods don't change it any more
+    searchrule.setField(QByteArray("X-Custom"));
+    searchrule.compile();
+    QCOMPARE(searchrule.requiredPart(), MailCommon::SearchRule::Header);
+    QCOMPARE(searchrule.cost(), 20);
+    QVERIFY(searchrule.isCompiled());
 }
 
 void SearchRuleStringTest::shouldBeEmpty()
@@ -20,4 +20,6 @@ private Q_SLOTS:
     void shouldHaveRequirePart();
     void shouldMatchString_data();
     void shouldBeEmpty();
+    void shouldRecompileWhenChanged();
+    void shouldCompileFromRequiredPart();
 };
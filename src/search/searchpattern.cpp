@@ -11,6 +11,7 @@
 #include "filter/filterlog.h"
 using MailCommon::FilterLog;
 #include "mailcommon_debug.h"
+#include "searchrule/itemstatussnapshot.h"
 #include <Akonadi/ContactSearchJob>
 
 #include <KMime/Message>
@@ -19,11 +20,155 @@ using MailCommon::FilterLog;
 
 #include <QDataStream>
 #include <QIODevice>
+#include <QMutex>
+#include <QVarLengthArray>
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
 
 using namespace MailCommon;
 
+class Q_DECL_HIDDEN SearchPattern::SearchPatternPrivate
+{
+public:
+    struct RuleStatistics {
+        std::atomic<quint32> evaluated = 0;
+        std::atomic<quint32> decisive = 0;
+    };
+
+    // The statistics of one list of rules. Once published, only its atomic
+    // members change, so matches() can use it from several threads without
+    // locking. A new plan is only created when the rules were changed.
+    struct Plan {
+        explicit Plan(const QList<SearchRule::Ptr> &list)
+            : rules(list)
+            , statistics(new RuleStatistics[list.size()])
+        {
+        }
+
+        QList<SearchRule::Ptr> rules;
+        std::unique_ptr<RuleStatistics[]> statistics;
+        // Positions in rules, in evaluation order, 4 bits each
+        std::atomic<quint64> order = 0;
+        std::atomic<quint32> evaluations = 0;
+    };
+
+    using EvaluationOrder = QVarLengthArray<qsizetype, 16>;
+
+    Plan *plan(const SearchPattern &pattern);
+    static EvaluationOrder evaluationOrder(const Plan *plan, bool listOrder);
+    static void recordEvaluation(Plan *plan, const EvaluationOrder &order, qsizetype evaluatedCount, bool decided);
+    static void sort(Plan *plan);
+
+    // Only the first rules fit in the order, the others keep their list order
+    static constexpr qsizetype maxSortedRules = 16;
+    // Resort the rules after this many evaluations
+    static constexpr quint32 sortInterval = 32;
+    // Halve the statistics once a rule was evaluated that often, so that
+    // the order keeps adapting
+    static constexpr quint32 maxEvaluations = 1 << 16;
+
+    std::atomic<Plan *> mCurrentPlan = nullptr;
+    // Creating a plan is locked; the plan it replaces stays alive until the
+    // next one is created, another thread could still be comparing its rules
+    QMutex mMutex;
+    std::vector<std::unique_ptr<Plan>> mPlans;
+};
+
+SearchPattern::SearchPatternPrivate::Plan *SearchPattern::SearchPatternPrivate::plan(const SearchPattern &pattern)
+{
+    const QList<SearchRule::Ptr> &rules = pattern;
+    Plan *current = mCurrentPlan.load(std::memory_order_acquire);
+    if (current && current->rules == rules) {
+        return current;
+    }
+
+    QMutexLocker locker(&mMutex);
+    current = mCurrentPlan.load(std::memory_order_relaxed);
+    if (current && current->rules == rules) {
+        return current;
+    }
+    // Changing the rules requires exclusive access to the pattern, so the
+    // older plans are no longer used by any thread
+    std::erase_if(mPlans, [current](const std::unique_ptr<Plan> &retired) {
+        return retired.get() != current;
+    });
+    auto newPlan = std::make_unique<Plan>(rules);
+    sort(newPlan.get());
+    current = newPlan.get();
+    mPlans.push_back(std::move(newPlan));
+    mCurrentPlan.store(current, std::memory_order_release);
+    return current;
+}
+
+SearchPattern::SearchPatternPrivate::EvaluationOrder SearchPattern::SearchPatternPrivate::evaluationOrder(const Plan *plan, bool listOrder)
+{
+    const qsizetype count = plan->rules.size();
+    const qsizetype sortedCount = listOrder ? 0 : std::min(count, maxSortedRules);
+    const quint64 packedOrder = plan->order.load(std::memory_order_relaxed);
+    EvaluationOrder order;
+    for (qsizetype i = 0; i < sortedCount; ++i) {
+        order.append((packedOrder >> (4 * i)) & 0xF);
+    }
+    for (qsizetype i = sortedCount; i < count; ++i) {
+        order.append(i);
+    }
+    return order;
+}
+
+void SearchPattern::SearchPatternPrivate::sort(Plan *plan)
+{
+    const qsizetype count = std::min(plan->rules.size(), maxSortedRules);
+    // Expected cost to reach a decision: cost / probability that the rule decides.
+    // Use a Laplace estimate of the probability so that unseen rules are only
+    // ordered by their cost.
+    QVarLengthArray<qreal, maxSortedRules> expectedCosts;
+    for (qsizetype i = 0; i < count; ++i) {
+        RuleStatistics &statistics = plan->statistics[i];
+        quint32 evaluated = statistics.evaluated.load(std::memory_order_relaxed);
+        quint32 decisive = statistics.decisive.load(std::memory_order_relaxed);
+        if (evaluated >= maxEvaluations) {
+            // Concurrent updates may be lost, this is only a statistic
+            evaluated /= 2;
+            decisive = std::min(decisive / 2, evaluated);
+            statistics.evaluated.store(evaluated, std::memory_order_relaxed);
+            statistics.decisive.store(decisive, std::memory_order_relaxed);
+        }
+        expectedCosts.append(qreal(plan->rules.at(i)->cost()) * (evaluated + 2) / (decisive + 1));
+    }
+
+    QVarLengthArray<qsizetype, maxSortedRules> order;
+    for (qsizetype i = 0; i < count; ++i) {
+        order.append(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&expectedCosts](qsizetype lhs, qsizetype rhs) {
+        return expectedCosts.at(lhs) < expectedCosts.at(rhs);
+    });
+
+    quint64 packedOrder = 0;
+    for (qsizetype i = 0; i < count; ++i) {
+        packedOrder |= quint64(order.at(i)) << (4 * i);
+    }
+    plan->order.store(packedOrder, std::memory_order_relaxed);
+}
+
+void SearchPattern::SearchPatternPrivate::recordEvaluation(Plan *plan, const EvaluationOrder &order, qsizetype evaluatedCount, bool decided)
+{
+    for (qsizetype i = 0; i < evaluatedCount; ++i) {
+        plan->statistics[order.at(i)].evaluated.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (decided) {
+        plan->statistics[order.at(evaluatedCount - 1)].decisive.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Whoever completes an interval resorts, the others keep the current order
+    if ((plan->evaluations.fetch_add(1, std::memory_order_relaxed) + 1) % sortInterval == 0) {
+        sort(plan);
+    }
+}
+
 //==================================================
 //
 // class SearchPattern
@@ -32,17 +177,25 @@ using namespace MailCommon;
 
 using namespace Qt::Literals::StringLiterals;
 SearchPattern::SearchPattern()
-
+    : d(new SearchPatternPrivate)
 {
     init();
 }
 
 SearchPattern::SearchPattern(const KConfigGroup &config)
-
+    : d(new SearchPatternPrivate)
 {
     readConfig(config);
 }
 
+SearchPattern::SearchPattern(const SearchPattern &other)
+    : QList<SearchRule::Ptr>()
+    , d(new SearchPatternPrivate)
+    , mOperator(OpAnd)
+{
+    *this = other;
+}
+
 SearchPattern::~SearchPattern() = default;
 
 bool SearchPattern::matches(const Akonadi::Item &item, bool ignoreBody) const
@@ -53,36 +206,70 @@ bool SearchPattern::matches(const Akonadi::Item &item, bool ignoreBody) const
     if (!item.hasPayload<std::shared_ptr<KMime::Message>>()) {
         return false;
     }
+    compile();
 
-    QList<SearchRule::Ptr>::const_iterator it;
-    QList<SearchRule::Ptr>::const_iterator end(constEnd());
+    bool match = false;
     switch (mOperator) {
     case OpAnd: // all rules must match
-        for (it = constBegin(); it != end; ++it) {
-            if (!((*it)->requiredPart() == SearchRule::CompleteMessage && ignoreBody)) {
-                if (!(*it)->matches(item)) {
-                    return false;
-                }
-            }
-        }
-        return true;
-
+        match = true;
+        break;
     case OpOr: // at least one rule must match
-        for (it = constBegin(); it != end; ++it) {
-            if (!((*it)->requiredPart() == MailCommon::SearchRule::CompleteMessage && ignoreBody)) {
-                if ((*it)->matches(item)) {
-                    return true;
-                }
-            }
-        }
-        return false;
-
+        match = false;
+        break;
     case OpAll:
         return true;
-
     default:
         return false;
     }
+
+    // Decode the status once for all status, attachment and invitation rules
+    std::optional<ItemStatusSnapshot> statusSnapshot;
+    if (!ItemStatusSnapshot::hasSnapshot(item)) {
+        statusSnapshot.emplace(item);
+    }
+
+    SearchPatternPrivate::Plan *plan = d->plan(*this);
+    // Rules log while they are evaluated, keep the log in the order of the pattern
+    const bool listOrder = FilterLog::instance()->isLogging();
+    const SearchPatternPrivate::EvaluationOrder order = SearchPatternPrivate::evaluationOrder(plan, listOrder);
+    qsizetype evaluatedCount = 0;
+    bool decided = false;
+    for (const qsizetype index : order) {
+        const SearchRule::Ptr &rule = plan->rules.at(index);
+        ++evaluatedCount;
+        if (rule->requiredPart() == SearchRule::CompleteMessage && ignoreBody) {
+            continue;
+        }
+        // a rule returning false decides OpAnd, a rule returning true decides OpOr
+        if (rule->matches(item) != match) {
+            match = !match;
+            decided = true;
+            break;
+        }
+    }
+    if (!listOrder) {
+        SearchPatternPrivate::recordEvaluation(plan, order, evaluatedCount, decided);
+    }
+    return match;
+}
+
+QList<SearchRule::Ptr> SearchPattern::evaluationOrder() const
+{
+    const SearchPatternPrivate::Plan *plan = d->plan(*this);
+    const SearchPatternPrivate::EvaluationOrder order = SearchPatternPrivate::evaluationOrder(plan, false);
+    QList<SearchRule::Ptr> rules;
+    rules.reserve(order.size());
+    for (const qsizetype index : order) {
+        rules.append(plan->rules.at(index));
+    }
+    return rules;
+}
+
+void SearchPattern::compile() const
+{
+    for (const SearchRule::Ptr &rule : *this) {
+        rule->compile();
+    }
 }
 
 SearchRule::RequiredPart SearchPattern::requiredPart() const
@@ -14,6 +14,8 @@
 #include <QList>
 #include <QString>
 
+#include <memory>
+
 #include <Akonadi/SearchQuery>
 
 namespace Akonadi
@@ -93,6 +95,11 @@ public:
      */
     explicit SearchPattern(const KConfigGroup &config);
 
+    /*!
+     * Copy constructor. Makes a deep copy.
+     */
+    SearchPattern(const SearchPattern &other);
+
     /*!
      * Destructor. Deletes all stored rules!
      */
@@ -106,15 +113,45 @@ public:
      * own result or else most functionality is lacking, or has to be
      * reimplemented, since the rules are private to this class.
      *
+     * The rules are not evaluated in list order but cheapest and most
+     * often decisive first, see evaluationOrder(). The result is the same,
+     * but which rules run, and so parse the message, differs. While the
+     * FilterLog is logging, rules are evaluated in list order so that the
+     * log follows the pattern.
+     *
+     * It can be called from several threads at once, see compile(), as long
+     * as the pattern is not modified meanwhile.
+     *
      * \param item The Akonadi item to match
      * \param ignoreBody Whether to ignore the body content when matching
      * \return True if the match was successful, false otherwise
      */
     bool matches(const Akonadi::Item &item, bool ignoreBody = false) const;
 
+    /*!
+     * Compiles all rules of the pattern, see SearchRule::compile().
+     *
+     * matches() and requiredPart() compile rules lazily; call this before
+     * using the same pattern from several threads.
+     */
+    void compile() const;
+
+    /*!
+     * Returns the rules in the order matches() evaluates them.
+     *
+     * Rules are sorted by their cost divided by how often they decided the
+     * outcome of a match so far (returning false for \a OpAnd, true for
+     * \a OpOr). The statistics are gathered by matches(), so the order
+     * adapts to the messages seen. Only the first 16 rules are sorted, the
+     * others follow in list order.
+     */
+    [[nodiscard]] QList<SearchRule::Ptr> evaluationOrder() const;
+
     /*!
      * Returns the required part from the item that is needed for the search to
      * operate. See \ SearchRule::RequiredPart
+     *
+     * This may compile rules, see compile().
      */
     SearchRule::RequiredPart requiredPart() const;
 
@@ -242,6 +279,9 @@ private:
      * to "<i18n("unnamed")>", and the boolean operator to \a OpAnd.
      */
     MAILCOMMON_NO_EXPORT void init();
+
+    class SearchPatternPrivate;
+    std::unique_ptr<SearchPatternPrivate> const d;
     QString mName;
     Operator mOperator;
 };
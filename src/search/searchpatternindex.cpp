@@ -0,0 +1,342 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "searchpatternindex.h"
+#include "filter/filterlog.h"
+#include "searchpattern.h"
+#include "searchrule/itemstatussnapshot.h"
+#include "searchrule/searchrulestring.h"
+
+#include <Akonadi/Item>
+#include <KMime/Message>
+
+#include <QHash>
+
+using namespace MailCommon;
+
+namespace
+{
+/*
+ * Aho-Corasick automaton over UTF-16 code units: finds all occurrences of
+ * all added patterns in one pass over the text.
+ */
+class MultiPatternMatcher
+{
+public:
+    int addPattern(const QString &pattern)
+    {
+        int state = 0;
+        for (const QChar c : pattern) {
+            const char16_t u = c.unicode();
+            const int next = mNodes.at(state).next.value(u, -1);
+            if (next == -1) {
+                mNodes.append(Node());
+                const int newState = mNodes.size() - 1;
+                mNodes[state].next.insert(u, newState);
+                state = newState;
+            } else {
+                state = next;
+            }
+        }
+        const int id = mLengths.size();
+        mLengths.append(pattern.size());
+        mNodes[state].outputs.append(id);
+        return id;
+    }
+
+    void build()
+    {
+        // Breadth first, so that the failure state of a node, being less
+        // deep, is complete when the node is handled
+        QList<int> queue;
+        for (const int child : std::as_const(mNodes.at(0).next)) {
+            mNodes[child].fail = 0;
+            queue.append(child);
+        }
+        for (qsizetype i = 0; i < queue.size(); ++i) {
+            const int state = queue.at(i);
+            const QHash<char16_t, int> next = mNodes.at(state).next;
+            for (auto it = next.cbegin(), end = next.cend(); it != end; ++it) {
+                const char16_t c = it.key();
+                const int child = it.value();
+                queue.append(child);
+                int fail = mNodes.at(state).fail;
+                while (fail != 0 && !mNodes.at(fail).next.contains(c)) {
+                    fail = mNodes.at(fail).fail;
+                }
+                const int target = mNodes.at(fail).next.value(c, 0);
+                mNodes[child].fail = target;
+                mNodes[child].outputs += mNodes.at(target).outputs;
+            }
+        }
+    }
+
+    // Calls callback(patternId, startPosition) for every occurrence
+    template<typename Callback>
+    void search(const QString &text, Callback callback) const
+    {
+        int state = 0;
+        for (qsizetype i = 0; i < text.size(); ++i) {
+            const char16_t c = text.at(i).unicode();
+            while (state != 0 && !mNodes.at(state).next.contains(c)) {
+                state = mNodes.at(state).fail;
+            }
+            state = mNodes.at(state).next.value(c, 0);
+            for (const int id : mNodes.at(state).outputs) {
+                callback(id, i - mLengths.at(id) + 1);
+            }
+        }
+    }
+
+private:
+    struct Node {
+        QHash<char16_t, int> next;
+        int fail = 0;
+        QList<int> outputs;
+    };
+    QList<Node> mNodes{Node()};
+    QList<qsizetype> mLengths;
+};
+
+bool isIndexable(const SearchRule::Ptr &rule)
+{
+    const auto stringRule = dynamic_cast<const SearchRuleString *>(rule.get());
+    if (!stringRule || stringRule->isEmpty() || !stringRule->isHeaderFieldRule()) {
+        return false;
+    }
+    switch (rule->function()) {
+    case SearchRule::FuncContains:
+    case SearchRule::FuncContainsNot:
+    case SearchRule::FuncEquals:
+    case SearchRule::FuncNotEqual:
+    case SearchRule::FuncStartWith:
+    case SearchRule::FuncNotStartWith:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isNegatedFunction(SearchRule::Function function)
+{
+    return function == SearchRule::FuncContainsNot || function == SearchRule::FuncNotEqual || function == SearchRule::FuncNotStartWith;
+}
+}
+
+class Q_DECL_HIDDEN SearchPatternIndex::SearchPatternIndexPrivate
+{
+public:
+    struct IndexedRule {
+        SearchRule::Function function = SearchRule::FuncNone;
+        QString contents;
+    };
+
+    struct FieldIndex {
+        // Any rule on the field, used to extract its value from a message
+        SearchRule::Ptr representative;
+        MultiPatternMatcher matcher;
+        QHash<QString, int> needleIds;
+        // needle id -> ids of the contains and starts with rules
+        QList<QList<int>> needleRules;
+        // lowercased contents -> ids of the equals rules
+        QHash<QString, QList<int>> equalsRules;
+        QList<int> ruleIds;
+    };
+
+    struct PatternEntry {
+        const SearchPattern *pattern = nullptr;
+        QList<int> indexedRuleIds;
+        QList<SearchRule::Ptr> otherRules;
+    };
+
+    void clear();
+    void addRule(const SearchRule::Ptr &rule, PatternEntry &entry);
+    void matchField(const FieldIndex &field, KMime::Message *msg, QBitArray &fired) const;
+    [[nodiscard]] bool resolve(const PatternEntry &entry, const QBitArray &fired, const Akonadi::Item &item, bool ignoreBody) const;
+
+    QList<IndexedRule> mRules;
+    QList<FieldIndex> mFields;
+    QHash<QByteArray, int> mFieldIds;
+    QList<PatternEntry> mEntries;
+};
+
+void SearchPatternIndex::SearchPatternIndexPrivate::clear()
+{
+    mRules.clear();
+    mFields.clear();
+    mFieldIds.clear();
+    mEntries.clear();
+}
+
+void SearchPatternIndex::SearchPatternIndexPrivate::addRule(const SearchRule::Ptr &rule, PatternEntry &entry)
+{
+    if (!isIndexable(rule)) {
+        entry.otherRules.append(rule);
+        return;
+    }
+
+    const int ruleId = mRules.size();
+    IndexedRule indexedRule;
+    indexedRule.function = rule->function();
+    indexedRule.contents = rule->contents();
+    mRules.append(indexedRule);
+    entry.indexedRuleIds.append(ruleId);
+
+    const QByteArray fieldName = rule->field().toLower();
+    int fieldId = mFieldIds.value(fieldName, -1);
+    if (fieldId == -1) {
+        fieldId = mFields.size();
+        FieldIndex field;
+        field.representative = rule;
+        mFields.append(field);
+        mFieldIds.insert(fieldName, fieldId);
+    }
+    FieldIndex &field = mFields[fieldId];
+    field.ruleIds.append(ruleId);
+
+    if (indexedRule.function == SearchRule::FuncEquals || indexedRule.function == SearchRule::FuncNotEqual) {
+        field.equalsRules[indexedRule.contents.toCaseFolded()].append(ruleId);
+        return;
+    }
+    const QString needle = indexedRule.contents.toCaseFolded();
+    int needleId = field.needleIds.value(needle, -1);
+    if (needleId == -1) {
+        needleId = field.matcher.addPattern(needle);
+        field.needleIds.insert(needle, needleId);
+        field.needleRules.append(QList<int>());
+    }
+    field.needleRules[needleId].append(ruleId);
+}
+
+void SearchPatternIndex::SearchPatternIndexPrivate::matchField(const FieldIndex &field, KMime::Message *msg, QBitArray &fired) const
+{
+    const QString value = static_cast<const SearchRuleString *>(field.representative.get())->headerFieldContents(msg);
+    if (value.isEmpty()) {
+        // SearchRuleString never matches an empty value, whatever the function
+        return;
+    }
+
+    QBitArray hit(mRules.size());
+    field.matcher.search(value.toCaseFolded(), [this, &field, &value, &hit](int needleId, qsizetype start) {
+        for (const int ruleId : field.needleRules.at(needleId)) {
+            const IndexedRule &rule = mRules.at(ruleId);
+            if (rule.function == SearchRule::FuncContains || rule.function == SearchRule::FuncContainsNot) {
+                hit.setBit(ruleId);
+            } else if (start == 0 && value.startsWith(rule.contents)) {
+                // starts with is case sensitive
+                hit.setBit(ruleId);
+            }
+        }
+    });
+    const QList<int> equalsRuleIds = field.equalsRules.value(value.toCaseFolded());
+    for (const int ruleId : equalsRuleIds) {
+        hit.setBit(ruleId);
+    }
+
+    for (const int ruleId : field.ruleIds) {
+        fired.setBit(ruleId, isNegatedFunction(mRules.at(ruleId).function) ? !hit.testBit(ruleId) : hit.testBit(ruleId));
+    }
+}
+
+bool SearchPatternIndex::SearchPatternIndexPrivate::resolve(const PatternEntry &entry, const QBitArray &fired, const Akonadi::Item &item, bool ignoreBody) const
+{
+    if (entry.pattern->isEmpty()) {
+        return true;
+    }
+    switch (entry.pattern->op()) {
+    case SearchPattern::OpAnd:
+        for (const int ruleId : entry.indexedRuleIds) {
+            if (!fired.testBit(ruleId)) {
+                return false;
+            }
+        }
+        for (const SearchRule::Ptr &rule : entry.otherRules) {
+            if (!(rule->requiredPart() == SearchRule::CompleteMessage && ignoreBody) && !rule->matches(item)) {
+                return false;
+            }
+        }
+        return true;
+    case SearchPattern::OpOr:
+        for (const int ruleId : entry.indexedRuleIds) {
+            if (fired.testBit(ruleId)) {
+                return true;
+            }
+        }
+        for (const SearchRule::Ptr &rule : entry.otherRules) {
+            if (!(rule->requiredPart() == SearchRule::CompleteMessage && ignoreBody) && rule->matches(item)) {
+                return true;
+            }
+        }
+        return false;
+    case SearchPattern::OpAll:
+        return true;
+    }
+    return false;
+}
+
+SearchPatternIndex::SearchPatternIndex()
+    : d(new SearchPatternIndexPrivate)
+{
+}
+
+SearchPatternIndex::~SearchPatternIndex() = default;
+
+void SearchPatternIndex::setPatterns(const QList<const SearchPattern *> &patterns)
+{
+    d->clear();
+    for (const SearchPattern *pattern : patterns) {
+        pattern->compile();
+        SearchPatternIndexPrivate::PatternEntry entry;
+        entry.pattern = pattern;
+        const QList<SearchRule::Ptr> rules = pattern->evaluationOrder();
+        for (const SearchRule::Ptr &rule : rules) {
+            d->addRule(rule, entry);
+        }
+        d->mEntries.append(entry);
+    }
+    for (SearchPatternIndexPrivate::FieldIndex &field : d->mFields) {
+        field.matcher.build();
+    }
+}
+
+QList<const SearchPattern *> SearchPatternIndex::patterns() const
+{
+    QList<const SearchPattern *> patterns;
+    patterns.reserve(d->mEntries.size());
+    for (const SearchPatternIndexPrivate::PatternEntry &entry : std::as_const(d->mEntries)) {
+        patterns.append(entry.pattern);
+    }
+    return patterns;
+}
+
+int SearchPatternIndex::indexedRuleCount() const
+{
+    return d->mRules.size();
+}
+
+QBitArray SearchPatternIndex::matches(const Akonadi::Item &item, bool ignoreBody) const
+{
+    QBitArray result(d->mEntries.size());
+    // Shared by the status rules of all patterns
+    const ItemStatusSnapshot statusSnapshot(item);
+    if (!item.hasPayload<std::shared_ptr<KMime::Message>>() || FilterLog::instance()->isLogging()) {
+        // Nothing to share, or each rule has to log its own result
+        for (qsizetype i = 0; i < d->mEntries.size(); ++i) {
+            result.setBit(i, d->mEntries.at(i).pattern->matches(item, ignoreBody));
+        }
+        return result;
+    }
+
+    const auto msg = item.payload<std::shared_ptr<KMime::Message>>();
+    QBitArray fired(d->mRules.size());
+    for (const SearchPatternIndexPrivate::FieldIndex &field : std::as_const(d->mFields)) {
+        d->matchField(field, msg.get(), fired);
+    }
+    for (qsizetype i = 0; i < d->mEntries.size(); ++i) {
+        result.setBit(i, d->resolve(d->mEntries.at(i), fired, item, ignoreBody));
+    }
+    return result;
+}
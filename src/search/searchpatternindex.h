@@ -0,0 +1,82 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_export.h"
+
+#include <QBitArray>
+#include <QList>
+
+#include <memory>
+
+namespace Akonadi
+{
+class Item;
+}
+
+namespace MailCommon
+{
+class SearchPattern;
+
+/*!
+ * \class MailCommon::SearchPatternIndex
+ * \inmodule MailCommon
+ * \inheaderfile MailCommon/SearchPatternIndex
+ *
+ * \brief Matches a whole set of search patterns against a message at once.
+ *
+ * When many filters are applied to a message, their "contains", "starts
+ * with" and "equals" rules on the same header field all scan the same
+ * string. The index groups these rules by header field and runs a single
+ * multi-pattern (Aho-Corasick) automaton per field and message, plus a
+ * hash lookup for the "equals" rules. The patterns are then resolved from
+ * the rules that fired; only the remaining rules are evaluated one by one.
+ *
+ * The patterns must outlive the index and must not be modified while it
+ * is in use; call setPatterns() again after changing them.
+ */
+class MAILCOMMON_EXPORT SearchPatternIndex
+{
+public:
+    /*!
+     * Creates an empty index.
+     */
+    SearchPatternIndex();
+
+    /*!
+     * Destroys the index.
+     */
+    ~SearchPatternIndex();
+
+    /*!
+     * Builds the index for the given \a patterns.
+     */
+    void setPatterns(const QList<const SearchPattern *> &patterns);
+
+    /*!
+     * Returns the indexed patterns.
+     */
+    [[nodiscard]] QList<const SearchPattern *> patterns() const;
+
+    /*!
+     * Returns the number of rules evaluated through the per-field automatons.
+     */
+    [[nodiscard]] int indexedRuleCount() const;
+
+    /*!
+     * Matches all patterns against the given \a item. Bit \c i of the result
+     * is set if the pattern at position \c i matches, with the same result
+     * as SearchPattern::matches(\a item, \a ignoreBody).
+     */
+    [[nodiscard]] QBitArray matches(const Akonadi::Item &item, bool ignoreBody = false) const;
+
+private:
+    Q_DISABLE_COPY(SearchPatternIndex)
+    class SearchPatternIndexPrivate;
+    std::unique_ptr<SearchPatternIndexPrivate> const d;
+};
+}
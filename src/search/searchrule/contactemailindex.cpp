@@ -0,0 +1,351 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "contactemailindex.h"
+#include "mailcommon_debug.h"
+
+#include <Akonadi/CollectionFetchJob>
+#include <Akonadi/CollectionFetchScope>
+#include <Akonadi/ContactSearchJob>
+#include <Akonadi/ItemFetchJob>
+#include <Akonadi/ItemFetchScope>
+#include <Akonadi/Monitor>
+
+#include <KContacts/Addressee>
+
+#include <QCoreApplication>
+#include <QHash>
+#include <QMutex>
+#include <QQueue>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+
+using namespace MailCommon;
+
+class Q_DECL_HIDDEN ContactEmailIndex::ContactEmailIndexPrivate
+{
+public:
+    struct ContactData {
+        Akonadi::Collection::Id collectionId = -1;
+        QStringList emails;
+        QStringList categories;
+    };
+
+    void removeContactLocked(Akonadi::Item::Id id);
+    void rememberUnknownLocked(const QString &email);
+    bool searchContacts(const QString &email, ContactEmailIndex *q);
+
+    QMutex mMutex;
+    // lowercased email -> ids of the contacts using it
+    QHash<QString, QList<Akonadi::Item::Id>> mEmailContacts;
+    QHash<Akonadi::Item::Id, ContactData> mContacts;
+    QSet<QString> mUnknownEmails;
+    QQueue<QString> mUnknownEmailsOrder;
+    Akonadi::Monitor *mMonitor = nullptr;
+    QString mLoadError;
+    int mPendingFetchJobs = 0;
+    int mLoadAttempts = 0;
+    bool mLoaded = false;
+};
+
+class ContactEmailIndexInstance
+{
+public:
+    ContactEmailIndexInstance()
+        : index(new ContactEmailIndex)
+    {
+        // The index owns an Akonadi::Monitor and jobs, which live in the thread creating them
+        Q_ASSERT_X(!QCoreApplication::instance() || QThread::currentThread() == QCoreApplication::instance()->thread(),
+                   "ContactEmailIndex::self()",
+                   "the global contact index must be created in the main thread");
+        index->start();
+    }
+
+    ~ContactEmailIndexInstance()
+    {
+        delete index;
+    }
+
+    ContactEmailIndex *const index;
+};
+
+Q_GLOBAL_STATIC(ContactEmailIndexInstance, sInstance)
+
+void ContactEmailIndex::ContactEmailIndexPrivate::removeContactLocked(Akonadi::Item::Id id)
+{
+    const auto it = mContacts.constFind(id);
+    if (it == mContacts.constEnd()) {
+        return;
+    }
+    for (const QString &email : std::as_const(it->emails)) {
+        auto emailIt = mEmailContacts.find(email);
+        if (emailIt != mEmailContacts.end()) {
+            emailIt->removeAll(id);
+            if (emailIt->isEmpty()) {
+                mEmailContacts.erase(emailIt);
+            }
+        }
+    }
+    mContacts.erase(it);
+}
+
+void ContactEmailIndex::ContactEmailIndexPrivate::rememberUnknownLocked(const QString &email)
+{
+    if (mUnknownEmails.contains(email)) {
+        return;
+    }
+    mUnknownEmails.insert(email);
+    mUnknownEmailsOrder.enqueue(email);
+    while (mUnknownEmailsOrder.size() > ContactEmailIndex::negativeCacheSize()) {
+        mUnknownEmails.remove(mUnknownEmailsOrder.dequeue());
+    }
+}
+
+bool ContactEmailIndex::ContactEmailIndexPrivate::searchContacts(const QString &email, ContactEmailIndex *q)
+{
+    {
+        QMutexLocker locker(&mMutex);
+        if (mEmailContacts.contains(email)) {
+            return true;
+        }
+        if (mLoaded || mUnknownEmails.contains(email)) {
+            return false;
+        }
+    }
+
+    // Not loaded yet, or loading failed: this is the search the rules used
+    // before the index existed. It is synchronous and needs the main thread,
+    // FilterCollectionsJob only evaluates rules in other threads once loaded.
+    Q_ASSERT(!QCoreApplication::instance() || QThread::currentThread() == QCoreApplication::instance()->thread());
+    auto job = new Akonadi::ContactSearchJob();
+    job->setQuery(Akonadi::ContactSearchJob::Email, email);
+    job->exec();
+    const Akonadi::Item::List items = job->items();
+    for (const Akonadi::Item &item : items) {
+        q->insertContact(item);
+    }
+
+    QMutexLocker locker(&mMutex);
+    if (mEmailContacts.contains(email)) {
+        return true;
+    }
+    rememberUnknownLocked(email);
+    return false;
+}
+
+ContactEmailIndex::ContactEmailIndex(QObject *parent)
+    : QObject(parent)
+    , d(new ContactEmailIndexPrivate)
+{
+}
+
+ContactEmailIndex::~ContactEmailIndex() = default;
+
+ContactEmailIndex *ContactEmailIndex::self()
+{
+    return sInstance->index;
+}
+
+int ContactEmailIndex::negativeCacheSize()
+{
+    return 1024;
+}
+
+int ContactEmailIndex::maximumLoadAttempts()
+{
+    return 3;
+}
+
+void ContactEmailIndex::start()
+{
+    if (d->mMonitor) {
+        return;
+    }
+    d->mMonitor = new Akonadi::Monitor(this);
+    d->mMonitor->setObjectName(QLatin1StringView("ContactEmailIndexMonitor"));
+    d->mMonitor->setMimeTypeMonitored(KContacts::Addressee::mimeType());
+    d->mMonitor->itemFetchScope().fetchFullPayload();
+    connect(d->mMonitor, &Akonadi::Monitor::itemAdded, this, [this](const Akonadi::Item &item) {
+        insertContact(item);
+    });
+    connect(d->mMonitor, &Akonadi::Monitor::itemChanged, this, [this](const Akonadi::Item &item) {
+        insertContact(item);
+    });
+    connect(d->mMonitor, &Akonadi::Monitor::itemRemoved, this, [this](const Akonadi::Item &item) {
+        removeContact(item.id());
+    });
+    connect(d->mMonitor, &Akonadi::Monitor::collectionRemoved, this, &ContactEmailIndex::slotCollectionRemoved);
+    load();
+}
+
+void ContactEmailIndex::load()
+{
+    d->mLoadError.clear();
+    auto job = new Akonadi::CollectionFetchJob(Akonadi::Collection::root(), Akonadi::CollectionFetchJob::Recursive, this);
+    job->fetchScope().setContentMimeTypes({KContacts::Addressee::mimeType()});
+    connect(job, &Akonadi::CollectionFetchJob::result, this, &ContactEmailIndex::slotCollectionsFetched);
+}
+
+void ContactEmailIndex::slotCollectionsFetched(KJob *job)
+{
+    if (job->error()) {
+        qCWarning(MAILCOMMON_LOG) << "Unable to fetch contact collections:" << job->errorString();
+        loadFailed(job->errorString());
+        return;
+    }
+    const Akonadi::Collection::List collections = static_cast<Akonadi::CollectionFetchJob *>(job)->collections();
+    for (const Akonadi::Collection &collection : collections) {
+        if (!collection.contentMimeTypes().contains(KContacts::Addressee::mimeType())) {
+            continue;
+        }
+        auto fetchJob = new Akonadi::ItemFetchJob(collection, this);
+        fetchJob->fetchScope().fetchFullPayload();
+        connect(fetchJob, &Akonadi::ItemFetchJob::result, this, &ContactEmailIndex::slotItemsFetched);
+        ++d->mPendingFetchJobs;
+    }
+    if (d->mPendingFetchJobs == 0) {
+        setLoaded(true);
+    }
+}
+
+void ContactEmailIndex::slotItemsFetched(KJob *job)
+{
+    --d->mPendingFetchJobs;
+    if (job->error()) {
+        qCWarning(MAILCOMMON_LOG) << "Unable to fetch contacts:" << job->errorString();
+        d->mLoadError = job->errorString();
+    } else {
+        const Akonadi::Item::List items = static_cast<Akonadi::ItemFetchJob *>(job)->items();
+        for (const Akonadi::Item &item : items) {
+            insertContact(item);
+        }
+    }
+    if (d->mPendingFetchJobs == 0) {
+        // A miss is only authoritative once every address book is indexed
+        if (d->mLoadError.isEmpty()) {
+            setLoaded(true);
+        } else {
+            loadFailed(d->mLoadError);
+        }
+    }
+}
+
+void ContactEmailIndex::loadFailed(const QString &errorString)
+{
+    ++d->mLoadAttempts;
+    if (d->mLoadAttempts < maximumLoadAttempts()) {
+        QTimer::singleShot(d->mLoadAttempts * 30 * 1000, this, &ContactEmailIndex::load);
+        return;
+    }
+    qCWarning(MAILCOMMON_LOG) << "Unable to load the contact index, addressbook lookups keep using a contact search:" << errorString;
+    Q_EMIT loadingFailed(errorString);
+}
+
+void ContactEmailIndex::slotCollectionRemoved(const Akonadi::Collection &collection)
+{
+    QMutexLocker locker(&d->mMutex);
+    QList<Akonadi::Item::Id> ids;
+    for (auto it = d->mContacts.cbegin(), end = d->mContacts.cend(); it != end; ++it) {
+        if (it->collectionId == collection.id()) {
+            ids.append(it.key());
+        }
+    }
+    for (const Akonadi::Item::Id id : std::as_const(ids)) {
+        d->removeContactLocked(id);
+    }
+}
+
+bool ContactEmailIndex::isLoaded() const
+{
+    QMutexLocker locker(&d->mMutex);
+    return d->mLoaded;
+}
+
+void ContactEmailIndex::setLoaded(bool loaded)
+{
+    {
+        QMutexLocker locker(&d->mMutex);
+        if (d->mLoaded == loaded) {
+            return;
+        }
+        d->mLoaded = loaded;
+        if (loaded) {
+            // Everything is indexed now, a miss is an authoritative answer.
+            d->mUnknownEmails.clear();
+            d->mUnknownEmailsOrder.clear();
+        }
+    }
+    if (loaded) {
+        Q_EMIT this->loaded();
+    }
+}
+
+bool ContactEmailIndex::contains(const QString &email)
+{
+    return d->searchContacts(email, this);
+}
+
+bool ContactEmailIndex::hasCategory(const QString &email, const QString &category)
+{
+    if (!d->searchContacts(email, this)) {
+        return false;
+    }
+    QMutexLocker locker(&d->mMutex);
+    const QList<Akonadi::Item::Id> ids = d->mEmailContacts.value(email);
+    for (const Akonadi::Item::Id id : ids) {
+        if (d->mContacts.value(id).categories.contains(category)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ContactEmailIndex::insertContact(const Akonadi::Item &item)
+{
+    if (!item.hasPayload<KContacts::Addressee>()) {
+        return;
+    }
+    const auto contact = item.payload<KContacts::Addressee>();
+
+    ContactEmailIndexPrivate::ContactData data;
+    data.collectionId = item.parentCollection().id();
+    data.categories = contact.categories();
+    const QStringList emails = contact.emails();
+    for (const QString &email : emails) {
+        const QString lowerEmail = email.trimmed().toLower();
+        if (!lowerEmail.isEmpty() && !data.emails.contains(lowerEmail)) {
+            data.emails.append(lowerEmail);
+        }
+    }
+
+    QMutexLocker locker(&d->mMutex);
+    d->removeContactLocked(item.id());
+    for (const QString &email : std::as_const(data.emails)) {
+        d->mEmailContacts[email].append(item.id());
+        if (d->mUnknownEmails.remove(email)) {
+            d->mUnknownEmailsOrder.removeOne(email);
+        }
+    }
+    d->mContacts.insert(item.id(), data);
+}
+
+void ContactEmailIndex::removeContact(Akonadi::Item::Id id)
+{
+    QMutexLocker locker(&d->mMutex);
+    d->removeContactLocked(id);
+}
+
+void ContactEmailIndex::clear()
+{
+    QMutexLocker locker(&d->mMutex);
+    d->mEmailContacts.clear();
+    d->mContacts.clear();
+    d->mUnknownEmails.clear();
+    d->mUnknownEmailsOrder.clear();
+}
+
+#include "moc_contactemailindex.cpp"
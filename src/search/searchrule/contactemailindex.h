@@ -0,0 +1,122 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+
+#include <Akonadi/Collection>
+#include <Akonadi/Item>
+
+#include <QObject>
+
+#include <memory>
+
+class KJob;
+
+namespace MailCommon
+{
+/**
+ * @short An in-process index of the email addresses found in the address books.
+ *
+ * It maps every (lowercased) email address of every contact to the categories
+ * of the contacts using it, so that the "is in addressbook" and "is in category"
+ * search rules do not need to run a ContactSearchJob per address and message.
+ *
+ * The index is filled once from all contact collections and kept up to date
+ * through an Akonadi::Monitor. Until it is loaded, lookups keep using the
+ * synchronous contact search the rules ran before, in the main thread only.
+ * Its results are remembered, unknown addresses being kept in a bounded
+ * negative cache. Loading is retried a few times when it fails, then
+ * loadingFailed() is emitted and lookups keep using the contact search.
+ */
+class MAILCOMMON_TESTS_EXPORT ContactEmailIndex : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * Creates an empty index. Call start() to load it from Akonadi.
+     */
+    explicit ContactEmailIndex(QObject *parent = nullptr);
+    ~ContactEmailIndex() override;
+
+    /**
+     * Returns the global index, which is started on first use. It must be
+     * first used in the main thread.
+     */
+    static ContactEmailIndex *self();
+
+    /**
+     * Fetches all contacts and starts monitoring the contact collections.
+     */
+    void start();
+
+    /**
+     * Returns whether all contacts have been indexed.
+     */
+    [[nodiscard]] bool isLoaded() const;
+
+    /**
+     * Marks the index as complete (or not). Once loaded, an unknown address
+     * is known not to be in any address book.
+     */
+    void setLoaded(bool loaded);
+
+    /**
+     * Returns whether a contact uses the given @p email address.
+     */
+    [[nodiscard]] bool contains(const QString &email);
+
+    /**
+     * Returns whether a contact using the given @p email address has the
+     * given @p category.
+     */
+    [[nodiscard]] bool hasCategory(const QString &email, const QString &category);
+
+    /**
+     * Adds or updates the contact stored in @p item.
+     */
+    void insertContact(const Akonadi::Item &item);
+
+    /**
+     * Removes the contact with the given item @p id.
+     */
+    void removeContact(Akonadi::Item::Id id);
+
+    /**
+     * Removes all contacts and cached lookups.
+     */
+    void clear();
+
+    /**
+     * Returns the maximum number of unknown addresses remembered while the
+     * index is not loaded.
+     */
+    [[nodiscard]] static int negativeCacheSize();
+
+    /**
+     * Returns how many times loading the contacts is tried before giving up.
+     */
+    [[nodiscard]] static int maximumLoadAttempts();
+
+Q_SIGNALS:
+    void loaded();
+    /**
+     * Emitted when the contacts could not be loaded after maximumLoadAttempts().
+     */
+    void loadingFailed(const QString &errorString);
+
+private:
+    MAILCOMMON_NO_EXPORT void load();
+    MAILCOMMON_NO_EXPORT void loadFailed(const QString &errorString);
+    MAILCOMMON_NO_EXPORT void slotCollectionsFetched(KJob *job);
+    MAILCOMMON_NO_EXPORT void slotItemsFetched(KJob *job);
+    MAILCOMMON_NO_EXPORT void slotCollectionRemoved(const Akonadi::Collection &collection);
+
+    class ContactEmailIndexPrivate;
+    std::unique_ptr<ContactEmailIndexPrivate> const d;
+};
+}
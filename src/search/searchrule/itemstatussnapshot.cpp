@@ -0,0 +1,67 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "itemstatussnapshot.h"
+
+using namespace MailCommon;
+
+namespace
+{
+thread_local ItemStatusSnapshot *currentSnapshot = nullptr;
+}
+
+ItemStatusSnapshot::ItemStatusSnapshot(const Akonadi::Item &item)
+    : mItem(item)
+    , mPrevious(currentSnapshot)
+{
+    currentSnapshot = this;
+}
+
+ItemStatusSnapshot::~ItemStatusSnapshot()
+{
+    Q_ASSERT(currentSnapshot == this);
+    currentSnapshot = mPrevious;
+}
+
+Akonadi::MessageStatus ItemStatusSnapshot::status() const
+{
+    if (!mDecoded) {
+        mStatus.setStatusFromFlags(mItem.flags());
+        mDecoded = true;
+    }
+    return mStatus;
+}
+
+void ItemStatusSnapshot::invalidate()
+{
+    mDecoded = false;
+}
+
+const ItemStatusSnapshot *ItemStatusSnapshot::find(const Akonadi::Item &item)
+{
+    // Snapshots are nested scopes, only a few of them are ever alive
+    for (const ItemStatusSnapshot *snapshot = currentSnapshot; snapshot; snapshot = snapshot->mPrevious) {
+        if (&snapshot->mItem == &item) {
+            return snapshot;
+        }
+    }
+    return nullptr;
+}
+
+Akonadi::MessageStatus ItemStatusSnapshot::statusOf(const Akonadi::Item &item)
+{
+    if (const ItemStatusSnapshot *snapshot = find(item)) {
+        return snapshot->status();
+    }
+    Akonadi::MessageStatus status;
+    status.setStatusFromFlags(item.flags());
+    return status;
+}
+
+bool ItemStatusSnapshot::hasSnapshot(const Akonadi::Item &item)
+{
+    return find(item);
+}
@@ -0,0 +1,66 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+
+#include <Akonadi/Item>
+#include <Akonadi/MessageStatus>
+
+namespace MailCommon
+{
+/**
+ * @short The message status of an item, decoded from its flags once.
+ *
+ * While a snapshot is alive, statusOf() returns its status for the very
+ * same item object instead of decoding the flags again, so that all the
+ * status, attachment and invitation rules evaluated on an item, by one
+ * pattern or by all the filters applied to it, share a single decoding.
+ *
+ * Snapshots are scoped objects, tracked per thread. Call invalidate()
+ * after changing the flags of the item.
+ */
+class MAILCOMMON_TESTS_EXPORT ItemStatusSnapshot
+{
+public:
+    /**
+     * Makes @p item use this snapshot until it is destroyed. The status is
+     * decoded on first use.
+     */
+    explicit ItemStatusSnapshot(const Akonadi::Item &item);
+    ~ItemStatusSnapshot();
+
+    /**
+     * Returns the status of the item.
+     */
+    [[nodiscard]] Akonadi::MessageStatus status() const;
+
+    /**
+     * Decodes the status again on next use.
+     */
+    void invalidate();
+
+    /**
+     * Returns the status of @p item, from a live snapshot of it if any.
+     */
+    [[nodiscard]] static Akonadi::MessageStatus statusOf(const Akonadi::Item &item);
+
+    /**
+     * Returns whether a snapshot of @p item is alive in this thread.
+     */
+    [[nodiscard]] static bool hasSnapshot(const Akonadi::Item &item);
+
+private:
+    Q_DISABLE_COPY(ItemStatusSnapshot)
+    [[nodiscard]] static const ItemStatusSnapshot *find(const Akonadi::Item &item);
+
+    const Akonadi::Item &mItem;
+    ItemStatusSnapshot *const mPrevious;
+    mutable Akonadi::MessageStatus mStatus;
+    mutable bool mDecoded = false;
+};
+}
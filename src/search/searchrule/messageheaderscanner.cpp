@@ -0,0 +1,138 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "messageheaderscanner.h"
+
+#include <KMime/HeaderParsing>
+#include <KMime/Headers>
+#include <KMime/Message>
+
+using namespace MailCommon;
+
+MessageHeaderScanner::MessageHeaderScanner(const QByteArray &head)
+{
+    setHead(head);
+}
+
+void MessageHeaderScanner::setHead(const QByteArray &head)
+{
+    mHead = head;
+    mFields.clear();
+
+    const char *data = mHead.constData();
+    const qsizetype size = mHead.size();
+    qsizetype pos = 0;
+    while (pos < size) {
+        qsizetype lineEnd = mHead.indexOf('\n', pos);
+        if (lineEnd < 0) {
+            lineEnd = size;
+        }
+        // An empty line ends the header block
+        if (lineEnd == pos || (lineEnd == pos + 1 && data[pos] == '\r')) {
+            break;
+        }
+        if (data[pos] == ' ' || data[pos] == '\t') {
+            // folded line: continuation of the previous field
+            if (!mFields.isEmpty()) {
+                mFields.last().valueEnd = lineEnd;
+            }
+        } else {
+            const qsizetype colon = mHead.indexOf(':', pos);
+            if (colon > pos && colon < lineEnd) {
+                Field field;
+                field.nameStart = pos;
+                field.nameLength = colon - pos;
+                field.valueStart = colon + 1;
+                field.valueEnd = lineEnd;
+                mFields.append(field);
+            }
+        }
+        pos = lineEnd + 1;
+    }
+}
+
+QByteArray MessageHeaderScanner::head() const
+{
+    return mHead;
+}
+
+int MessageHeaderScanner::fieldCount() const
+{
+    return mFields.count();
+}
+
+const MessageHeaderScanner::Field *MessageHeaderScanner::findField(QByteArrayView name) const
+{
+    const char *data = mHead.constData();
+    for (const Field &field : mFields) {
+        if (field.nameLength == name.size() && QByteArrayView(data + field.nameStart, field.nameLength).compare(name, Qt::CaseInsensitive) == 0) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+bool MessageHeaderScanner::hasHeader(QByteArrayView name) const
+{
+    return findField(name) != nullptr;
+}
+
+QByteArray MessageHeaderScanner::rawValue(QByteArrayView name) const
+{
+    const Field *field = findField(name);
+    if (!field) {
+        return {};
+    }
+    QByteArray value;
+    value.reserve(field->valueEnd - field->valueStart);
+    const char *data = mHead.constData();
+    for (qsizetype i = field->valueStart; i < field->valueEnd; ++i) {
+        if (data[i] != '\r' && data[i] != '\n') {
+            value.append(data[i]);
+        }
+    }
+    return value.trimmed();
+}
+
+QString MessageHeaderScanner::value(QByteArrayView name) const
+{
+    const QByteArray raw = rawValue(name);
+    if (raw.isEmpty()) {
+        return {};
+    }
+    // Decode as KMime does for a parsed message, unencoded 8-bit values
+    // then use the same fallback charset
+    KMime::Headers::Generic header(name.toByteArray().constData());
+    header.from7BitString(raw);
+    return header.asUnicodeString();
+}
+
+const MessageHeaderScanner &MessageHeaderScanner::forHead(const QByteArray &head)
+{
+    // Keeping a copy of the head keeps its data alive, so comparing data
+    // pointers cannot confuse two different header blocks.
+    thread_local MessageHeaderScanner scanner;
+    if (scanner.mHead.constData() != head.constData() || scanner.mHead.size() != head.size()) {
+        scanner.setHead(head);
+    }
+    return scanner;
+}
+
+QDateTime MessageHeaderScanner::dateOf(KMime::Message *message)
+{
+    const QByteArray head = message->head();
+    if (!head.isEmpty()) {
+        const QByteArray raw = forHead(head).rawValue("Date");
+        if (!raw.isEmpty()) {
+            const char *cursor = raw.constData();
+            QDateTime dateTime;
+            if (KMime::HeaderParsing::parseDateTime(cursor, raw.constData() + raw.size(), dateTime)) {
+                return dateTime;
+            }
+        }
+    }
+    return message->date()->dateTime();
+}
@@ -0,0 +1,100 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QDateTime>
+#include <QList>
+#include <QString>
+
+namespace KMime
+{
+class Message;
+}
+
+namespace MailCommon
+{
+/**
+ * @short A lightweight scanner over the raw header block of a message.
+ *
+ * It locates the name and value of every header field once, without
+ * building a MIME tree, and then serves lookups by header name. This is
+ * all the Header level search rules need, so messages with large bodies
+ * do not have to be parsed completely to evaluate them.
+ */
+class MAILCOMMON_TESTS_EXPORT MessageHeaderScanner
+{
+public:
+    /**
+     * Creates a scanner for the given raw header block @p head.
+     */
+    explicit MessageHeaderScanner(const QByteArray &head = QByteArray());
+
+    /**
+     * Scans a new raw header block.
+     */
+    void setHead(const QByteArray &head);
+
+    /**
+     * Returns the scanned raw header block.
+     */
+    [[nodiscard]] QByteArray head() const;
+
+    /**
+     * Returns the number of header fields found.
+     */
+    [[nodiscard]] int fieldCount() const;
+
+    /**
+     * Returns whether a header field called @p name (case insensitive) exists.
+     */
+    [[nodiscard]] bool hasHeader(QByteArrayView name) const;
+
+    /**
+     * Returns the unfolded raw value of the first header field called @p name.
+     */
+    [[nodiscard]] QByteArray rawValue(QByteArrayView name) const;
+
+    /**
+     * Returns the unfolded and RFC 2047 decoded value of the first header
+     * field called @p name, or an empty string if there is none. It is
+     * decoded like KMime decodes the header of a parsed message.
+     */
+    [[nodiscard]] QString value(QByteArrayView name) const;
+
+    /**
+     * Returns a scanner for @p head, reusing the one of the previous call
+     * in the same thread when it was made for the same header block. All
+     * the rules of a pattern, and all the filters applied to a message,
+     * thus share one scan.
+     */
+    [[nodiscard]] static const MessageHeaderScanner &forHead(const QByteArray &head);
+
+    /**
+     * Returns the date of @p message. The raw Date header is parsed
+     * directly when the message still has its header block, otherwise
+     * (or when it cannot be parsed) KMime's Date header is used.
+     */
+    [[nodiscard]] static QDateTime dateOf(KMime::Message *message);
+
+private:
+    struct Field {
+        qsizetype nameStart = 0;
+        qsizetype nameLength = 0;
+        qsizetype valueStart = 0;
+        qsizetype valueEnd = 0;
+    };
+
+    [[nodiscard]] const Field *findField(QByteArrayView name) const;
+
+    QByteArray mHead;
+    QList<Field> mFields;
+};
+}
@@ -72,6 +72,7 @@ const SearchRule &SearchRule::operator=(const SearchRule &other)
     mField = other.mField;
     mFunction = other.mFunction;
     mContents = other.mContents;
+    mCompiled = false;
 
     return *this;
 }
@@ -500,6 +501,7 @@ void SearchRule::generateSieveScript(QStringList &requireModules, QString &code)
 void SearchRule::setFunction(Function function)
 {
     mFunction = function;
+    mCompiled = false;
 }
 
 SearchRule::Function SearchRule::function() const
@@ -510,6 +512,7 @@ SearchRule::Function SearchRule::function() const
 void SearchRule::setField(const QByteArray &field)
 {
     mField = field;
+    mCompiled = false;
 }
 
 QByteArray SearchRule::field() const
@@ -520,6 +523,7 @@ QByteArray SearchRule::field() const
 void SearchRule::setContents(const QString &contents)
 {
     mContents = contents;
+    mCompiled = false;
 }
 
 QString SearchRule::contents() const
@@ -527,11 +531,70 @@ QString SearchRule::contents() const
     return mContents;
 }
 
+int SearchRule::cost() const
+{
+    int cost = 10;
+    switch (requiredPart()) {
+    case Envelope:
+        cost = 10;
+        break;
+    case Header:
+        cost = 20;
+        break;
+    case CompleteMessage:
+        cost = 200;
+        break;
+    }
+
+    switch (mFunction) {
+    case FuncRegExp:
+    case FuncNotRegExp:
+        cost *= 3;
+        break;
+    case FuncIsInAddressbook:
+    case FuncIsNotInAddressbook:
+    case FuncIsInCategory:
+    case FuncIsNotInCategory:
+        cost += 100;
+        break;
+    case FuncHasAttachment:
+    case FuncHasNoAttachment:
+        cost += 200;
+        break;
+    default:
+        break;
+    }
+    return cost;
+}
+
+void SearchRule::compile() const
+{
+    if (mCompiled) {
+        return;
+    }
+    compileInternal();
+    mCompiled = true;
+}
+
+bool SearchRule::isCompiled() const
+{
+    return mCompiled;
+}
+
+void SearchRule::compileInternal() const
+{
+}
+
 const QString SearchRule::asString() const
 {
-    QString result = QLatin1StringView("\"") + QString::fromLatin1(mField) + QLatin1StringView("\" <");
-    result += functionToString(mFunction);
-    result += QLatin1StringView("> \"") + mContents + QLatin1StringView("\"");
+    return asString(mField, mFunction, mContents);
+}
+
+QString SearchRule::asString(const QByteArray &field, Function function, const QString &contents)
+{
+    QString result = QLatin1StringView("\"") + QString::fromLatin1(field) + QLatin1StringView("\" <");
+    result += functionToString(function);
+    result += QLatin1StringView("> \"") + contents + QLatin1StringView("\"");
 
     return result;
 }
@@ -600,10 +663,7 @@ bool SearchRule::isNegated() const
 void SearchRule::maybeLogMatchResult(bool result) const
 {
     if (FilterLog::instance()->isLogging()) {
-        // TODO change with locale?
-        QString msg = QStringLiteral("<font color=#%1 = </font>%2 ( <i>%3</i> )")
-                          .arg((result ? QStringLiteral("00FF00>1") : QStringLiteral("FF0000>0")), FilterLog::recode(asString()), contents());
-        FilterLog::instance()->add(msg, FilterLog::RuleResult);
+        FilterLog::instance()->addRuleResult(*this, result, contents());
     }
 }
 
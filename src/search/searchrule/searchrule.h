@@ -172,10 +172,23 @@ ote This function does no validation of the data obtained
      * Returns the required part from the item that is needed for the search to
      * operate. See \sa RequiredPart
      *
+     * Subclasses may derive it from the compiled state, and then compile the
+     * rule on first use like matches() does, see compile().
+     *
      * \return The required part for this rule
      */
     virtual SearchRule::RequiredPart requiredPart() const = 0;
 
+    /*!
+     * Returns an estimate of the relative cost of matching the rule against
+     * one message. SearchPattern evaluates cheap rules first.
+     *
+     * The default implementation derives it from requiredPart() and function().
+     *
+     * \return The estimated cost of the rule
+     */
+    [[nodiscard]] virtual int cost() const;
+
     /*!
      * Saves the object into a given config \a group.
      *
@@ -253,6 +266,28 @@ ote This function does no validation of the data obtained
      */
     [[nodiscard]] QString contents() const;
 
+    /*!
+     * Precomputes the data needed by matches() from the field, function
+     * and contents of the rule, so that it is not redone for every message.
+     *
+     * matches(), requiredPart() and cost() call it lazily, so although they
+     * are const they may write the compiled state. Changing the field, the
+     * function or the contents invalidates the compiled state.
+     *
+     * \note Not thread-safe: call compile() after the last change of the rule
+     * and before sharing it between threads; the const methods are then safe
+     * to call concurrently.
+     */
+    void compile() const;
+
+    /*!
+     * Returns whether the rule is compiled for its current field,
+     * function and contents.
+     *
+     * \return True if the rule is compiled, false otherwise
+     */
+    [[nodiscard]] bool isCompiled() const;
+
     /*!
      * Returns the rule as string for debugging purpose
      *
@@ -260,6 +295,12 @@ ote This function does no validation of the data obtained
      */
     [[nodiscard]] const QString asString() const;
 
+    /*!
+     * Returns the string representation of a rule with the given \a field,
+     * \a function and \a contents, as returned by asString().
+     */
+    [[nodiscard]] static QString asString(const QByteArray &field, Function function, const QString &contents);
+
     /*!
      * Adds query terms to the given term group.
      *
@@ -308,6 +349,12 @@ protected:
      */
     void maybeLogMatchResult(bool result) const;
 
+    /*!
+     * Reimplement to precompute the subclass specific matching data.
+     * Called by compile(). The default implementation does nothing.
+     */
+    virtual void compileInternal() const;
+
 private:
     MAILCOMMON_NO_EXPORT static Function configValueToFunc(const char *);
     MAILCOMMON_NO_EXPORT static QString functionToString(Function);
@@ -316,5 +363,6 @@ private:
     QByteArray mField;
     Function mFunction;
     QString mContents;
+    mutable bool mCompiled = false;
 };
 }
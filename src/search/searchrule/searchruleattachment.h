@@ -19,6 +19,7 @@ public:
     [[nodiscard]] bool isEmpty() const override;
     [[nodiscard]] bool matches(const Akonadi::Item &item) const override;
     [[nodiscard]] SearchRule::RequiredPart requiredPart() const override;
+    [[nodiscard]] int cost() const override;
     void addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const override;
 };
 }
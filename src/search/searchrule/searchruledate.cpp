@@ -5,6 +5,7 @@
 */
 
 #include "searchruledate.h"
+#include "messageheaderscanner.h"
 
 #include <KLocalizedString>
 #include <KMime/Message>
@@ -22,7 +23,13 @@ QString SearchRuleDate::informationAboutNotValidRules() const
 
 bool SearchRuleDate::isEmpty() const
 {
-    return !QDate::fromString(contents(), Qt::ISODate).isValid();
+    compile();
+    return !mDateValue.isValid();
+}
+
+void SearchRuleDate::compileInternal() const
+{
+    mDateValue = QDate::fromString(contents(), Qt::ISODate);
 }
 
 bool SearchRuleDate::matches(const Akonadi::Item &item) const
@@ -32,9 +39,9 @@ bool SearchRuleDate::matches(const Akonadi::Item &item) const
     }
     const auto msg = item.payload<std::shared_ptr<KMime::Message>>();
 
-    const QDate msgDate = msg->date()->dateTime().date();
-    const QDate dateValue = QDate::fromString(contents(), Qt::ISODate);
-    const bool rc = matchesInternal(dateValue, msgDate);
+    compile();
+    const QDate msgDate = MessageHeaderScanner::dateOf(msg.get()).date();
+    const bool rc = matchesInternal(mDateValue, msgDate);
 
     maybeLogMatchResult(rc);
     return rc;
@@ -71,13 +78,18 @@ SearchRule::RequiredPart SearchRuleDate::requiredPart() const
     return SearchRule::Envelope;
 }
 
+int SearchRuleDate::cost() const
+{
+    return 5;
+}
+
 void SearchRuleDate::addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const
 {
     using namespace Akonadi;
     emptyIsNotAnError = false;
 
-    const QDate date = QDate::fromString(contents(), Qt::ISODate);
-    EmailSearchTerm term(EmailSearchTerm::HeaderOnlyDate, date, akonadiComparator());
+    compile();
+    EmailSearchTerm term(EmailSearchTerm::HeaderOnlyDate, mDateValue, akonadiComparator());
     term.setIsNegated(isNegated());
     groupTerm.addSubTerm(term);
 }
@@ -36,6 +36,11 @@ public:
      */
     [[nodiscard]] RequiredPart requiredPart() const override;
 
+    /**
+     * @copydoc SearchRule::cost()
+     */
+    [[nodiscard]] int cost() const override;
+
     // Optimized matching not implemented, will use the unoptimized matching
     // from SearchRule
     using SearchRule::matches;
@@ -51,5 +56,15 @@ public:
      */
     void addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const override;
     [[nodiscard]] QString informationAboutNotValidRules() const override;
+
+protected:
+    /**
+     * @copydoc SearchRule::compileInternal()
+     */
+    void compileInternal() const override;
+
+private:
+    // Compiled from contents(), see compile()
+    mutable QDate mDateValue;
 };
 }
@@ -5,6 +5,7 @@
 */
 
 #include "searchruleinvitation.h"
+#include "itemstatussnapshot.h"
 #include <Akonadi/MessageStatus>
 #include <KMime/Message>
 
@@ -28,8 +29,7 @@ bool SearchRuleInvitation::matches(const Akonadi::Item &item) const
     if (!item.hasPayload<std::shared_ptr<KMime::Message>>()) {
         return false;
     }
-    Akonadi::MessageStatus status;
-    status.setStatusFromFlags(item.flags());
+    const Akonadi::MessageStatus status = ItemStatusSnapshot::statusOf(item);
     bool rc = false;
     switch (function()) {
     case FuncEquals:
@@ -51,6 +51,12 @@ SearchRule::RequiredPart SearchRuleInvitation::requiredPart() const
     return SearchRule::Envelope;
 }
 
+int SearchRuleInvitation::cost() const
+{
+    // Only the item flags are looked at
+    return 1;
+}
+
 void SearchRuleInvitation::addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const
 {
     using namespace Akonadi;
@@ -5,19 +5,36 @@
 */
 
 #include "searchrulenumerical.h"
+#include "messageheaderscanner.h"
 
 #include "filter/filterlog.h"
 using MailCommon::FilterLog;
 
 #include <KMime/Message>
 #include <QDateTime>
-
-#include <QRegularExpression>
-
-#include <algorithm>
+#include <QElapsedTimer>
 
 using namespace MailCommon;
 
+namespace
+{
+/*
+ * The current time, refreshed at most once per second. The age of every
+ * message of a filtering run is then computed against the same instant
+ * instead of querying the clock (and the time zone) for each message.
+ */
+QDateTime cachedCurrentDateTime()
+{
+    thread_local QDateTime now;
+    thread_local QElapsedTimer timer;
+    if (!timer.isValid() || timer.elapsed() >= 1000) {
+        now = QDateTime::currentDateTime();
+        timer.start();
+    }
+    return now;
+}
+}
+
 SearchRuleNumerical::SearchRuleNumerical(const QByteArray &field, Function func, const QString &contents)
     : SearchRule(field, func, contents)
 {
@@ -25,10 +42,34 @@ SearchRuleNumerical::SearchRuleNumerical(const QByteArray &field, Function func,
 
 bool SearchRuleNumerical::isEmpty() const
 {
+    compile();
+    return !mValueIsValid;
+}
+
+void SearchRuleNumerical::compileInternal() const
+{
+    const QByteArray f = field();
+    if (qstricmp(f.constData(), "<size>") == 0) {
+        mFieldKind = FieldKind::Size;
+    } else if (qstricmp(f.constData(), "<age in days>") == 0) {
+        mFieldKind = FieldKind::AgeInDays;
+    } else {
+        mFieldKind = FieldKind::Unknown;
+    }
+
     bool ok = false;
-    contents().toLongLong(&ok);
+    mValue = contents().toLongLong(&ok);
+    mValueIsValid = ok;
+    if (mFieldKind == FieldKind::AgeInDays) {
+        // the age has always been compared as an int
+        mValue = contents().toInt();
+    }
 
-    return !ok;
+    if (function() == FuncRegExp || function() == FuncNotRegExp) {
+        mRegExp = QRegularExpression(contents(), QRegularExpression::CaseInsensitiveOption);
+    } else {
+        mRegExp = QRegularExpression();
+    }
 }
 
 bool SearchRuleNumerical::matches(const Akonadi::Item &item) const
@@ -37,30 +78,36 @@ bool SearchRuleNumerical::matches(const Akonadi::Item &item) const
         return false;
     }
 
-    const auto msg = item.payload<std::shared_ptr<KMime::Message>>();
-
-    QString msgContents;
+    compile();
     qint64 numericalMsgContents = 0;
-    qint64 numericalValue = 0;
-
-    if (qstricmp(field().constData(), "<size>") == 0) {
+    switch (mFieldKind) {
+    case FieldKind::Size:
         numericalMsgContents = item.size();
-        numericalValue = contents().toLongLong();
-        msgContents.setNum(numericalMsgContents);
-    } else if (qstricmp(field().constData(), "<age in days>") == 0) {
-        QDateTime msgDateTime = msg->date()->dateTime();
-        numericalMsgContents = msgDateTime.daysTo(QDateTime::currentDateTime());
-        numericalValue = contents().toInt();
-        msgContents.setNum(numericalMsgContents);
-    } else {
+        break;
+    case FieldKind::AgeInDays: {
+        const auto msg = item.payload<std::shared_ptr<KMime::Message>>();
+        numericalMsgContents = MessageHeaderScanner::dateOf(msg.get()).daysTo(cachedCurrentDateTime());
+        break;
+    }
+    case FieldKind::Unknown:
         return false;
     }
-    const bool rc = matchesInternal(numericalValue, numericalMsgContents, msgContents);
+
+    // Only the textual functions need the value as a string
+    QString msgContents;
+    switch (function()) {
+    case FuncContains:
+    case FuncContainsNot:
+    case FuncRegExp:
+    case FuncNotRegExp:
+        msgContents.setNum(numericalMsgContents);
+        break;
+    default:
+        break;
+    }
+    const bool rc = matchesInternal(mValue, numericalMsgContents, msgContents);
     if (FilterLog::instance()->isLogging()) {
-        QString messageStr = (rc ? QStringLiteral("<font color=#00FF00>1 = </font>") : QStringLiteral("<font color=#FF0000>0 = </font>"));
-        messageStr += FilterLog::recode(asString());
-        messageStr += QLatin1StringView(" ( <i>") + QString::number(numericalMsgContents) + QLatin1StringView("</i> )");
-        FilterLog::instance()->add(messageStr, FilterLog::RuleResult);
+        FilterLog::instance()->addRuleResult(*this, rc, QString::number(numericalMsgContents));
     }
     return rc;
 }
@@ -70,6 +117,13 @@ SearchRule::RequiredPart SearchRuleNumerical::requiredPart() const
     return SearchRule::Envelope;
 }
 
+int SearchRuleNumerical::cost() const
+{
+    // <size> comes from the item, <age in days> needs the Date header
+    compile();
+    return mFieldKind == FieldKind::Size ? 2 : 5;
+}
+
 bool SearchRuleNumerical::matchesInternal(long numericalValue, long numericalMsgContents, const QString &msgContents) const
 {
     switch (function()) {
@@ -86,10 +140,12 @@ bool SearchRuleNumerical::matchesInternal(long numericalValue, long numericalMsg
         return !msgContents.contains(contents(), Qt::CaseInsensitive);
 
     case SearchRule::FuncRegExp:
-        return msgContents.contains(QRegularExpression(contents(), QRegularExpression::CaseInsensitiveOption));
+        compile();
+        return msgContents.contains(mRegExp);
 
     case SearchRule::FuncNotRegExp:
-        return !msgContents.contains(QRegularExpression(contents(), QRegularExpression::CaseInsensitiveOption));
+        compile();
+        return !msgContents.contains(mRegExp);
 
     case FuncIsGreater:
         return numericalMsgContents > numericalValue;
@@ -8,6 +8,7 @@
 #include "mailcommon_private_export.h"
 #include "searchpattern.h"
 #include <Akonadi/Item>
+#include <QRegularExpression>
 namespace MailCommon
 {
 /**
@@ -43,6 +44,11 @@ public:
      */
     [[nodiscard]] RequiredPart requiredPart() const override;
 
+    /**
+     * @copydoc SearchRule::cost()
+     */
+    [[nodiscard]] int cost() const override;
+
     // Optimized matching not implemented, will use the unoptimized matching
     // from SearchRule
     using SearchRule::matches;
@@ -58,5 +64,24 @@ public:
      */
     void addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const override;
     [[nodiscard]] QString informationAboutNotValidRules() const override;
+
+protected:
+    /**
+     * @copydoc SearchRule::compileInternal()
+     */
+    void compileInternal() const override;
+
+private:
+    enum class FieldKind {
+        Size,
+        AgeInDays,
+        Unknown,
+    };
+
+    // Compiled from field(), function() and contents(), see compile()
+    mutable FieldKind mFieldKind = FieldKind::Unknown;
+    mutable qint64 mValue = 0;
+    mutable bool mValueIsValid = false;
+    mutable QRegularExpression mRegExp;
 };
 }
@@ -6,6 +6,7 @@
 
 #include "searchrulestatus.h"
 #include "filter/filterlog.h"
+#include "itemstatussnapshot.h"
 #include <QVariant>
 using MailCommon::FilterLog;
 
@@ -79,8 +80,7 @@ bool SearchRuleStatus::isEmpty() const
 
 bool SearchRuleStatus::matches(const Akonadi::Item &item) const
 {
-    Akonadi::MessageStatus status;
-    status.setStatusFromFlags(item.flags());
+    const Akonadi::MessageStatus status = ItemStatusSnapshot::statusOf(item);
     bool rc = false;
     switch (function()) {
     case FuncEquals: // fallthrough. So that "<status> 'is' 'read'" works
@@ -101,9 +101,7 @@ bool SearchRuleStatus::matches(const Akonadi::Item &item) const
         break;
     }
     if (FilterLog::instance()->isLogging()) {
-        QString msg = (rc ? QStringLiteral("<font color=#00FF00>1 = </font>") : QStringLiteral("<font color=#FF0000>0 = </font>"));
-        msg += FilterLog::recode(asString());
-        FilterLog::instance()->add(msg, FilterLog::RuleResult);
+        FilterLog::instance()->addRuleResult(*this, rc);
     }
     return rc;
 }
@@ -113,6 +111,11 @@ SearchRule::RequiredPart SearchRuleStatus::requiredPart() const
     return SearchRule::Envelope;
 }
 
+int SearchRuleStatus::cost() const
+{
+    return 1;
+}
+
 void SearchRuleStatus::addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const
 {
     using namespace Akonadi;
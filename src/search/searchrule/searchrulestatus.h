@@ -63,6 +63,11 @@ public:
      */
     [[nodiscard]] RequiredPart requiredPart() const override;
 
+    /*!
+     * Returns the estimated cost of the rule, which only looks at the item flags.
+     */
+    [[nodiscard]] int cost() const override;
+
     /*!
      * Adds query terms to the given term group.
      *
@@ -5,12 +5,12 @@
 */
 
 #include "searchrulestring.h"
+#include "contactemailindex.h"
+#include "messageheaderscanner.h"
 
 #include "filter/filterlog.h"
 using MailCommon::FilterLog;
 
-#include <Akonadi/ContactSearchJob>
-
 #include <Akonadi/SearchQuery>
 
 #include <KMime/Message>
@@ -53,21 +53,67 @@ bool SearchRuleString::isEmpty() const
 }
 
 SearchRule::RequiredPart SearchRuleString::requiredPart() const
+{
+    // Writes the compiled state the first time, see SearchRule::compile()
+    compile();
+    return mRequiredPart;
+}
+
+void SearchRuleString::compileInternal() const
 {
     const QByteArray f = field();
-    SearchRule::RequiredPart part = Header;
+    mRequiredPart = Header;
     if (qstricmp(f.constData(), "<recipients>") == 0 || qstricmp(f.constData(), "<status>") == 0 || qstricmp(f.constData(), "<tag>") == 0
         || qstricmp(f.constData(), "subject") == 0 || qstricmp(f.constData(), "from") == 0 || qstricmp(f.constData(), "sender") == 0
         || qstricmp(f.constData(), "reply-to") == 0 || qstricmp(f.constData(), "to") == 0 || qstricmp(f.constData(), "cc") == 0
         || qstricmp(f.constData(), "bcc") == 0 || qstricmp(f.constData(), "in-reply-to") == 0 || qstricmp(f.constData(), "message-id") == 0
         || qstricmp(f.constData(), "references") == 0) {
         // these fields are directly provided by KMime::Message, no need to fetch the whole Header part
-        part = Envelope;
+        mRequiredPart = Envelope;
     } else if (qstricmp(f.constData(), "<message>") == 0 || qstricmp(f.constData(), "<body>") == 0) {
-        part = CompleteMessage;
+        mRequiredPart = CompleteMessage;
+    }
+
+    if (qstricmp(f.constData(), "<message>") == 0) {
+        mFieldKind = FieldKind::Message;
+    } else if (qstricmp(f.constData(), "<body>") == 0) {
+        mFieldKind = FieldKind::Body;
+    } else if (qstricmp(f.constData(), "<any header>") == 0) {
+        mFieldKind = FieldKind::AnyHeader;
+    } else if (qstricmp(f.constData(), "<recipients>") == 0) {
+        mFieldKind = FieldKind::Recipients;
+    } else if (qstricmp(f.constData(), "<tag>") == 0) {
+        mFieldKind = FieldKind::Tag;
+    } else {
+        mFieldKind = FieldKind::Header;
     }
+    mIsAddressField = (qstricmp(f.constData(), "to") == 0) || (qstricmp(f.constData(), "cc") == 0) || (qstricmp(f.constData(), "bcc") == 0)
+        || (qstricmp(f.constData(), "from") == 0) || (qstricmp(f.constData(), "reply-to") == 0);
 
-    return part;
+    mLowerContents.clear();
+    mContentsMatcher = QStringMatcher();
+    mRegExp = QRegularExpression();
+    switch (function()) {
+    case SearchRule::FuncEquals:
+    case SearchRule::FuncNotEqual:
+    case SearchRule::FuncIsGreater:
+    case SearchRule::FuncIsLessOrEqual:
+    case SearchRule::FuncIsLess:
+    case SearchRule::FuncIsGreaterOrEqual:
+        mLowerContents = contents().toLower();
+        break;
+    case SearchRule::FuncContains:
+    case SearchRule::FuncContainsNot:
+        mContentsMatcher = QStringMatcher(contents(), Qt::CaseInsensitive);
+        break;
+    case SearchRule::FuncRegExp:
+    case SearchRule::FuncNotRegExp:
+        mRegExp = QRegularExpression(contents(), QRegularExpression::CaseInsensitiveOption);
+        mRegExp.optimize();
+        break;
+    default:
+        break;
+    }
 }
 
 bool SearchRuleString::matches(const Akonadi::Item &item) const
@@ -78,29 +124,44 @@ bool SearchRuleString::matches(const Akonadi::Item &item) const
     if (!item.hasPayload<std::shared_ptr<KMime::Message>>()) {
         return false;
     }
+    compile();
 
     const auto msg = item.payload<std::shared_ptr<KMime::Message>>();
     Q_ASSERT(msg.get());
 
-    if (!msg->hasHeader("From")) {
+    // Rules on headers not provided by the envelope are served from the raw
+    // header block, so they do not need the message to be parsed.
+    QByteArray head;
+    const bool needsMimeTree = function() == FuncHasAttachment || function() == FuncHasNoAttachment;
+    if (!needsMimeTree && ((mFieldKind == FieldKind::Header && mRequiredPart == Header) || mFieldKind == FieldKind::AnyHeader)) {
+        head = msg->head();
+    }
+    if (head.isEmpty() && !msg->hasHeader("From")) {
         msg->parse(); // probably not parsed yet: make sure we can access all headers
     }
+    const auto headerValue = [this, &msg]() -> QString {
+        return headerFieldContents(msg.get());
+    };
 
     QString msgContents;
     // Show the value used to compare the rules against in the log.
     // Overwrite the value for complete messages and all headers!
     bool logContents = true;
 
-    if (qstricmp(field().constData(), "<message>") == 0) {
+    switch (mFieldKind) {
+    case FieldKind::Message:
         msgContents = QString::fromUtf8(msg->encodedContent());
         logContents = false;
-    } else if (qstricmp(field().constData(), "<body>") == 0) {
+        break;
+    case FieldKind::Body:
         msgContents = QString::fromUtf8(msg->body());
         logContents = false;
-    } else if (qstricmp(field().constData(), "<any header>") == 0) {
-        msgContents = QString::fromUtf8(msg->head());
+        break;
+    case FieldKind::AnyHeader:
+        msgContents = QString::fromUtf8(head.isEmpty() ? msg->head() : head);
         logContents = false;
-    } else if (qstricmp(field().constData(), "<recipients>") == 0) {
+        break;
+    case FieldKind::Recipients:
         // (mmutz 2001-11-05) hack to fix "<recipients> !contains foo" to
         // meet user's expectations. See FAQ entry in KDE 2.2.2's KMail
         // handbook
@@ -113,28 +174,25 @@ bool SearchRuleString::matches(const Akonadi::Item &item) const
         msgContents = msg->to()->asUnicodeString();
         msgContents += QLatin1StringView(", ") + msg->cc()->asUnicodeString();
         msgContents += QLatin1StringView(", ") + msg->bcc()->asUnicodeString();
-    } else if (qstricmp(field().constData(), "<tag>") == 0) {
+        break;
+    case FieldKind::Tag:
         // port?
         //     const Nepomuk2::Resource res( item.url() );
         //     foreach ( const Nepomuk2::Tag &tag, res.tags() ) {
         //       msgContents += tag.label();
         //     }
         logContents = false;
-    } else {
+        break;
+    case FieldKind::Header:
         // make sure to treat messages with multiple header lines for
         // the same header correctly
-        msgContents.clear();
-        if (auto hrd = msg->headerByType(field().constData())) {
-            msgContents = hrd->asUnicodeString();
-        }
+        msgContents = headerValue();
+        break;
     }
 
     if (function() == FuncIsInAddressbook || function() == FuncIsNotInAddressbook) {
         // I think only the "from"-field makes sense.
-        msgContents.clear();
-        if (auto hrd = msg->headerByType(field().constData())) {
-            msgContents = hrd->asUnicodeString();
-        }
+        msgContents = headerValue();
 
         if (msgContents.isEmpty()) {
             return (function() == FuncIsInAddressbook) ? false : true;
@@ -152,8 +210,7 @@ bool SearchRuleString::matches(const Akonadi::Item &item) const
     if (!rc) {
         // Try to search endwith for emails => remove >
         // Bug 455273
-        if ((qstricmp(field().constData(), "to") == 0) || (qstricmp(field().constData(), "cc") == 0) || (qstricmp(field().constData(), "bcc") == 0)
-            || (qstricmp(field().constData(), "from") == 0) || (qstricmp(field().constData(), "reply-to") == 0)) {
+        if (mIsAddressField) {
             if (function() == SearchRule::FuncEndWith || function() == SearchRule::FuncNotEndWith) {
                 QString newContents = msgContents;
                 if (newContents.endsWith(u'>')) {
@@ -164,17 +221,36 @@ bool SearchRuleString::matches(const Akonadi::Item &item) const
         }
     }
     if (FilterLog::instance()->isLogging()) {
-        QString msgStr = (rc ? QStringLiteral("<font color=#00FF00>1 = </font>") : QStringLiteral("<font color=#FF0000>0 = </font>"));
-        msgStr += FilterLog::recode(asString());
         // only log headers because messages and bodies can be pretty large
-        if (logContents) {
-            msgStr += QLatin1StringView(" (<i>") + FilterLog::recode(msgContents) + QLatin1StringView("</i>)");
-        }
-        FilterLog::instance()->add(msgStr, FilterLog::RuleResult);
+        FilterLog::instance()->addRuleResult(*this, rc, logContents ? msgContents : QString());
     }
     return rc;
 }
 
+bool SearchRuleString::isHeaderFieldRule() const
+{
+    compile();
+    return mFieldKind == FieldKind::Header;
+}
+
+QString SearchRuleString::headerFieldContents(KMime::Message *msg) const
+{
+    compile();
+    if (mFieldKind == FieldKind::Header && mRequiredPart == Header) {
+        const QByteArray head = msg->head();
+        if (!head.isEmpty()) {
+            return MessageHeaderScanner::forHead(head).value(field());
+        }
+    }
+    if (!msg->hasHeader("From")) {
+        msg->parse(); // probably not parsed yet: make sure we can access all headers
+    }
+    if (auto hrd = msg->headerByType(field().constData())) {
+        return hrd->asUnicodeString();
+    }
+    return {};
+}
+
 void SearchRuleString::addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const
 {
     using namespace Akonadi;
@@ -241,25 +317,26 @@ bool SearchRuleString::matchesInternal(const QString &msgContents) const
     if (msgContents.isEmpty()) {
         return false;
     }
+    compile();
 
     switch (function()) {
     case SearchRule::FuncEquals:
-        return QString::compare(msgContents.toLower(), contents().toLower()) == 0;
+        return QString::compare(msgContents, mLowerContents, Qt::CaseInsensitive) == 0;
 
     case SearchRule::FuncNotEqual:
-        return QString::compare(msgContents.toLower(), contents().toLower()) != 0;
+        return QString::compare(msgContents, mLowerContents, Qt::CaseInsensitive) != 0;
 
     case SearchRule::FuncContains:
-        return msgContents.contains(contents(), Qt::CaseInsensitive);
+        return mContentsMatcher.indexIn(msgContents) != -1;
 
     case SearchRule::FuncContainsNot:
-        return !msgContents.contains(contents(), Qt::CaseInsensitive);
+        return mContentsMatcher.indexIn(msgContents) == -1;
 
     case SearchRule::FuncRegExp:
-        return msgContents.contains(QRegularExpression(contents(), QRegularExpression::CaseInsensitiveOption));
+        return msgContents.contains(mRegExp);
 
     case SearchRule::FuncNotRegExp:
-        return !msgContents.contains(QRegularExpression(contents(), QRegularExpression::CaseInsensitiveOption));
+        return !msgContents.contains(mRegExp);
 
     case SearchRule::FuncStartWith:
         return msgContents.startsWith(contents());
@@ -274,31 +351,23 @@ bool SearchRuleString::matchesInternal(const QString &msgContents) const
         return !msgContents.endsWith(contents());
 
     case FuncIsGreater:
-        return QString::compare(msgContents.toLower(), contents().toLower()) > 0;
+        return QString::compare(msgContents.toLower(), mLowerContents) > 0;
 
     case FuncIsLessOrEqual:
-        return QString::compare(msgContents.toLower(), contents().toLower()) <= 0;
+        return QString::compare(msgContents.toLower(), mLowerContents) <= 0;
 
     case FuncIsLess:
-        return QString::compare(msgContents.toLower(), contents().toLower()) < 0;
+        return QString::compare(msgContents.toLower(), mLowerContents) < 0;
 
     case FuncIsGreaterOrEqual:
-        return QString::compare(msgContents.toLower(), contents().toLower()) >= 0;
+        return QString::compare(msgContents.toLower(), mLowerContents) >= 0;
 
     case FuncIsInAddressbook: {
         const QStringList addressList = KEmailAddress::splitAddressList(msgContents.toLower());
-        QStringList::ConstIterator end(addressList.constEnd());
-        for (QStringList::ConstIterator it = addressList.constBegin(); (it != end); ++it) {
-            const QString email(KEmailAddress::extractEmailAddress(*it).toLower());
-            if (!email.isEmpty()) {
-                auto job = new Akonadi::ContactSearchJob();
-                job->setLimit(1);
-                job->setQuery(Akonadi::ContactSearchJob::Email, email);
-                job->exec();
-
-                if (!job->contacts().isEmpty()) {
-                    return true;
-                }
+        for (const QString &address : addressList) {
+            const QString email(KEmailAddress::extractEmailAddress(address).toLower());
+            if (!email.isEmpty() && ContactEmailIndex::self()->contains(email)) {
+                return true;
             }
         }
         return false;
@@ -306,67 +375,34 @@ bool SearchRuleString::matchesInternal(const QString &msgContents) const
 
     case FuncIsNotInAddressbook: {
         const QStringList addressList = KEmailAddress::splitAddressList(msgContents.toLower());
-        QStringList::ConstIterator end(addressList.constEnd());
-
-        for (QStringList::ConstIterator it = addressList.constBegin(); (it != end); ++it) {
-            const QString email(KEmailAddress::extractEmailAddress(*it).toLower());
-            if (!email.isEmpty()) {
-                auto job = new Akonadi::ContactSearchJob();
-                job->setLimit(1);
-                job->setQuery(Akonadi::ContactSearchJob::Email, email);
-                job->exec();
-
-                if (job->contacts().isEmpty()) {
-                    return true;
-                }
+        for (const QString &address : addressList) {
+            const QString email(KEmailAddress::extractEmailAddress(address).toLower());
+            if (!email.isEmpty() && !ContactEmailIndex::self()->contains(email)) {
+                return true;
             }
         }
         return false;
     }
 
     case FuncIsInCategory: {
-        QString category = contents();
+        const QString category = contents();
         const QStringList addressList = KEmailAddress::splitAddressList(msgContents.toLower());
-
-        QStringList::ConstIterator end(addressList.constEnd());
-        for (QStringList::ConstIterator it = addressList.constBegin(); it != end; ++it) {
-            const QString email(KEmailAddress::extractEmailAddress(*it).toLower());
-            if (!email.isEmpty()) {
-                auto job = new Akonadi::ContactSearchJob();
-                job->setQuery(Akonadi::ContactSearchJob::Email, email);
-                job->exec();
-
-                const KContacts::Addressee::List contacts = job->contacts();
-
-                for (const KContacts::Addressee &contact : contacts) {
-                    if (contact.hasCategory(category)) {
-                        return true;
-                    }
-                }
+        for (const QString &address : addressList) {
+            const QString email(KEmailAddress::extractEmailAddress(address).toLower());
+            if (!email.isEmpty() && ContactEmailIndex::self()->hasCategory(email, category)) {
+                return true;
             }
         }
         return false;
     }
 
     case FuncIsNotInCategory: {
-        QString category = contents();
+        const QString category = contents();
         const QStringList addressList = KEmailAddress::splitAddressList(msgContents.toLower());
-
-        QStringList::ConstIterator end(addressList.constEnd());
-        for (QStringList::ConstIterator it = addressList.constBegin(); it != end; ++it) {
-            const QString email(KEmailAddress::extractEmailAddress(*it).toLower());
-            if (!email.isEmpty()) {
-                auto job = new Akonadi::ContactSearchJob();
-                job->setQuery(Akonadi::ContactSearchJob::Email, email);
-                job->exec();
-
-                const KContacts::Addressee::List contacts = job->contacts();
-
-                for (const KContacts::Addressee &contact : contacts) {
-                    if (contact.hasCategory(category)) {
-                        return false;
-                    }
-                }
+        for (const QString &address : addressList) {
+            const QString email(KEmailAddress::extractEmailAddress(address).toLower());
+            if (!email.isEmpty() && ContactEmailIndex::self()->hasCategory(email, category)) {
+                return false;
             }
         }
         return true;
@@ -9,6 +9,9 @@
 #include "searchpattern.h"
 #include <Akonadi/Item>
 
+#include <QRegularExpression>
+#include <QStringMatcher>
+
 /**
  * @short This class represents a search pattern rule operating on a string.
  *
@@ -66,10 +69,46 @@ public:
      */
     [[nodiscard]] bool matchesInternal(const QString &contents) const;
 
+    /**
+     * Returns whether the rule looks at a single, named header field
+     * rather than at a pseudo header such as \<body\> or \<recipients\>.
+     */
+    [[nodiscard]] bool isHeaderFieldRule() const;
+
+    /**
+     * Returns the value of the header field of @p msg the rule compares
+     * against, as used by matches() for header field rules.
+     */
+    [[nodiscard]] QString headerFieldContents(KMime::Message *msg) const;
+
     /**
      * @copydoc SearchRule::addQueryTerms()
      */
     void addQueryTerms(Akonadi::SearchTerm &groupTerm, bool &emptyIsNotAnError) const override;
     [[nodiscard]] QString informationAboutNotValidRules() const override;
+
+protected:
+    /**
+     * @copydoc SearchRule::compileInternal()
+     */
+    void compileInternal() const override;
+
+private:
+    enum class FieldKind {
+        Message,
+        Body,
+        AnyHeader,
+        Recipients,
+        Tag,
+        Header,
+    };
+
+    // Compiled from field(), function() and contents(), see compile()
+    mutable FieldKind mFieldKind = FieldKind::Header;
+    mutable RequiredPart mRequiredPart = Header;
+    mutable bool mIsAddressField = false;
+    mutable QString mLowerContents;
+    mutable QStringMatcher mContentsMatcher;
+    mutable QRegularExpression mRegExp;
 };
 }
@@ -0,0 +1,123 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "snippetsindextest.h"
+#include "../snippetsindex.h"
+#include <QTest>
+
+#include <algorithm>
+
+using Ids = QList<MailCommon::SnippetsIndex::Id>;
+
+namespace
+{
+Ids sorted(Ids ids)
+{
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+void fillIndex(MailCommon::SnippetsIndex &index)
+{
+    index.insert(1, QStringLiteral("Greeting"), QStringLiteral("hi"), QStringLiteral("Hello $name$,"));
+    index.insert(2, QStringLiteral("Green tea"), QStringLiteral("tea"), QStringLiteral("Would you like some tea?"));
+    index.insert(3, QStringLiteral("Signature"), QStringLiteral("sig"), QStringLiteral("Best regards"));
+    index.insert(4, QStringLiteral("Short greeting"), QStringLiteral("hi"), QStringLiteral("Hi!"));
+}
+}
+
+SnippetsIndexTest::SnippetsIndexTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SnippetsIndexTest::~SnippetsIndexTest() = default;
+
+void SnippetsIndexTest::shouldHaveDefaultValue()
+{
+    MailCommon::SnippetsIndex index;
+    QCOMPARE(index.count(), 0);
+    QVERIFY(index.snippetsForKeyword(QStringLiteral("hi")).isEmpty());
+    QVERIFY(index.snippetsWithNamePrefix(QStringLiteral("g")).isEmpty());
+    QVERIFY(index.snippetsContaining(QStringLiteral("hello")).isEmpty());
+}
+
+void SnippetsIndexTest::shouldFindKeyword()
+{
+    MailCommon::SnippetsIndex index;
+    fillIndex(index);
+    QCOMPARE(index.count(), 4);
+    QCOMPARE(sorted(index.snippetsForKeyword(QStringLiteral("hi"))), Ids({1, 4}));
+    QCOMPARE(index.snippetsForKeyword(QStringLiteral("sig")), Ids({3}));
+    QVERIFY(index.snippetsForKeyword(QStringLiteral("HI")).isEmpty());
+    QVERIFY(index.snippetsForKeyword(QString()).isEmpty());
+}
+
+void SnippetsIndexTest::shouldFindNamePrefix()
+{
+    MailCommon::SnippetsIndex index;
+    fillIndex(index);
+    QCOMPARE(sorted(index.snippetsWithNamePrefix(QStringLiteral("gre"))), Ids({1, 2}));
+    QCOMPARE(index.snippetsWithNamePrefix(QStringLiteral("GREET")), Ids({1}));
+    QCOMPARE(sorted(index.snippetsWithNamePrefix(QString())), Ids({1, 2, 3, 4}));
+    QVERIFY(index.snippetsWithNamePrefix(QStringLiteral("greeting!")).isEmpty());
+}
+
+void SnippetsIndexTest::shouldFindText_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<Ids>("result");
+    QTest::newRow("short") << QStringLiteral("hi") << Ids({4});
+    QTest::newRow("single char") << QStringLiteral("!") << Ids({4});
+    QTest::newRow("name") << QStringLiteral("greeting") << Ids({1, 4});
+    QTest::newRow("text") << QStringLiteral("REGARDS") << Ids({3});
+    QTest::newRow("name and text") << QStringLiteral("tea") << Ids({2});
+    QTest::newRow("words in other order") << QStringLiteral("regards best") << Ids();
+    QTest::newRow("unknown") << QStringLiteral("xyz") << Ids();
+}
+
+void SnippetsIndexTest::shouldFindText()
+{
+    QFETCH(QString, text);
+    QFETCH(Ids, result);
+    MailCommon::SnippetsIndex index;
+    fillIndex(index);
+    QCOMPARE(sorted(index.snippetsContaining(text)), result);
+}
+
+void SnippetsIndexTest::shouldReindexSnippet()
+{
+    MailCommon::SnippetsIndex index;
+    fillIndex(index);
+    index.insert(1, QStringLiteral("Farewell"), QStringLiteral("bye"), QStringLiteral("Goodbye"));
+    QCOMPARE(index.count(), 4);
+    QCOMPARE(index.snippetsForKeyword(QStringLiteral("hi")), Ids({4}));
+    QCOMPARE(index.snippetsForKeyword(QStringLiteral("bye")), Ids({1}));
+    QCOMPARE(index.snippetsWithNamePrefix(QStringLiteral("greet")), Ids());
+    QCOMPARE(index.snippetsWithNamePrefix(QStringLiteral("fare")), Ids({1}));
+    QVERIFY(index.snippetsContaining(QStringLiteral("hello")).isEmpty());
+    QCOMPARE(index.snippetsContaining(QStringLiteral("goodbye")), Ids({1}));
+}
+
+void SnippetsIndexTest::shouldRemoveSnippet()
+{
+    MailCommon::SnippetsIndex index;
+    fillIndex(index);
+    index.remove(4);
+    index.remove(42);
+    QCOMPARE(index.count(), 3);
+    QCOMPARE(index.snippetsForKeyword(QStringLiteral("hi")), Ids({1}));
+    QCOMPARE(index.snippetsWithNamePrefix(QStringLiteral("short")), Ids());
+    QCOMPARE(index.snippetsContaining(QStringLiteral("greeting")), Ids({1}));
+
+    index.clear();
+    QCOMPARE(index.count(), 0);
+    QVERIFY(index.snippetsContaining(QStringLiteral("tea")).isEmpty());
+}
+
+QTEST_MAIN(SnippetsIndexTest)
+
+#include "moc_snippetsindextest.cpp"
@@ -0,0 +1,25 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class SnippetsIndexTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SnippetsIndexTest(QObject *parent = nullptr);
+    ~SnippetsIndexTest() override;
+private Q_SLOTS:
+    void shouldHaveDefaultValue();
+    void shouldFindKeyword();
+    void shouldFindNamePrefix();
+    void shouldFindText_data();
+    void shouldFindText();
+    void shouldReindexSnippet();
+    void shouldRemoveSnippet();
+};
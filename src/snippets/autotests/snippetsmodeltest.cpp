@@ -0,0 +1,200 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "snippetsmodeltest.h"
+#include "../snippetsmodel.h"
+#include <KConfig>
+#include <KConfigGroup>
+#include <QFile>
+#include <QStandardPaths>
+#include <QTest>
+
+namespace
+{
+QModelIndex addGroup(MailCommon::SnippetsModel &model, const QString &name)
+{
+    const int row = model.rowCount();
+    model.insertRow(row, QModelIndex());
+    const QModelIndex groupIndex = model.index(row, 0, QModelIndex());
+    model.setData(groupIndex, name, MailCommon::SnippetsModel::NameRole);
+    return groupIndex;
+}
+
+void addSnippet(MailCommon::SnippetsModel &model, const QModelIndex &groupIndex, const QString &name, const QString &text)
+{
+    const int row = model.rowCount(groupIndex);
+    model.insertRow(row, groupIndex);
+    const QModelIndex snippetIndex = model.index(row, 0, groupIndex);
+    model.setData(snippetIndex, name, MailCommon::SnippetsModel::NameRole);
+    model.setData(snippetIndex, text, MailCommon::SnippetsModel::TextRole);
+}
+}
+
+SnippetsModelTest::SnippetsModelTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SnippetsModelTest::~SnippetsModelTest() = default;
+
+void SnippetsModelTest::initTestCase()
+{
+    QStandardPaths::setTestModeEnabled(true);
+}
+
+void SnippetsModelTest::init()
+{
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QLatin1StringView("/kmailsnippetrc"));
+    QFile::remove(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1StringView("/kmailsnippetrc.snapshot"));
+}
+
+void SnippetsModelTest::shouldSaveAndReloadSnippets()
+{
+    {
+        MailCommon::SnippetsModel model;
+        QCOMPARE(model.rowCount(), 0);
+        const QModelIndex groupIndex = addGroup(model, QStringLiteral("General"));
+        addSnippet(model, groupIndex, QStringLiteral("greeting"), QStringLiteral("Hello $name$"));
+        model.setSavedVariables({{QStringLiteral("name"), QStringLiteral("Bob")}});
+        model.flushPendingSave();
+    }
+
+    MailCommon::SnippetsModel model;
+    QCOMPARE(model.rowCount(), 1);
+    const QModelIndex groupIndex = model.index(0, 0, QModelIndex());
+    QCOMPARE(groupIndex.data(MailCommon::SnippetsModel::NameRole).toString(), QStringLiteral("General"));
+    QCOMPARE(model.rowCount(groupIndex), 1);
+    const QModelIndex snippetIndex = model.index(0, 0, groupIndex);
+    QCOMPARE(snippetIndex.data(MailCommon::SnippetsModel::NameRole).toString(), QStringLiteral("greeting"));
+    QCOMPARE(snippetIndex.data(MailCommon::SnippetsModel::TextRole).toString(), QStringLiteral("Hello $name$"));
+    QCOMPARE(model.savedVariables().value(QStringLiteral("name")), QStringLiteral("Bob"));
+    QVERIFY(!model.hasPendingChanges());
+}
+
+void SnippetsModelTest::shouldTrackPendingChanges()
+{
+    MailCommon::SnippetsModel model;
+    QVERIFY(!model.hasPendingChanges());
+
+    const QModelIndex groupIndex = addGroup(model, QStringLiteral("General"));
+    QVERIFY(model.hasPendingChanges());
+    model.flushPendingSave();
+    QVERIFY(!model.hasPendingChanges());
+
+    addSnippet(model, groupIndex, QStringLiteral("greeting"), QStringLiteral("Hello"));
+    QVERIFY(model.hasPendingChanges());
+    model.scheduleSave();
+    QTRY_VERIFY(!model.hasPendingChanges());
+
+    model.setSavedVariables(model.savedVariables());
+    QVERIFY(!model.hasPendingChanges());
+    model.setSavedVariables({{QStringLiteral("name"), QStringLiteral("Bob")}});
+    QVERIFY(model.hasPendingChanges());
+}
+
+void SnippetsModelTest::shouldRemoveDeletedGroups()
+{
+    MailCommon::SnippetsModel model;
+    const QModelIndex firstGroup = addGroup(model, QStringLiteral("first"));
+    addSnippet(model, firstGroup, QStringLiteral("a"), QStringLiteral("text a"));
+    addSnippet(model, firstGroup, QStringLiteral("b"), QStringLiteral("text b"));
+    const QModelIndex secondGroup = addGroup(model, QStringLiteral("second"));
+    addSnippet(model, secondGroup, QStringLiteral("c"), QStringLiteral("text c"));
+    model.flushPendingSave();
+
+    model.removeRow(0, QModelIndex());
+    model.flushPendingSave();
+
+    const KConfig config(QStringLiteral("kmailsnippetrc"), KConfig::NoGlobals);
+    QCOMPARE(config.group(QStringLiteral("SnippetPart")).readEntry("snippetGroupCount", 0), 1);
+    QVERIFY(!config.hasGroup(QStringLiteral("SnippetGroup_1")));
+    const KConfigGroup group = config.group(QStringLiteral("SnippetGroup_0"));
+    QCOMPARE(group.readEntry("Name"), QStringLiteral("second"));
+    QCOMPARE(group.readEntry("snippetCount", 0), 1);
+    QCOMPARE(group.readEntry("snippetName_0"), QStringLiteral("c"));
+    QVERIFY(!group.hasKey(QStringLiteral("snippetName_1")));
+}
+
+void SnippetsModelTest::shouldIgnoreOutdatedSnapshot()
+{
+    {
+        MailCommon::SnippetsModel model;
+        const QModelIndex groupIndex = addGroup(model, QStringLiteral("General"));
+        addSnippet(model, groupIndex, QStringLiteral("greeting"), QStringLiteral("Hello"));
+        model.flushPendingSave();
+    }
+
+    {
+        KConfig config(QStringLiteral("kmailsnippetrc"), KConfig::NoGlobals);
+        config.group(QStringLiteral("SnippetGroup_0")).writeEntry("Name", QStringLiteral("Edited elsewhere"));
+        config.sync();
+    }
+
+    MailCommon::SnippetsModel model;
+    QCOMPARE(model.rowCount(), 1);
+    QCOMPARE(model.index(0, 0, QModelIndex()).data(MailCommon::SnippetsModel::NameRole).toString(), QStringLiteral("Edited elsewhere"));
+}
+
+void SnippetsModelTest::shouldLookupSnippets()
+{
+    MailCommon::SnippetsModel model;
+    const QModelIndex firstGroup = addGroup(model, QStringLiteral("first"));
+    addSnippet(model, firstGroup, QStringLiteral("Greeting"), QStringLiteral("Hello"));
+    const QModelIndex secondGroup = addGroup(model, QStringLiteral("second"));
+    addSnippet(model, secondGroup, QStringLiteral("Signature"), QStringLiteral("Best regards"));
+    addSnippet(model, secondGroup, QStringLiteral("Short greeting"), QStringLiteral("Hi"));
+    model.setData(model.index(1, 0, secondGroup), QStringLiteral("hi"), MailCommon::SnippetsModel::KeywordRole);
+
+    const QModelIndexList keywordMatches = model.snippetsForKeyword(QStringLiteral("hi"));
+    QCOMPARE(keywordMatches.count(), 1);
+    QCOMPARE(keywordMatches.first(), model.index(1, 0, secondGroup));
+
+    QCOMPARE(model.snippetsWithNamePrefix(QStringLiteral("sig")), QModelIndexList({model.index(0, 0, secondGroup)}));
+    QCOMPARE(model.searchSnippets(QStringLiteral("greeting")), QModelIndexList({model.index(0, 0, firstGroup), model.index(1, 0, secondGroup)}));
+
+    model.setData(model.index(0, 0, firstGroup), QStringLiteral("Welcome"), MailCommon::SnippetsModel::NameRole);
+    QCOMPARE(model.searchSnippets(QStringLiteral("greeting")), QModelIndexList({model.index(1, 0, secondGroup)}));
+
+    model.removeRow(1, QModelIndex());
+    QVERIFY(model.snippetsForKeyword(QStringLiteral("hi")).isEmpty());
+    QVERIFY(model.searchSnippets(QStringLiteral("regards")).isEmpty());
+}
+
+void SnippetsModelTest::shouldReturnSnippetsInModelOrder()
+{
+    MailCommon::SnippetsModel model;
+    const QModelIndex firstGroup = addGroup(model, QStringLiteral("first"));
+    for (int i = 0; i < 3; ++i) {
+        addSnippet(model, firstGroup, QStringLiteral("Reply %1").arg(i), QStringLiteral("Text"));
+    }
+    const QModelIndex secondGroup = addGroup(model, QStringLiteral("second"));
+    for (int i = 0; i < 3; ++i) {
+        addSnippet(model, secondGroup, QStringLiteral("Reply %1").arg(i), QStringLiteral("Text"));
+    }
+
+    // Indexed last, but placed before the others
+    model.insertRow(0, secondGroup);
+    model.setData(model.index(0, 0, secondGroup), QStringLiteral("Reply first"), MailCommon::SnippetsModel::NameRole);
+    model.insertRow(0, QModelIndex());
+    const QModelIndex thirdGroup = model.index(0, 0, QModelIndex());
+    model.setData(thirdGroup, QStringLiteral("third"), MailCommon::SnippetsModel::NameRole);
+    addSnippet(model, thirdGroup, QStringLiteral("Reply"), QStringLiteral("Text"));
+
+    QModelIndexList expected;
+    for (int group = 0; group < model.rowCount(); ++group) {
+        const QModelIndex groupIndex = model.index(group, 0, QModelIndex());
+        for (int row = 0; row < model.rowCount(groupIndex); ++row) {
+            expected.append(model.index(row, 0, groupIndex));
+        }
+    }
+    QCOMPARE(expected.count(), 8);
+    QCOMPARE(model.snippetsWithNamePrefix(QStringLiteral("reply")), expected);
+    QCOMPARE(model.searchSnippets(QStringLiteral("reply")), expected);
+}
+
+QTEST_MAIN(SnippetsModelTest)
+
+#include "moc_snippetsmodeltest.cpp"
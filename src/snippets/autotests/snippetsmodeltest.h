@@ -0,0 +1,26 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class SnippetsModelTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SnippetsModelTest(QObject *parent = nullptr);
+    ~SnippetsModelTest() override;
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void shouldSaveAndReloadSnippets();
+    void shouldTrackPendingChanges();
+    void shouldRemoveDeletedGroups();
+    void shouldIgnoreOutdatedSnapshot();
+    void shouldLookupSnippets();
+    void shouldReturnSnippetsInModelOrder();
+};
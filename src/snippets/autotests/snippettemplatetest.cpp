@@ -0,0 +1,82 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#include "snippettemplatetest.h"
+#include "../snippettemplate.h"
+#include <QTest>
+
+SnippetTemplateTest::SnippetTemplateTest(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SnippetTemplateTest::~SnippetTemplateTest() = default;
+
+void SnippetTemplateTest::shouldHaveDefaultValue()
+{
+    MailCommon::SnippetTemplate snippetTemplate;
+    QVERIFY(snippetTemplate.text().isEmpty());
+    QVERIFY(snippetTemplate.variables().isEmpty());
+    QVERIFY(snippetTemplate.expand({}).isEmpty());
+}
+
+void SnippetTemplateTest::shouldFindVariables_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QStringList>("variables");
+    QTest::newRow("empty") << QString() << QStringList();
+    QTest::newRow("novariable") << QStringLiteral("foo bar") << QStringList();
+    QTest::newRow("onevariable") << QStringLiteral("Hello $name$!") << QStringList{QStringLiteral("$name$")};
+    QTest::newRow("duplicate") << QStringLiteral("$a$ $b$ $a$") << QStringList{QStringLiteral("$a$"), QStringLiteral("$b$")};
+    QTest::newRow("adjacent") << QStringLiteral("$a$$b$") << QStringList{QStringLiteral("$a$"), QStringLiteral("$b$")};
+    QTest::newRow("escaped") << QStringLiteral("costs $$5") << QStringList();
+    QTest::newRow("invalid") << QStringLiteral("$5.00 and $x y$") << QStringList{QStringLiteral("$x y$")};
+    QTest::newRow("unterminated") << QStringLiteral("foo $bar") << QStringList();
+}
+
+void SnippetTemplateTest::shouldFindVariables()
+{
+    QFETCH(QString, text);
+    QFETCH(QStringList, variables);
+    const MailCommon::SnippetTemplate snippetTemplate(text);
+    QCOMPARE(snippetTemplate.text(), text);
+    QCOMPARE(snippetTemplate.variables(), variables);
+}
+
+void SnippetTemplateTest::shouldExpandVariables_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QString>("result");
+    QTest::newRow("novariable") << QStringLiteral("foo bar") << QStringLiteral("foo bar");
+    QTest::newRow("onevariable") << QStringLiteral("Hello $name$!") << QStringLiteral("Hello John!");
+    QTest::newRow("duplicate") << QStringLiteral("$name$ and $name$") << QStringLiteral("John and John");
+    QTest::newRow("escaped") << QStringLiteral("costs $$5") << QStringLiteral("costs $5");
+    QTest::newRow("invalid") << QStringLiteral("$5.00 for $name$") << QStringLiteral("$5.00 for John");
+    QTest::newRow("unknown") << QStringLiteral("[$unknown$]") << QStringLiteral("[]");
+    QTest::newRow("valuewithdollar") << QStringLiteral("$price$ $name$") << QStringLiteral("$name$ John");
+}
+
+void SnippetTemplateTest::shouldExpandVariables()
+{
+    QFETCH(QString, text);
+    QFETCH(QString, result);
+    const QMap<QString, QString> values{{QStringLiteral("$name$"), QStringLiteral("John")}, {QStringLiteral("$price$"), QStringLiteral("$name$")}};
+    const MailCommon::SnippetTemplate snippetTemplate(text);
+    QCOMPARE(snippetTemplate.expand(values), result);
+}
+
+void SnippetTemplateTest::shouldRecompileText()
+{
+    MailCommon::SnippetTemplate snippetTemplate(QStringLiteral("$a$"));
+    QCOMPARE(snippetTemplate.variables(), QStringList{QStringLiteral("$a$")});
+    snippetTemplate.setText(QStringLiteral("$b$ text"));
+    QCOMPARE(snippetTemplate.variables(), QStringList{QStringLiteral("$b$")});
+    QCOMPARE(snippetTemplate.expand({{QStringLiteral("$b$"), QStringLiteral("x")}}), QStringLiteral("x text"));
+}
+
+QTEST_MAIN(SnippetTemplateTest)
+
+#include "moc_snippettemplatetest.cpp"
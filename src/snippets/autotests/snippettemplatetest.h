@@ -0,0 +1,24 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: GPL-2.0-only
+*/
+
+#pragma once
+
+#include <QObject>
+
+class SnippetTemplateTest : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SnippetTemplateTest(QObject *parent = nullptr);
+    ~SnippetTemplateTest() override;
+private Q_SLOTS:
+    void shouldHaveDefaultValue();
+    void shouldFindVariables_data();
+    void shouldFindVariables();
+    void shouldExpandVariables_data();
+    void shouldExpandVariables();
+    void shouldRecompileText();
+};
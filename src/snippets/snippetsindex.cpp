@@ -0,0 +1,160 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "snippetsindex.h"
+
+using namespace MailCommon;
+
+namespace
+{
+quint64 trigramAt(const QString &text, qsizetype pos)
+{
+    return (quint64(text.at(pos).unicode()) << 32) | (quint64(text.at(pos + 1).unicode()) << 16) | quint64(text.at(pos + 2).unicode());
+}
+
+void addTrigrams(const QString &text, QSet<quint64> &trigrams)
+{
+    for (qsizetype i = 0; i + 2 < text.size(); ++i) {
+        trigrams.insert(trigramAt(text, i));
+    }
+}
+}
+
+void SnippetsIndex::insert(Id id, const QString &name, const QString &keyword, const QString &text)
+{
+    remove(id);
+
+    Entry entry;
+    entry.keyword = keyword;
+    entry.foldedName = name.toCaseFolded();
+    entry.foldedText = text.toCaseFolded();
+    addTrigrams(entry.foldedName, entry.trigrams);
+    addTrigrams(entry.foldedText, entry.trigrams);
+
+    if (!keyword.isEmpty()) {
+        mKeywords[keyword].append(id);
+    }
+    mNames.emplace(entry.foldedName, id);
+    for (const quint64 trigram : std::as_const(entry.trigrams)) {
+        mTrigrams[trigram].insert(id);
+    }
+    mEntries.insert(id, std::move(entry));
+}
+
+void SnippetsIndex::remove(Id id)
+{
+    const auto it = mEntries.constFind(id);
+    if (it == mEntries.cend()) {
+        return;
+    }
+    const Entry &entry = it.value();
+
+    if (!entry.keyword.isEmpty()) {
+        auto keywordIt = mKeywords.find(entry.keyword);
+        keywordIt->removeOne(id);
+        if (keywordIt->isEmpty()) {
+            mKeywords.erase(keywordIt);
+        }
+    }
+
+    auto [nameIt, nameEnd] = mNames.equal_range(entry.foldedName);
+    for (; nameIt != nameEnd; ++nameIt) {
+        if (nameIt->second == id) {
+            mNames.erase(nameIt);
+            break;
+        }
+    }
+
+    for (const quint64 trigram : std::as_const(entry.trigrams)) {
+        auto trigramIt = mTrigrams.find(trigram);
+        trigramIt->remove(id);
+        if (trigramIt->isEmpty()) {
+            mTrigrams.erase(trigramIt);
+        }
+    }
+
+    mEntries.erase(it);
+}
+
+void SnippetsIndex::clear()
+{
+    mEntries.clear();
+    mKeywords.clear();
+    mNames.clear();
+    mTrigrams.clear();
+}
+
+int SnippetsIndex::count() const
+{
+    return mEntries.count();
+}
+
+QList<SnippetsIndex::Id> SnippetsIndex::snippetsForKeyword(const QString &keyword) const
+{
+    return mKeywords.value(keyword);
+}
+
+QList<SnippetsIndex::Id> SnippetsIndex::snippetsWithNamePrefix(const QString &prefix) const
+{
+    const QString foldedPrefix = prefix.toCaseFolded();
+    QList<Id> result;
+    for (auto it = mNames.lower_bound(foldedPrefix); it != mNames.cend() && it->first.startsWith(foldedPrefix); ++it) {
+        result.append(it->second);
+    }
+    return result;
+}
+
+bool SnippetsIndex::entryContains(const Entry &entry, const QString &foldedText)
+{
+    return entry.foldedName.contains(foldedText) || entry.foldedText.contains(foldedText);
+}
+
+QList<SnippetsIndex::Id> SnippetsIndex::snippetsContaining(const QString &text) const
+{
+    const QString foldedText = text.toCaseFolded();
+    QList<Id> result;
+
+    if (foldedText.size() < 3) {
+        // Too short for trigrams, check every snippet
+        for (auto it = mEntries.cbegin(), end = mEntries.cend(); it != end; ++it) {
+            if (entryContains(it.value(), foldedText)) {
+                result.append(it.key());
+            }
+        }
+        return result;
+    }
+
+    QSet<quint64> trigrams;
+    addTrigrams(foldedText, trigrams);
+
+    // Start from the rarest trigram, the others only filter it
+    const QSet<Id> *candidates = nullptr;
+    for (const quint64 trigram : std::as_const(trigrams)) {
+        const auto it = mTrigrams.constFind(trigram);
+        if (it == mTrigrams.cend()) {
+            return result;
+        }
+        if (!candidates || it->size() < candidates->size()) {
+            candidates = &it.value();
+        }
+    }
+
+    for (const Id id : *candidates) {
+        const Entry &entry = mEntries.constFind(id).value();
+        bool hasAllTrigrams = true;
+        for (const quint64 trigram : std::as_const(trigrams)) {
+            if (!entry.trigrams.contains(trigram)) {
+                hasAllTrigrams = false;
+                break;
+            }
+        }
+        // Trigrams are only a filter, the substring itself still has to match
+        if (hasAllTrigrams && entryContains(entry, foldedText)) {
+            result.append(id);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+
+#include <map>
+
+namespace MailCommon
+{
+/**
+ * @short Lookup tables over the snippets of a SnippetsModel.
+ *
+ * Snippets are identified by an opaque id. The index keeps a hash from
+ * keyword to snippets, an ordered map of case-folded names for prefix
+ * completion and a trigram index over names and texts for substring search,
+ * so that lookups do not depend on the number of snippets.
+ */
+class MAILCOMMON_TESTS_EXPORT SnippetsIndex
+{
+public:
+    using Id = quintptr;
+
+    /**
+     * Indexes the snippet @p id, replacing what was indexed for it before.
+     */
+    void insert(Id id, const QString &name, const QString &keyword, const QString &text);
+
+    /**
+     * Removes the snippet @p id from the index.
+     */
+    void remove(Id id);
+
+    /**
+     * Removes every snippet from the index.
+     */
+    void clear();
+
+    /**
+     * Returns the number of indexed snippets.
+     */
+    [[nodiscard]] int count() const;
+
+    /**
+     * Returns the snippets whose keyword is exactly @p keyword.
+     */
+    [[nodiscard]] QList<Id> snippetsForKeyword(const QString &keyword) const;
+
+    /**
+     * Returns the snippets whose name starts with @p prefix, case insensitively.
+     */
+    [[nodiscard]] QList<Id> snippetsWithNamePrefix(const QString &prefix) const;
+
+    /**
+     * Returns the snippets whose name or text contains @p text, case insensitively.
+     */
+    [[nodiscard]] QList<Id> snippetsContaining(const QString &text) const;
+
+private:
+    struct Entry {
+        QString keyword;
+        QString foldedName;
+        QString foldedText;
+        QSet<quint64> trigrams;
+    };
+    [[nodiscard]] static bool entryContains(const Entry &entry, const QString &foldedText);
+
+    QHash<Id, Entry> mEntries;
+    QHash<QString, QList<Id>> mKeywords;
+    std::multimap<QString, Id> mNames;
+    QHash<quint64, QSet<Id>> mTrigrams;
+};
+}
@@ -12,6 +12,7 @@
 #include "mailcommon_debug.h"
 #include "snippetdialog.h"
 #include "snippetsmodel.h"
+#include "snippettemplate.h"
 #include "snippetvariabledialog.h"
 #include <KActionCollection>
 #include <KSharedConfig>
@@ -21,9 +22,9 @@
 #include <QIcon>
 
 #include <QAction>
+#include <QHash>
 #include <QItemSelectionModel>
 #include <QPointer>
-#include <QRegularExpression>
 
 using namespace MailCommon;
 
@@ -75,6 +76,7 @@ public:
     void initializeActionCollection();
 
     QString replaceVariables(const QString &text);
+    [[nodiscard]] const SnippetTemplate &snippetTemplate(const QString &text);
 
     void save();
 
@@ -90,6 +92,8 @@ public:
     QAction *mDeleteSnippetGroupAction = nullptr;
     QAction *mInsertSnippetAction = nullptr;
     QWidget *mParent = nullptr;
+    // Compiled snippet texts, cleared whenever the snippets change
+    QHash<QString, SnippetTemplate> mTemplates;
     bool mDirty = false;
 };
 
@@ -479,50 +483,45 @@ void SnippetsManager::SnippetsManagerPrivate::updateActionCollection(const QStri
     }
 }
 
+const SnippetTemplate &SnippetsManager::SnippetsManagerPrivate::snippetTemplate(const QString &text)
+{
+    auto it = mTemplates.find(text);
+    if (it == mTemplates.end()) {
+        it = mTemplates.insert(text, SnippetTemplate(text));
+    }
+    return it.value();
+}
+
 QString SnippetsManager::SnippetsManagerPrivate::replaceVariables(const QString &text)
 {
-    QString result = text;
-    QString variableName;
-    QString variableValue;
+    // A copy: the cache may be cleared while a variable dialog is open
+    const SnippetTemplate compiledText = snippetTemplate(text);
+    const QStringList variables = compiledText.variables();
+    if (variables.isEmpty()) {
+        return compiledText.expand({});
+    }
+
     QMap<QString, QString> localVariables(SnippetsModel::instance()->savedVariables());
-    int iFound = -1;
-    int iEnd = -1;
     QMap<QString, QString> tempLocalVariables(localVariables);
-    do {
-        // find the next variable by this regex
-        iFound = text.indexOf(QRegularExpression(QStringLiteral("\\$[A-Za-z\\-_0-9\\s]*\\$")), iEnd + 1);
-        if (iFound >= 0) {
-            iEnd = text.indexOf(u'$', iFound + 1) + 1;
-
-            variableName = text.mid(iFound, iEnd - iFound);
-
-            if (variableName != QLatin1StringView("$$")) { // if not double-delimiter
-                if (!localVariables.contains(variableName)) { // and not already in map
-                    QPointer<SnippetVariableDialog> dlg = new SnippetVariableDialog(variableName, &tempLocalVariables, mParent);
-                    if (dlg->exec()) {
-                        if (dlg->saveVariableIsChecked()) {
-                            mDirty = true;
-                        }
-                        variableValue = dlg->variableValue();
-                    } else {
-                        delete dlg;
-                        return {};
-                    }
-                    delete dlg;
-                } else {
-                    variableValue = localVariables.value(variableName);
-                }
-            } else {
-                variableValue = u'$'; // if double-delimiter -> replace by single character
+    for (const QString &variableName : variables) {
+        if (localVariables.contains(variableName)) {
+            continue;
+        }
+        QPointer<SnippetVariableDialog> dlg = new SnippetVariableDialog(variableName, &tempLocalVariables, mParent);
+        if (dlg->exec()) {
+            if (dlg->saveVariableIsChecked()) {
+                mDirty = true;
             }
-
-            result.replace(variableName, variableValue);
-            localVariables[variableName] = variableValue;
+            localVariables[variableName] = dlg->variableValue();
+        } else {
+            delete dlg;
+            return {};
         }
-    } while (iFound != -1);
+        delete dlg;
+    }
     SnippetsModel::instance()->setSavedVariables(tempLocalVariables);
 
-    return result;
+    return compiledText.expand(localVariables);
 }
 
 void SnippetsManager::SnippetsManagerPrivate::save()
@@ -531,7 +530,7 @@ void SnippetsManager::SnippetsManagerPrivate::save()
         return;
     }
 
-    SnippetsModel::instance()->save();
+    SnippetsModel::instance()->scheduleSave();
     mDirty = false;
 }
 
@@ -580,6 +579,12 @@ SnippetsManager::SnippetsManager(KActionCollection *actionCollection, QObject *p
     connect(d->mModel, &SnippetsModel::dndDone, this, [this]() {
         d->dndDone();
     });
+    const auto clearTemplates = [this]() {
+        d->mTemplates.clear();
+    };
+    connect(d->mModel, &QAbstractItemModel::dataChanged, this, clearTemplates);
+    connect(d->mModel, &QAbstractItemModel::rowsRemoved, this, clearTemplates);
+    connect(d->mModel, &QAbstractItemModel::modelReset, this, clearTemplates);
     connect(d->mModel, &SnippetsModel::addNewDndSnippset, this, [this](const QString &str) {
         d->slotAddNewDndSnippset(str);
     });
@@ -618,6 +623,7 @@ SnippetsManager::SnippetsManager(KActionCollection *actionCollection, QObject *p
 SnippetsManager::~SnippetsManager()
 {
     d->save();
+    SnippetsModel::instance()->flushPendingSave();
 }
 
 QAbstractItemModel *SnippetsManager::model() const
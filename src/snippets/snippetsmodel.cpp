@@ -8,18 +8,48 @@
 */
 
 #include "snippetsmodel.h"
+#include "mailcommon_debug.h"
+#include "snippetsindex.h"
 
 #include <KConfigGroup>
 #include <KLocalizedString>
 #include <KMessageBox>
 #include <KSharedConfig>
 #include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QIODevice>
 #include <QMimeData>
+#include <QSaveFile>
+#include <QStandardPaths>
 #include <QStringList>
+#include <QTimer>
+
+#include <algorithm>
 
 using namespace MailCommon;
 
+namespace
+{
+// Delay used to coalesce consecutive edits into a single write.
+constexpr int saveDelay = 1000;
+
+constexpr quint32 snapshotMagic = 0x4b534e50; // "KSNP"
+constexpr qint32 snapshotVersion = 1;
+
+QString configFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QLatin1StringView("/kmailsnippetrc");
+}
+
+QString snapshotFilePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1StringView("/kmailsnippetrc.snapshot");
+}
+}
+
 class MailCommon::SnippetItem
 {
 public:
@@ -228,7 +258,15 @@ SnippetsModel *SnippetsModel::instance()
 
 SnippetsModel::SnippetsModel(QObject *parent)
     : QAbstractItemModel(parent)
+    , mIndex(std::make_unique<SnippetsIndex>())
+    , mConfig(KSharedConfig::openConfig(QStringLiteral("kmailsnippetrc"), KConfig::NoGlobals))
+    , mSaveTimer(new QTimer(this))
 {
+    mSaveTimer->setSingleShot(true);
+    mSaveTimer->setInterval(saveDelay);
+    connect(mSaveTimer, &QTimer::timeout, this, [this]() {
+        save();
+    });
     mRootItem = new SnippetItem(true);
     load();
 }
@@ -255,43 +293,41 @@ bool SnippetsModel::setData(const QModelIndex &index, const QVariant &value, int
     switch (role) {
     case NameRole:
         item->setName(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case TextRole:
         item->setText(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case KeySequenceRole:
         item->setKeySequence(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case KeywordRole:
         item->setKeyword(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case SubjectRole:
         item->setSubject(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case ToRole:
         item->setTo(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case CcRole:
         item->setCc(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case BccRole:
         item->setBcc(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
     case AttachmentRole:
         item->setAttachment(value.toString());
-        Q_EMIT dataChanged(index, index);
-        return true;
+        break;
+    default:
+        return false;
     }
 
-    return false;
+    if (!item->isGroup() && (role == NameRole || role == TextRole || role == KeywordRole)) {
+        indexSnippet(item);
+    }
+    markGroupDirty(index);
+    Q_EMIT dataChanged(index, index);
+    return true;
 }
 
 QVariant SnippetsModel::data(const QModelIndex &index, int role) const
@@ -415,6 +451,13 @@ bool SnippetsModel::insertRows(int row, int count, const QModelIndex &parent)
     }
     endInsertRows();
 
+    if (parent.isValid()) {
+        markGroupDirty(parent);
+    } else {
+        // groups are stored by position, every group from here on moves
+        mDirtyGroupsFrom = (mDirtyGroupsFrom == -1) ? row : qMin(mDirtyGroupsFrom, row);
+    }
+
     return true;
 }
 
@@ -430,10 +473,19 @@ bool SnippetsModel::removeRows(int row, int count, const QModelIndex &parent)
 
     beginRemoveRows(parent, row, row + count - 1);
     for (int i = 0; i < count; ++i) {
-        parentItem->removeChild(parentItem->child(row));
+        SnippetItem *child = parentItem->child(row);
+        mDirtyGroups.remove(child);
+        unindexItem(child);
+        parentItem->removeChild(child);
     }
     endRemoveRows();
 
+    if (parent.isValid()) {
+        markGroupDirty(parent);
+    } else {
+        mDirtyGroupsFrom = (mDirtyGroupsFrom == -1) ? row : qMin(mDirtyGroupsFrom, row);
+    }
+
     return true;
 }
 
@@ -530,6 +582,8 @@ bool SnippetsModel::dropMimeData(const QMimeData *data, Qt::DropAction action, i
                 item->setTo(to);
                 item->setCc(cc);
                 item->setBcc(bcc);
+                indexSnippet(item);
+                markGroupDirty(parent);
                 return true;
             }
             return false;
@@ -555,6 +609,8 @@ bool SnippetsModel::dropMimeData(const QMimeData *data, Qt::DropAction action, i
                                                    KGuiItem(i18nc("@action:button", "Update")),
                                                    KStandardGuiItem::cancel())) {
                 item->setText(encodedData);
+                indexSnippet(item);
+                markGroupDirty(parent);
             }
         }
         return false;
@@ -577,52 +633,218 @@ QModelIndex SnippetsModel::createGroup(const QString &groupName)
 
 void SnippetsModel::load(const QString &filename)
 {
-    const KSharedConfig::Ptr config = KSharedConfig::openConfig(filename.isEmpty() ? QStringLiteral("kmailsnippetrc") : filename, KConfig::NoGlobals);
+    const bool defaultFile = filename.isEmpty();
+    const bool wasEmpty = (rowCount() == 0);
+    const bool fromSnapshot = defaultFile && wasEmpty && mSnapshotEnabled && loadSnapshot();
 
-    const KConfigGroup snippetPartGroup = config->group("SnippetPart");
+    if (!fromSnapshot) {
+        const KSharedConfig::Ptr config = defaultFile ? mConfig : KSharedConfig::openConfig(filename, KConfig::NoGlobals);
 
-    const int groupCount = snippetPartGroup.readEntry("snippetGroupCount", 0);
+        const KConfigGroup snippetPartGroup = config->group("SnippetPart");
 
-    for (int i = 0; i < groupCount; ++i) {
-        const KConfigGroup group = config->group(QStringLiteral("SnippetGroup_%1").arg(i));
+        const int groupCount = snippetPartGroup.readEntry("snippetGroupCount", 0);
 
-        const QString groupName = group.readEntry("Name");
+        for (int i = 0; i < groupCount; ++i) {
+            const KConfigGroup group = config->group(QStringLiteral("SnippetGroup_%1").arg(i));
 
-        // create group
-        const QModelIndex groupIndex = createGroup(groupName);
+            const QString groupName = group.readEntry("Name");
 
-        const int snippetCount = group.readEntry("snippetCount", 0);
-        for (int j = 0; j < snippetCount; ++j) {
-            const QString snippetName = group.readEntry(QStringLiteral("snippetName_%1").arg(j), QString());
+            // create group
+            const QModelIndex groupIndex = createGroup(groupName);
+
+            const int snippetCount = group.readEntry("snippetCount", 0);
+            for (int j = 0; j < snippetCount; ++j) {
+                const QString snippetName = group.readEntry(QStringLiteral("snippetName_%1").arg(j), QString());
+
+                const QString snippetText = group.readEntry(QStringLiteral("snippetText_%1").arg(j), QString());
+
+                const QString snippetKeySequence = group.readEntry(QStringLiteral("snippetKeySequence_%1").arg(j), QString());
+
+                const QString snippetKeyword = group.readEntry(QStringLiteral("snippetKeyword_%1").arg(j), QString());
+
+                const QString snippetSubject = group.readEntry(QStringLiteral("snippetSubject_%1").arg(j), QString());
+
+                const QString to = group.readEntry(QStringLiteral("snippetTo_%1").arg(j), QString());
+
+                const QString cc = group.readEntry(QStringLiteral("snippetCc_%1").arg(j), QString());
+
+                const QString bcc = group.readEntry(QStringLiteral("snippetBcc_%1").arg(j), QString());
+
+                const QString attachment = group.readEntry(QStringLiteral("snippetAttachment_%1").arg(j), QString());
+                createSnippet(groupIndex, snippetName, snippetText, snippetKeySequence, snippetKeyword, snippetSubject, to, cc, bcc, attachment);
+            }
+        }
 
-            const QString snippetText = group.readEntry(QStringLiteral("snippetText_%1").arg(j), QString());
+        const KConfigGroup group = config->group("SavedVariablesPart");
+        const int variablesCount = group.readEntry("variablesCount", 0);
 
-            const QString snippetKeySequence = group.readEntry(QStringLiteral("snippetKeySequence_%1").arg(j), QString());
+        for (int i = 0; i < variablesCount; ++i) {
+            const QString variableKey = group.readEntry(QStringLiteral("variableName_%1").arg(i), QString());
 
-            const QString snippetKeyword = group.readEntry(QStringLiteral("snippetKeyword_%1").arg(j), QString());
+            const QString variableValue = group.readEntry(QStringLiteral("variableValue_%1").arg(i), QString());
 
-            const QString snippetSubject = group.readEntry(QStringLiteral("snippetSubject_%1").arg(j), QString());
+            mSavedVariables.insert(variableKey, variableValue);
+            mSavedVariablesDirty = true;
+        }
+    }
 
-            const QString to = group.readEntry(QStringLiteral("snippetTo_%1").arg(j), QString());
+    if (defaultFile && wasEmpty) {
+        // The model now mirrors the file on disk.
+        mDirtyGroups.clear();
+        mDirtyGroupsFrom = -1;
+        mSavedVariablesDirty = false;
+        mFullSaveRequired = false;
+        mSavedGroupCount = rowCount();
+        if (!fromSnapshot && mSnapshotEnabled) {
+            writeSnapshot();
+        }
+    }
+}
 
-            const QString cc = group.readEntry(QStringLiteral("snippetCc_%1").arg(j), QString());
+bool SnippetsModel::loadSnapshot()
+{
+    const QFileInfo configInfo(configFilePath());
+    if (!configInfo.exists()) {
+        return false;
+    }
+
+    QFile file(snapshotFilePath());
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+        return false;
+    }
+    uchar *data = file.map(0, file.size());
+    if (!data) {
+        return false;
+    }
 
-            const QString bcc = group.readEntry(QStringLiteral("snippetBcc_%1").arg(j), QString());
+    const QByteArray buffer = QByteArray::fromRawData(reinterpret_cast<const char *>(data), file.size());
+    QDataStream stream(buffer);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    qint32 version = 0;
+    qint64 configModified = 0;
+    qint64 configSize = 0;
+    qint32 groupCount = 0;
+    stream >> magic >> version >> configModified >> configSize >> groupCount;
+    if (stream.status() != QDataStream::Ok || magic != snapshotMagic || version != snapshotVersion
+        || configModified != configInfo.lastModified().toMSecsSinceEpoch() || configSize != configInfo.size() || groupCount < 0) {
+        file.unmap(data);
+        return false;
+    }
 
-            const QString attachment = group.readEntry(QStringLiteral("snippetAttachment_%1").arg(j), QString());
-            createSnippet(groupIndex, snippetName, snippetText, snippetKeySequence, snippetKeyword, snippetSubject, to, cc, bcc, attachment);
+    // Build the tree aside so that a truncated snapshot leaves the model untouched.
+    QList<SnippetItem *> groups;
+    groups.reserve(groupCount);
+    for (int i = 0; i < groupCount && stream.status() == QDataStream::Ok; ++i) {
+        auto group = new SnippetItem(true, mRootItem);
+        groups.append(group);
+
+        QString groupName;
+        qint32 snippetCount = 0;
+        stream >> groupName >> snippetCount;
+        group->setName(groupName);
+        for (int j = 0; j < snippetCount && stream.status() == QDataStream::Ok; ++j) {
+            QString name;
+            QString text;
+            QString keySequence;
+            QString keyword;
+            QString subject;
+            QString to;
+            QString cc;
+            QString bcc;
+            QString attachment;
+            stream >> name >> text >> keySequence >> keyword >> subject >> to >> cc >> bcc >> attachment;
+
+            auto snippet = new SnippetItem(false, group);
+            snippet->setName(name);
+            snippet->setText(text);
+            snippet->setKeySequence(keySequence);
+            snippet->setKeyword(keyword);
+            snippet->setSubject(subject);
+            snippet->setTo(to);
+            snippet->setCc(cc);
+            snippet->setBcc(bcc);
+            snippet->setAttachment(attachment);
+            group->insertChild(group->childCount(), snippet);
+            indexSnippet(snippet);
         }
     }
+    QMap<QString, QString> savedVariables;
+    stream >> savedVariables;
+
+    const bool valid = (stream.status() == QDataStream::Ok);
+    file.unmap(data);
+    if (!valid) {
+        qCWarning(MAILCOMMON_LOG) << "Ignoring corrupted snippet snapshot" << file.fileName();
+        for (const SnippetItem *group : std::as_const(groups)) {
+            unindexItem(group);
+        }
+        qDeleteAll(groups);
+        return false;
+    }
 
-    const KConfigGroup group = config->group("SavedVariablesPart");
-    const int variablesCount = group.readEntry("variablesCount", 0);
+    if (!groups.isEmpty()) {
+        beginInsertRows(QModelIndex(), 0, groups.count() - 1);
+        for (SnippetItem *group : std::as_const(groups)) {
+            mRootItem->insertChild(mRootItem->childCount(), group);
+        }
+        endInsertRows();
+    }
+    mSavedVariables = savedVariables;
 
-    for (int i = 0; i < variablesCount; ++i) {
-        const QString variableKey = group.readEntry(QStringLiteral("variableName_%1").arg(i), QString());
+    for (const SnippetItem *group : std::as_const(groups)) {
+        for (int j = 0; j < group->childCount(); ++j) {
+            const SnippetItem *snippet = group->child(j);
+            Q_EMIT updateActionCollection(QString(),
+                                          snippet->name(),
+                                          QKeySequence::fromString(snippet->keySequence()),
+                                          snippet->text(),
+                                          snippet->subject(),
+                                          snippet->to(),
+                                          snippet->cc(),
+                                          snippet->bcc(),
+                                          snippet->attachment());
+        }
+    }
+    return true;
+}
 
-        const QString variableValue = group.readEntry(QStringLiteral("variableValue_%1").arg(i), QString());
+void SnippetsModel::writeSnapshot() const
+{
+    const QFileInfo configInfo(configFilePath());
+    if (!configInfo.exists()) {
+        return;
+    }
 
-        mSavedVariables.insert(variableKey, variableValue);
+    const QString fileName = snapshotFilePath();
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCWarning(MAILCOMMON_LOG) << "Impossible to write snippet snapshot" << fileName << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << snapshotMagic << snapshotVersion << configInfo.lastModified().toMSecsSinceEpoch() << configInfo.size();
+
+    const int groupCount = mRootItem->childCount();
+    stream << qint32(groupCount);
+    for (int i = 0; i < groupCount; ++i) {
+        const SnippetItem *group = mRootItem->child(i);
+        const int snippetCount = group->childCount();
+        stream << group->name() << qint32(snippetCount);
+        for (int j = 0; j < snippetCount; ++j) {
+            const SnippetItem *snippet = group->child(j);
+            stream << snippet->name() << snippet->text() << snippet->keySequence() << snippet->keyword() << snippet->subject() << snippet->to()
+                   << snippet->cc() << snippet->bcc() << snippet->attachment();
+        }
+    }
+    stream << mSavedVariables;
+
+    if (!file.commit()) {
+        qCWarning(MAILCOMMON_LOG) << "Impossible to write snippet snapshot" << fileName << file.errorString();
     }
 }
 
@@ -656,7 +878,88 @@ void SnippetsModel::createSnippet(const QModelIndex &groupIndex,
 
 void SnippetsModel::setSavedVariables(const QMap<QString, QString> &savedVariables)
 {
-    mSavedVariables = savedVariables;
+    if (mSavedVariables != savedVariables) {
+        mSavedVariables = savedVariables;
+        mSavedVariablesDirty = true;
+    }
+}
+
+void SnippetsModel::indexSnippet(const SnippetItem *item)
+{
+    mIndex->insert(quintptr(item), item->name(), item->keyword(), item->text());
+}
+
+void SnippetsModel::unindexItem(const SnippetItem *item)
+{
+    if (item->isGroup()) {
+        for (int i = 0; i < item->childCount(); ++i) {
+            mIndex->remove(quintptr(item->child(i)));
+        }
+    } else {
+        mIndex->remove(quintptr(item));
+    }
+}
+
+QModelIndexList SnippetsModel::indexesForSnippets(const QList<quintptr> &ids) const
+{
+    // SnippetItem::row() looks the item up in its parent: number the children
+    // of each group holding a result once, rather than calling it per result
+    // and in the comparator
+    struct Position {
+        int groupRow;
+        int row;
+        SnippetItem *item;
+    };
+    QHash<const SnippetItem *, int> groupRows;
+    QHash<const SnippetItem *, int> rows;
+    QList<Position> positions;
+    positions.reserve(ids.count());
+    for (const quintptr id : ids) {
+        auto item = reinterpret_cast<SnippetItem *>(id);
+        const SnippetItem *group = item->parent();
+        auto groupRow = groupRows.constFind(group);
+        if (groupRow == groupRows.cend()) {
+            groupRow = groupRows.insert(group, group->row());
+            for (int i = 0; i < group->childCount(); ++i) {
+                rows.insert(group->child(i), i);
+            }
+        }
+        positions.append({groupRow.value(), rows.value(item), item});
+    }
+    std::sort(positions.begin(), positions.end(), [](const Position &left, const Position &right) {
+        return left.groupRow < right.groupRow || (left.groupRow == right.groupRow && left.row < right.row);
+    });
+
+    QModelIndexList indexes;
+    indexes.reserve(positions.count());
+    for (const Position &position : std::as_const(positions)) {
+        indexes.append(createIndex(position.row, 0, position.item));
+    }
+    return indexes;
+}
+
+QModelIndexList SnippetsModel::snippetsForKeyword(const QString &keyword) const
+{
+    return indexesForSnippets(mIndex->snippetsForKeyword(keyword));
+}
+
+QModelIndexList SnippetsModel::snippetsWithNamePrefix(const QString &prefix) const
+{
+    return indexesForSnippets(mIndex->snippetsWithNamePrefix(prefix));
+}
+
+QModelIndexList SnippetsModel::searchSnippets(const QString &text) const
+{
+    return indexesForSnippets(mIndex->snippetsContaining(text));
+}
+
+void SnippetsModel::markGroupDirty(const QModelIndex &index)
+{
+    auto item = static_cast<const SnippetItem *>(index.internalPointer());
+    const SnippetItem *group = item->isGroup() ? item : item->parent();
+    if (group && group != mRootItem) {
+        mDirtyGroups.insert(group);
+    }
 }
 
 QList<SnippetsInfo> SnippetsModel::snippetsInfo() const
@@ -702,14 +1005,115 @@ QMap<QString, QString> SnippetsModel::savedVariables() const
     return mSavedVariables;
 }
 
-void SnippetsModel::save(const QString &filename)
+void SnippetsModel::scheduleSave()
 {
-    KSharedConfig::Ptr config = KSharedConfig::openConfig(filename.isEmpty() ? QStringLiteral("kmailsnippetrc") : filename, KConfig::NoGlobals);
+    if (hasPendingChanges()) {
+        mSaveTimer->start();
+    }
+}
 
-    // clear everything
-    const QStringList lst = config->groupList();
-    for (const QString &group : lst) {
-        config->deleteGroup(group);
+void SnippetsModel::flushPendingSave()
+{
+    mSaveTimer->stop();
+    if (hasPendingChanges()) {
+        save();
+    }
+}
+
+bool SnippetsModel::hasPendingChanges() const
+{
+    return mFullSaveRequired || mSavedVariablesDirty || mDirtyGroupsFrom != -1 || !mDirtyGroups.isEmpty();
+}
+
+void SnippetsModel::setSnapshotEnabled(bool enabled)
+{
+    mSnapshotEnabled = enabled;
+}
+
+bool SnippetsModel::snapshotEnabled() const
+{
+    return mSnapshotEnabled;
+}
+
+void SnippetsModel::writeGroup(KConfigGroup &snippetConfigGroup, const QModelIndex &groupIndex) const
+{
+    const QString groupName = groupIndex.data(SnippetsModel::NameRole).toString();
+    snippetConfigGroup.writeEntry("Name", groupName);
+
+    const int snippetCount = rowCount(groupIndex);
+
+    snippetConfigGroup.writeEntry("snippetCount", snippetCount);
+    for (int j = 0; j < snippetCount; ++j) {
+        const QModelIndex modelIndex = index(j, 0, groupIndex);
+
+        const QString snippetName = modelIndex.data(SnippetsModel::NameRole).toString();
+        if (!snippetName.isEmpty()) {
+            const QString snippetText = modelIndex.data(SnippetsModel::TextRole).toString();
+            const QString snippetKeySequence = modelIndex.data(SnippetsModel::KeySequenceRole).toString();
+            const QString snippetKeyword = modelIndex.data(SnippetsModel::KeywordRole).toString();
+            const QString snippetSubject = modelIndex.data(SnippetsModel::SubjectRole).toString();
+            const QString snippetTo = modelIndex.data(SnippetsModel::ToRole).toString();
+            const QString snippetCc = modelIndex.data(SnippetsModel::CcRole).toString();
+            const QString snippetBcc = modelIndex.data(SnippetsModel::BccRole).toString();
+            const QString snippetAttachment = modelIndex.data(SnippetsModel::AttachmentRole).toString();
+
+            snippetConfigGroup.writeEntry(QStringLiteral("snippetName_%1").arg(j), snippetName);
+            if (!snippetText.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetText_%1").arg(j), snippetText);
+            }
+            if (!snippetKeySequence.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetKeySequence_%1").arg(j), snippetKeySequence);
+            }
+            if (!snippetKeyword.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetKeyword_%1").arg(j), snippetKeyword);
+            }
+            if (!snippetSubject.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetSubject_%1").arg(j), snippetSubject);
+            }
+            if (!snippetTo.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetTo_%1").arg(j), snippetTo);
+            }
+            if (!snippetCc.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetCc_%1").arg(j), snippetCc);
+            }
+            if (!snippetBcc.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetBcc_%1").arg(j), snippetBcc);
+            }
+            if (!snippetAttachment.isEmpty()) {
+                snippetConfigGroup.writeEntry(QStringLiteral("snippetAttachment_%1").arg(j), snippetAttachment);
+            }
+        }
+    }
+}
+
+void SnippetsModel::writeSavedVariables(KConfigGroup &savedVariableConfigGroup) const
+{
+    const int variablesCount = mSavedVariables.count();
+    savedVariableConfigGroup.writeEntry("variablesCount", variablesCount);
+
+    int counter = 0;
+    QMap<QString, QString>::const_iterator it = mSavedVariables.cbegin();
+    const QMap<QString, QString>::const_iterator itEnd = mSavedVariables.cend();
+    for (; it != itEnd; ++it) {
+        savedVariableConfigGroup.writeEntry(QStringLiteral("variableName_%1").arg(counter), it.key());
+        savedVariableConfigGroup.writeEntry(QStringLiteral("variableValue_%1").arg(counter), it.value());
+        counter++;
+    }
+}
+
+void SnippetsModel::save(const QString &filename)
+{
+    const bool defaultFile = filename.isEmpty();
+    // Another file, or a default file we never read, has to be written from scratch.
+    const bool fullSave = !defaultFile || mFullSaveRequired;
+    KSharedConfig::Ptr config = defaultFile ? mConfig : KSharedConfig::openConfig(filename, KConfig::NoGlobals);
+
+    if (fullSave) {
+        // clear everything
+        const QStringList lst = config->groupList();
+        for (const QString &group : lst) {
+            config->deleteGroup(group);
+        }
     }
 
     // write number of snippet groups
@@ -720,73 +1124,47 @@ void SnippetsModel::save(const QString &filename)
 
     for (int i = 0; i < groupCount; ++i) {
         const QModelIndex groupIndex = index(i, 0, QModelIndex());
-        const QString groupName = groupIndex.data(SnippetsModel::NameRole).toString();
-
-        KConfigGroup snippetConfigGroup = config->group(QStringLiteral("SnippetGroup_%1").arg(i));
-        snippetConfigGroup.writeEntry("Name", groupName);
-
-        const int snippetCount = rowCount(groupIndex);
-
-        snippetConfigGroup.writeEntry("snippetCount", snippetCount);
-        for (int j = 0; j < snippetCount; ++j) {
-            const QModelIndex modelIndex = index(j, 0, groupIndex);
+        const bool groupDirty =
+            (mDirtyGroupsFrom != -1 && i >= mDirtyGroupsFrom) || mDirtyGroups.contains(static_cast<const SnippetItem *>(groupIndex.internalPointer()));
+        if (!fullSave && !groupDirty) {
+            continue;
+        }
 
-            const QString snippetName = modelIndex.data(SnippetsModel::NameRole).toString();
-            if (!snippetName.isEmpty()) {
-                const QString snippetText = modelIndex.data(SnippetsModel::TextRole).toString();
-                const QString snippetKeySequence = modelIndex.data(SnippetsModel::KeySequenceRole).toString();
-                const QString snippetKeyword = modelIndex.data(SnippetsModel::KeywordRole).toString();
-                const QString snippetSubject = modelIndex.data(SnippetsModel::SubjectRole).toString();
-                const QString snippetTo = modelIndex.data(SnippetsModel::ToRole).toString();
-                const QString snippetCc = modelIndex.data(SnippetsModel::CcRole).toString();
-                const QString snippetBcc = modelIndex.data(SnippetsModel::BccRole).toString();
-                const QString snippetAttachment = modelIndex.data(SnippetsModel::AttachmentRole).toString();
+        const QString groupName = QStringLiteral("SnippetGroup_%1").arg(i);
+        if (!fullSave) {
+            // drop entries of snippets which no longer exist
+            config->deleteGroup(groupName);
+        }
+        KConfigGroup snippetConfigGroup = config->group(groupName);
+        writeGroup(snippetConfigGroup, groupIndex);
+    }
 
-                snippetConfigGroup.writeEntry(QStringLiteral("snippetName_%1").arg(j), snippetName);
-                if (!snippetText.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetText_%1").arg(j), snippetText);
-                }
-                if (!snippetKeySequence.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetKeySequence_%1").arg(j), snippetKeySequence);
-                }
-                if (!snippetKeyword.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetKeyword_%1").arg(j), snippetKeyword);
-                }
-                if (!snippetSubject.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetSubject_%1").arg(j), snippetSubject);
-                }
-                if (!snippetTo.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetTo_%1").arg(j), snippetTo);
-                }
-                if (!snippetCc.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetCc_%1").arg(j), snippetCc);
-                }
-                if (!snippetBcc.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetBcc_%1").arg(j), snippetBcc);
-                }
-                if (!snippetAttachment.isEmpty()) {
-                    snippetConfigGroup.writeEntry(QStringLiteral("snippetAttachment_%1").arg(j), snippetAttachment);
-                }
-            }
+    if (!fullSave) {
+        for (int i = groupCount; i < mSavedGroupCount; ++i) {
+            config->deleteGroup(QStringLiteral("SnippetGroup_%1").arg(i));
         }
     }
 
-    {
+    if (fullSave || mSavedVariablesDirty) {
+        if (!fullSave) {
+            config->deleteGroup(QStringLiteral("SavedVariablesPart"));
+        }
         KConfigGroup savedVariableConfigGroup = config->group("SavedVariablesPart");
+        writeSavedVariables(savedVariableConfigGroup);
+    }
+    config->sync();
 
-        const int variablesCount = mSavedVariables.count();
-        savedVariableConfigGroup.writeEntry("variablesCount", variablesCount);
-
-        int counter = 0;
-        QMap<QString, QString>::const_iterator it = mSavedVariables.cbegin();
-        const QMap<QString, QString>::const_iterator itEnd = mSavedVariables.cend();
-        for (; it != itEnd; ++it) {
-            savedVariableConfigGroup.writeEntry(QStringLiteral("variableName_%1").arg(counter), it.key());
-            savedVariableConfigGroup.writeEntry(QStringLiteral("variableValue_%1").arg(counter), it.value());
-            counter++;
+    if (defaultFile) {
+        mSaveTimer->stop();
+        mDirtyGroups.clear();
+        mDirtyGroupsFrom = -1;
+        mSavedVariablesDirty = false;
+        mFullSaveRequired = false;
+        mSavedGroupCount = groupCount;
+        if (mSnapshotEnabled) {
+            writeSnapshot();
         }
     }
-    config->sync();
 }
 
 #include "moc_snippetsmodel.cpp"
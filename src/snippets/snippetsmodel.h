@@ -10,11 +10,16 @@
 #pragma once
 
 #include "mailcommon_export.h"
+#include <KSharedConfig>
 #include <QAbstractItemModel>
 #include <QKeySequence>
+#include <QSet>
+#include <memory>
+class QTimer;
 namespace MailCommon
 {
 class SnippetItem;
+class SnippetsIndex;
 /*!
  * \brief The SnippetsInfo struct
  * \author Laurent Montel <montel@kde.org>
@@ -184,6 +189,35 @@ public:
      */
     void load(const QString &filename = QString());
 
+    /*!
+     * Schedules a save of the default snippet file.
+     *
+     * Calls made within the debounce interval are coalesced into a single
+     * write, and only the groups modified since the last save are rewritten.
+     */
+    void scheduleSave();
+    /*!
+     * Writes pending changes to the default snippet file immediately.
+     */
+    void flushPendingSave();
+    /*!
+     * Returns whether the model holds changes not yet written to the default snippet file.
+     */
+    [[nodiscard]] bool hasPendingChanges() const;
+
+    /*!
+     * Sets whether a binary snapshot of the snippets is written next to the
+     * configuration file and used by load() when it is still up to date.
+     * Enabled by default.
+     *
+     * \param enabled True to use the binary snapshot, false otherwise
+     */
+    void setSnapshotEnabled(bool enabled);
+    /*!
+     * Returns whether the binary snapshot is used.
+     */
+    [[nodiscard]] bool snapshotEnabled() const;
+
     /*!
      * Returns the saved variables map.
      *
@@ -204,6 +238,28 @@ public:
      */
     [[nodiscard]] QList<SnippetsInfo> snippetsInfo() const;
 
+    /*!
+     * Returns the snippets whose keyword is exactly \a keyword.
+     *
+     * \param keyword The keyword typed in the editor
+     * \return The model indexes of the matching snippets, in model order
+     */
+    [[nodiscard]] QModelIndexList snippetsForKeyword(const QString &keyword) const;
+    /*!
+     * Returns the snippets whose name starts with \a prefix, ignoring case.
+     *
+     * \param prefix The beginning of the snippet name
+     * \return The model indexes of the matching snippets, in model order
+     */
+    [[nodiscard]] QModelIndexList snippetsWithNamePrefix(const QString &prefix) const;
+    /*!
+     * Returns the snippets whose name or text contains \a text, ignoring case.
+     *
+     * \param text The text to search for
+     * \return The model indexes of the matching snippets, in model order
+     */
+    [[nodiscard]] QModelIndexList searchSnippets(const QString &text) const;
+
 protected:
     /*!
      * Inserts new rows into the model.
@@ -271,8 +327,25 @@ private:
                                             const QString &cc,
                                             const QString &bcc,
                                             const QString &attachment);
+    MAILCOMMON_NO_EXPORT void markGroupDirty(const QModelIndex &index);
+    MAILCOMMON_NO_EXPORT void indexSnippet(const SnippetItem *item);
+    MAILCOMMON_NO_EXPORT void unindexItem(const SnippetItem *item);
+    [[nodiscard]] MAILCOMMON_NO_EXPORT QModelIndexList indexesForSnippets(const QList<quintptr> &ids) const;
+    MAILCOMMON_NO_EXPORT void writeGroup(KConfigGroup &group, const QModelIndex &groupIndex) const;
+    MAILCOMMON_NO_EXPORT void writeSavedVariables(KConfigGroup &group) const;
+    [[nodiscard]] MAILCOMMON_NO_EXPORT bool loadSnapshot();
+    MAILCOMMON_NO_EXPORT void writeSnapshot() const;
     SnippetItem *mRootItem = nullptr;
+    std::unique_ptr<SnippetsIndex> const mIndex;
     QMap<QString, QString> mSavedVariables;
+    KSharedConfig::Ptr mConfig;
+    QTimer *const mSaveTimer;
+    QSet<const SnippetItem *> mDirtyGroups;
+    int mDirtyGroupsFrom = -1;
+    int mSavedGroupCount = 0;
+    bool mSavedVariablesDirty = false;
+    bool mFullSaveRequired = true;
+    bool mSnapshotEnabled = true;
 };
 }
 Q_DECLARE_TYPEINFO(MailCommon::SnippetsInfo, Q_RELOCATABLE_TYPE);
@@ -0,0 +1,112 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "snippettemplate.h"
+
+using namespace MailCommon;
+
+namespace
+{
+// The characters allowed in a variable name, see SnippetTemplate
+bool isVariableCharacter(QChar c)
+{
+    return (c >= u'a' && c <= u'z') || (c >= u'A' && c <= u'Z') || (c >= u'0' && c <= u'9') || c == u'-' || c == u'_' || c.isSpace();
+}
+}
+
+SnippetTemplate::SnippetTemplate(const QString &text)
+{
+    setText(text);
+}
+
+void SnippetTemplate::setText(const QString &text)
+{
+    mText = text;
+    mSegments.clear();
+    mVariables.clear();
+
+    const qsizetype size = mText.size();
+    qsizetype literalStart = 0;
+    qsizetype pos = mText.indexOf(u'$');
+    while (pos >= 0) {
+        const qsizetype end = mText.indexOf(u'$', pos + 1);
+        if (end < 0) {
+            break;
+        }
+        bool isVariable = true;
+        for (qsizetype i = pos + 1; i < end; ++i) {
+            if (!isVariableCharacter(mText.at(i))) {
+                isVariable = false;
+                break;
+            }
+        }
+        if (!isVariable) {
+            // A lone dollar sign, the next one may start a variable
+            pos = end;
+            continue;
+        }
+
+        if (pos > literalStart) {
+            mSegments.append({literalStart, pos - literalStart});
+        }
+        if (end == pos + 1) {
+            // "$$" stands for a single dollar sign
+            mSegments.append({pos, 1});
+        } else {
+            const QString name = mText.mid(pos, end + 1 - pos);
+            qsizetype variable = mVariables.indexOf(name);
+            if (variable < 0) {
+                variable = mVariables.size();
+                mVariables.append(name);
+            }
+            mSegments.append({pos, end + 1 - pos, variable});
+        }
+        literalStart = end + 1;
+        pos = mText.indexOf(u'$', literalStart);
+    }
+    if (literalStart < size) {
+        mSegments.append({literalStart, size - literalStart});
+    }
+}
+
+QString SnippetTemplate::text() const
+{
+    return mText;
+}
+
+QStringList SnippetTemplate::variables() const
+{
+    return mVariables;
+}
+
+QString SnippetTemplate::expand(const QMap<QString, QString> &values) const
+{
+    if (mSegments.size() == 1 && mSegments.constFirst().variable < 0 && mSegments.constFirst().length == mText.size()) {
+        return mText;
+    }
+
+    // Look each variable up once, however often it occurs
+    QStringList variableValues;
+    variableValues.reserve(mVariables.size());
+    for (const QString &variable : mVariables) {
+        variableValues.append(values.value(variable));
+    }
+    qsizetype resultSize = 0;
+    for (const Segment &segment : mSegments) {
+        resultSize += segment.variable < 0 ? segment.length : variableValues.at(segment.variable).size();
+    }
+
+    QString result;
+    result.reserve(resultSize);
+    for (const Segment &segment : mSegments) {
+        if (segment.variable < 0) {
+            result += QStringView(mText).mid(segment.start, segment.length);
+        } else {
+            result += variableValues.at(segment.variable);
+        }
+    }
+    return result;
+}
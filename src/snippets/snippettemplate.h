@@ -0,0 +1,68 @@
+/*
+  SPDX-FileCopyrightText: 2026 Laurent Montel <montel@kde.org>
+
+  SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "mailcommon_private_export.h"
+
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+namespace MailCommon
+{
+/**
+ * @short The text of a snippet, compiled for variable expansion.
+ *
+ * Variables are written between dollar signs, e.g. $name$, and "$$" stands
+ * for a single dollar sign. The text is tokenized once into literal spans
+ * and variable slots, so that expanding it is a single concatenation pass
+ * whatever the number of variables.
+ */
+class MAILCOMMON_TESTS_EXPORT SnippetTemplate
+{
+public:
+    /**
+     * Creates a template for @p text.
+     */
+    explicit SnippetTemplate(const QString &text = QString());
+
+    /**
+     * Compiles the new @p text.
+     */
+    void setText(const QString &text);
+
+    /**
+     * Returns the text of the template.
+     */
+    [[nodiscard]] QString text() const;
+
+    /**
+     * Returns the names of the variables of the template, with their dollar
+     * signs, in the order of their first occurrence and without duplicates.
+     */
+    [[nodiscard]] QStringList variables() const;
+
+    /**
+     * Returns the text with every variable replaced by its value in @p values.
+     * Variables without a value are replaced by an empty string.
+     */
+    [[nodiscard]] QString expand(const QMap<QString, QString> &values) const;
+
+private:
+    struct Segment {
+        qsizetype start = 0;
+        qsizetype length = 0;
+        // Index in mVariables, -1 for a literal span
+        qsizetype variable = -1;
+    };
+
+    QString mText;
+    QList<Segment> mSegments;
+    QStringList mVariables;
+};
+}